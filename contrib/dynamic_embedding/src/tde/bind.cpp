@@ -1,5 +1,6 @@
 #include <torch/torch.h>
 
+#include "tde/details/trace_replay.h"
 #include "tde/id_transformer.h"
 #include "tde/ps.h"
 
@@ -11,9 +12,26 @@ TORCH_LIBRARY(tde, m) {
     details::IORegistry::Instance().RegisterPlugin(name.c_str());
   });
 
+  m.def(
+      "replay",
+      [](const std::string& trace_path,
+         const std::string& io_config,
+         bool recorded_pace,
+         int64_t max_in_flight) {
+        return details::Replay(
+            details::ReadTrace(trace_path),
+            io_config,
+            details::ReplayOption{
+                .recorded_pace_ = recorded_pace,
+                .max_in_flight_ = static_cast<uint32_t>(max_in_flight),
+            });
+      });
+
   m.class_<TransformResult>("TransformResult")
       .def_readonly("success", &TransformResult::success_)
-      .def_readonly("ids_to_fetch", &TransformResult::ids_to_fetch_);
+      .def_readonly("ids_to_fetch", &TransformResult::ids_to_fetch_)
+      .def_readonly("num_transformed", &TransformResult::num_transformed_)
+      .def_readonly("num_to_evict", &TransformResult::num_to_evict_);
 
   m.class_<TensorList>("TensorList")
       .def(torch::init([]() { return c10::make_intrusive<TensorList>(); }))
@@ -28,24 +46,45 @@ TORCH_LIBRARY(tde, m) {
             num_embedding, std::move(json));
       }))
       .def("transform", &IDTransformer::Transform)
+      .def("preload", &IDTransformer::Preload)
       .def("evict", &IDTransformer::Evict)
-      .def("save", &IDTransformer::Save);
+      .def("evict_at_least", &IDTransformer::EvictAtLeast)
+      .def("save", &IDTransformer::Save)
+      .def("release", &IDTransformer::Release)
+      .def("ranked", &IDTransformer::Ranked);
 
   m.class_<LocalShardList>("LocalShardList")
       .def(torch::init([]() { return c10::make_intrusive<LocalShardList>(); }))
       .def("append", &LocalShardList::emplace_back);
 
   m.class_<FetchHandle>("FetchHandle").def("wait", &FetchHandle::Wait);
+  m.class_<EvictHandle>("EvictHandle").def("wait", &EvictHandle::Wait);
+  m.class_<PreloadHandle>("PreloadHandle")
+      .def("num_ids", &PreloadHandle::NumIds)
+      .def("num_loaded", &PreloadHandle::NumLoaded)
+      .def("wait", &PreloadHandle::Wait);
 
   m.class_<PS>("PS")
-      .def(torch::init<
-           std::string,
-           c10::intrusive_ptr<LocalShardList>,
-           int64_t,
-           int64_t,
-           std::string,
-           int64_t>())
+      .def(torch::init([](const std::string& table_name,
+                          c10::intrusive_ptr<LocalShardList> shards,
+                          int64_t col_size,
+                          int64_t num_optimizer_stats,
+                          const std::string& io_config,
+                          int64_t chunk_size,
+                          const std::string& config) {
+        return c10::make_intrusive<PS>(
+            table_name,
+            std::move(shards),
+            col_size,
+            num_optimizer_stats,
+            io_config,
+            chunk_size,
+            nlohmann::json::parse(config));
+      }))
       .def("fetch", &PS::Fetch)
-      .def("evict", &PS::Evict);
+      .def("preload", &PS::Preload)
+      .def("evict", &PS::Evict)
+      .def("evict_async", &PS::EvictAsync)
+      .def("stats", &PS::Stats);
 }
 } // namespace tde
@@ -0,0 +1,77 @@
+#include "tde/details/adaptive_chunk.h"
+#include <algorithm>
+
+namespace tde::details {
+
+// The weight of a sample in the moving averages, as the smoothed RTT of TCP.
+static constexpr double k_sample_weight = 0.125;
+
+AdaptiveChunkSize::AdaptiveChunkSize(
+    uint32_t initial_size,
+    AdaptiveChunkOption opt)
+    : opt_(opt) {
+  TORCH_CHECK(opt_.min_size_ != 0, "min chunk size must not be zero");
+  TORCH_CHECK(
+      opt_.min_size_ <= opt_.max_size_,
+      "min chunk size ",
+      opt_.min_size_,
+      " is larger than max chunk size ",
+      opt_.max_size_);
+  TORCH_CHECK(
+      0 < opt_.decrease_factor_ && opt_.decrease_factor_ < 1,
+      "decrease factor must be in (0, 1)");
+  initial_size = std::clamp(initial_size, opt_.min_size_, opt_.max_size_);
+  if (opt_.increase_step_ == 0) {
+    opt_.increase_step_ = std::max<uint32_t>(initial_size / 8, 1);
+  }
+  size_ = initial_size;
+}
+
+void AdaptiveChunkSize::Record(uint32_t size, uint64_t latency_us) {
+  std::lock_guard<std::mutex> lock(mu_);
+  double latency = static_cast<double>(std::max<uint64_t>(latency_us, 1));
+  double throughput = size * 1e6 / latency;
+  if (num_samples_++ == 0) {
+    latency_us_ = latency;
+    throughput_ = throughput;
+  } else {
+    latency_us_ += k_sample_weight * (latency - latency_us_);
+    throughput_ += k_sample_weight * (throughput - throughput_);
+  }
+  if (!enabled()) {
+    return;
+  }
+
+  uint32_t current = size_.load(std::memory_order_relaxed);
+  if (size != current) {
+    return;
+  }
+  if (latency_us > opt_.target_latency_us_) {
+    auto decreased = static_cast<uint32_t>(current * opt_.decrease_factor_);
+    decreased = std::max(decreased, opt_.min_size_);
+    if (decreased != current) {
+      size_.store(decreased, std::memory_order_relaxed);
+      ++num_decreases_;
+    }
+  } else {
+    uint64_t increased = static_cast<uint64_t>(current) + opt_.increase_step_;
+    increased = std::min<uint64_t>(increased, opt_.max_size_);
+    if (increased != current) {
+      size_.store(static_cast<uint32_t>(increased), std::memory_order_relaxed);
+      ++num_increases_;
+    }
+  }
+}
+
+void AdaptiveChunkSize::Export(
+    const std::string& prefix,
+    c10::Dict<std::string, double>& out) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  out.insert_or_assign(prefix + ".size", Get());
+  out.insert_or_assign(prefix + ".latency_us", latency_us_);
+  out.insert_or_assign(prefix + ".throughput", throughput_);
+  out.insert_or_assign(prefix + ".num_increases", num_increases_);
+  out.insert_or_assign(prefix + ".num_decreases", num_decreases_);
+}
+
+} // namespace tde::details
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+struct AdaptiveChunkOption {
+  uint32_t min_size_{1};
+  uint32_t max_size_{UINT32_MAX};
+  // 0 disables the adaption, i.e., the size stays the initial one.
+  uint32_t target_latency_us_{0};
+  // The size added after a chunk within the target. 0 for 1/8 of the
+  // initial size.
+  uint32_t increase_step_{0};
+  // The size is multiplied by it after a chunk over the target.
+  double decrease_factor_{0.5};
+};
+
+/**
+ * The size of the chunks of a pipeline, adapted by AIMD toward a target
+ * latency of a chunk.
+ *
+ * The size grows by a step after each chunk done within the target, and is
+ * cut by a factor after a chunk over it, within [min_size, max_size]. Larger
+ * chunks cost fewer round trips, smaller ones keep more chunks in flight and
+ * a slow chunk short. The unit of the size is up to the pipeline, e.g., ids
+ * or values.
+ *
+ * Only the chunks of the current size change it, so the chunks in flight
+ * when it changes, and the partial chunks, e.g., the last one of a request,
+ * do not change it again.
+ *
+ * `Get` is lock-free. `Record` can be called concurrently.
+ */
+class AdaptiveChunkSize {
+ public:
+  AdaptiveChunkSize(uint32_t initial_size, AdaptiveChunkOption opt);
+
+  AdaptiveChunkSize(const AdaptiveChunkSize&) = delete;
+  AdaptiveChunkSize& operator=(const AdaptiveChunkSize&) = delete;
+
+  [[nodiscard]] bool enabled() const {
+    return opt_.target_latency_us_ != 0;
+  }
+
+  [[nodiscard]] uint32_t Get() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Adapt the size by a chunk of size done in latency_us.
+   */
+  void Record(uint32_t size, uint64_t latency_us);
+
+  /**
+   * Add `<prefix>.size`, the current size, `.latency_us` and `.throughput`,
+   * the moving averages of the latency of a chunk and of the size done per
+   * second, and `.num_increases` and `.num_decreases` to out.
+   */
+  void Export(const std::string& prefix, c10::Dict<std::string, double>& out)
+      const;
+
+ private:
+  AdaptiveChunkOption opt_;
+  std::atomic<uint32_t> size_;
+  mutable std::mutex mu_;
+  double latency_us_{0};
+  double throughput_{0};
+  uint64_t num_samples_{0};
+  uint64_t num_increases_{0};
+  uint64_t num_decreases_{0};
+};
+
+} // namespace tde::details
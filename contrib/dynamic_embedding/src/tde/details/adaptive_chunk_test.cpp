@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include "tde/details/adaptive_chunk.h"
+
+namespace tde::details {
+
+TEST(TDE, AdaptiveChunkSize_aimd) {
+  AdaptiveChunkSize chunk(
+      64,
+      AdaptiveChunkOption{
+          .min_size_ = 16,
+          .max_size_ = 80,
+          .target_latency_us_ = 1000,
+          .increase_step_ = 8,
+      });
+  ASSERT_TRUE(chunk.enabled());
+  ASSERT_EQ(chunk.Get(), 64);
+
+  // Additive increase up to the max.
+  chunk.Record(64, 500);
+  ASSERT_EQ(chunk.Get(), 72);
+  chunk.Record(72, 500);
+  chunk.Record(80, 500);
+  ASSERT_EQ(chunk.Get(), 80);
+
+  // Multiplicative decrease down to the min.
+  chunk.Record(80, 2000);
+  ASSERT_EQ(chunk.Get(), 40);
+  chunk.Record(40, 2000);
+  chunk.Record(20, 2000);
+  ASSERT_EQ(chunk.Get(), 16);
+
+  c10::Dict<std::string, double> stats;
+  chunk.Export("chunk", stats);
+  ASSERT_EQ(stats.at("chunk.size"), 16);
+  ASSERT_EQ(stats.at("chunk.num_increases"), 2);
+  ASSERT_EQ(stats.at("chunk.num_decreases"), 3);
+  ASSERT_GT(stats.at("chunk.latency_us"), 500);
+  ASSERT_GT(stats.at("chunk.throughput"), 0);
+}
+
+TEST(TDE, AdaptiveChunkSize_stale_chunks) {
+  AdaptiveChunkSize chunk(
+      64,
+      AdaptiveChunkOption{
+          .min_size_ = 1,
+          .max_size_ = 1024,
+          .target_latency_us_ = 1000,
+          .increase_step_ = 8,
+      });
+  // The chunks in flight when the size is cut do not cut it again.
+  chunk.Record(64, 2000);
+  ASSERT_EQ(chunk.Get(), 32);
+  chunk.Record(64, 2000);
+  chunk.Record(64, 500);
+  ASSERT_EQ(chunk.Get(), 32);
+
+  // Nor do the chunks sent before it grows grow it again.
+  chunk.Record(32, 500);
+  ASSERT_EQ(chunk.Get(), 40);
+  chunk.Record(32, 500);
+  ASSERT_EQ(chunk.Get(), 40);
+  // Nor a partial chunk.
+  chunk.Record(7, 2000);
+  ASSERT_EQ(chunk.Get(), 40);
+}
+
+TEST(TDE, AdaptiveChunkSize_disabled) {
+  AdaptiveChunkSize chunk(100, AdaptiveChunkOption{});
+  ASSERT_FALSE(chunk.enabled());
+  chunk.Record(100, 1000000);
+  chunk.Record(100, 1);
+  ASSERT_EQ(chunk.Get(), 100);
+
+  c10::Dict<std::string, double> stats;
+  chunk.Export("chunk", stats);
+  ASSERT_EQ(stats.at("chunk.size"), 100);
+  ASSERT_EQ(stats.at("chunk.num_decreases"), 0);
+}
+
+} // namespace tde::details
@@ -0,0 +1,98 @@
+#include "tde/details/bloom_filter.h"
+#include <algorithm>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+/**
+ * The finalizer of splitmix64, see `HashRing`.
+ */
+static uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// Odd multipliers picking the bit of each word of a block from the same
+// 32 bits of hash.
+static constexpr uint32_t k_salts[BloomFilter::k_block_words] = {
+    0x47b6137bU,
+    0x44974d91U,
+    0x8824ad5bU,
+    0xa2b7289dU,
+    0x705495c7U,
+    0x2df1424bU,
+    0x9efc4947U,
+    0x5c6bfb31U,
+};
+
+BloomFilter::BloomFilter(uint64_t expected_ids, uint32_t bits_per_id) {
+  TORCH_CHECK(expected_ids != 0, "expected_ids must not be zero");
+  TORCH_CHECK(bits_per_id != 0, "bits_per_id must not be zero");
+  uint64_t block_bits = k_block_words * 64;
+  uint64_t min_blocks = (expected_ids * bits_per_id + block_bits - 1) /
+      block_bits;
+  num_blocks_ = 1;
+  while (num_blocks_ < min_blocks) {
+    num_blocks_ <<= 1;
+  }
+  TORCH_CHECK(
+      num_blocks_ <= (1ULL << 32), "too many expected ids ", expected_ids);
+  page_blocks_ = static_cast<uint32_t>(
+      std::min<uint64_t>(num_blocks_, k_max_page_blocks));
+  words_.resize(num_blocks_ * k_block_words);
+  dirty_.resize(num_pages());
+}
+
+void BloomFilter::Insert(int64_t id) {
+  uint64_t hash = Mix(static_cast<uint64_t>(id));
+  uint64_t block = (hash >> 32) & (num_blocks_ - 1);
+  uint64_t* words = words_.data() + block * k_block_words;
+  auto low = static_cast<uint32_t>(hash);
+  bool changed = false;
+  for (uint32_t i = 0; i < k_block_words; ++i) {
+    uint64_t bit = 1ULL << ((low * k_salts[i]) >> 26);
+    changed |= (words[i] & bit) == 0;
+    words[i] |= bit;
+  }
+  if (changed) {
+    dirty_[block / page_blocks_] = true;
+  }
+}
+
+bool BloomFilter::MayContain(int64_t id) const {
+  uint64_t hash = Mix(static_cast<uint64_t>(id));
+  uint64_t block = (hash >> 32) & (num_blocks_ - 1);
+  const uint64_t* words = words_.data() + block * k_block_words;
+  auto low = static_cast<uint32_t>(hash);
+  for (uint32_t i = 0; i < k_block_words; ++i) {
+    if ((words[i] & (1ULL << ((low * k_salts[i]) >> 26))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BloomFilter::MergePage(uint32_t page, const uint64_t* words) {
+  TORCH_CHECK(page < num_pages(), "page ", page, " out of range");
+  uint64_t* dst = words_.data() + page * page_words();
+  for (uint32_t i = 0; i < page_words(); ++i) {
+    dst[i] |= words[i];
+  }
+}
+
+std::vector<uint32_t> BloomFilter::TakeDirtyPages() {
+  std::vector<uint32_t> pages;
+  for (uint32_t i = 0; i < dirty_.size(); ++i) {
+    if (dirty_[i]) {
+      pages.emplace_back(i);
+      dirty_[i] = false;
+    }
+  }
+  return pages;
+}
+
+} // namespace tde::details
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "tcb/span.hpp"
+
+namespace tde::details {
+
+/**
+ * A blocked bloom filter of global ids.
+ *
+ * Each id sets one bit in each of the 8 words of a 64 bytes block, so a
+ * lookup touches one cache line. With 16 bits per id, about 0.1% of the ids
+ * never inserted are reported as maybe present. There are no false
+ * negatives.
+ *
+ * The blocks are grouped into pages, the unit of persistence. The pages
+ * changed by `Insert` are tracked until `TakeDirtyPages`.
+ *
+ * Not thread safe.
+ */
+class BloomFilter {
+ public:
+  static constexpr uint32_t k_block_words = 8;
+  static constexpr uint32_t k_max_page_blocks = 1024;
+
+  /**
+   * @param expected_ids number of distinct ids the filter is sized for.
+   * The number of blocks is rounded up to a power of two.
+   */
+  explicit BloomFilter(uint64_t expected_ids, uint32_t bits_per_id = 16);
+
+  BloomFilter(const BloomFilter&) = delete;
+  BloomFilter& operator=(const BloomFilter&) = delete;
+
+  void Insert(int64_t id);
+
+  [[nodiscard]] bool MayContain(int64_t id) const;
+
+  [[nodiscard]] uint64_t num_blocks() const {
+    return num_blocks_;
+  }
+
+  [[nodiscard]] uint32_t num_pages() const {
+    return static_cast<uint32_t>(num_blocks_ / page_blocks_);
+  }
+
+  /**
+   * Number of 64 bits words of a page.
+   */
+  [[nodiscard]] uint32_t page_words() const {
+    return page_blocks_ * k_block_words;
+  }
+
+  [[nodiscard]] tcb::span<const uint64_t> Page(uint32_t page) const {
+    return {words_.data() + page * page_words(), page_words()};
+  }
+
+  /**
+   * Add the ids of a page of another filter of the same size, e.g., the
+   * persisted one.
+   */
+  void MergePage(uint32_t page, const uint64_t* words);
+
+  /**
+   * @return the pages changed since the last call, in ascending order.
+   */
+  std::vector<uint32_t> TakeDirtyPages();
+
+ private:
+  uint64_t num_blocks_;
+  uint32_t page_blocks_;
+  std::vector<uint64_t> words_;
+  std::vector<bool> dirty_;
+};
+
+} // namespace tde::details
@@ -0,0 +1,44 @@
+#include "gtest/gtest.h"
+#include "tde/details/bloom_filter.h"
+
+namespace tde::details {
+
+TEST(TDE, BloomFilter_no_false_negative) {
+  BloomFilter filter(10000);
+  for (int64_t id = 0; id < 10000; ++id) {
+    filter.Insert(id * 7919);
+  }
+  for (int64_t id = 0; id < 10000; ++id) {
+    ASSERT_TRUE(filter.MayContain(id * 7919));
+  }
+  int num_false_positives = 0;
+  for (int64_t id = 0; id < 100000; ++id) {
+    num_false_positives += filter.MayContain(-id - 1);
+  }
+  ASSERT_LT(num_false_positives, 1000);
+}
+
+TEST(TDE, BloomFilter_pages) {
+  // 2048 blocks in 2 pages.
+  BloomFilter filter(65536);
+  ASSERT_EQ(filter.num_blocks(), 2048);
+  ASSERT_EQ(filter.num_pages(), 2);
+  ASSERT_EQ(filter.page_words(), 8192);
+  ASSERT_TRUE(filter.TakeDirtyPages().empty());
+
+  filter.Insert(42);
+  auto pages = filter.TakeDirtyPages();
+  ASSERT_EQ(pages.size(), 1);
+  ASSERT_TRUE(filter.TakeDirtyPages().empty());
+  // Inserting again changes nothing.
+  filter.Insert(42);
+  ASSERT_TRUE(filter.TakeDirtyPages().empty());
+
+  BloomFilter loaded(65536);
+  ASSERT_FALSE(loaded.MayContain(42));
+  loaded.MergePage(pages[0], filter.Page(pages[0]).data());
+  ASSERT_TRUE(loaded.MayContain(42));
+  ASSERT_TRUE(loaded.TakeDirtyPages().empty());
+}
+
+} // namespace tde::details
@@ -88,12 +88,14 @@ class CachelineIDTransformer {
    * @param cache_ids [out] Cache ID vector
    * @param update update lambda. See `Update` doc.
    * @param fetch fetch lambda. See `Fetch` doc.
-   * @return true if all transformed, otherwise need eviction.
+   * @return number of global ids transformed. If it is less than
+   * global_ids.size(), the transformer is full and needs eviction, and the
+   * ids from it on are not transformed.
    */
   template <
       typename Update = decltype(transform_default::NoUpdate<LXURecord>),
       typename Fetch = decltype(transform_default::NoFetch)>
-  bool Transform(
+  int64_t Transform(
       tcb::span<const int64_t> global_ids,
       tcb::span<int64_t> cache_ids,
       Update update = transform_default::NoUpdate<LXURecord>,
@@ -101,6 +103,8 @@ class CachelineIDTransformer {
 
   void Evict(tcb::span<const int64_t> global_ids);
 
+  [[nodiscard]] bool Contains(int64_t global_id) const;
+
   CachelineIDTransformerIterator<LXURecord> Iterator() const {
     return CachelineIDTransformerIterator<LXURecord>(
         cache_values_.get(), cache_values_.get() + num_groups_ * group_size_);
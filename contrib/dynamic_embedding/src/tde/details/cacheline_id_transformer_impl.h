@@ -47,7 +47,7 @@ template <
     typename BitMap,
     typename Hash>
 template <typename Update, typename Fetch>
-inline bool CachelineIDTransformer<
+inline int64_t CachelineIDTransformer<
     LXURecord,
     NumCacheline,
     CachelineSize,
@@ -81,7 +81,7 @@ inline bool CachelineIDTransformer<
       } else { // empty slot
         // The transformer is full.
         if (C10_UNLIKELY(bitmap_.Full())) {
-          return false;
+          return static_cast<int64_t>(i);
         }
         cache_id = bitmap_.NextFreeBit();
         cache_value.global_id_not_ = global_id_not;
@@ -94,10 +94,10 @@ inline bool CachelineIDTransformer<
     }
 
     if (k == group_size_) {
-      return false;
+      return static_cast<int64_t>(i);
     }
   }
-  return true;
+  return static_cast<int64_t>(global_ids.size());
 }
 
 template <
@@ -132,4 +132,30 @@ inline void CachelineIDTransformer<
   }
 }
 
+template <
+    typename LXURecord,
+    int64_t NumCacheline,
+    int64_t CachelineSize,
+    typename BitMap,
+    typename Hash>
+inline bool CachelineIDTransformer<
+    LXURecord,
+    NumCacheline,
+    CachelineSize,
+    BitMap,
+    Hash>::Contains(int64_t global_id) const {
+  auto [group_id, intra_id] = FindGroupIndex(global_id);
+  int64_t global_id_not = ~global_id;
+  for (int64_t k = 0; k < group_size_; k++) {
+    int64_t offset = group_id * group_size_ + (intra_id + k) % group_size_;
+    int64_t xor_value = global_id_not ^ cache_values_[offset].global_id_not_;
+    if (xor_value < 0) { // not exist
+      return false;
+    } else if (xor_value == 0) { // found slot
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace tde::details
@@ -8,7 +8,7 @@ TEST(tde, CachelineThreadedIDTransformer_NoFilter) {
   const int64_t global_ids[5] = {100, 101, 100, 102, 101};
   int64_t cache_ids[5];
   int64_t expected_cache_ids[5] = {0, 1, 0, 2, 1};
-  ASSERT_TRUE(transformer.Transform(global_ids, cache_ids));
+  ASSERT_EQ(transformer.Transform(global_ids, cache_ids), 5);
   for (size_t i = 0; i < 5; i++) {
     ASSERT_EQ(expected_cache_ids[i], cache_ids[i]);
   }
@@ -19,10 +19,12 @@ TEST(tde, CachelineThreadedIDTransformer_Full) {
   const int64_t global_ids[5] = {100, 101, 102, 103, 104};
   int64_t cache_ids[5];
   int64_t expected_cache_ids[5] = {0, 1, 2, 3, -1};
-  EXPECT_FALSE(transformer.Transform(global_ids, cache_ids));
+  EXPECT_EQ(transformer.Transform(global_ids, cache_ids), 4);
   for (size_t i = 0; i < 4; i++) {
     EXPECT_EQ(expected_cache_ids[i], cache_ids[i]);
   }
+  EXPECT_TRUE(transformer.Contains(103));
+  EXPECT_FALSE(transformer.Contains(104));
 }
 
 TEST(tde, CachelineThreadedIDTransformer_Evict) {
@@ -30,7 +32,7 @@ TEST(tde, CachelineThreadedIDTransformer_Evict) {
   const int64_t global_ids[5] = {100, 101, 102, 103, 104};
   int64_t cache_ids[5];
 
-  EXPECT_FALSE(transformer.Transform(global_ids, cache_ids));
+  EXPECT_EQ(transformer.Transform(global_ids, cache_ids), 4);
 
   const int64_t evict_global_ids[2] = {100, 102};
   transformer.Evict(evict_global_ids);
@@ -38,7 +40,7 @@ TEST(tde, CachelineThreadedIDTransformer_Evict) {
   const int64_t new_global_ids[4] = {101, 102, 103, 104};
   int64_t new_cache_ids[4];
 
-  EXPECT_TRUE(transformer.Transform(new_global_ids, new_cache_ids));
+  EXPECT_EQ(transformer.Transform(new_global_ids, new_cache_ids), 4);
 
   int64_t expected_cache_ids[4] = {1, 0, 3, 2};
   for (size_t i = 0; i < 4; i++) {
@@ -51,7 +53,7 @@ TEST(tde, CachelineThreadedIDTransformer_Iterator) {
   const int64_t global_ids[5] = {100, 101, 100, 102, 101};
   int64_t cache_ids[5];
   int64_t expected_cache_ids[5] = {0, 1, 0, 2, 0};
-  ASSERT_TRUE(transformer.Transform(global_ids, cache_ids));
+  ASSERT_EQ(transformer.Transform(global_ids, cache_ids), 5);
 
   auto iterator = transformer.Iterator();
   for (size_t i = 0; i < 3; i++) {
@@ -0,0 +1,29 @@
+#include "file_io.h"
+#include "tde/details/io_registry.h"
+#include "tde/details/log_file_io.h"
+
+namespace tde::details {
+
+void RegisterFileIO() {
+  auto& reg = IORegistry::Instance();
+
+  {
+    IOProvider provider{};
+    provider.type_ = "file";
+    provider.Initialize = +[](const char* cfg) -> void* {
+      auto opt = log_file_io::Option::Parse(cfg);
+      return new log_file_io::LogFileIO(opt);
+    };
+    provider.Finalize = +[](void* inst) {
+      delete reinterpret_cast<log_file_io::LogFileIO*>(inst);
+    };
+    provider.Pull = +[](void* inst, IOPullParameter param) {
+      reinterpret_cast<log_file_io::LogFileIO*>(inst)->Pull(param);
+    };
+    provider.Push = +[](void* inst, IOPushParameter param) {
+      reinterpret_cast<log_file_io::LogFileIO*>(inst)->Push(param);
+    };
+    reg.Register(provider);
+  }
+}
+} // namespace tde::details
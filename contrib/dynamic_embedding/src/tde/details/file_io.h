@@ -0,0 +1,7 @@
+#pragma once
+
+namespace tde::details {
+
+extern void RegisterFileIO();
+
+}
@@ -0,0 +1,66 @@
+#include "tde/details/hash_ring.h"
+#include <algorithm>
+#include <unordered_set>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+/**
+ * The finalizer of splitmix64, which makes every bit of the result depend on
+ * every bit of x.
+ */
+static uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+HashRing::HashRing(
+    const std::vector<std::string>& nodes,
+    uint32_t num_virtual_nodes)
+    : num_nodes_(static_cast<uint32_t>(nodes.size())) {
+  TORCH_CHECK(!nodes.empty(), "hash ring needs at least one node");
+  TORCH_CHECK(num_virtual_nodes != 0, "num_virtual_nodes must not be zero");
+  std::unordered_set<std::string_view> names;
+  points_.reserve(nodes.size() * num_virtual_nodes);
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    TORCH_CHECK(names.emplace(nodes[i]).second, "duplicated node ", nodes[i]);
+    uint64_t node_hash = Hash(nodes[i]);
+    for (uint32_t j = 0; j < num_virtual_nodes; ++j) {
+      points_.emplace_back(Mix(node_hash + j), i);
+    }
+  }
+  std::sort(points_.begin(), points_.end());
+}
+
+uint32_t HashRing::Find(uint64_t key_hash) const {
+  auto it = std::lower_bound(
+      points_.begin(),
+      points_.end(),
+      key_hash,
+      [](const std::pair<uint64_t, uint32_t>& point, uint64_t hash) {
+        return point.first < hash;
+      });
+  if (it == points_.end()) {
+    it = points_.begin();
+  }
+  return it->second;
+}
+
+uint64_t HashRing::Hash(std::string_view str) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char ch : str) {
+    hash ^= static_cast<uint8_t>(ch);
+    hash *= 0x100000001b3ULL;
+  }
+  return Mix(hash);
+}
+
+uint64_t HashRing::Hash(uint64_t table_hash, int64_t global_id) {
+  return Mix(table_hash ^ Mix(static_cast<uint64_t>(global_id)));
+}
+
+} // namespace tde::details
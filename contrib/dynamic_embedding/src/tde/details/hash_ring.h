@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tde::details {
+
+/**
+ * A consistent hash ring of named nodes, e.g., `host:port` of redis servers.
+ *
+ * Each node is placed on the ring at `num_virtual_nodes` points, and a key is
+ * owned by the node of the first point at or after the hash of the key. When
+ * a node is added to a ring of n nodes, about 1/(n+1) of the keys move, all
+ * of them to the new node.
+ *
+ * The points only depend on the names of the nodes, not on their order.
+ */
+class HashRing {
+ public:
+  static constexpr uint32_t k_default_num_virtual_nodes = 160;
+
+  explicit HashRing(
+      const std::vector<std::string>& nodes,
+      uint32_t num_virtual_nodes = k_default_num_virtual_nodes);
+
+  [[nodiscard]] uint32_t num_nodes() const {
+    return num_nodes_;
+  }
+
+  /**
+   * @return the index of the node, in the nodes of the constructor, which
+   * owns the key of the given hash.
+   */
+  [[nodiscard]] uint32_t Find(uint64_t key_hash) const;
+
+  /**
+   * FNV-1a hash of str, mixed to spread over the ring.
+   */
+  static uint64_t Hash(std::string_view str);
+
+  /**
+   * Hash of a global id of a table, where table_hash is `Hash(table_name)`,
+   * which is computed once for all the global ids of a request.
+   */
+  static uint64_t Hash(uint64_t table_hash, int64_t global_id);
+
+ private:
+  uint32_t num_nodes_;
+  // (point, node index), sorted by point.
+  std::vector<std::pair<uint64_t, uint32_t>> points_;
+};
+
+} // namespace tde::details
@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "tde/details/hash_ring.h"
+
+namespace tde::details {
+
+TEST(TDE, hash_ring) {
+  HashRing ring({"a:6379", "b:6379", "c:6379"});
+  ASSERT_EQ(ring.num_nodes(), 3);
+  // The owners only depend on the names of the nodes.
+  HashRing reordered({"c:6379", "a:6379", "b:6379"});
+  constexpr static uint32_t reordered_index[] = {2, 0, 1};
+  uint64_t table_hash = HashRing::Hash("table");
+  std::vector<uint32_t> counts(3);
+  constexpr int64_t k_num_keys = 100000;
+  for (int64_t gid = 0; gid < k_num_keys; ++gid) {
+    auto hash = HashRing::Hash(table_hash, gid);
+    uint32_t node = ring.Find(hash);
+    ASSERT_EQ(node, ring.Find(hash));
+    ASSERT_EQ(reordered_index[reordered.Find(hash)], node);
+    ++counts[node];
+  }
+  for (auto count : counts) {
+    ASSERT_GT(count, k_num_keys / 3 * 0.8);
+    ASSERT_LT(count, k_num_keys / 3 * 1.2);
+  }
+
+  ASSERT_ANY_THROW(HashRing({}));
+  ASSERT_ANY_THROW(HashRing({"a:6379", "a:6379"}));
+}
+
+TEST(TDE, hash_ring_add_node) {
+  HashRing ring({"a", "b", "c"});
+  HashRing added({"a", "b", "c", "d"});
+  uint64_t table_hash = HashRing::Hash("table");
+  constexpr int64_t k_num_keys = 100000;
+  int64_t num_moved = 0;
+  for (int64_t gid = 0; gid < k_num_keys; ++gid) {
+    auto hash = HashRing::Hash(table_hash, gid);
+    uint32_t before = ring.Find(hash);
+    uint32_t after = added.Find(hash);
+    if (before != after) {
+      // Keys only move to the new node.
+      ASSERT_EQ(after, 3);
+      ++num_moved;
+    }
+  }
+  ASSERT_GT(num_moved, k_num_keys / 4 * 0.8);
+  ASSERT_LT(num_moved, k_num_keys / 4 * 1.2);
+}
+
+} // namespace tde::details
@@ -0,0 +1,65 @@
+#include "tde/details/histogram.h"
+#include <cmath>
+#include "tde/details/bits_op.h"
+
+namespace tde::details {
+
+uint32_t Histogram::BucketIndex(uint64_t value) {
+  if (value < k_num_sub_buckets) {
+    return value;
+  }
+  // value >> shift is in [k_num_sub_buckets, 2 * k_num_sub_buckets).
+  uint32_t shift = 63 - Clz(value) - k_sub_bucket_bits;
+  return shift * k_num_sub_buckets + (value >> shift);
+}
+
+uint64_t Histogram::BucketUpperBound(uint32_t index) {
+  if (index < k_num_sub_buckets) {
+    return index;
+  }
+  uint32_t shift = index / k_num_sub_buckets - 1;
+  uint64_t top = index - shift * k_num_sub_buckets;
+  return ((top + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value) {
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max &&
+         !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t Histogram::Quantile(double q) const {
+  uint64_t n = count();
+  if (n == 0) {
+    return 0;
+  }
+  auto target = std::max<uint64_t>(1, std::ceil(q * n));
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < k_num_buckets; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= target) {
+      return std::min(BucketUpperBound(i), max());
+    }
+  }
+  return max();
+}
+
+void Histogram::Export(
+    const std::string& prefix,
+    c10::Dict<std::string, double>& out) const {
+  uint64_t n = count();
+  out.insert_or_assign(prefix + ".count", n);
+  out.insert_or_assign(
+      prefix + ".mean", n == 0 ? 0 : static_cast<double>(sum()) / n);
+  out.insert_or_assign(prefix + ".p50", Quantile(0.5));
+  out.insert_or_assign(prefix + ".p90", Quantile(0.9));
+  out.insert_or_assign(prefix + ".p99", Quantile(0.99));
+  out.insert_or_assign(prefix + ".p999", Quantile(0.999));
+  out.insert_or_assign(prefix + ".max", max());
+}
+
+} // namespace tde::details
@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+/**
+ * A lock-free histogram of non-negative integers, e.g., latencies in
+ * microseconds.
+ *
+ * Like HdrHistogram, values are counted in log-linear buckets: each power of
+ * two range is divided into 2^k_sub_bucket_bits sub buckets, so the relative
+ * error of quantiles is at most 1/2^k_sub_bucket_bits, i.e., 12.5%. Values
+ * less than 2^(k_sub_bucket_bits + 1) are exact.
+ *
+ * Record is wait-free except for updating the max, and can be called
+ * concurrently. The reads are not synchronized with the records, so they are
+ * approximate snapshots.
+ */
+class Histogram {
+ public:
+  static constexpr uint32_t k_sub_bucket_bits = 3;
+  static constexpr uint32_t k_num_sub_buckets = 1 << k_sub_bucket_bits;
+  static constexpr uint32_t k_num_buckets =
+      (64 - k_sub_bucket_bits + 1) * k_num_sub_buckets;
+
+  void Record(uint64_t value);
+
+  [[nodiscard]] uint64_t count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] uint64_t sum() const {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] uint64_t max() const {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the upper bound of the bucket where the q-quantile is. 0 if the
+   * histogram is empty.
+   * @param q in [0, 1]
+   */
+  [[nodiscard]] uint64_t Quantile(double q) const;
+
+  /**
+   * Add `<prefix>.count`, `.mean`, `.p50`, `.p90`, `.p99`, `.p999` and
+   * `.max` to out.
+   */
+  void Export(const std::string& prefix, c10::Dict<std::string, double>& out)
+      const;
+
+  static uint32_t BucketIndex(uint64_t value);
+  /**
+   * The largest value in the bucket.
+   */
+  static uint64_t BucketUpperBound(uint32_t index);
+
+ private:
+  std::array<std::atomic<uint64_t>, k_num_buckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * Records the microseconds from construction to destruction.
+ */
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(Histogram& histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedLatency() {
+    histogram_.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start_)
+                          .count());
+  }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+  Histogram& histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace tde::details
@@ -0,0 +1,65 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tde/details/histogram.h"
+
+namespace tde::details {
+
+TEST(TDE, Histogram_buckets) {
+  // Small values are exact.
+  for (uint64_t v = 0; v < 2 * Histogram::k_num_sub_buckets; ++v) {
+    ASSERT_EQ(v, Histogram::BucketUpperBound(Histogram::BucketIndex(v)));
+  }
+  uint32_t last = 0;
+  for (uint64_t v : std::vector<uint64_t>{
+           17, 100, 1000, 12345, 1ULL << 40, (1ULL << 40) + 12345, ~0ULL}) {
+    uint32_t index = Histogram::BucketIndex(v);
+    ASSERT_LT(index, Histogram::k_num_buckets);
+    ASSERT_GE(index, last);
+    last = index;
+    uint64_t upper = Histogram::BucketUpperBound(index);
+    ASSERT_GE(upper, v);
+    // The relative error is bounded by the sub buckets.
+    ASSERT_LE(upper - v, v / Histogram::k_num_sub_buckets);
+    if (index > 0) {
+      ASSERT_LT(Histogram::BucketUpperBound(index - 1), v);
+    }
+  }
+  ASSERT_EQ(Histogram::BucketIndex(~0ULL), Histogram::k_num_buckets - 1);
+}
+
+TEST(TDE, Histogram_quantile) {
+  Histogram histogram;
+  ASSERT_EQ(histogram.Quantile(0.5), 0);
+  for (uint64_t v = 1; v <= 1000; ++v) {
+    histogram.Record(v);
+  }
+  ASSERT_EQ(histogram.count(), 1000);
+  ASSERT_EQ(histogram.sum(), 500500);
+  ASSERT_EQ(histogram.max(), 1000);
+  for (double q : {0.5, 0.9, 0.99}) {
+    double expect = q * 1000;
+    ASSERT_GE(histogram.Quantile(q), expect);
+    ASSERT_LE(histogram.Quantile(q), expect * 1.125);
+  }
+  ASSERT_EQ(histogram.Quantile(1), 1000);
+}
+
+TEST(TDE, Histogram_concurrent) {
+  Histogram histogram;
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram, t] {
+      for (uint64_t v = 0; v < 10000; ++v) {
+        histogram.Record(v * 4 + t);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(histogram.count(), 40000);
+  ASSERT_EQ(histogram.max(), 39999);
+}
+
+} // namespace tde::details
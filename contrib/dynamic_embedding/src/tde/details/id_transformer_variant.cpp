@@ -1,4 +1,6 @@
 #include "tde/details/id_transformer_variant.h"
+#include <algorithm>
+#include <tuple>
 #include <vector>
 
 namespace tde::details {
@@ -13,7 +15,21 @@ IDTransformer::IDTransformer(int64_t num_embeddings, nlohmann::json json)
 std::vector<int64_t> IDTransformer::Evict(int64_t num_to_evict) {
   // Get the ids to evict from lxu strategy.
   std::vector<int64_t> ids_to_evict = std::visit(
-      [&](auto&& s) { return strategy_.Evict(s.Iterator(), num_to_evict); },
+      [&](auto&& s) {
+        if (pins_.empty()) {
+          return strategy_.Evict(s.Iterator(), num_to_evict);
+        }
+        auto iterator = s.Iterator();
+        return strategy_.Evict(
+            [&]() {
+              auto val = iterator();
+              while (val.has_value() && pins_.count(val->cache_id_) != 0) {
+                val = iterator();
+              }
+              return val;
+            },
+            num_to_evict);
+      },
       var_);
   // get the cache id of the ids to evict.
   std::vector<int64_t> cache_ids(ids_to_evict.size());
@@ -49,6 +65,63 @@ std::vector<int64_t> IDTransformer::Save(int64_t time) {
       var_);
 }
 
+bool IDTransformer::Contains(int64_t global_id) const {
+  return std::visit(
+      [&](auto&& transformer) { return transformer.Contains(global_id); },
+      var_);
+}
+
+void IDTransformer::Pin(tcb::span<const int64_t> cache_ids) {
+  for (int64_t cache_id : cache_ids) {
+    ++pins_[cache_id];
+  }
+}
+
+void IDTransformer::Unpin(tcb::span<const int64_t> cache_ids) {
+  for (int64_t cache_id : cache_ids) {
+    auto it = pins_.find(cache_id);
+    TORCH_CHECK(it != pins_.end(), "cache id ", cache_id, " is not pinned");
+    if (--it->second == 0) {
+      pins_.erase(it);
+    }
+  }
+}
+
+std::vector<int64_t> IDTransformer::Ranked(int64_t num) {
+  // (frequency power, time, global id), the hottest first.
+  std::vector<std::tuple<int64_t, int64_t, int64_t>> items;
+  std::visit(
+      [&](auto&& s) {
+        auto iterator = s.Iterator();
+        while (true) {
+          auto val = iterator();
+          if (!val.has_value()) [[unlikely]] {
+            break;
+          }
+          items.emplace_back(
+              strategy_.FreqPower(val->lxu_record_),
+              strategy_.Time(val->lxu_record_),
+              val->global_id_);
+        }
+      },
+      var_);
+  size_t num_ranked = num < 0
+      ? items.size()
+      : std::min(items.size(), static_cast<size_t>(num));
+  std::partial_sort(
+      items.begin(),
+      items.begin() + num_ranked,
+      items.end(),
+      std::greater<>());
+  std::vector<int64_t> result;
+  result.reserve(2 * num_ranked);
+  for (size_t i = 0; i < num_ranked; ++i) {
+    result.emplace_back(std::get<2>(items[i]));
+    result.emplace_back(std::get<0>(items[i]));
+  }
+  return result;
+}
+
 IDTransformer::LXUStrategy::LXUStrategy(const nlohmann::json& json)
     : strategy_(MixedLFULRUStrategy(json.value("min_used_freq_power", 5))) {
   if (auto it = json.find("type"); it != json.end()) {
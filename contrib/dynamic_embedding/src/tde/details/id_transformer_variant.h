@@ -22,17 +22,57 @@ class IDTransformer {
    * @param cache_ids
    * @param fetch Callback when need fetch. By default, do nothing.
    * @return number elems transformed. If the Transformer is full and need to be
-   * evict. Then the return value is not equal to global_ids.size();
+   * evict. Then the return value is not equal to global_ids.size(), and the
+   * elems from the return value on are not transformed.
    */
   template <typename Fetch = decltype(transform_default::NoFetch)>
-  bool Transform(
+  int64_t Transform(
       tcb::span<const int64_t> global_ids,
       tcb::span<int64_t> cache_ids,
       Fetch fetch = transform_default::NoFetch);
 
+  /**
+   * Insert global ids ranked by hotness, e.g., by `Ranked` of a previous run,
+   * with their recorded frequency. The ids already in the transformer keep
+   * their records.
+   *
+   * @param freq_powers empty, or the frequency power of each global id.
+   * @param fetch called for the ids inserted, see `Transform`.
+   * @return number of global ids transformed, which stops at the first id
+   * that does not fit.
+   */
+  template <typename Fetch = decltype(transform_default::NoFetch)>
+  int64_t Preload(
+      tcb::span<const int64_t> global_ids,
+      tcb::span<const int64_t> freq_powers,
+      tcb::span<int64_t> cache_ids,
+      Fetch fetch = transform_default::NoFetch);
+
+  /**
+   * Evict the num_to_evict ids chosen by the LXU strategy, skipping the
+   * pinned ones.
+   * @return pairs of global id and cache id of the evicted ids.
+   */
   std::vector<int64_t> Evict(int64_t num_to_evict);
   std::vector<int64_t> Save(int64_t time);
 
+  [[nodiscard]] bool Contains(int64_t global_id) const;
+
+  /**
+   * Pin cache ids, e.g., of a batch still in use, so that `Evict` skips them
+   * until each pin is undone by `Unpin`.
+   */
+  void Pin(tcb::span<const int64_t> cache_ids);
+  void Unpin(tcb::span<const int64_t> cache_ids);
+
+  /**
+   * The hottest ids, by frequency and then by recency, as pairs of global id
+   * and frequency power.
+   *
+   * @param num max number of ids, all the ids if negative.
+   */
+  std::vector<int64_t> Ranked(int64_t num);
+
   struct LXUStrategy {
    private:
     // use to indicate VisitUpdator 's result
@@ -47,6 +87,13 @@ class IDTransformer {
     void UpdateTime(uint32_t time);
     template <typename T>
     int64_t Time(T record);
+    template <typename T>
+    int64_t FreqPower(T record);
+    /**
+     * The record of an id preloaded with freq_power.
+     */
+    template <typename T>
+    T Preload(int64_t freq_power);
 
     template <typename Visitor>
     auto VisitUpdator(Visitor visit)
@@ -66,6 +113,8 @@ class IDTransformer {
 
  private:
   Variant var_;
+  // Number of pins of each pinned cache id.
+  ska::flat_hash_map<int64_t, uint32_t> pins_;
 };
 
 } // namespace tde::details
@@ -3,23 +3,54 @@
 namespace tde::details {
 
 template <typename Fetch>
-inline bool IDTransformer::Transform(
+inline int64_t IDTransformer::Transform(
     tcb::span<const int64_t> global_ids,
     tcb::span<int64_t> cache_ids,
     Fetch fetch) {
-  return strategy_.VisitUpdator([&](auto&& update) -> bool {
+  return strategy_.VisitUpdator([&](auto&& update) {
     return std::visit(
-        [&](auto&& transformer) -> bool {
+        [&](auto&& transformer) {
           return transformer.Transform(
-              global_ids,
-              cache_ids,
-              std::forward<decltype(update)>(update),
-              std::move(fetch));
+              global_ids, cache_ids, update, std::move(fetch));
         },
         var_);
   });
 }
 
+template <typename Fetch>
+inline int64_t IDTransformer::Preload(
+    tcb::span<const int64_t> global_ids,
+    tcb::span<const int64_t> freq_powers,
+    tcb::span<int64_t> cache_ids,
+    Fetch fetch) {
+  TORCH_CHECK(
+      freq_powers.empty() || freq_powers.size() == global_ids.size(),
+      "expect ",
+      global_ids.size(),
+      " freq powers, got ",
+      freq_powers.size());
+  return std::visit(
+      [&](auto&& transformer) -> int64_t {
+        for (size_t i = 0; i < global_ids.size(); ++i) {
+          int64_t freq_power = freq_powers.empty() ? -1 : freq_powers[i];
+          auto update = [&](std::optional<uint32_t> record, int64_t, int64_t) {
+            return record.has_value()
+                ? *record
+                : strategy_.Preload<uint32_t>(freq_power);
+          };
+          if (transformer.Transform(
+                  global_ids.subspan(i, 1),
+                  cache_ids.subspan(i, 1),
+                  update,
+                  fetch) == 0) {
+            return static_cast<int64_t>(i);
+          }
+        }
+        return static_cast<int64_t>(global_ids.size());
+      },
+      var_);
+}
+
 template <typename Visitor>
 inline auto IDTransformer::LXUStrategy::VisitUpdator(Visitor visit)
     -> std::invoke_result_t<Visitor, _UpdateFunctor> {
@@ -43,6 +74,19 @@ int64_t IDTransformer::LXUStrategy::Time(T record) {
     strategy_);
 }
 
+template <typename T>
+int64_t IDTransformer::LXUStrategy::FreqPower(T record) {
+  return std::visit(
+      [&](auto& s) -> int64_t { return s.FreqPower(record); }, strategy_);
+}
+
+template <typename T>
+T IDTransformer::LXUStrategy::Preload(int64_t freq_power) {
+  return std::visit(
+      [&](auto& s) -> T { return static_cast<T>(s.Preload(freq_power)); },
+      strategy_);
+}
+
 template <typename Iterator>
 inline std::vector<int64_t> IDTransformer::LXUStrategy::Evict(
     Iterator iterator,
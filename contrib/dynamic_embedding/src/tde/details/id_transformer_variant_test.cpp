@@ -21,4 +21,89 @@ TEST(TDE, IDTransformer) {
   transformer.Transform(vec, result);
 }
 
+TEST(TDE, IDTransformer_preload_ranked) {
+  IDTransformer transformer(3, nlohmann::json::parse(R"(
+{
+  "lxu_strategy": {"type": "mixed_lru_lfu", "min_used_freq_power": 5},
+  "id_transformer": {"type": "naive"}
+}
+      )"));
+  std::vector<int64_t> global_ids{10, 11, 12, 13};
+  std::vector<int64_t> freq_powers{20, 7, 9, 8};
+  std::vector<int64_t> cache_ids(global_ids.size());
+  std::vector<int64_t> fetched;
+  // Only the first 3 ids fit.
+  ASSERT_EQ(
+      transformer.Preload(
+          global_ids,
+          freq_powers,
+          cache_ids,
+          [&](int64_t global_id, int64_t) { fetched.emplace_back(global_id); }),
+      3);
+  ASSERT_EQ(fetched, std::vector<int64_t>({10, 11, 12}));
+
+  // Ranked by the preloaded frequency.
+  ASSERT_EQ(
+      transformer.Ranked(-1), std::vector<int64_t>({10, 20, 12, 9, 11, 7}));
+  ASSERT_EQ(transformer.Ranked(1), std::vector<int64_t>({10, 20}));
+
+  // The coldest ids are evicted first.
+  auto evicted = transformer.Evict(1);
+  ASSERT_EQ(evicted[0], 11);
+}
+
+TEST(TDE, IDTransformer_pin) {
+  IDTransformer transformer(4, nlohmann::json::parse(R"(
+{
+  "lxu_strategy": {"type": "mixed_lru_lfu"},
+  "id_transformer": {"type": "naive"}
+}
+      )"));
+  std::vector<int64_t> global_ids{10, 11, 12, 13};
+  std::vector<int64_t> cache_ids(global_ids.size());
+  ASSERT_EQ(transformer.Transform(global_ids, cache_ids), 4);
+  // The cache ids of 10 and 11 are pinned twice.
+  transformer.Pin({cache_ids.data(), 2});
+  transformer.Pin({cache_ids.data(), 2});
+
+  auto evicted = transformer.Evict(4);
+  ASSERT_EQ(evicted.size(), 4);
+  ASSERT_TRUE(evicted[0] == 12 || evicted[0] == 13);
+  ASSERT_TRUE(evicted[2] == 12 || evicted[2] == 13);
+
+  transformer.Unpin({cache_ids.data(), 2});
+  ASSERT_TRUE(transformer.Evict(4).empty());
+  transformer.Unpin({cache_ids.data(), 2});
+  ASSERT_EQ(transformer.Evict(4).size(), 4);
+  ASSERT_ANY_THROW(transformer.Unpin({cache_ids.data(), 1}));
+}
+
+TEST(TDE, IDTransformer_partial) {
+  IDTransformer transformer(3, nlohmann::json::parse(R"(
+{
+  "lxu_strategy": {"type": "mixed_lru_lfu"},
+  "id_transformer": {"type": "naive"}
+}
+      )"));
+  std::vector<int64_t> global_ids{10, 11, 10, 12, 13, 11, 14};
+  std::vector<int64_t> cache_ids(global_ids.size(), -1);
+  // 13 does not fit.
+  ASSERT_EQ(transformer.Transform(global_ids, cache_ids), 4);
+  ASSERT_EQ(cache_ids[2], cache_ids[0]);
+  ASSERT_EQ(cache_ids[4], -1);
+  ASSERT_TRUE(transformer.Contains(12));
+  ASSERT_FALSE(transformer.Contains(13));
+
+  transformer.Pin({cache_ids.data(), 4});
+  ASSERT_TRUE(transformer.Evict(1).empty());
+  transformer.Unpin({cache_ids.data(), 4});
+  ASSERT_EQ(transformer.Evict(2).size(), 4);
+  // Resume from 13.
+  ASSERT_EQ(
+      transformer.Transform(
+          tcb::span{global_ids}.subspan(4, 2),
+          tcb::span{cache_ids}.subspan(4, 2)),
+      2);
+}
+
 } // namespace tde::details
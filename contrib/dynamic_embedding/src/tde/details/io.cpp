@@ -1,19 +1,21 @@
 #include "io.h"
+#include <chrono>
+#include "tde/details/row_codec.h"
 
 namespace tde::details {
 
 static constexpr std::string_view k_schema_separator = "://";
 
-IO::IO(const std::string& config) {
+IO::IO(const std::string& config, IOBudgetOption budget) : budget_(budget) {
   auto pos = config.find(k_schema_separator);
   TORCH_CHECK(
       pos != std::string::npos,
       "config string should be schema://cfg_string, cannot find schema");
 
-  std::string schema = config.substr(0, pos);
+  schema_ = config.substr(0, pos);
   std::string rest_cfg = config.substr(pos + k_schema_separator.size());
   auto& reg = IORegistry::Instance();
-  provider_ = reg.Resolve(schema);
+  provider_ = reg.Resolve(schema_);
   instance_ = provider_.Initialize(rest_cfg.c_str());
 }
 
@@ -31,36 +33,35 @@ struct FetchContext {
   uint32_t num_optimizer_states_;
 };
 
-static void OnGlobalIDFetched(
-    void* ctx,
-    uint32_t offset,
-    uint32_t optimizer_state,
-    void* data,
-    uint32_t data_len) {
+static void OnChunkFetched(void* ctx, const IOPullChunk* chunk) {
   auto c = reinterpret_cast<FetchContext*>(ctx);
-  auto& tensor = c->tensors_[offset];
-  // non-existed global id
-  if (data_len == 0) {
-    if (tensor.defined()) {
-      tensor = torch::Tensor{};
+  auto* data = reinterpret_cast<const uint8_t*>(chunk->data_);
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    auto& tensor = c->tensors_[chunk->row_begin_ + i];
+    uint64_t data_len = chunk->offsets_[i + 1] - chunk->offsets_[i];
+    // non-existed global id
+    if (!chunk->present_[i] || data_len == 0) {
+      if (tensor.defined()) {
+        tensor = torch::Tensor{};
+      }
+      continue;
     }
-    return;
-  }
-  if (!tensor.defined()) {
-    size_t elem_size = torch::elementSize(c->scalar_type_);
-    TORCH_CHECK(data_len % elem_size == 0);
-    size_t num_elems = data_len / elem_size;
-    tensor = torch::empty(
-        {
-            static_cast<int64_t>(c->num_optimizer_states_),
-            static_cast<int64_t>(num_elems),
-        },
-        c10::TensorOptions().dtype(c->scalar_type_));
+    if (!tensor.defined()) {
+      size_t elem_size = torch::elementSize(c->scalar_type_);
+      TORCH_CHECK(data_len % elem_size == 0);
+      size_t num_elems = data_len / elem_size;
+      tensor = torch::empty(
+          {
+              static_cast<int64_t>(c->num_optimizer_states_),
+              static_cast<int64_t>(num_elems),
+          },
+          c10::TensorOptions().dtype(c->scalar_type_));
+    }
+    void* ptr = reinterpret_cast<void*>(
+        reinterpret_cast<uintptr_t>(tensor.data_ptr()) +
+        chunk->optimizer_state_ * data_len);
+    memcpy(ptr, data + chunk->offsets_[i], data_len);
   }
-  void* ptr = reinterpret_cast<void*>(
-      reinterpret_cast<uintptr_t>(tensor.data_ptr()) +
-      optimizer_state * data_len);
-  memcpy(ptr, data, data_len);
 }
 
 static void OnAllFetched(void* ctx) {
@@ -75,7 +76,8 @@ void IO::Pull(
     tcb::span<const int64_t> col_ids,
     uint32_t num_optimizer_states,
     torch::ScalarType type,
-    MoveOnlyFunction<void(std::vector<torch::Tensor>)> on_fetch_complete) {
+    MoveOnlyFunction<void(std::vector<torch::Tensor>)> on_fetch_complete,
+    IOPriority priority) {
   std::unique_ptr<FetchContext> ctx(new FetchContext{
       .on_complete_ = std::move(on_fetch_complete),
       .scalar_type_ = type,
@@ -95,18 +97,362 @@ void IO::Pull(
         col_ids.size());
   }
 
-  IOPullParameter param{
+  IOPullParameterV2 param{
       .table_name_ = table_name.c_str(),
       .num_cols_ = static_cast<uint32_t>(col_ids.size()),
       .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
       .col_ids_ = col_ids.data(),
       .global_ids_ = global_ids.data(),
       .num_optimizer_stats_ = num_optimizer_states,
-      .on_global_id_fetched_ = OnGlobalIDFetched,
+      .on_chunk_fetched_ = OnChunkFetched,
       .on_all_fetched_ = OnAllFetched,
   };
   param.on_complete_context_ = ctx.release();
-  provider_.Pull(instance_, param);
+  // The sizes of the values are unknown, only the request is counted.
+  DoPull(param, priority, 0);
+}
+
+struct BatchedFetchContext {
+  BatchedPullResult result_;
+  MoveOnlyFunction<void(BatchedPullResult)> on_complete_;
+  uint32_t row_size_;
+  uint64_t row_bytes_;
+  uint64_t os_stride_bytes_;
+  bool decode_;
+};
+
+static void OnChunkFetchedBatched(void* ctx, const IOPullChunk* chunk) {
+  auto c = reinterpret_cast<BatchedFetchContext*>(ctx);
+  auto* src = reinterpret_cast<const uint8_t*>(chunk->data_);
+  auto* dst = reinterpret_cast<uint8_t*>(c->result_.rows_.data_ptr()) +
+      chunk->optimizer_state_ * c->os_stride_bytes_ +
+      chunk->row_begin_ * c->row_bytes_;
+
+  // Rows of raw values packed back to back are copied at once. The encoded
+  // rows could have the same size, so decoding rows never takes this path.
+  bool dense = !c->decode_;
+  for (uint32_t i = 0; dense && i < chunk->num_rows_; ++i) {
+    dense = chunk->present_[i] &&
+        chunk->offsets_[i + 1] - chunk->offsets_[0] == (i + 1) * c->row_bytes_;
+  }
+  if (dense) {
+    memcpy(dst, src + chunk->offsets_[0], chunk->num_rows_ * c->row_bytes_);
+    return;
+  }
+
+  bool* found = c->result_.found_.data_ptr<bool>();
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    uint64_t data_len = chunk->offsets_[i + 1] - chunk->offsets_[i];
+    // non-existed global id
+    if (!chunk->present_[i] || data_len == 0) {
+      found[chunk->row_begin_ + i] = false;
+      continue;
+    }
+    const uint8_t* row = src + chunk->offsets_[i];
+    uint8_t* ptr = dst + i * c->row_bytes_;
+    if (c->decode_) {
+      DecodeRow(row, data_len, reinterpret_cast<float*>(ptr), c->row_size_);
+      continue;
+    }
+    TORCH_CHECK(
+        data_len == c->row_bytes_,
+        "fetched value size mismatch, expect ",
+        c->row_bytes_,
+        " bytes, got ",
+        data_len);
+    memcpy(ptr, row, data_len);
+  }
+}
+
+static void OnAllFetchedBatched(void* ctx) {
+  auto c = reinterpret_cast<BatchedFetchContext*>(ctx);
+  c->on_complete_(std::move(c->result_));
+  delete c;
+}
+
+void IO::PullBatched(
+    const std::string& table_name,
+    tcb::span<const int64_t> global_ids,
+    tcb::span<const int64_t> col_ids,
+    uint32_t num_optimizer_states,
+    torch::ScalarType type,
+    int64_t row_size,
+    MoveOnlyFunction<void(BatchedPullResult)> on_fetch_complete,
+    IOPriority priority) {
+  int64_t num_rows =
+      global_ids.size() * std::max(col_ids.size(), static_cast<size_t>(1));
+  std::unique_ptr<BatchedFetchContext> ctx(new BatchedFetchContext{
+      .on_complete_ = std::move(on_fetch_complete),
+      .row_size_ = static_cast<uint32_t>(row_size),
+      .row_bytes_ = row_size * torch::elementSize(type),
+      .os_stride_bytes_ = num_rows * row_size * torch::elementSize(type),
+      .decode_ = type == torch::kFloat,
+  });
+  try {
+    ctx->result_.rows_ = torch::empty(
+        {static_cast<int64_t>(num_optimizer_states), num_rows, row_size},
+        c10::TensorOptions().dtype(type));
+    ctx->result_.found_ =
+        torch::ones({num_rows}, c10::TensorOptions().dtype(torch::kBool));
+  } catch (std::bad_alloc& ex) {
+    TORCH_CHECK(
+        false,
+        "bad allocate ",
+        ex.what(),
+        " global_ids.size()=",
+        global_ids.size(),
+        " col_ids.size()=",
+        col_ids.size());
+  }
+
+  IOPullParameterV2 param{
+      .table_name_ = table_name.c_str(),
+      .num_cols_ = static_cast<uint32_t>(col_ids.size()),
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .col_ids_ = col_ids.data(),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = num_optimizer_states,
+      .on_chunk_fetched_ = OnChunkFetchedBatched,
+      .on_all_fetched_ = OnAllFetchedBatched,
+  };
+  uint64_t bytes = ctx->result_.rows_.nbytes();
+  param.on_complete_context_ = ctx.release();
+  DoPull(param, priority, bytes);
+}
+
+struct PullIntoContext {
+  BatchedPullResult result_;
+  std::vector<IOPullDestination> dsts_;
+  MoveOnlyFunction<void(BatchedPullResult)> on_complete_;
+  uint32_t num_optimizer_states_;
+  bool decode_;
+};
+
+static void OnChunkFetchedInto(void* ctx, const IOPullChunk* chunk) {
+  auto c = reinterpret_cast<PullIntoContext*>(ctx);
+  auto* data = reinterpret_cast<const uint8_t*>(chunk->data_);
+  bool* found = c->result_.found_.data_ptr<bool>();
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    uint32_t row = chunk->row_begin_ + i;
+    const IOPullDestination& dst =
+        c->dsts_[row * c->num_optimizer_states_ + chunk->optimizer_state_];
+    auto* dst_ptr = reinterpret_cast<uint8_t*>(dst.data_);
+    auto num_elems = static_cast<uint32_t>(dst.capacity_ / sizeof(float));
+    if (chunk->present_[i] == k_row_in_destination) {
+      // An encoded row can have the size of the raw row, which is decoded in
+      // place through a copy.
+      if (c->decode_ && !IsRawRow(dst_ptr, dst.capacity_, num_elems)) {
+        std::vector<uint8_t> encoded(dst_ptr, dst_ptr + dst.capacity_);
+        DecodeRow(
+            encoded.data(),
+            encoded.size(),
+            reinterpret_cast<float*>(dst_ptr),
+            num_elems);
+      }
+      continue;
+    }
+    uint64_t data_len = chunk->offsets_[i + 1] - chunk->offsets_[i];
+    // non-existed global id
+    if (chunk->present_[i] == k_row_missing || data_len == 0) {
+      found[row] = false;
+      continue;
+    }
+    const uint8_t* src = data + chunk->offsets_[i];
+    if (c->decode_) {
+      DecodeRow(src, data_len, reinterpret_cast<float*>(dst_ptr), num_elems);
+      continue;
+    }
+    TORCH_CHECK(
+        data_len <= dst.capacity_,
+        "fetched value of ",
+        data_len,
+        " bytes exceeds the capacity ",
+        dst.capacity_);
+    memcpy(dst_ptr, src, data_len);
+  }
+}
+
+static void OnAllFetchedInto(void* ctx) {
+  auto c = reinterpret_cast<PullIntoContext*>(ctx);
+  c->on_complete_(std::move(c->result_));
+  delete c;
+}
+
+void IO::PullInto(
+    const std::string& table_name,
+    tcb::span<const int64_t> global_ids,
+    tcb::span<const int64_t> col_ids,
+    uint32_t num_optimizer_states,
+    torch::ScalarType type,
+    std::vector<IOPullDestination> dsts,
+    MoveOnlyFunction<void(BatchedPullResult)> on_fetch_complete,
+    IOPriority priority) {
+  size_t num_rows =
+      global_ids.size() * std::max(col_ids.size(), static_cast<size_t>(1));
+  TORCH_CHECK(
+      dsts.size() == num_rows * num_optimizer_states,
+      "expect ",
+      num_rows * num_optimizer_states,
+      " destinations, got ",
+      dsts.size());
+  std::unique_ptr<PullIntoContext> ctx(new PullIntoContext{
+      .dsts_ = std::move(dsts),
+      .on_complete_ = std::move(on_fetch_complete),
+      .num_optimizer_states_ = num_optimizer_states,
+      .decode_ = type == torch::kFloat,
+  });
+  ctx->result_.found_ = torch::ones(
+      {static_cast<int64_t>(num_rows)},
+      c10::TensorOptions().dtype(torch::kBool));
+
+  IOPullParameterV2 param{
+      .table_name_ = table_name.c_str(),
+      .num_cols_ = static_cast<uint32_t>(col_ids.size()),
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .col_ids_ = col_ids.data(),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = num_optimizer_states,
+      .on_chunk_fetched_ = OnChunkFetchedInto,
+      .on_all_fetched_ = OnAllFetchedInto,
+      .dsts_ = ctx->dsts_.data(),
+  };
+  uint64_t bytes = 0;
+  for (auto& dst : ctx->dsts_) {
+    bytes += dst.capacity_;
+  }
+  param.on_complete_context_ = ctx.release();
+  DoPull(param, priority, bytes);
+}
+
+/**
+ * Owns the table name and the ids of a pull, which can start after the
+ * caller returns, and releases the budget when the pull finishes.
+ */
+struct BudgetedPullContext {
+  IOBudget* budget_;
+  uint64_t bytes_;
+  std::string table_name_;
+  std::vector<int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  void* on_complete_context_;
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
+  void (*on_all_fetched_)(void* ctx);
+};
+
+static void OnChunkFetchedBudgeted(void* ctx, const IOPullChunk* chunk) {
+  auto c = reinterpret_cast<BudgetedPullContext*>(ctx);
+  c->on_chunk_fetched_(c->on_complete_context_, chunk);
+}
+
+static void OnAllFetchedBudgeted(void* ctx) {
+  std::unique_ptr<BudgetedPullContext> c(
+      reinterpret_cast<BudgetedPullContext*>(ctx));
+  c->on_all_fetched_(c->on_complete_context_);
+  c->budget_->Release(c->bytes_);
+}
+
+/**
+ * Counts the rows and the bytes of a pull, and records its latency.
+ */
+struct MeteredPullContext {
+  IOTableMetrics* metrics_;
+  std::chrono::steady_clock::time_point start_;
+  const IOPullDestination* dsts_;
+  uint32_t num_optimizer_states_;
+  void* on_complete_context_;
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
+  void (*on_all_fetched_)(void* ctx);
+  // Counted by the chunks of the pull, and added to metrics_ once the pull
+  // completes, so that the chunks do not contend on the table metrics.
+  std::atomic<uint64_t> pulled_bytes_{0};
+  std::atomic<uint64_t> num_missing_rows_{0};
+};
+
+static void OnChunkFetchedMetered(void* ctx, const IOPullChunk* chunk) {
+  auto c = reinterpret_cast<MeteredPullContext*>(ctx);
+  uint64_t bytes = chunk->offsets_[chunk->num_rows_] - chunk->offsets_[0];
+  uint64_t num_missing = 0;
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    if (chunk->present_[i] == k_row_missing) {
+      ++num_missing;
+    } else if (chunk->present_[i] == k_row_in_destination) {
+      uint64_t row = chunk->row_begin_ + i;
+      bytes += c->dsts_[row * c->num_optimizer_states_ +
+                        chunk->optimizer_state_]
+                   .capacity_;
+    }
+  }
+  c->pulled_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  // A missing row misses all of its optimizer states, count it once.
+  if (chunk->optimizer_state_ == 0 && num_missing != 0) {
+    c->num_missing_rows_.fetch_add(num_missing, std::memory_order_relaxed);
+  }
+  c->on_chunk_fetched_(c->on_complete_context_, chunk);
+}
+
+static void OnAllFetchedMetered(void* ctx) {
+  std::unique_ptr<MeteredPullContext> c(
+      reinterpret_cast<MeteredPullContext*>(ctx));
+  c->metrics_->pulled_bytes_.fetch_add(
+      c->pulled_bytes_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  c->metrics_->num_missing_rows_.fetch_add(
+      c->num_missing_rows_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  c->metrics_->pull_latency_us_.Record(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - c->start_)
+          .count());
+  c->on_all_fetched_(c->on_complete_context_);
+}
+
+void IO::DoPull(IOPullParameterV2 param, IOPriority priority, uint64_t bytes) {
+  IOTableMetrics& metrics = Metrics(param.table_name_);
+  metrics.num_pulls_.fetch_add(1, std::memory_order_relaxed);
+  metrics.num_pulled_rows_.fetch_add(
+      static_cast<uint64_t>(param.num_global_ids_) *
+          std::max(param.num_cols_, 1U),
+      std::memory_order_relaxed);
+  auto* metered = new MeteredPullContext{
+      .metrics_ = &metrics,
+      .start_ = std::chrono::steady_clock::now(),
+      .dsts_ = param.dsts_,
+      .num_optimizer_states_ = param.num_optimizer_stats_,
+      .on_complete_context_ = param.on_complete_context_,
+      .on_chunk_fetched_ = param.on_chunk_fetched_,
+      .on_all_fetched_ = param.on_all_fetched_,
+  };
+  param.on_complete_context_ = metered;
+  param.on_chunk_fetched_ = OnChunkFetchedMetered;
+  param.on_all_fetched_ = OnAllFetchedMetered;
+
+  if (!budget_.enabled()) {
+    LaunchPull(param);
+    return;
+  }
+  auto* ctx = new BudgetedPullContext{
+      .budget_ = &budget_,
+      .bytes_ = bytes,
+      .table_name_ = param.table_name_,
+      .global_ids_ = std::vector<int64_t>(
+          param.global_ids_, param.global_ids_ + param.num_global_ids_),
+      .col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_),
+      .on_complete_context_ = param.on_complete_context_,
+      .on_chunk_fetched_ = param.on_chunk_fetched_,
+      .on_all_fetched_ = param.on_all_fetched_,
+  };
+  param.table_name_ = ctx->table_name_.c_str();
+  param.global_ids_ = ctx->global_ids_.data();
+  param.col_ids_ = ctx->col_ids_.data();
+  param.on_complete_context_ = ctx;
+  param.on_chunk_fetched_ = OnChunkFetchedBudgeted;
+  param.on_all_fetched_ = OnAllFetchedBudgeted;
+  budget_.Submit(priority, bytes, [this, param] { LaunchPull(param); });
+}
+
+void IO::LaunchPull(IOPullParameterV2 param) {
+  PullChunked(provider_, instance_, param);
 }
 
 struct PushContext {
@@ -126,7 +472,8 @@ void IO::Push(
     tcb::span<const uint32_t> os_ids,
     tcb::span<const uint8_t> data,
     tcb::span<const uint64_t> offsets,
-    MoveOnlyFunction<void()> on_push_complete) {
+    MoveOnlyFunction<void()> on_push_complete,
+    IOPriority priority) {
   std::unique_ptr<PushContext> ctx(new PushContext{
       .on_push_complete_ = std::move(on_push_complete),
   });
@@ -144,7 +491,142 @@ void IO::Push(
       .on_complete_context_ = ctx.release(),
       .on_push_complete = OnPushComplete,
   };
-  provider_.Push(instance_, param);
+  // The offsets can point into a larger buffer, only the values in between
+  // are pushed.
+  uint64_t bytes = offsets.empty() ? 0 : offsets.back() - offsets.front();
+  DoPush(param, priority, bytes);
+}
+
+/**
+ * The push version of BudgetedPullContext.
+ */
+struct BudgetedPushContext {
+  IOBudget* budget_;
+  uint64_t bytes_;
+  std::string table_name_;
+  std::vector<int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  std::vector<uint32_t> os_ids_;
+  void* on_complete_context_;
+  void (*on_push_complete_)(void* ctx);
+};
+
+static void OnPushCompleteBudgeted(void* ctx) {
+  std::unique_ptr<BudgetedPushContext> c(
+      reinterpret_cast<BudgetedPushContext*>(ctx));
+  c->on_push_complete_(c->on_complete_context_);
+  c->budget_->Release(c->bytes_);
+}
+
+/**
+ * The push version of MeteredPullContext.
+ */
+struct MeteredPushContext {
+  IOTableMetrics* metrics_;
+  std::chrono::steady_clock::time_point start_;
+  void* on_complete_context_;
+  void (*on_push_complete_)(void* ctx);
+};
+
+static void OnPushCompleteMetered(void* ctx) {
+  std::unique_ptr<MeteredPushContext> c(
+      reinterpret_cast<MeteredPushContext*>(ctx));
+  c->metrics_->push_latency_us_.Record(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - c->start_)
+          .count());
+  c->on_push_complete_(c->on_complete_context_);
+}
+
+void IO::DoPush(IOPushParameter param, IOPriority priority, uint64_t bytes) {
+  IOTableMetrics& metrics = Metrics(param.table_name_);
+  metrics.num_pushes_.fetch_add(1, std::memory_order_relaxed);
+  metrics.num_pushed_rows_.fetch_add(
+      static_cast<uint64_t>(param.num_global_ids_) *
+          std::max(param.num_cols_, 1U),
+      std::memory_order_relaxed);
+  metrics.pushed_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  param.on_complete_context_ = new MeteredPushContext{
+      .metrics_ = &metrics,
+      .start_ = std::chrono::steady_clock::now(),
+      .on_complete_context_ = param.on_complete_context_,
+      .on_push_complete_ = param.on_push_complete,
+  };
+  param.on_push_complete = OnPushCompleteMetered;
+
+  if (!budget_.enabled()) {
+    provider_.Push(instance_, param);
+    return;
+  }
+  auto* ctx = new BudgetedPushContext{
+      .budget_ = &budget_,
+      .bytes_ = bytes,
+      .table_name_ = param.table_name_,
+      .global_ids_ = std::vector<int64_t>(
+          param.global_ids_, param.global_ids_ + param.num_global_ids_),
+      .col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_),
+      .os_ids_ = std::vector<uint32_t>(
+          param.optimizer_stats_ids_,
+          param.optimizer_stats_ids_ + param.num_optimizer_stats_),
+      .on_complete_context_ = param.on_complete_context_,
+      .on_push_complete_ = param.on_push_complete,
+  };
+  param.table_name_ = ctx->table_name_.c_str();
+  param.global_ids_ = ctx->global_ids_.data();
+  param.col_ids_ = ctx->col_ids_.data();
+  param.optimizer_stats_ids_ = ctx->os_ids_.data();
+  param.on_complete_context_ = ctx;
+  param.on_push_complete = OnPushCompleteBudgeted;
+  budget_.Submit(
+      priority, bytes, [this, param] { provider_.Push(instance_, param); });
+}
+
+IOTableMetrics& IO::Metrics(const std::string& table_name) {
+  std::lock_guard<std::mutex> lock(metrics_mu_);
+  auto& metrics = metrics_[table_name];
+  if (metrics == nullptr) {
+    metrics = std::make_unique<IOTableMetrics>();
+  }
+  return *metrics;
+}
+
+c10::Dict<std::string, double> IO::Stats() {
+  c10::Dict<std::string, double> stats;
+  std::lock_guard<std::mutex> lock(metrics_mu_);
+  for (auto& [table_name, metrics] : metrics_) {
+    std::string prefix = "io." + schema_ + "." + table_name + ".";
+    auto load = [](const std::atomic<uint64_t>& counter) {
+      return static_cast<double>(counter.load(std::memory_order_relaxed));
+    };
+    double num_pulled_rows = load(metrics->num_pulled_rows_);
+    double num_missing_rows = load(metrics->num_missing_rows_);
+    stats.insert(prefix + "num_pulls", load(metrics->num_pulls_));
+    stats.insert(prefix + "num_pulled_rows", num_pulled_rows);
+    stats.insert(prefix + "num_missing_rows", num_missing_rows);
+    stats.insert(
+        prefix + "missing_rate",
+        num_pulled_rows == 0 ? 0 : num_missing_rows / num_pulled_rows);
+    stats.insert(prefix + "pulled_bytes", load(metrics->pulled_bytes_));
+    stats.insert(prefix + "num_pushes", load(metrics->num_pushes_));
+    stats.insert(prefix + "num_pushed_rows", load(metrics->num_pushed_rows_));
+    stats.insert(prefix + "pushed_bytes", load(metrics->pushed_bytes_));
+    metrics->pull_latency_us_.Export(prefix + "pull_latency_us", stats);
+    metrics->push_latency_us_.Export(prefix + "push_latency_us", stats);
+  }
+  if (provider_.Stats != nullptr) {
+    struct StatsContext {
+      std::string prefix_;
+      c10::Dict<std::string, double>& stats_;
+    };
+    StatsContext ctx{"io." + schema_ + ".", stats};
+    provider_.Stats(
+        instance_, &ctx, +[](void* ctx, const char* key, double value) {
+          auto* c = reinterpret_cast<StatsContext*>(ctx);
+          c->stats_.insert_or_assign(c->prefix_ + key, value);
+        });
+  }
+  return stats;
 }
 
 } // namespace tde::details
@@ -1,15 +1,64 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "tcb/span.hpp"
+#include "tde/details/histogram.h"
+#include "tde/details/io_budget.h"
 #include "tde/details/io_registry.h"
 #include "tde/details/move_only_function.h"
 #include "torch/torch.h"
 
 namespace tde::details {
 
+/**
+ * Result of `IO::PullBatched`.
+ */
+struct BatchedPullResult {
+  // Fetched rows, shape [num_optimizer_states, num_rows, row_size]. The row
+  // of the i-th global id and j-th col id is `rows_[:, i * num_cols + j]`.
+  torch::Tensor rows_;
+  // Bool tensor of shape [num_rows]. False if the parameter server does not
+  // contain the row, and the content of `rows_` is undefined for that row.
+  torch::Tensor found_;
+};
+
+/**
+ * Counters of the requests to one table. They are updated by the IO threads
+ * without locks.
+ */
+struct IOTableMetrics {
+  std::atomic<uint64_t> num_pulls_{0};
+  // Number of rows pulled, i.e., global ids times max(num_cols, 1).
+  std::atomic<uint64_t> num_pulled_rows_{0};
+  // Number of rows of optimizer state 0 the parameter server does not have.
+  std::atomic<uint64_t> num_missing_rows_{0};
+  std::atomic<uint64_t> pulled_bytes_{0};
+  std::atomic<uint64_t> num_pushes_{0};
+  std::atomic<uint64_t> num_pushed_rows_{0};
+  std::atomic<uint64_t> pushed_bytes_{0};
+  // From the call of the IO method to the completion, including the time
+  // waiting for budget.
+  Histogram pull_latency_us_;
+  Histogram push_latency_us_;
+};
+
+/**
+ * The client of a parameter server, which is resolved from the IORegistry by
+ * the schema of the config string, `schema://cfg_string`.
+ *
+ * The requests can be limited by an IOBudget. Requests over budget are
+ * deferred, or block the caller if `block_` is set, and are admitted in the
+ * order of their priorities. When the budget is enabled, the ids and the
+ * table name are copied, so they can be freed once a method returns.
+ *
+ * The requests of each table are counted in `IOTableMetrics`, see `Stats`.
+ */
 class IO {
  public:
-  explicit IO(const std::string& config);
+  explicit IO(const std::string& config, IOBudgetOption budget = {});
   ~IO();
 
   IO(const IO&) = delete;
@@ -39,7 +88,65 @@ class IO {
       tcb::span<const int64_t> col_ids,
       uint32_t num_optimizer_states,
       torch::ScalarType type,
-      MoveOnlyFunction<void(std::vector<torch::Tensor>)> on_fetch_complete);
+      MoveOnlyFunction<void(std::vector<torch::Tensor>)> on_fetch_complete,
+      IOPriority priority = IOPriority::kFetch);
+
+  /**
+   * Fetch parameter and optimizer states from ParamServer into one
+   * contiguous buffer per optimizer state.
+   *
+   * Unlike `Pull`, no tensor is allocated per global id, so the caller can
+   * scatter the whole result into the embedding tensors with one
+   * `index_copy_` per optimizer state.
+   *
+   * @param row_size number of elements of each fetched value. Values of a
+   * different size are treated as errors. If type is float, the values are
+   * decoded by `DecodeRow`, so they can be stored in any `RowEncoding`.
+   * @param on_fetch_complete fetch complete callback. It is invoked in the IO
+   * thread, so it should not do heavy work.
+   *
+   * @note this method is asynchronous, see `Pull`.
+   */
+  void PullBatched(
+      const std::string& table_name,
+      tcb::span<const int64_t> global_ids,
+      tcb::span<const int64_t> col_ids,
+      uint32_t num_optimizer_states,
+      torch::ScalarType type,
+      int64_t row_size,
+      MoveOnlyFunction<void(BatchedPullResult)> on_fetch_complete,
+      IOPriority priority = IOPriority::kFetch);
+
+  /**
+   * Fetch parameter and optimizer states from ParamServer into the given
+   * destinations, e.g., the rows of the embedding tensors in host memory.
+   *
+   * Providers that support destinations write the values into them directly,
+   * otherwise the values are copied from the fetched chunks. Either way, no
+   * intermediate tensor is allocated.
+   *
+   * @param dsts the destination of the i-th row and j-th optimizer state is
+   * `dsts[i * num_optimizer_states + j]`, where the row index is
+   * `gid_index * max(num_cols, 1) + col_index`. The destinations must stay
+   * valid until `on_fetch_complete` is invoked.
+   * @param type data type. If type is float, the values are decoded by
+   * `DecodeRow` into `capacity_ / sizeof(float)` floats. Otherwise, the
+   * values are copied as is, and must fit the capacity.
+   * @param on_fetch_complete fetch complete callback. `rows_` of the result
+   * is undefined. It is invoked in the IO thread, so it should not do heavy
+   * work.
+   *
+   * @note this method is asynchronous, see `Pull`.
+   */
+  void PullInto(
+      const std::string& table_name,
+      tcb::span<const int64_t> global_ids,
+      tcb::span<const int64_t> col_ids,
+      uint32_t num_optimizer_states,
+      torch::ScalarType type,
+      std::vector<IOPullDestination> dsts,
+      MoveOnlyFunction<void(BatchedPullResult)> on_fetch_complete,
+      IOPriority priority = IOPriority::kFetch);
 
   /**
    * Push Parameter/Optimizer stats to parameter server.
@@ -53,6 +160,8 @@ class IO {
    *
    * @param offsets
    * @param on_push_complete
+   *
+   * @note data and offsets must stay valid until on_push_complete.
    */
   void Push(
       const std::string& table_name,
@@ -61,11 +170,37 @@ class IO {
       tcb::span<const uint32_t> os_ids,
       tcb::span<const uint8_t> data,
       tcb::span<const uint64_t> offsets,
-      MoveOnlyFunction<void()> on_push_complete);
+      MoveOnlyFunction<void()> on_push_complete,
+      IOPriority priority = IOPriority::kWriteBack);
+
+  /**
+   * Snapshot of the metrics of all tables. The keys are
+   * `io.<schema>.<table>.<metric>`, and the latency histograms are exported
+   * by `Histogram::Export`, e.g., `io.redis.t0.pull_latency_us.p99`. The
+   * stats of the provider instance, if any, are `io.<schema>.<key>`.
+   */
+  [[nodiscard]] c10::Dict<std::string, double> Stats();
 
  private:
+  IOTableMetrics& Metrics(const std::string& table_name);
+
+  /**
+   * Submit a pull of `bytes` to the budget.
+   */
+  void DoPull(IOPullParameterV2 param, IOPriority priority, uint64_t bytes);
+  /**
+   * Pull through the v2 ABI, or through the v1 ABI with a shim.
+   */
+  void LaunchPull(IOPullParameterV2 param);
+  void DoPush(IOPushParameter param, IOPriority priority, uint64_t bytes);
+
+  std::string schema_;
   IOProvider provider_{};
   void* instance_{};
+  IOBudget budget_;
+  std::mutex metrics_mu_;
+  // The metrics are never erased, so the references stay valid.
+  std::unordered_map<std::string, std::unique_ptr<IOTableMetrics>> metrics_;
 };
 
 } // namespace tde::details
@@ -0,0 +1,110 @@
+#include "tde/details/io_budget.h"
+#include "tde/details/notification.h"
+
+namespace tde::details {
+
+void IOBudget::Submit(
+    IOPriority priority,
+    uint64_t bytes,
+    MoveOnlyFunction<void()> start) {
+  if (!enabled()) {
+    start();
+    return;
+  }
+  auto p = static_cast<size_t>(priority);
+  Notification admitted;
+  bool wait = false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    bool urgent_waiting = false;
+    for (size_t i = 0; i <= p; ++i) {
+      urgent_waiting |= !waiting_[i].empty();
+    }
+    if (!urgent_waiting && Fits(bytes)) {
+      inflight_bytes_ += bytes;
+      ++inflight_requests_;
+    } else if (opt_.block_) {
+      waiting_[p].emplace_back(Waiting{
+          .bytes_ = bytes,
+          .start_ = [&admitted] { admitted.Done(); },
+      });
+      wait = true;
+    } else {
+      waiting_[p].emplace_back(Waiting{
+          .bytes_ = bytes,
+          .start_ = std::move(start),
+      });
+      return;
+    }
+  }
+  if (wait) {
+    admitted.Wait();
+  }
+  start();
+}
+
+void IOBudget::Release(uint64_t bytes) {
+  if (!enabled()) {
+    return;
+  }
+  std::deque<MoveOnlyFunction<void()>> to_start;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    inflight_bytes_ -= bytes;
+    --inflight_requests_;
+    to_start = AdmitWaiting();
+  }
+  for (auto& start : to_start) {
+    start();
+  }
+}
+
+bool IOBudget::Fits(uint64_t bytes) const {
+  if (inflight_requests_ == 0) {
+    return true;
+  }
+  if (opt_.max_inflight_requests_ != 0 &&
+      inflight_requests_ >= opt_.max_inflight_requests_) {
+    return false;
+  }
+  return opt_.max_inflight_bytes_ == 0 ||
+      inflight_bytes_ + bytes <= opt_.max_inflight_bytes_;
+}
+
+std::deque<MoveOnlyFunction<void()>> IOBudget::AdmitWaiting() {
+  std::deque<MoveOnlyFunction<void()>> admitted;
+  for (auto& waiting : waiting_) {
+    while (!waiting.empty() && Fits(waiting.front().bytes_)) {
+      inflight_bytes_ += waiting.front().bytes_;
+      ++inflight_requests_;
+      admitted.emplace_back(std::move(waiting.front().start_));
+      waiting.pop_front();
+    }
+    // Less urgent requests wait behind this class.
+    if (!waiting.empty()) {
+      break;
+    }
+  }
+  return admitted;
+}
+
+uint64_t IOBudget::inflight_bytes() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return inflight_bytes_;
+}
+
+uint32_t IOBudget::inflight_requests() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return inflight_requests_;
+}
+
+size_t IOBudget::num_waiting() {
+  std::lock_guard<std::mutex> lock(mu_);
+  size_t n = 0;
+  for (auto& waiting : waiting_) {
+    n += waiting.size();
+  }
+  return n;
+}
+
+} // namespace tde::details
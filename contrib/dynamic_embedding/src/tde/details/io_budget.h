@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "tde/details/move_only_function.h"
+
+namespace tde::details {
+
+/**
+ * Priority classes of IO requests. Smaller is more urgent.
+ */
+enum class IOPriority : uint8_t {
+  // Fetches the current training step waits for.
+  kFetch = 0,
+  // Fetches of the steps ahead.
+  kPrefetch = 1,
+  // Pushes of the evicted rows.
+  kWriteBack = 2,
+};
+
+struct IOBudgetOption {
+  // 0 for unlimited.
+  uint64_t max_inflight_bytes_{0};
+  // 0 for unlimited.
+  uint32_t max_inflight_requests_{0};
+  // Block the submitter when over budget, instead of deferring the request.
+  bool block_{false};
+};
+
+/**
+ * Limits the bytes and the number of the requests in flight.
+ *
+ * A request over budget waits until the requests in flight release enough
+ * budget. Waiting requests are admitted in priority order, and in FIFO order
+ * within a priority class. A request of lower priority is not admitted while
+ * a more urgent one is waiting, so fetches are not delayed by a backlog of
+ * write-backs. A single request larger than the byte budget is admitted when
+ * nothing else is in flight.
+ */
+class IOBudget {
+ public:
+  explicit IOBudget(IOBudgetOption opt = {}) : opt_(opt) {}
+
+  IOBudget(const IOBudget&) = delete;
+  IOBudget& operator=(const IOBudget&) = delete;
+
+  [[nodiscard]] bool enabled() const {
+    return opt_.max_inflight_bytes_ != 0 || opt_.max_inflight_requests_ != 0;
+  }
+
+  /**
+   * Run `start` once the request of `bytes` is admitted.
+   *
+   * If the request is within budget, `start` runs immediately in this
+   * thread. Otherwise, this method either blocks until the request is
+   * admitted, if `block_` is set, or returns and `start` runs later in the
+   * thread releasing the budget.
+   */
+  void Submit(
+      IOPriority priority,
+      uint64_t bytes,
+      MoveOnlyFunction<void()> start);
+
+  /**
+   * Release the budget of a finished request, and start the waiting requests
+   * which fit the budget.
+   */
+  void Release(uint64_t bytes);
+
+  [[nodiscard]] uint64_t inflight_bytes();
+  [[nodiscard]] uint32_t inflight_requests();
+  [[nodiscard]] size_t num_waiting();
+
+ private:
+  static constexpr size_t k_num_priorities = 3;
+
+  struct Waiting {
+    uint64_t bytes_;
+    MoveOnlyFunction<void()> start_;
+  };
+
+  bool Fits(uint64_t bytes) const;
+  /**
+   * Admit the waiting requests which fit the budget.
+   * @return the requests to start outside the lock.
+   */
+  std::deque<MoveOnlyFunction<void()>> AdmitWaiting();
+
+  IOBudgetOption opt_;
+  std::mutex mu_;
+  uint64_t inflight_bytes_{0};
+  uint32_t inflight_requests_{0};
+  std::deque<Waiting> waiting_[k_num_priorities];
+};
+
+} // namespace tde::details
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tde/details/io_budget.h"
+
+namespace tde::details {
+
+TEST(TDE, IOBudget_unlimited) {
+  IOBudget budget;
+  ASSERT_FALSE(budget.enabled());
+  int num_started = 0;
+  for (int i = 0; i < 10; ++i) {
+    budget.Submit(IOPriority::kWriteBack, 1 << 30, [&] { ++num_started; });
+  }
+  ASSERT_EQ(num_started, 10);
+}
+
+TEST(TDE, IOBudget_priority) {
+  IOBudget budget(IOBudgetOption{.max_inflight_requests_ = 1});
+  std::vector<int> started;
+  budget.Submit(IOPriority::kFetch, 0, [&] { started.emplace_back(0); });
+  budget.Submit(IOPriority::kWriteBack, 0, [&] { started.emplace_back(1); });
+  budget.Submit(IOPriority::kPrefetch, 0, [&] { started.emplace_back(2); });
+  budget.Submit(IOPriority::kFetch, 0, [&] { started.emplace_back(3); });
+  ASSERT_EQ(started, std::vector<int>({0}));
+  ASSERT_EQ(budget.num_waiting(), 3);
+
+  budget.Release(0);
+  ASSERT_EQ(started, std::vector<int>({0, 3}));
+  budget.Release(0);
+  ASSERT_EQ(started, std::vector<int>({0, 3, 2}));
+  budget.Release(0);
+  ASSERT_EQ(started, std::vector<int>({0, 3, 2, 1}));
+  budget.Release(0);
+  ASSERT_EQ(budget.inflight_requests(), 0);
+}
+
+TEST(TDE, IOBudget_bytes) {
+  IOBudget budget(IOBudgetOption{.max_inflight_bytes_ = 100});
+  int num_started = 0;
+  budget.Submit(IOPriority::kFetch, 60, [&] { ++num_started; });
+  budget.Submit(IOPriority::kFetch, 60, [&] { ++num_started; });
+  ASSERT_EQ(num_started, 1);
+  ASSERT_EQ(budget.inflight_bytes(), 60);
+
+  // A less urgent request does not overtake the waiting one, even if it
+  // fits.
+  budget.Submit(IOPriority::kWriteBack, 10, [&] { ++num_started; });
+  ASSERT_EQ(num_started, 1);
+
+  budget.Release(60);
+  ASSERT_EQ(num_started, 3);
+  ASSERT_EQ(budget.inflight_bytes(), 70);
+  budget.Release(60);
+  budget.Release(10);
+
+  // A request larger than the budget runs alone.
+  budget.Submit(IOPriority::kFetch, 1000, [&] { ++num_started; });
+  ASSERT_EQ(num_started, 4);
+  budget.Release(1000);
+}
+
+TEST(TDE, IOBudget_block) {
+  IOBudget budget(
+      IOBudgetOption{.max_inflight_requests_ = 1, .block_ = true});
+  budget.Submit(IOPriority::kFetch, 0, [] {});
+  std::atomic<bool> started{false};
+  std::thread submitter([&] {
+    budget.Submit(IOPriority::kFetch, 0, [&] { started = true; });
+  });
+  while (budget.num_waiting() == 0) {
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(started);
+  budget.Release(0);
+  submitter.join();
+  ASSERT_TRUE(started);
+  ASSERT_EQ(budget.inflight_requests(), 1);
+  budget.Release(0);
+}
+
+} // namespace tde::details
@@ -1,12 +1,23 @@
 #include "tde/details/io_registry.h"
 #include "dlfcn.h"
+#include "tde/details/file_io.h"
+#include "tde/details/memory_io.h"
+#include "tde/details/record_io.h"
 #include "tde/details/redis_io.h"
+#include "tde/details/tiered_io.h"
 #include "torch/torch.h"
 
 namespace tde::details {
 
 void IORegistry::Register(IOProvider provider) {
   std::string type = provider.type_;
+  TORCH_CHECK(
+      provider.version_ == k_io_version_2 ? provider.PullV2 != nullptr
+                                          : provider.Pull != nullptr,
+      "IO provider ",
+      type,
+      " does not implement the pull of version ",
+      provider.version_);
   auto it = providers_.find(type);
   if (it != providers_.end()) {
     TORCH_WARN("IO provider ", type, " already registered. Ignored this time.");
@@ -34,14 +45,35 @@ void IORegistry::RegisterPlugin(const char* filename) {
   provider.Finalize =
       reinterpret_cast<decltype(provider.Finalize)>(finalize_ptr);
 
+  auto version_ptr = dlsym(ptr.get(), "IO_version");
+  if (version_ptr != nullptr) {
+    provider.version_ = *reinterpret_cast<const uint32_t*>(version_ptr);
+  }
+  TORCH_CHECK(
+      provider.version_ == k_io_version_1 ||
+          provider.version_ == k_io_version_2,
+      "unsupported IO version ",
+      provider.version_,
+      " of ",
+      filename);
+
   auto pull_ptr = dlsym(ptr.get(), "IO_Pull");
   TORCH_CHECK(pull_ptr != nullptr, "cannot find IO_Pull symbol");
-  provider.Pull = reinterpret_cast<decltype(provider.Pull)>(pull_ptr);
+  if (provider.version_ == k_io_version_2) {
+    provider.PullV2 = reinterpret_cast<decltype(provider.PullV2)>(pull_ptr);
+  } else {
+    provider.Pull = reinterpret_cast<decltype(provider.Pull)>(pull_ptr);
+  }
 
   auto push_ptr = dlsym(ptr.get(), "IO_Push");
   TORCH_CHECK(push_ptr != nullptr, "cannot find IO_Push symbol");
   provider.Push = reinterpret_cast<decltype(provider.Push)>(push_ptr);
 
+  auto stats_ptr = dlsym(ptr.get(), "IO_Stats");
+  if (stats_ptr != nullptr) {
+    provider.Stats = reinterpret_cast<decltype(provider.Stats)>(stats_ptr);
+  }
+
   Register(provider);
   dls_.emplace_back(std::move(ptr));
 }
@@ -60,6 +92,69 @@ IOProvider IORegistry::Resolve(const std::string& name) const {
   return it->second;
 }
 
+/**
+ * Adapts the per value callbacks of a v1 pull to chunks of one row.
+ */
+struct V1PullShimContext {
+  void* on_complete_context_;
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
+  void (*on_all_fetched_)(void* ctx);
+};
+
+static void OnGlobalIDFetchedV1Shim(
+    void* ctx,
+    uint32_t offset,
+    uint32_t optimizer_state,
+    void* data,
+    uint32_t data_len) {
+  auto c = reinterpret_cast<V1PullShimContext*>(ctx);
+  uint64_t offsets[] = {0, data_len};
+  uint8_t present = data_len != 0;
+  IOPullChunk chunk{
+      .row_begin_ = offset,
+      .num_rows_ = 1,
+      .optimizer_state_ = optimizer_state,
+      .data_ = data,
+      .offsets_ = offsets,
+      .present_ = &present,
+  };
+  c->on_chunk_fetched_(c->on_complete_context_, &chunk);
+}
+
+static void OnAllFetchedV1Shim(void* ctx) {
+  auto c = reinterpret_cast<V1PullShimContext*>(ctx);
+  c->on_all_fetched_(c->on_complete_context_);
+  delete c;
+}
+
+void PullChunked(
+    const IOProvider& provider,
+    void* instance,
+    IOPullParameterV2 param) {
+  if (provider.version_ == k_io_version_2) {
+    provider.PullV2(instance, param);
+    return;
+  }
+  auto* shim = new V1PullShimContext{
+      .on_complete_context_ = param.on_complete_context_,
+      .on_chunk_fetched_ = param.on_chunk_fetched_,
+      .on_all_fetched_ = param.on_all_fetched_,
+  };
+  provider.Pull(
+      instance,
+      IOPullParameter{
+          .table_name_ = param.table_name_,
+          .num_cols_ = param.num_cols_,
+          .num_global_ids_ = param.num_global_ids_,
+          .col_ids_ = param.col_ids_,
+          .global_ids_ = param.global_ids_,
+          .num_optimizer_stats_ = param.num_optimizer_stats_,
+          .on_complete_context_ = shim,
+          .on_global_id_fetched_ = OnGlobalIDFetchedV1Shim,
+          .on_all_fetched_ = OnAllFetchedV1Shim,
+      });
+}
+
 IORegistry& IORegistry::Instance() {
   static IORegistry instance;
   return instance;
@@ -67,6 +162,10 @@ IORegistry& IORegistry::Instance() {
 
 void IORegistry::RegisterAllDefaultIOs() {
   RegisterRedisIO();
+  RegisterFileIO();
+  RegisterMemoryIO();
+  RegisterTieredIO();
+  RegisterRecordIO();
 }
 
 } // namespace tde::details
@@ -24,6 +24,67 @@ struct IOPullParameter {
   void (*on_all_fetched_)(void* ctx);
 };
 
+/**
+ * Values of a range of rows and one optimizer state, fetched by a v2 Pull.
+ * The index of a row is `gid_index * num_cols + col_index`, the same as the
+ * offset passed to `on_global_id_fetched_` of v1.
+ */
+struct IOPullChunk {
+  uint32_t row_begin_;
+  uint32_t num_rows_;
+  uint32_t optimizer_state_;
+  // The value of the i-th row is `data_[offsets_[i], offsets_[i + 1])`.
+  const void* data_;
+  // num_rows_ + 1 offsets in bytes.
+  const uint64_t* offsets_;
+  // num_rows_ flags, one of k_row_missing, k_row_present and
+  // k_row_in_destination.
+  const uint8_t* present_;
+};
+
+// The parameter server does not contain the row.
+static constexpr uint8_t k_row_missing = 0;
+// The value of the row is in `IOPullChunk::data_`.
+static constexpr uint8_t k_row_present = 1;
+// The value of the row is written into its `IOPullDestination`, and fills
+// it. The range of the row in `IOPullChunk::data_` is empty.
+static constexpr uint8_t k_row_in_destination = 2;
+
+/**
+ * Where the caller wants a fetched value to be.
+ */
+struct IOPullDestination {
+  void* data_;
+  uint64_t capacity_;
+};
+
+/**
+ * Pull parameter of the v2 ABI. The values are delivered in chunks instead
+ * of one callback per (global id, col id, optimizer state).
+ *
+ * `on_chunk_fetched_` can be invoked concurrently for different chunks. The
+ * chunk and the memory it points to are only valid during the callback.
+ *
+ * If `dsts_` is not null, the provider can write a value into its
+ * destination directly when the size of the value equals the capacity, and
+ * mark the row `k_row_in_destination`, which saves a copy. The destination
+ * of the i-th row and j-th optimizer state is
+ * `dsts_[i * num_optimizer_stats_ + j]`. The destinations are valid until
+ * `on_all_fetched_` is invoked.
+ */
+struct IOPullParameterV2 {
+  const char* table_name_;
+  uint32_t num_cols_;
+  uint32_t num_global_ids_;
+  const int64_t* col_ids_;
+  const int64_t* global_ids_;
+  uint32_t num_optimizer_stats_;
+  void* on_complete_context_;
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
+  void (*on_all_fetched_)(void* ctx);
+  const IOPullDestination* dsts_;
+};
+
 struct IOPushParameter {
   const char* table_name_;
   uint32_t num_cols_;
@@ -45,14 +106,45 @@ struct IOPushParameter {
   void (*on_push_complete)(void* ctx);
 };
 
+static constexpr uint32_t k_io_version_1 = 1;
+static constexpr uint32_t k_io_version_2 = 2;
+
+/**
+ * Receives a stat of a provider instance, e.g., a chunk size it adapts.
+ */
+using IOStatsEmitter = void (*)(void* ctx, const char* key, double value);
+
+/**
+ * A v1 provider implements `Pull`, and a v2 provider implements `PullV2`.
+ * The pulls of v1 providers are adapted to v2 by `IO`.
+ *
+ * A plugin declares its version by the `IO_version` symbol, an uint32_t.
+ * Plugins without it are v1. The `IO_Pull` symbol of a v2 plugin has the
+ * signature of `PullV2`.
+ *
+ * `Stats` is optional in any version, and is the `IO_Stats` symbol of a
+ * plugin. It passes each stat of the instance to `emit`.
+ */
 struct IOProvider {
   const char* type_;
   void* (*Initialize)(const char* cfg);
   void (*Pull)(void* instance, IOPullParameter cfg);
   void (*Push)(void* instance, IOPushParameter cfg);
   void (*Finalize)(void*);
+  uint32_t version_{k_io_version_1};
+  void (*PullV2)(void* instance, IOPullParameterV2 cfg){nullptr};
+  void (*Stats)(void* instance, void* ctx, IOStatsEmitter emit){nullptr};
 };
 
+/**
+ * Pull from an instance of provider through the v2 ABI. The pulls of v1
+ * providers are adapted by a shim, which delivers chunks of one row.
+ */
+void PullChunked(
+    const IOProvider& provider,
+    void* instance,
+    IOPullParameterV2 param);
+
 class IORegistry {
  public:
   void Register(IOProvider provider);
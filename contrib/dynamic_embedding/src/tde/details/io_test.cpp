@@ -0,0 +1,299 @@
+#include <atomic>
+#include "gtest/gtest.h"
+#include "tde/details/io.h"
+#include "tde/details/notification.h"
+#include "tde/details/redis_io_v1.h"
+
+namespace tde::details {
+
+/**
+ * A v1 provider, whose rows of global id `gid` are `{gid, -gid}`, and odd
+ * global ids are missing.
+ */
+static int _r = [] {
+  IORegistry::RegisterAllDefaultIOs();
+  IOProvider provider{};
+  provider.type_ = "io_test_v1";
+  provider.Initialize = +[](const char*) -> void* { return nullptr; };
+  provider.Finalize = +[](void*) {};
+  provider.Pull = +[](void*, IOPullParameter param) {
+    for (uint32_t i = 0; i < param.num_global_ids_; ++i) {
+      float row[] = {
+          static_cast<float>(param.global_ids_[i]),
+          -static_cast<float>(param.global_ids_[i])};
+      for (uint32_t os = 0; os < param.num_optimizer_stats_; ++os) {
+        param.on_global_id_fetched_(
+            param.on_complete_context_,
+            i,
+            os,
+            row,
+            param.global_ids_[i] % 2 == 0 ? sizeof(row) : 0);
+      }
+    }
+    param.on_all_fetched_(param.on_complete_context_);
+  };
+  provider.Push = +[](void*, IOPushParameter param) {
+    param.on_push_complete(param.on_complete_context_);
+  };
+  IORegistry::Instance().Register(provider);
+  return 0;
+}();
+
+// The chunks delivered by io_test_redis.
+static std::atomic<uint32_t> num_redis_chunks{0};
+
+/**
+ * A v2 provider delivering like `RedisV1`: the ids are split into jobs of 4
+ * ids, whose values are gathered into `ChunkValues` and delivered as a
+ * chunk per optimizer state. The rows are the ones of io_test_v1.
+ */
+static int _r_redis = [] {
+  IOProvider provider{};
+  provider.type_ = "io_test_redis";
+  provider.version_ = k_io_version_2;
+  provider.Initialize = +[](const char*) -> void* { return nullptr; };
+  provider.Finalize = +[](void*) {};
+  provider.PullV2 = +[](void*, IOPullParameterV2 param) {
+    constexpr uint32_t job_size = 4;
+    redis_v1::ChunkValues values;
+    for (uint32_t begin = 0; begin < param.num_global_ids_;
+         begin += job_size) {
+      uint32_t end = std::min(begin + job_size, param.num_global_ids_);
+      values.Reset(begin, param.num_optimizer_stats_);
+      for (uint32_t i = begin; i < end; ++i) {
+        int64_t gid = param.global_ids_[i];
+        float row[] = {static_cast<float>(gid), -static_cast<float>(gid)};
+        for (uint32_t os = 0; os < param.num_optimizer_stats_; ++os) {
+          if (gid % 2 != 0) {
+            values.AddMissing(os);
+            continue;
+          }
+          const IOPullDestination* dst = param.dsts_ == nullptr
+              ? nullptr
+              : &param.dsts_[i * param.num_optimizer_stats_ + os];
+          values.Add(os, reinterpret_cast<char*>(row), sizeof(row), dst);
+        }
+      }
+      for (uint32_t os = 0; os < param.num_optimizer_stats_; ++os) {
+        IOPullChunk chunk = values.Chunk(os, 0, end - begin);
+        num_redis_chunks.fetch_add(1);
+        param.on_chunk_fetched_(param.on_complete_context_, &chunk);
+      }
+    }
+    param.on_all_fetched_(param.on_complete_context_);
+  };
+  provider.Push = +[](void*, IOPushParameter param) {
+    param.on_push_complete(param.on_complete_context_);
+  };
+  IORegistry::Instance().Register(provider);
+  return 0;
+}();
+
+TEST(TDE, IO_v1_shim) {
+  IO io("io_test_v1://");
+  constexpr static int64_t global_ids[] = {2, 3, 4};
+  Notification notification;
+  io.PullBatched("table", global_ids, {}, 2, torch::kF32, 2, [&](auto res) {
+    auto opt = torch::TensorOptions().dtype(torch::kF32);
+    auto found = res.found_.template data_ptr<bool>();
+    ASSERT_TRUE(found[0]);
+    ASSERT_FALSE(found[1]);
+    ASSERT_TRUE(found[2]);
+    for (int64_t os = 0; os < 2; ++os) {
+      ASSERT_TRUE(res.rows_[os][0].allclose(torch::tensor({2, -2}, opt)));
+      ASSERT_TRUE(res.rows_[os][2].allclose(torch::tensor({4, -4}, opt)));
+    }
+    notification.Done();
+  });
+  notification.Wait();
+
+  notification.Clear();
+  io.Pull("table", global_ids, {}, 1, torch::kF32, [&](auto val) {
+    ASSERT_EQ(val.size(), 3);
+    ASSERT_FALSE(val[1].defined());
+    ASSERT_TRUE(val[2][0].allclose(
+        torch::tensor({4, -4}, torch::TensorOptions().dtype(torch::kF32))));
+    notification.Done();
+  });
+  notification.Wait();
+}
+
+TEST(TDE, IO_v2_chunks) {
+  IO io("memory://?chunk_size=3");
+  std::vector<int64_t> global_ids;
+  std::vector<float> params;
+  std::vector<uint64_t> offsets{0};
+  for (int64_t i = 0; i < 10; ++i) {
+    global_ids.emplace_back(i);
+    params.emplace_back(i);
+    params.emplace_back(-i);
+    offsets.emplace_back(params.size() * sizeof(float));
+  }
+  constexpr static uint32_t os_ids[] = {0};
+  Notification notification;
+  io.Push(
+      "table",
+      tcb::span<const int64_t>(global_ids.data(), 8),
+      {},
+      os_ids,
+      tcb::span<const uint8_t>(
+          reinterpret_cast<const uint8_t*>(params.data()),
+          params.size() * sizeof(float)),
+      tcb::span<const uint64_t>(offsets.data(), 9),
+      [&notification] { notification.Done(); });
+  notification.Wait();
+
+  // The last two ids are not pushed.
+  notification.Clear();
+  io.PullBatched("table", global_ids, {}, 1, torch::kF32, 2, [&](auto res) {
+    auto found = res.found_.template data_ptr<bool>();
+    for (int64_t i = 0; i < 10; ++i) {
+      ASSERT_EQ(found[i], i < 8);
+      if (i < 8) {
+        ASSERT_EQ(res.rows_[0][i][0].template item<float>(), i);
+        ASSERT_EQ(res.rows_[0][i][1].template item<float>(), -i);
+      }
+    }
+    notification.Done();
+  });
+  notification.Wait();
+}
+
+TEST(TDE, IO_redis_chunks) {
+  IO io("io_test_redis://");
+  std::vector<int64_t> global_ids{2, 3, 4, 6, 8, 10, 11, 12, 14, 16};
+  Notification notification;
+  num_redis_chunks = 0;
+  io.PullBatched("table", global_ids, {}, 2, torch::kF32, 2, [&](auto res) {
+    auto found = res.found_.template data_ptr<bool>();
+    for (size_t i = 0; i < global_ids.size(); ++i) {
+      int64_t gid = global_ids[i];
+      ASSERT_EQ(found[i], gid % 2 == 0);
+      if (gid % 2 != 0) {
+        continue;
+      }
+      for (int64_t os = 0; os < 2; ++os) {
+        ASSERT_EQ(res.rows_[os][i][0].template item<float>(), gid);
+        ASSERT_EQ(res.rows_[os][i][1].template item<float>(), -gid);
+      }
+    }
+    notification.Done();
+  });
+  notification.Wait();
+  // 3 jobs of 2 optimizer states, instead of a callback per row and
+  // optimizer state.
+  ASSERT_EQ(num_redis_chunks.load(), 3 * 2);
+  ASSERT_LT(num_redis_chunks.load(), global_ids.size());
+}
+
+/**
+ * Pull rows of 2 floats into dsts through io, the missing rows are left
+ * untouched.
+ */
+static std::vector<bool> PullInto(
+    IO& io,
+    const std::vector<int64_t>& global_ids,
+    std::vector<float>& dsts) {
+  std::vector<IOPullDestination> destinations;
+  for (size_t i = 0; i < global_ids.size(); ++i) {
+    destinations.emplace_back(IOPullDestination{
+        .data_ = dsts.data() + i * 2,
+        .capacity_ = 2 * sizeof(float),
+    });
+  }
+  std::vector<bool> found;
+  Notification notification;
+  io.PullInto(
+      "table",
+      global_ids,
+      {},
+      1,
+      torch::kF32,
+      std::move(destinations),
+      [&](auto res) {
+        ASSERT_FALSE(res.rows_.defined());
+        auto ptr = res.found_.template data_ptr<bool>();
+        found.assign(ptr, ptr + global_ids.size());
+        notification.Done();
+      });
+  notification.Wait();
+  return found;
+}
+
+TEST(TDE, IO_pull_into) {
+  std::vector<float> dsts(6, 0);
+  {
+    IO io("io_test_v1://");
+    auto found = PullInto(io, {2, 3, 4}, dsts);
+    ASSERT_EQ(found, std::vector<bool>({true, false, true}));
+    ASSERT_EQ(dsts, std::vector<float>({2, -2, 0, 0, 4, -4}));
+  }
+
+  IO io("memory://");
+  constexpr static int64_t global_ids[] = {1, 2};
+  constexpr static uint32_t os_ids[] = {0};
+  constexpr static float params[] = {1, -1, 2, -2};
+  constexpr static uint64_t offsets[] = {
+      0 * sizeof(float), 2 * sizeof(float), 4 * sizeof(float)};
+  Notification notification;
+  io.Push(
+      "table",
+      global_ids,
+      {},
+      os_ids,
+      tcb::span<const uint8_t>(
+          reinterpret_cast<const uint8_t*>(params), sizeof(params)),
+      offsets,
+      [&notification] { notification.Done(); });
+  notification.Wait();
+  // memory:// writes the rows into the destinations directly.
+  std::fill(dsts.begin(), dsts.end(), 0);
+  auto found = PullInto(io, {1, 5, 2}, dsts);
+  ASSERT_EQ(found, std::vector<bool>({true, false, true}));
+  ASSERT_EQ(dsts, std::vector<float>({1, -1, 0, 0, 2, -2}));
+}
+
+TEST(TDE, IO_stats) {
+  IO io("io_test_v1://");
+  constexpr static int64_t global_ids[] = {2, 3, 4};
+  Notification notification;
+  io.PullBatched("table", global_ids, {}, 2, torch::kF32, 2, [&](auto) {
+    notification.Done();
+  });
+  notification.Wait();
+
+  constexpr static uint32_t os_ids[] = {0};
+  constexpr static float params[] = {0, 0, 2, -2, 4, -4};
+  constexpr static uint64_t offsets[] = {
+      2 * sizeof(float), 4 * sizeof(float), 6 * sizeof(float)};
+  notification.Clear();
+  io.Push(
+      "table",
+      tcb::span<const int64_t>(global_ids + 1, 2),
+      {},
+      os_ids,
+      tcb::span<const uint8_t>(
+          reinterpret_cast<const uint8_t*>(params), sizeof(params)),
+      offsets,
+      [&notification] { notification.Done(); });
+  notification.Wait();
+
+  auto stats = io.Stats();
+  auto stat = [&](const std::string& name) {
+    return stats.at("io.io_test_v1.table." + name);
+  };
+  ASSERT_EQ(stat("num_pulls"), 1);
+  ASSERT_EQ(stat("num_pulled_rows"), 3);
+  ASSERT_EQ(stat("num_missing_rows"), 1);
+  ASSERT_NEAR(stat("missing_rate"), 1.0 / 3, 1e-6);
+  // 2 rows of 2 optimizer states of 2 floats.
+  ASSERT_EQ(stat("pulled_bytes"), 2 * 2 * 2 * sizeof(float));
+  ASSERT_EQ(stat("pull_latency_us.count"), 1);
+  ASSERT_EQ(stat("num_pushes"), 1);
+  ASSERT_EQ(stat("num_pushed_rows"), 2);
+  // Only the bytes in between the offsets are pushed.
+  ASSERT_EQ(stat("pushed_bytes"), 4 * sizeof(float));
+  ASSERT_EQ(stat("push_latency_us.count"), 1);
+}
+
+} // namespace tde::details
@@ -0,0 +1,137 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "tde/details/io_registry.h"
+#include "tde/details/notification.h"
+
+namespace tde::details {
+
+/**
+ * Helpers of the IO provider tests. The tables are named "table", and `io`
+ * is either an instance with `Push` and `Pull` members, or a callable taking
+ * the parameter.
+ */
+
+/**
+ * Push the values of global_ids and the optimizer states os_ids, and wait.
+ * The layout of data is [global id][optimizer state][dim], and every value
+ * has the same dim.
+ */
+template <typename IO>
+void PushRows(
+    IO&& io,
+    const std::vector<int64_t>& global_ids,
+    const std::vector<uint32_t>& os_ids,
+    const std::vector<float>& data) {
+  size_t num_values = global_ids.size() * os_ids.size();
+  uint64_t value_bytes = data.size() / num_values * sizeof(float);
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i <= num_values; ++i) {
+    offsets.emplace_back(i * value_bytes);
+  }
+  Notification notification;
+  IOPushParameter param{
+      .table_name_ = "table",
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = static_cast<uint32_t>(os_ids.size()),
+      .optimizer_stats_ids_ = os_ids.data(),
+      .num_offsets_ = static_cast<uint32_t>(offsets.size()),
+      .offsets_ = offsets.data(),
+      .data_ = data.data(),
+      .on_complete_context_ = &notification,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+  };
+  if constexpr (std::is_invocable_v<IO, IOPushParameter>) {
+    io(param);
+  } else {
+    io.Push(param);
+  }
+  notification.Wait();
+}
+
+struct PullResult {
+  Notification notification_;
+  std::mutex mu_;
+  uint32_t num_optimizer_stats_;
+  // (row, optimizer state) -> value, empty if not delivered as present.
+  std::vector<std::vector<float>> values_;
+  std::vector<int> num_deliveries_;
+  std::vector<uint8_t> present_;
+
+  [[nodiscard]] const std::vector<float>& Value(size_t row, uint32_t os = 0)
+      const {
+    return values_[row * num_optimizer_stats_ + os];
+  }
+};
+
+/**
+ * Pull global_ids of num_optimizer_stats states, into dsts if not null nor
+ * empty, which are split evenly among the values, and wait.
+ */
+template <typename IO>
+std::unique_ptr<PullResult> PullRows(
+    IO&& io,
+    const std::vector<int64_t>& global_ids,
+    uint32_t num_optimizer_stats = 1,
+    std::vector<float>* dsts = nullptr) {
+  size_t num_values = global_ids.size() * num_optimizer_stats;
+  auto result = std::make_unique<PullResult>();
+  result->num_optimizer_stats_ = num_optimizer_stats;
+  result->values_.resize(num_values);
+  result->num_deliveries_.resize(num_values);
+  result->present_.resize(num_values);
+  std::vector<IOPullDestination> destinations;
+  if (dsts != nullptr && !dsts->empty()) {
+    size_t dim = dsts->size() / num_values;
+    for (size_t i = 0; i < num_values; ++i) {
+      destinations.emplace_back(IOPullDestination{
+          .data_ = dsts->data() + i * dim,
+          .capacity_ = dim * sizeof(float),
+      });
+    }
+  }
+  IOPullParameterV2 param{
+      .table_name_ = "table",
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = num_optimizer_stats,
+      .on_complete_context_ = result.get(),
+      .on_chunk_fetched_ =
+          +[](void* ctx, const IOPullChunk* chunk) {
+            auto* r = reinterpret_cast<PullResult*>(ctx);
+            std::lock_guard<std::mutex> lock(r->mu_);
+            auto* data = reinterpret_cast<const uint8_t*>(chunk->data_);
+            for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+              uint32_t k = (chunk->row_begin_ + i) * r->num_optimizer_stats_ +
+                  chunk->optimizer_state_;
+              ++r->num_deliveries_[k];
+              r->present_[k] = chunk->present_[i];
+              if (chunk->present_[i] != k_row_present) {
+                continue;
+              }
+              r->values_[k].assign(
+                  reinterpret_cast<const float*>(data + chunk->offsets_[i]),
+                  reinterpret_cast<const float*>(
+                      data + chunk->offsets_[i + 1]));
+            }
+          },
+      .on_all_fetched_ =
+          +[](void* ctx) {
+            reinterpret_cast<PullResult*>(ctx)->notification_.Done();
+          },
+      .dsts_ = destinations.empty() ? nullptr : destinations.data(),
+  };
+  if constexpr (std::is_invocable_v<IO, IOPullParameterV2>) {
+    io(param);
+  } else {
+    io.Pull(param);
+  }
+  result->notification_.Wait();
+  return result;
+}
+
+} // namespace tde::details
@@ -0,0 +1,32 @@
+#include "tde/details/latency_window.h"
+#include <algorithm>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+LatencyWindow::LatencyWindow(uint32_t capacity, double quantile)
+    : quantile_(quantile), samples_(capacity) {
+  TORCH_CHECK(capacity != 0, "capacity must not be zero");
+  TORCH_CHECK(
+      quantile >= 0 && quantile <= 1, "quantile ", quantile, " not in [0, 1]");
+}
+
+void LatencyWindow::Record(uint64_t latency_us) {
+  std::lock_guard<std::mutex> lock(mu_);
+  size_t capacity = samples_.size();
+  samples_[num_samples_ % capacity] = latency_us;
+  ++num_samples_;
+  uint64_t period = std::max<uint64_t>(capacity / 16, 1);
+  if (num_samples_ < std::max<uint64_t>(capacity / 4, 1) ||
+      num_samples_ % period != 0) {
+    return;
+  }
+  size_t n = std::min<uint64_t>(num_samples_, capacity);
+  sorted_.assign(samples_.begin(), samples_.begin() + n);
+  auto nth = sorted_.begin() +
+      std::min<size_t>(static_cast<size_t>(quantile_ * n), n - 1);
+  std::nth_element(sorted_.begin(), nth, sorted_.end());
+  quantile_us_.store(*nth, std::memory_order_relaxed);
+}
+
+} // namespace tde::details
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace tde::details {
+
+/**
+ * A quantile of the latest latencies, e.g., of the chunks of a pipeline.
+ *
+ * The last capacity samples are kept in a ring, and the quantile is
+ * recomputed every capacity / 16 records, so `Quantile` is lock-free and
+ * recent. It is 0 until a quarter of the ring is filled.
+ *
+ * `Record` can be called concurrently.
+ */
+class LatencyWindow {
+ public:
+  /**
+   * @param quantile in [0, 1], e.g., 0.95.
+   */
+  LatencyWindow(uint32_t capacity, double quantile);
+
+  LatencyWindow(const LatencyWindow&) = delete;
+  LatencyWindow& operator=(const LatencyWindow&) = delete;
+
+  void Record(uint64_t latency_us);
+
+  [[nodiscard]] uint64_t Quantile() const {
+    return quantile_us_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  double quantile_;
+  std::mutex mu_;
+  std::vector<uint64_t> samples_;
+  std::vector<uint64_t> sorted_;
+  uint64_t num_samples_{0};
+  std::atomic<uint64_t> quantile_us_{0};
+};
+
+} // namespace tde::details
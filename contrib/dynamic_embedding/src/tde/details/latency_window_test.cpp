@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+#include "tde/details/latency_window.h"
+
+namespace tde::details {
+
+TEST(TDE, LatencyWindow_quantile) {
+  LatencyWindow window(64, 0.9);
+  // Not known until a quarter of the window is filled.
+  for (uint64_t i = 1; i < 16; ++i) {
+    window.Record(i);
+  }
+  ASSERT_EQ(window.Quantile(), 0);
+  window.Record(16);
+  ASSERT_EQ(window.Quantile(), 15);
+
+  for (uint64_t i = 17; i <= 64; ++i) {
+    window.Record(i);
+  }
+  ASSERT_EQ(window.Quantile(), 58);
+}
+
+TEST(TDE, LatencyWindow_recent) {
+  LatencyWindow window(64, 0.5);
+  for (int i = 0; i < 64; ++i) {
+    window.Record(1000);
+  }
+  ASSERT_EQ(window.Quantile(), 1000);
+  // The old samples are forgotten.
+  for (int i = 0; i < 64; ++i) {
+    window.Record(10);
+  }
+  ASSERT_EQ(window.Quantile(), 10);
+}
+
+} // namespace tde::details
@@ -0,0 +1,849 @@
+#include "tde/details/log_file_io.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <variant>
+#include "lexy/callback.hpp"
+#include "lexy/dsl.hpp"
+#include "tcb/span.hpp"
+#include "tde/details/url.h"
+
+namespace tde::details::log_file_io {
+
+static constexpr uint32_t k_record_magic = 0x7D3E0A01;
+static constexpr uint64_t k_record_alignment = 8;
+// Alignment of appends and of reads with O_DIRECT.
+static constexpr uint64_t k_block_size = 4096;
+// Values closer than this in a segment are read by one pread.
+static constexpr uint64_t k_max_read_gap = 64 * 1024;
+static constexpr uint64_t k_max_read_size = 4 * 1024 * 1024;
+
+struct NumThreadsOpt {
+  uint32_t num_threads_;
+};
+struct ChunkSizeOpt {
+  uint32_t chunk_size_;
+};
+struct SegmentSizeOpt {
+  uint32_t segment_size_;
+};
+struct DirectIOOpt {
+  uint32_t direct_io_;
+};
+struct CompactRatioOpt {
+  uint32_t ratio_;
+};
+struct CompactIntervalMsOpt {
+  uint32_t interval_;
+};
+
+using OptVar = std::variant<
+    NumThreadsOpt,
+    ChunkSizeOpt,
+    SegmentSizeOpt,
+    DirectIOOpt,
+    CompactRatioOpt,
+    CompactIntervalMsOpt>;
+
+struct OptionSetter {
+  void operator()(Option* self, NumThreadsOpt opt) {
+    TORCH_CHECK(opt.num_threads_ != 0);
+    self->num_io_threads_ = opt.num_threads_;
+  }
+  void operator()(Option* self, ChunkSizeOpt opt) {
+    TORCH_CHECK(opt.chunk_size_ != 0);
+    self->chunk_size_ = opt.chunk_size_;
+  }
+  void operator()(Option* self, SegmentSizeOpt opt) {
+    TORCH_CHECK(opt.segment_size_ != 0);
+    self->segment_size_ = opt.segment_size_;
+  }
+  void operator()(Option* self, DirectIOOpt opt) {
+    self->direct_io_ = opt.direct_io_ != 0;
+  }
+  void operator()(Option* self, CompactRatioOpt opt) {
+    TORCH_CHECK(opt.ratio_ != 0 && opt.ratio_ <= 100);
+    self->compact_ratio_ = opt.ratio_;
+  }
+  void operator()(Option* self, CompactIntervalMsOpt opt) {
+    TORCH_CHECK(opt.interval_ != 0);
+    self->compact_interval_ms_ = opt.interval_;
+  }
+};
+
+namespace option_rules {
+namespace dsl = lexy::dsl;
+struct Integer {
+  constexpr static auto rule =
+      dsl::integer<uint32_t>(dsl::digits<>.no_leading_zero());
+  constexpr static auto value = lexy::construct<uint32_t>;
+};
+
+struct NumThreads {
+  constexpr static auto rule = LEXY_LIT("num_threads=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<NumThreadsOpt>;
+};
+
+struct ChunkSize {
+  constexpr static auto rule = LEXY_LIT("chunk_size=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<ChunkSizeOpt>;
+};
+
+struct SegmentSize {
+  constexpr static auto rule = LEXY_LIT("segment_size=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<SegmentSizeOpt>;
+};
+
+struct DirectIO {
+  constexpr static auto rule = LEXY_LIT("direct_io=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<DirectIOOpt>;
+};
+
+struct CompactRatio {
+  constexpr static auto rule = LEXY_LIT("compact_ratio=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<CompactRatioOpt>;
+};
+
+struct CompactInterval {
+  constexpr static auto rule =
+      LEXY_LIT("compact_interval_ms=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<CompactIntervalMsOpt>;
+};
+
+struct UnknownOption {
+  constexpr static auto name = "unknown option";
+};
+
+struct Option {
+  constexpr static auto rule = dsl::p<NumThreads> | dsl::p<ChunkSize> |
+      dsl::p<SegmentSize> | dsl::p<DirectIO> | dsl::p<CompactRatio> |
+      dsl::p<CompactInterval> | dsl::error<UnknownOption>;
+  constexpr static auto value = lexy::construct<OptVar>;
+};
+
+struct Options {
+  constexpr static auto rule =
+      dsl::list(dsl::p<Option>, dsl::sep(LEXY_LIT("&&")));
+
+  constexpr static auto value = lexy::as_list<std::vector<OptVar>>;
+};
+
+} // namespace option_rules
+
+Option::Option(std::string_view config_str) {
+  auto pos = config_str.find('?');
+  std::string_view path = config_str.substr(0, pos);
+  while (path.size() > 1 && path.back() == '/') {
+    path.remove_suffix(1);
+  }
+  TORCH_CHECK(!path.empty(), "path of file io must not be empty");
+  path_ = std::string(path);
+
+  if (pos == std::string_view::npos) {
+    return;
+  }
+  std::ostringstream err_oss_;
+  url_parser::ErrorCollector collector{err_oss_};
+
+  auto result = lexy::parse<option_rules::Options>(
+      lexy::string_input(config_str.substr(pos + 1)), collector);
+  auto err_str = err_oss_.str();
+
+  TORCH_CHECK(
+      result.has_value() && err_str.empty(), "parse param error ", err_str);
+
+  for (auto&& opt_var : result.value()) {
+    std::visit(
+        [this](auto&& opt) {
+          OptionSetter setter;
+          setter(this, std::move(opt));
+        },
+        opt_var);
+  }
+}
+
+static uint64_t RoundUp(uint64_t n, uint64_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t RecordSize(uint32_t table_name_len, uint32_t data_len) {
+  return RoundUp(
+      sizeof(RecordHeader) + table_name_len + data_len, k_record_alignment);
+}
+
+struct AlignedDeleter {
+  void operator()(uint8_t* ptr) const {
+    free(ptr);
+  }
+};
+
+using AlignedPtr = std::unique_ptr<uint8_t[], AlignedDeleter>;
+
+/**
+ * Allocate a buffer which can be used with O_DIRECT. The size is rounded up
+ * to the block size.
+ */
+static AlignedPtr AllocAligned(uint64_t size) {
+  void* ptr = std::aligned_alloc(k_block_size, RoundUp(size, k_block_size));
+  TORCH_CHECK(ptr != nullptr, "cannot allocate ", size, " bytes");
+  return AlignedPtr(reinterpret_cast<uint8_t*>(ptr));
+}
+
+static void PWriteAll(
+    int fd,
+    const uint8_t* data,
+    uint64_t size,
+    uint64_t offset) {
+  while (size != 0) {
+    ssize_t n = pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    TORCH_CHECK(n > 0, "write segment error, errno ", errno);
+    data += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+/**
+ * Read until size bytes are read or the end of file.
+ * @return bytes read.
+ */
+static uint64_t
+PReadAll(int fd, uint8_t* data, uint64_t size, uint64_t offset) {
+  uint64_t total = 0;
+  while (total < size) {
+    ssize_t n =
+        pread(fd, data + total, size - total, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    TORCH_CHECK(n >= 0, "read segment error, errno ", errno);
+    if (n == 0) {
+      break;
+    }
+    total += n;
+    offset += n;
+  }
+  return total;
+}
+
+/**
+ * Read the whole file without O_DIRECT, whose size may be unaligned.
+ */
+static std::vector<uint8_t> ReadFile(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  TORCH_CHECK(fd >= 0, "cannot open ", filename, ", errno ", errno);
+  struct stat st {};
+  fstat(fd, &st);
+  std::vector<uint8_t> data(st.st_size);
+  data.resize(PReadAll(fd, data.data(), data.size(), 0));
+  close(fd);
+  return data;
+}
+
+/**
+ * Call f(record offset, header, table name) for each record. Bytes which do
+ * not start with a record magic are the padding to the next block.
+ */
+template <typename F>
+static void ForEachRecord(const std::vector<uint8_t>& data, F&& f) {
+  uint64_t pos = 0;
+  while (pos + sizeof(RecordHeader) <= data.size()) {
+    RecordHeader header{};
+    memcpy(&header, data.data() + pos, sizeof(header));
+    if (header.magic_ != k_record_magic) {
+      pos = RoundUp(pos + 1, k_block_size);
+      continue;
+    }
+    uint64_t record_size =
+        RecordSize(header.table_name_len_, header.data_len_);
+    if (pos + record_size > data.size()) {
+      // torn write.
+      break;
+    }
+    std::string_view table_name(
+        reinterpret_cast<const char*>(data.data() + pos + sizeof(header)),
+        header.table_name_len_);
+    f(pos, header, table_name);
+    pos += record_size;
+  }
+}
+
+size_t KeyHash::operator()(const Key& key) const {
+  uint64_t h = static_cast<uint64_t>(key.global_id_) * 0x9E3779B97F4A7C15ULL;
+  h ^= (static_cast<uint64_t>(key.col_id_) +
+        (static_cast<uint64_t>(key.table_id_) << 32 | key.os_id_)) *
+      0xC2B2AE3D27D4EB4FULL;
+  return h ^ (h >> 29);
+}
+
+Segment::~Segment() {
+  close(fd_);
+}
+
+LogFileIO::LogFileIO(Option opt) : opt_(std::move(opt)) {
+  std::filesystem::create_directories(opt_.path_);
+  Recover();
+  compact_thread_ = std::thread([this] {
+    std::chrono::milliseconds interval(opt_.compact_interval_ms_);
+    std::unique_lock<std::mutex> lock(stop_mu_);
+    while (!stop_cv_.wait_for(lock, interval, [this] { return stopping_; })) {
+      lock.unlock();
+      Compact();
+      lock.lock();
+    }
+  });
+  pool_ = std::make_unique<ThreadPool>(opt_.num_io_threads_);
+}
+
+LogFileIO::~LogFileIO() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mu_);
+    stopping_ = true;
+  }
+  stop_cv_.notify_all();
+  compact_thread_.join();
+  pool_.reset();
+}
+
+uint32_t LogFileIO::GetTableID(std::string_view table_name) {
+  std::lock_guard<std::mutex> lock(tables_mu_);
+  auto [it, _] = table_ids_.try_emplace(
+      std::string(table_name), static_cast<uint32_t>(table_ids_.size()));
+  return it->second;
+}
+
+LogFileIO::IndexShard& LogFileIO::GetIndexShard(const Key& key) {
+  auto h = static_cast<uint64_t>(key.global_id_) ^ key.os_id_;
+  return index_shards_[h % k_num_index_shards];
+}
+
+std::shared_ptr<Segment> LogFileIO::OpenSegment(uint32_t id, bool create) {
+  char name[32];
+  snprintf(name, sizeof(name), "segment_%08u.log", id);
+  std::string filename = opt_.path_ + "/" + name;
+  int flags = O_RDWR;
+  if (create) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+  if (opt_.direct_io_) {
+    flags |= O_DIRECT;
+  }
+  int fd = open(filename.c_str(), flags, 0644);
+  TORCH_CHECK(fd >= 0, "cannot open ", filename, ", errno ", errno);
+  return std::make_shared<Segment>(id, fd, std::move(filename));
+}
+
+void LogFileIO::Recover() {
+  std::vector<uint32_t> ids;
+  for (auto& entry : std::filesystem::directory_iterator(opt_.path_)) {
+    uint32_t id;
+    if (sscanf(entry.path().filename().c_str(), "segment_%u.log", &id) == 1) {
+      ids.emplace_back(id);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+
+  uint64_t max_seq = 0;
+  ska::flat_hash_map<uint32_t, uint64_t> garbage;
+  for (uint32_t id : ids) {
+    auto segment = OpenSegment(id, false);
+    std::vector<uint8_t> data = ReadFile(segment->filename_);
+    segment->size_ = data.size();
+    ForEachRecord(
+        data,
+        [&](uint64_t pos,
+            const RecordHeader& header,
+            std::string_view table_name) {
+          Key key{
+              .table_id_ = GetTableID(table_name),
+              .os_id_ = header.os_id_,
+              .global_id_ = header.global_id_,
+              .col_id_ = header.col_id_,
+          };
+          Location loc{
+              .segment_id_ = id,
+              .data_len_ = header.data_len_,
+              .offset_ = pos + sizeof(header) + header.table_name_len_,
+              .seq_ = header.seq_,
+          };
+          UpdateIndex(key, loc, header.table_name_len_, garbage);
+          max_seq = std::max(max_seq, header.seq_);
+        });
+    segments_[id] = std::move(segment);
+    next_segment_id_ = id + 1;
+  }
+  AddGarbage(garbage);
+  next_seq_ = max_seq + 1;
+}
+
+std::pair<std::shared_ptr<Segment>, uint64_t> LogFileIO::Append(
+    const uint8_t* data,
+    uint64_t size) {
+  std::shared_ptr<Segment> segment;
+  uint64_t offset;
+  {
+    std::lock_guard<std::mutex> lock(write_mu_);
+    if (active_segment_ == nullptr ||
+        (active_segment_->size_ != 0 &&
+         active_segment_->size_ + size > opt_.segment_size_)) {
+      active_segment_ = OpenSegment(next_segment_id_++, true);
+      std::unique_lock<std::shared_mutex> segments_lock(segments_mu_);
+      segments_[active_segment_->id_] = active_segment_;
+    }
+    segment = active_segment_;
+    offset = segment->size_;
+    segment->size_ += size;
+    ++segment->pending_writes_;
+  }
+  // Appends reserve disjoint ranges, so they can be written concurrently.
+  PWriteAll(segment->fd_, data, size, offset);
+  return {std::move(segment), offset};
+}
+
+void LogFileIO::UpdateIndex(
+    const Key& key,
+    const Location& loc,
+    uint32_t table_name_len,
+    ska::flat_hash_map<uint32_t, uint64_t>& garbage) {
+  auto& shard = GetIndexShard(key);
+  std::lock_guard<std::mutex> lock(shard.mu_);
+  auto [it, inserted] = shard.locations_.try_emplace(key, loc);
+  if (inserted) {
+    return;
+  }
+  Location& current = it->second;
+  if (current.seq_ > loc.seq_) {
+    garbage[loc.segment_id_] += RecordSize(table_name_len, loc.data_len_);
+    return;
+  }
+  garbage[current.segment_id_] +=
+      RecordSize(table_name_len, current.data_len_);
+  current = loc;
+}
+
+void LogFileIO::AddGarbage(
+    const ska::flat_hash_map<uint32_t, uint64_t>& garbage) {
+  if (garbage.empty()) {
+    return;
+  }
+  std::shared_lock<std::shared_mutex> lock(segments_mu_);
+  for (auto& [id, bytes] : garbage) {
+    // The segment may have been compacted.
+    if (auto it = segments_.find(id); it != segments_.end()) {
+      it->second->garbage_bytes_ += bytes;
+    }
+  }
+}
+
+struct LogFileIOPullContext {
+  std::atomic<uint32_t> num_complete_ids_{0};
+  uint32_t table_id_;
+  std::vector<int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  uint32_t num_optimizer_stats_;
+  void* on_complete_context_;
+  void (*on_global_id_fetched_)(
+      void* ctx,
+      uint32_t gid_offset,
+      uint32_t optimizer_state,
+      void* data,
+      uint32_t data_len);
+  void (*on_all_fetched_)(void* ctx);
+
+  LogFileIOPullContext(uint32_t table_id, IOPullParameter param)
+      : table_id_(table_id),
+        global_ids_(
+            param.global_ids_,
+            param.global_ids_ + param.num_global_ids_),
+        num_optimizer_stats_(param.num_optimizer_stats_),
+        on_complete_context_(param.on_complete_context_),
+        on_global_id_fetched_(param.on_global_id_fetched_),
+        on_all_fetched_(param.on_all_fetched_) {
+    if (param.num_cols_ == 0) {
+      col_ids_.emplace_back(-1);
+    } else {
+      col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_);
+    }
+  }
+};
+
+void LogFileIO::Pull(IOPullParameter param) {
+  if (param.num_global_ids_ == 0) {
+    param.on_all_fetched_(param.on_complete_context_);
+    return;
+  }
+  auto* ctx =
+      new LogFileIOPullContext(GetTableID(param.table_name_), param);
+  for (uint32_t i = 0; i < param.num_global_ids_; i += opt_.chunk_size_) {
+    pool_->Enqueue([i, ctx, this] { DoPull(i, ctx); });
+  }
+}
+
+void LogFileIO::DoPull(uint32_t gid_offset, void* pull_ctx) {
+  auto& ctx = *reinterpret_cast<LogFileIOPullContext*>(pull_ctx);
+  uint32_t end = std::min(
+      gid_offset + opt_.chunk_size_,
+      static_cast<uint32_t>(ctx.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(ctx.col_ids_.size());
+
+  struct PendingRead {
+    uint32_t offset_;
+    uint32_t os_id_;
+    Location loc_;
+  };
+  std::vector<PendingRead> reads;
+  std::vector<std::pair<uint32_t, uint32_t>> missing;
+  ska::flat_hash_map<uint32_t, std::shared_ptr<Segment>> segments;
+  {
+    std::shared_lock<std::shared_mutex> lock(segments_mu_);
+    for (uint32_t i = gid_offset; i < end; ++i) {
+      for (uint32_t j = 0; j < num_cols; ++j) {
+        uint32_t offset = i * num_cols + j;
+        for (uint32_t os_id = 0; os_id < ctx.num_optimizer_stats_; ++os_id) {
+          Key key{
+              .table_id_ = ctx.table_id_,
+              .os_id_ = os_id,
+              .global_id_ = ctx.global_ids_[i],
+              .col_id_ = ctx.col_ids_[j],
+          };
+          auto& shard = GetIndexShard(key);
+          std::unique_lock<std::mutex> shard_lock(shard.mu_);
+          auto it = shard.locations_.find(key);
+          if (it == shard.locations_.end()) {
+            shard_lock.unlock();
+            missing.emplace_back(offset, os_id);
+            continue;
+          }
+          Location loc = it->second;
+          shard_lock.unlock();
+          reads.emplace_back(PendingRead{offset, os_id, loc});
+          if (segments.find(loc.segment_id_) == segments.end()) {
+            segments[loc.segment_id_] = segments_.at(loc.segment_id_);
+          }
+        }
+      }
+    }
+  }
+
+  for (auto [offset, os_id] : missing) {
+    ctx.on_global_id_fetched_(
+        ctx.on_complete_context_, offset, os_id, nullptr, 0);
+  }
+
+  std::sort(reads.begin(), reads.end(), [](auto& a, auto& b) {
+    return std::tie(a.loc_.segment_id_, a.loc_.offset_) <
+        std::tie(b.loc_.segment_id_, b.loc_.offset_);
+  });
+
+  AlignedPtr buffer;
+  uint64_t buffer_size = 0;
+  for (size_t begin = 0; begin < reads.size();) {
+    // Coalesce the nearby values of one segment.
+    const Location& first = reads[begin].loc_;
+    uint64_t range_begin = first.offset_;
+    uint64_t range_end = first.offset_ + first.data_len_;
+    size_t stop = begin + 1;
+    for (; stop < reads.size(); ++stop) {
+      const Location& loc = reads[stop].loc_;
+      uint64_t loc_end = loc.offset_ + loc.data_len_;
+      if (loc.segment_id_ != first.segment_id_ ||
+          loc.offset_ > range_end + k_max_read_gap ||
+          std::max(range_end, loc_end) - range_begin > k_max_read_size) {
+        break;
+      }
+      range_end = std::max(range_end, loc_end);
+    }
+    if (opt_.direct_io_) {
+      range_begin = range_begin / k_block_size * k_block_size;
+      range_end = RoundUp(range_end, k_block_size);
+    }
+    uint64_t range_size = range_end - range_begin;
+    if (range_size > buffer_size) {
+      buffer = AllocAligned(range_size);
+      buffer_size = RoundUp(range_size, k_block_size);
+    }
+    auto& segment = segments[first.segment_id_];
+    PReadAll(segment->fd_, buffer.get(), range_size, range_begin);
+    for (size_t k = begin; k < stop; ++k) {
+      auto& read = reads[k];
+      ctx.on_global_id_fetched_(
+          ctx.on_complete_context_,
+          read.offset_,
+          read.os_id_,
+          buffer.get() + (read.loc_.offset_ - range_begin),
+          read.loc_.data_len_);
+    }
+    begin = stop;
+  }
+
+  uint32_t n = end - gid_offset;
+  uint32_t target = ctx.global_ids_.size();
+  if (ctx.num_complete_ids_.fetch_add(n) + n == target) {
+    ctx.on_all_fetched_(ctx.on_complete_context_);
+    delete &ctx;
+  }
+}
+
+struct LogFileIOPushContext {
+  std::atomic<uint32_t> num_complete_ids_{0};
+  std::string table_name_;
+  uint32_t table_id_;
+  tcb::span<const int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  tcb::span<const uint32_t> os_ids_;
+  tcb::span<const uint64_t> offsets_;
+  const void* data_;
+  void* on_complete_context_;
+  void (*on_push_complete_)(void*);
+
+  LogFileIOPushContext(uint32_t table_id, IOPushParameter param)
+      : table_name_(param.table_name_),
+        table_id_(table_id),
+        global_ids_(param.global_ids_, param.num_global_ids_),
+        os_ids_(param.optimizer_stats_ids_, param.num_optimizer_stats_),
+        offsets_(param.offsets_, param.num_offsets_),
+        data_(param.data_),
+        on_complete_context_(param.on_complete_context_),
+        on_push_complete_(param.on_push_complete) {
+    if (param.num_cols_ != 0) {
+      col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_);
+    } else {
+      col_ids_.emplace_back(-1);
+    }
+  }
+};
+
+void LogFileIO::Push(IOPushParameter param) {
+  if (param.num_global_ids_ == 0) {
+    param.on_push_complete(param.on_complete_context_);
+    return;
+  }
+  auto* ctx =
+      new LogFileIOPushContext(GetTableID(param.table_name_), param);
+  for (uint32_t i = 0; i < param.num_global_ids_; i += opt_.chunk_size_) {
+    pool_->Enqueue([i, ctx, this] { DoPush(i, ctx); });
+  }
+}
+
+void LogFileIO::DoPush(uint32_t gid_offset, void* push_ctx) {
+  auto& ctx = *reinterpret_cast<LogFileIOPushContext*>(push_ctx);
+  uint32_t end = std::min(
+      gid_offset + opt_.chunk_size_,
+      static_cast<uint32_t>(ctx.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(ctx.col_ids_.size());
+  auto num_os = static_cast<uint32_t>(ctx.os_ids_.size());
+  auto name_len = static_cast<uint32_t>(ctx.table_name_.size());
+
+  auto loop = [&](auto&& callback) {
+    for (uint32_t i = gid_offset; i < end; ++i) {
+      for (uint32_t j = 0; j < num_cols; ++j) {
+        for (uint32_t k = 0; k < num_os; ++k) {
+          uint32_t offset = k + j * num_os + i * num_cols * num_os;
+          callback(offset, i, j, k);
+        }
+      }
+    }
+  };
+
+  uint64_t size = 0;
+  loop([&](uint32_t o, ...) {
+    size += RecordSize(name_len, ctx.offsets_[o + 1] - ctx.offsets_[o]);
+  });
+  uint64_t num_records = static_cast<uint64_t>(end - gid_offset) *
+      num_cols * num_os;
+  uint64_t seq = next_seq_.fetch_add(num_records);
+
+  // Pad the append to blocks, so that every append starts at an aligned
+  // offset for O_DIRECT.
+  uint64_t append_size =
+      opt_.direct_io_ ? RoundUp(size, k_block_size) : size;
+  AlignedPtr buffer = AllocAligned(append_size);
+  memset(buffer.get() + size, 0, append_size - size);
+  std::vector<Location> locations;
+  locations.reserve(num_records);
+  uint64_t pos = 0;
+  loop([&](uint32_t o, uint32_t i, uint32_t j, uint32_t k) {
+    uint64_t beg = ctx.offsets_[o];
+    auto data_len = static_cast<uint32_t>(ctx.offsets_[o + 1] - beg);
+    RecordHeader header{
+        .magic_ = k_record_magic,
+        .data_len_ = data_len,
+        .seq_ = seq + locations.size(),
+        .global_id_ = ctx.global_ids_[i],
+        .col_id_ = ctx.col_ids_[j],
+        .os_id_ = ctx.os_ids_[k],
+        .table_name_len_ = name_len,
+    };
+    uint8_t* record = buffer.get() + pos;
+    uint64_t record_size = RecordSize(name_len, data_len);
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), ctx.table_name_.data(), name_len);
+    memcpy(
+        record + sizeof(header) + name_len,
+        reinterpret_cast<const uint8_t*>(ctx.data_) + beg,
+        data_len);
+    memset(
+        record + sizeof(header) + name_len + data_len,
+        0,
+        record_size - sizeof(header) - name_len - data_len);
+    locations.emplace_back(Location{
+        .data_len_ = data_len,
+        .offset_ = pos + sizeof(header) + name_len,
+        .seq_ = header.seq_,
+    });
+    pos += record_size;
+  });
+
+  auto [segment, base] = Append(buffer.get(), append_size);
+
+  ska::flat_hash_map<uint32_t, uint64_t> garbage;
+  size_t r = 0;
+  loop([&](uint32_t, uint32_t i, uint32_t j, uint32_t k) {
+    Location& loc = locations[r++];
+    loc.segment_id_ = segment->id_;
+    loc.offset_ += base;
+    Key key{
+        .table_id_ = ctx.table_id_,
+        .os_id_ = ctx.os_ids_[k],
+        .global_id_ = ctx.global_ids_[i],
+        .col_id_ = ctx.col_ids_[j],
+    };
+    UpdateIndex(key, loc, name_len, garbage);
+  });
+  --segment->pending_writes_;
+  AddGarbage(garbage);
+
+  uint32_t n = end - gid_offset;
+  uint32_t target = ctx.global_ids_.size();
+  if (ctx.num_complete_ids_.fetch_add(n) + n == target) {
+    ctx.on_push_complete_(ctx.on_complete_context_);
+    delete &ctx;
+  }
+}
+
+void LogFileIO::Compact() {
+  std::lock_guard<std::mutex> compact_lock(compact_mu_);
+  std::vector<std::shared_ptr<Segment>> candidates;
+  {
+    std::lock_guard<std::mutex> lock(write_mu_);
+    std::shared_lock<std::shared_mutex> segments_lock(segments_mu_);
+    for (auto& [id, segment] : segments_) {
+      if (segment == active_segment_ || segment->pending_writes_ != 0 ||
+          segment->size_ == 0) {
+        continue;
+      }
+      if (segment->garbage_bytes_ * 100 >=
+          segment->size_ * opt_.compact_ratio_) {
+        candidates.emplace_back(segment);
+      }
+    }
+  }
+  for (auto& segment : candidates) {
+    CompactSegment(segment);
+  }
+}
+
+void LogFileIO::CompactSegment(const std::shared_ptr<Segment>& segment) {
+  std::vector<uint8_t> data = ReadFile(segment->filename_);
+
+  struct LiveRecord {
+    Key key_;
+    uint64_t src_;
+    uint64_t dst_;
+    uint32_t table_name_len_;
+    uint32_t data_len_;
+    uint64_t seq_;
+  };
+  std::vector<LiveRecord> live;
+  uint64_t size = 0;
+  ForEachRecord(
+      data,
+      [&](uint64_t pos,
+          const RecordHeader& header,
+          std::string_view table_name) {
+        Key key{
+            .table_id_ = GetTableID(table_name),
+            .os_id_ = header.os_id_,
+            .global_id_ = header.global_id_,
+            .col_id_ = header.col_id_,
+        };
+        auto& shard = GetIndexShard(key);
+        {
+          std::lock_guard<std::mutex> lock(shard.mu_);
+          auto it = shard.locations_.find(key);
+          if (it == shard.locations_.end() ||
+              it->second.segment_id_ != segment->id_ ||
+              it->second.seq_ != header.seq_) {
+            return;
+          }
+        }
+        live.emplace_back(LiveRecord{
+            .key_ = key,
+            .src_ = pos,
+            .dst_ = size,
+            .table_name_len_ = header.table_name_len_,
+            .data_len_ = header.data_len_,
+            .seq_ = header.seq_,
+        });
+        size += RecordSize(header.table_name_len_, header.data_len_);
+      });
+
+  if (!live.empty()) {
+    // The records are copied as is, so they keep their sequence numbers.
+    uint64_t append_size =
+        opt_.direct_io_ ? RoundUp(size, k_block_size) : size;
+    AlignedPtr buffer = AllocAligned(append_size);
+    memset(buffer.get() + size, 0, append_size - size);
+    for (auto& record : live) {
+      memcpy(
+          buffer.get() + record.dst_,
+          data.data() + record.src_,
+          RecordSize(record.table_name_len_, record.data_len_));
+    }
+    auto [dst, base] = Append(buffer.get(), append_size);
+
+    ska::flat_hash_map<uint32_t, uint64_t> garbage;
+    for (auto& record : live) {
+      auto& shard = GetIndexShard(record.key_);
+      std::lock_guard<std::mutex> lock(shard.mu_);
+      auto it = shard.locations_.find(record.key_);
+      if (it != shard.locations_.end() &&
+          it->second.segment_id_ == segment->id_ &&
+          it->second.seq_ == record.seq_) {
+        it->second.segment_id_ = dst->id_;
+        it->second.offset_ =
+            base + record.dst_ + sizeof(RecordHeader) + record.table_name_len_;
+      } else {
+        // pushed again during the compaction.
+        garbage[dst->id_] +=
+            RecordSize(record.table_name_len_, record.data_len_);
+      }
+    }
+    --dst->pending_writes_;
+    AddGarbage(garbage);
+  }
+
+  {
+    std::unique_lock<std::shared_mutex> lock(segments_mu_);
+    segments_.erase(segment->id_);
+  }
+  // The pulls holding the segment can still read it after unlinking.
+  unlink(segment->filename_.c_str());
+}
+
+size_t LogFileIO::NumSegments() {
+  std::shared_lock<std::shared_mutex> lock(segments_mu_);
+  return segments_.size();
+}
+
+} // namespace tde::details::log_file_io
@@ -0,0 +1,201 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "c10/util/flat_hash_map.h"
+#include "tde/details/io_registry.h"
+#include "tde/details/thread_pool.h"
+
+namespace tde::details::log_file_io {
+
+struct Option {
+ public:
+  std::string path_;
+  uint32_t num_io_threads_{4};
+  // Number of global ids handled by one IO job.
+  uint32_t chunk_size_{1024};
+  // Size in bytes, after which the log rolls over to a new segment file.
+  uint32_t segment_size_{64 * 1024 * 1024};
+  bool direct_io_{false};
+  // A sealed segment is compacted when this percentage of it is garbage.
+  uint32_t compact_ratio_{50};
+  uint32_t compact_interval_ms_{1000};
+
+  Option() = default;
+
+  /**
+   * Parse `path/?opt=val&&opt=val`, e.g.
+   * `/mnt/nvme/ps/?num_threads=8&&direct_io=1`.
+   */
+  static Option Parse(std::string_view config_str) {
+    return Option(config_str);
+  }
+
+ private:
+  Option(std::string_view config_str);
+};
+
+/**
+ * The header of each record in the log, followed by the table name and the
+ * value. Records are 8 bytes aligned.
+ */
+struct RecordHeader {
+  uint32_t magic_;
+  uint32_t data_len_;
+  uint64_t seq_;
+  int64_t global_id_;
+  int64_t col_id_;
+  uint32_t os_id_;
+  uint32_t table_name_len_;
+};
+
+struct Key {
+  uint32_t table_id_;
+  uint32_t os_id_;
+  int64_t global_id_;
+  int64_t col_id_;
+
+  bool operator==(const Key& o) const {
+    return table_id_ == o.table_id_ && os_id_ == o.os_id_ &&
+        global_id_ == o.global_id_ && col_id_ == o.col_id_;
+  }
+};
+
+struct KeyHash {
+  size_t operator()(const Key& key) const;
+};
+
+/**
+ * Where the latest value of a key is.
+ */
+struct Location {
+  uint32_t segment_id_;
+  uint32_t data_len_;
+  // offset of the value in the segment.
+  uint64_t offset_;
+  // sequence number of the push, the larger one is newer.
+  uint64_t seq_;
+};
+
+struct Segment {
+  uint32_t id_;
+  int fd_;
+  std::string filename_;
+  // Guarded by LogFileIO::write_mu_. Never changes after sealing.
+  uint64_t size_{0};
+  std::atomic<uint64_t> garbage_bytes_{0};
+  // Number of appends not indexed yet. A segment is not compacted until its
+  // appends are indexed.
+  std::atomic<uint32_t> pending_writes_{0};
+
+  Segment(uint32_t id, int fd, std::string filename)
+      : id_(id), fd_(fd), filename_(std::move(filename)) {}
+  ~Segment();
+};
+
+/**
+ * A log structured row store on local disks.
+ *
+ * Pushed values are appended to segment files with large writes, one per IO
+ * job, and an in memory index maps (table, global id, col id, os id) to the
+ * latest value. Pulls sort the values by their places in the segments and
+ * coalesce the nearby ones into one pread. A background thread rewrites the
+ * live values of sealed segments with too much garbage and deletes them.
+ *
+ * The index is rebuilt by scanning the segments when the directory is opened
+ * again. The log is not fsynced, so it is meant to be a cache or a store of
+ * single node runs, not a durable storage.
+ */
+class LogFileIO {
+ public:
+  explicit LogFileIO(Option opt);
+
+  ~LogFileIO();
+
+  void Pull(IOPullParameter param);
+
+  void Push(IOPushParameter param);
+
+  /**
+   * Compact the sealed segments whose garbage ratio exceeds
+   * `compact_ratio_`. Runs in the background periodically.
+   */
+  void Compact();
+
+  [[nodiscard]] size_t NumSegments();
+
+ private:
+  static constexpr uint32_t k_num_index_shards = 32;
+
+  struct IndexShard {
+    std::mutex mu_;
+    ska::flat_hash_map<Key, Location, KeyHash> locations_;
+  };
+
+  uint32_t GetTableID(std::string_view table_name);
+  IndexShard& GetIndexShard(const Key& key);
+
+  void Recover();
+  std::shared_ptr<Segment> OpenSegment(uint32_t id, bool create);
+  /**
+   * Append data to the log. The caller must decrease `pending_writes_` of the
+   * returned segment after indexing the data.
+   * @return the segment and the offset the data is written to.
+   */
+  std::pair<std::shared_ptr<Segment>, uint64_t> Append(
+      const uint8_t* data,
+      uint64_t size);
+  /**
+   * Point key to loc if loc is newer. The bytes that become garbage are
+   * added to `garbage`, keyed by segment id.
+   */
+  void UpdateIndex(
+      const Key& key,
+      const Location& loc,
+      uint32_t table_name_len,
+      ska::flat_hash_map<uint32_t, uint64_t>& garbage);
+  void AddGarbage(const ska::flat_hash_map<uint32_t, uint64_t>& garbage);
+  void CompactSegment(const std::shared_ptr<Segment>& segment);
+
+  void DoPull(uint32_t gid_offset, void* pull_ctx);
+  void DoPush(uint32_t gid_offset, void* push_ctx);
+
+  Option opt_;
+  std::atomic<uint64_t> next_seq_{1};
+
+  std::mutex tables_mu_;
+  ska::flat_hash_map<std::string, uint32_t> table_ids_;
+
+  IndexShard index_shards_[k_num_index_shards];
+
+  // guards active_segment_ and the sizes of segments.
+  std::mutex write_mu_;
+  std::shared_ptr<Segment> active_segment_;
+  uint32_t next_segment_id_{0};
+
+  // guards segments_. A pull holds it shared from looking up the index to
+  // taking references of the segments, so that a compacted segment is never
+  // referred to.
+  std::shared_mutex segments_mu_;
+  ska::flat_hash_map<uint32_t, std::shared_ptr<Segment>> segments_;
+
+  // makes compactions exclusive.
+  std::mutex compact_mu_;
+
+  std::mutex stop_mu_;
+  std::condition_variable stop_cv_;
+  bool stopping_{false};
+  std::thread compact_thread_;
+
+  // Declared last, so that the jobs are drained before the members above
+  // are destroyed.
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace tde::details::log_file_io
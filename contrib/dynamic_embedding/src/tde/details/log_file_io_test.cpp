@@ -0,0 +1,230 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <filesystem>
+#include "gtest/gtest.h"
+#include "tde/details/io.h"
+#include "tde/details/log_file_io.h"
+#include "tde/details/notification.h"
+
+namespace tde::details::log_file_io {
+
+static int _r = [] {
+  IORegistry::RegisterAllDefaultIOs();
+  return 0;
+}();
+
+static std::string MakeTempDir() {
+  char path[] = "/tmp/tde_log_file_io_XXXXXX";
+  TORCH_CHECK(mkdtemp(path) != nullptr);
+  return path;
+}
+
+TEST(TDE, log_file_io_Option) {
+  auto opt = Option::Parse(
+      "/mnt/nvme/ps/?num_threads=2&&segment_size=4096&&direct_io=1");
+  ASSERT_EQ(opt.path_, "/mnt/nvme/ps");
+  ASSERT_EQ(opt.num_io_threads_, 2);
+  ASSERT_EQ(opt.segment_size_, 4096);
+  ASSERT_TRUE(opt.direct_io_);
+  ASSERT_EQ(opt.compact_ratio_, 50);
+
+  opt = Option::Parse("/mnt/nvme/ps");
+  ASSERT_EQ(opt.path_, "/mnt/nvme/ps");
+  ASSERT_FALSE(opt.direct_io_);
+
+  ASSERT_ANY_THROW(Option::Parse("/mnt/nvme/ps/?no_opt=1"));
+  ASSERT_ANY_THROW(Option::Parse("/mnt/nvme/ps/?compact_ratio=101"));
+}
+
+/**
+ * Push rows of `dim` floats, whose values are `global_id * 10 + version`.
+ */
+static void PushRows(
+    LogFileIO& io,
+    const std::vector<int64_t>& global_ids,
+    uint32_t dim,
+    float version) {
+  std::vector<float> data;
+  std::vector<uint64_t> offsets{0};
+  for (int64_t gid : global_ids) {
+    for (uint32_t i = 0; i < dim; ++i) {
+      data.emplace_back(gid * 10 + version);
+    }
+    offsets.emplace_back(data.size() * sizeof(float));
+  }
+  static constexpr uint32_t os_ids[] = {0};
+  Notification notification;
+  io.Push(IOPushParameter{
+      .table_name_ = "table",
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = 1,
+      .optimizer_stats_ids_ = os_ids,
+      .num_offsets_ = static_cast<uint32_t>(offsets.size()),
+      .offsets_ = offsets.data(),
+      .data_ = data.data(),
+      .on_complete_context_ = &notification,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+  });
+  notification.Wait();
+}
+
+struct PullContext {
+  Notification notification_;
+  // one row per global id, empty if not found.
+  std::vector<std::vector<float>> rows_;
+};
+
+static std::vector<std::vector<float>> PullRows(
+    LogFileIO& io,
+    const std::vector<int64_t>& global_ids) {
+  PullContext ctx;
+  ctx.rows_.resize(global_ids.size());
+  io.Pull(IOPullParameter{
+      .table_name_ = "table",
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = 1,
+      .on_complete_context_ = &ctx,
+      .on_global_id_fetched_ =
+          +[](void* ctx,
+              uint32_t offset,
+              uint32_t os_id,
+              void* data,
+              uint32_t data_len) {
+            auto& rows = reinterpret_cast<PullContext*>(ctx)->rows_;
+            auto* ptr = reinterpret_cast<float*>(data);
+            rows[offset].assign(ptr, ptr + data_len / sizeof(float));
+          },
+      .on_all_fetched_ =
+          +[](void* ctx) {
+            reinterpret_cast<PullContext*>(ctx)->notification_.Done();
+          },
+  });
+  ctx.notification_.Wait();
+  return std::move(ctx.rows_);
+}
+
+static void ExpectRows(
+    const std::vector<std::vector<float>>& rows,
+    const std::vector<int64_t>& global_ids,
+    uint32_t dim,
+    float version) {
+  ASSERT_EQ(rows.size(), global_ids.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    ASSERT_EQ(rows[i].size(), dim);
+    for (float v : rows[i]) {
+      ASSERT_EQ(v, global_ids[i] * 10 + version);
+    }
+  }
+}
+
+static void TestPushPull(bool direct_io) {
+  auto path = MakeTempDir();
+  auto opt = Option::Parse(path + "/?chunk_size=7");
+  opt.direct_io_ = direct_io;
+  std::vector<int64_t> global_ids;
+  for (int64_t i = 0; i < 100; ++i) {
+    global_ids.emplace_back(i * 3);
+  }
+  {
+    LogFileIO io(opt);
+    PushRows(io, global_ids, 16, 1);
+    ExpectRows(PullRows(io, global_ids), global_ids, 16, 1);
+    // The latest push wins.
+    PushRows(io, global_ids, 16, 2);
+    ExpectRows(PullRows(io, global_ids), global_ids, 16, 2);
+
+    auto rows = PullRows(io, {1, 3});
+    ASSERT_TRUE(rows[0].empty());
+    ASSERT_EQ(rows[1].size(), 16);
+  }
+  {
+    // The index is recovered from the log.
+    LogFileIO io(opt);
+    ExpectRows(PullRows(io, global_ids), global_ids, 16, 2);
+  }
+  std::filesystem::remove_all(path);
+}
+
+TEST(TDE, log_file_io_push_pull) {
+  TestPushPull(false);
+}
+
+TEST(TDE, log_file_io_push_pull_direct_io) {
+  auto path = MakeTempDir();
+  int fd = open((path + "/probe").c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  std::filesystem::remove_all(path);
+  if (fd < 0) {
+    GTEST_SKIP() << "O_DIRECT is not supported by the file system of /tmp";
+  }
+  close(fd);
+  TestPushPull(true);
+}
+
+TEST(TDE, log_file_io_compact) {
+  auto path = MakeTempDir();
+  // Never compacts in background during the test.
+  auto opt = Option::Parse(
+      path + "/?segment_size=4096&&compact_interval_ms=3600000");
+  std::vector<int64_t> global_ids;
+  for (int64_t i = 0; i < 10; ++i) {
+    global_ids.emplace_back(i);
+  }
+  {
+    LogFileIO io(opt);
+    for (int version = 0; version < 50; ++version) {
+      PushRows(io, global_ids, 16, version);
+    }
+    size_t num_segments = io.NumSegments();
+    ASSERT_GT(num_segments, 10);
+    io.Compact();
+    ASSERT_LT(io.NumSegments(), num_segments / 2);
+    ExpectRows(PullRows(io, global_ids), global_ids, 16, 49);
+  }
+  {
+    LogFileIO io(opt);
+    ExpectRows(PullRows(io, global_ids), global_ids, 16, 49);
+  }
+  std::filesystem::remove_all(path);
+}
+
+TEST(TDE, IO_file) {
+  auto path = MakeTempDir();
+  constexpr static int64_t global_ids[] = {1, 3, 4};
+  constexpr static uint32_t os_ids[] = {0};
+  constexpr static float params[] = {1, 2, 3, 4, 5, 9};
+  constexpr static uint64_t offsets[] = {
+      0 * sizeof(float),
+      2 * sizeof(float),
+      4 * sizeof(float),
+      6 * sizeof(float)};
+
+  IO io("file://" + path);
+  Notification notification;
+  io.Push(
+      "table",
+      global_ids,
+      {},
+      os_ids,
+      tcb::span<const uint8_t>(
+          reinterpret_cast<const uint8_t*>(params), sizeof(params)),
+      offsets,
+      [&notification] { notification.Done(); });
+  notification.Wait();
+
+  notification.Clear();
+  io.Pull("table", global_ids, {}, 1, torch::kF32, [&](auto val) {
+    ASSERT_EQ(val.size(), 3);
+    auto opt = torch::TensorOptions().dtype(torch::kF32);
+    ASSERT_TRUE(val[0].allclose(torch::tensor({1, 2}, opt)));
+    ASSERT_TRUE(val[1].allclose(torch::tensor({3, 4}, opt)));
+    ASSERT_TRUE(val[2].allclose(torch::tensor({5, 9}, opt)));
+    notification.Done();
+  });
+  notification.Wait();
+  std::filesystem::remove_all(path);
+}
+
+} // namespace tde::details::log_file_io
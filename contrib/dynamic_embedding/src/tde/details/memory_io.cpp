@@ -0,0 +1,419 @@
+#include "tde/details/memory_io.h"
+#include <cstring>
+#include <variant>
+#include "lexy/callback.hpp"
+#include "lexy/dsl.hpp"
+#include "tcb/span.hpp"
+#include "tde/details/url.h"
+
+namespace tde::details {
+
+void RegisterMemoryIO() {
+  auto& reg = IORegistry::Instance();
+
+  {
+    IOProvider provider{};
+    provider.type_ = "memory";
+    provider.Initialize = +[](const char* cfg) -> void* {
+      auto opt = memory_io::Option::Parse(cfg);
+      return new memory_io::MemoryIO(opt);
+    };
+    provider.Finalize = +[](void* inst) {
+      delete reinterpret_cast<memory_io::MemoryIO*>(inst);
+    };
+    provider.version_ = k_io_version_2;
+    provider.PullV2 = +[](void* inst, IOPullParameterV2 param) {
+      reinterpret_cast<memory_io::MemoryIO*>(inst)->Pull(param);
+    };
+    provider.Push = +[](void* inst, IOPushParameter param) {
+      reinterpret_cast<memory_io::MemoryIO*>(inst)->Push(param);
+    };
+    reg.Register(provider);
+  }
+}
+
+namespace memory_io {
+
+struct NumThreadsOpt {
+  uint32_t num_threads_;
+};
+struct NumShardsOpt {
+  uint32_t num_shards_;
+};
+struct ChunkSizeOpt {
+  uint32_t chunk_size_;
+};
+struct CapacityOpt {
+  uint64_t capacity_;
+};
+
+using OptVar =
+    std::variant<NumThreadsOpt, NumShardsOpt, ChunkSizeOpt, CapacityOpt>;
+
+struct OptionSetter {
+  void operator()(Option* self, NumThreadsOpt opt) {
+    TORCH_CHECK(opt.num_threads_ != 0);
+    self->num_io_threads_ = opt.num_threads_;
+  }
+  void operator()(Option* self, NumShardsOpt opt) {
+    TORCH_CHECK(opt.num_shards_ != 0);
+    self->num_shards_ = opt.num_shards_;
+  }
+  void operator()(Option* self, ChunkSizeOpt opt) {
+    TORCH_CHECK(opt.chunk_size_ != 0);
+    self->chunk_size_ = opt.chunk_size_;
+  }
+  void operator()(Option* self, CapacityOpt opt) {
+    self->capacity_ = opt.capacity_;
+  }
+};
+
+namespace option_rules {
+namespace dsl = lexy::dsl;
+struct Integer {
+  constexpr static auto rule =
+      dsl::integer<uint32_t>(dsl::digits<>.no_leading_zero());
+  constexpr static auto value = lexy::construct<uint32_t>;
+};
+
+struct NumThreads {
+  constexpr static auto rule = LEXY_LIT("num_threads=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<NumThreadsOpt>;
+};
+
+struct NumShards {
+  constexpr static auto rule = LEXY_LIT("num_shards=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<NumShardsOpt>;
+};
+
+struct ChunkSize {
+  constexpr static auto rule = LEXY_LIT("chunk_size=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<ChunkSizeOpt>;
+};
+
+struct Size {
+  constexpr static auto rule =
+      dsl::integer<uint64_t>(dsl::digits<>.no_leading_zero()) >>
+      dsl::opt(dsl::capture(dsl::literal_set(
+          LEXY_LIT("K"), LEXY_LIT("M"), LEXY_LIT("G"), LEXY_LIT("T"))));
+
+  constexpr static auto value = lexy::callback<uint64_t>(
+      [](uint64_t size, lexy::nullopt) { return size; },
+      [](uint64_t size, auto&& unit) {
+        constexpr std::string_view units = "KMGT";
+        uint32_t shift = 10 * (units.find(*unit.begin()) + 1);
+        TORCH_CHECK(size <= (UINT64_MAX >> shift), "size overflow");
+        return size << shift;
+      });
+};
+
+struct Capacity {
+  constexpr static auto rule = LEXY_LIT("cap=") >> dsl::p<Size>;
+  constexpr static auto value = lexy::construct<CapacityOpt>;
+};
+
+struct UnknownOption {
+  constexpr static auto name = "unknown option";
+};
+
+struct Option {
+  constexpr static auto rule = dsl::p<NumThreads> | dsl::p<NumShards> |
+      dsl::p<ChunkSize> | dsl::p<Capacity> | dsl::error<UnknownOption>;
+  constexpr static auto value = lexy::construct<OptVar>;
+};
+
+struct Options {
+  constexpr static auto rule =
+      dsl::list(dsl::p<Option>, dsl::sep(LEXY_LIT("&&")));
+
+  constexpr static auto value = lexy::as_list<std::vector<OptVar>>;
+};
+
+} // namespace option_rules
+
+Option::Option(std::string_view config_str) {
+  auto pos = config_str.find('?');
+  if (pos == std::string_view::npos) {
+    return;
+  }
+  std::ostringstream err_oss_;
+  url_parser::ErrorCollector collector{err_oss_};
+
+  auto result = lexy::parse<option_rules::Options>(
+      lexy::string_input(config_str.substr(pos + 1)), collector);
+  auto err_str = err_oss_.str();
+
+  TORCH_CHECK(
+      result.has_value() && err_str.empty(), "parse param error ", err_str);
+
+  for (auto&& opt_var : result.value()) {
+    std::visit(
+        [this](auto&& opt) {
+          OptionSetter setter;
+          setter(this, std::move(opt));
+        },
+        opt_var);
+  }
+}
+
+size_t KeyHash::operator()(const Key& key) const {
+  uint64_t h = static_cast<uint64_t>(key.global_id_) * 0x9E3779B97F4A7C15ULL;
+  h ^= (static_cast<uint64_t>(key.col_id_) +
+        (static_cast<uint64_t>(key.table_id_) << 32)) *
+      0xC2B2AE3D27D4EB4FULL;
+  return h ^ (h >> 29);
+}
+
+MemoryIO::MemoryIO(Option opt)
+    : opt_(std::move(opt)),
+      shards_(opt_.num_shards_),
+      pool_(std::make_unique<ThreadPool>(opt_.num_io_threads_)) {}
+
+MemoryIO::~MemoryIO() {
+  pool_.reset();
+}
+
+uint32_t MemoryIO::GetTableID(const char* table_name) {
+  std::lock_guard<std::mutex> lock(tables_mu_);
+  auto [it, _] = table_ids_.try_emplace(
+      std::string(table_name), static_cast<uint32_t>(table_ids_.size()));
+  return it->second;
+}
+
+MemoryIO::Shard& MemoryIO::GetShard(const Key& key) {
+  // Do not use the low bits of KeyHash, which are used by the hash map.
+  return shards_[static_cast<uint64_t>(key.global_id_) % shards_.size()];
+}
+
+struct MemoryIOPullContext {
+  std::atomic<uint32_t> num_complete_ids_{0};
+  uint32_t table_id_;
+  std::vector<int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  uint32_t num_optimizer_stats_;
+  void* on_complete_context_;
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
+  void (*on_all_fetched_)(void* ctx);
+  const IOPullDestination* dsts_;
+
+  MemoryIOPullContext(uint32_t table_id, IOPullParameterV2 param)
+      : table_id_(table_id),
+        global_ids_(
+            param.global_ids_,
+            param.global_ids_ + param.num_global_ids_),
+        num_optimizer_stats_(param.num_optimizer_stats_),
+        on_complete_context_(param.on_complete_context_),
+        on_chunk_fetched_(param.on_chunk_fetched_),
+        on_all_fetched_(param.on_all_fetched_),
+        dsts_(param.dsts_) {
+    if (param.num_cols_ == 0) {
+      col_ids_.emplace_back(-1);
+    } else {
+      col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_);
+    }
+  }
+};
+
+void MemoryIO::Pull(IOPullParameterV2 param) {
+  if (param.num_global_ids_ == 0) {
+    param.on_all_fetched_(param.on_complete_context_);
+    return;
+  }
+  auto* ctx = new MemoryIOPullContext(GetTableID(param.table_name_), param);
+  for (uint32_t i = 0; i < param.num_global_ids_; i += opt_.chunk_size_) {
+    pool_->Enqueue([i, ctx, this] { DoPull(i, ctx); });
+  }
+}
+
+void MemoryIO::DoPull(uint32_t gid_offset, void* pull_ctx) {
+  auto& ctx = *reinterpret_cast<MemoryIOPullContext*>(pull_ctx);
+  uint32_t end = std::min(
+      gid_offset + opt_.chunk_size_,
+      static_cast<uint32_t>(ctx.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(ctx.col_ids_.size());
+  uint32_t row_begin = gid_offset * num_cols;
+  uint32_t num_rows = (end - gid_offset) * num_cols;
+  std::vector<uint8_t> data;
+  std::vector<uint64_t> offsets(num_rows + 1);
+  std::vector<uint8_t> present(num_rows);
+  // One chunk per optimizer state. The values are copied out, into the
+  // destinations if possible, so that no lock is held during the callback.
+  for (uint32_t os_id = 0; os_id < ctx.num_optimizer_stats_; ++os_id) {
+    data.clear();
+    for (uint32_t i = gid_offset; i < end; ++i) {
+      for (uint32_t j = 0; j < num_cols; ++j) {
+        uint32_t row = (i - gid_offset) * num_cols + j;
+        Key key{
+            .table_id_ = ctx.table_id_,
+            .global_id_ = ctx.global_ids_[i],
+            .col_id_ = ctx.col_ids_[j],
+        };
+        auto& shard = GetShard(key);
+        {
+          std::shared_lock<std::shared_mutex> lock(shard.mu_);
+          auto it = shard.rows_.find(key);
+          const std::vector<uint8_t>* value = nullptr;
+          if (it != shard.rows_.end() && os_id < it->second.size() &&
+              it->second[os_id].has_value()) {
+            value = &*it->second[os_id];
+          }
+          const IOPullDestination* dst = ctx.dsts_ == nullptr
+              ? nullptr
+              : &ctx.dsts_
+                     [(row_begin + row) * ctx.num_optimizer_stats_ + os_id];
+          if (value == nullptr) {
+            present[row] = k_row_missing;
+          } else if (dst != nullptr && value->size() == dst->capacity_) {
+            present[row] = k_row_in_destination;
+            memcpy(dst->data_, value->data(), value->size());
+          } else {
+            present[row] = k_row_present;
+            data.insert(data.end(), value->begin(), value->end());
+          }
+        }
+        offsets[row + 1] = data.size();
+      }
+    }
+    IOPullChunk chunk{
+        .row_begin_ = row_begin,
+        .num_rows_ = num_rows,
+        .optimizer_state_ = os_id,
+        .data_ = data.data(),
+        .offsets_ = offsets.data(),
+        .present_ = present.data(),
+    };
+    ctx.on_chunk_fetched_(ctx.on_complete_context_, &chunk);
+  }
+
+  uint32_t n = end - gid_offset;
+  uint32_t target = ctx.global_ids_.size();
+  if (ctx.num_complete_ids_.fetch_add(n) + n == target) {
+    ctx.on_all_fetched_(ctx.on_complete_context_);
+    delete &ctx;
+  }
+}
+
+struct MemoryIOPushContext {
+  std::atomic<uint32_t> num_complete_ids_{0};
+  uint32_t table_id_;
+  tcb::span<const int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  tcb::span<const uint32_t> os_ids_;
+  tcb::span<const uint64_t> offsets_;
+  const void* data_;
+  void* on_complete_context_;
+  void (*on_push_complete_)(void*);
+
+  MemoryIOPushContext(uint32_t table_id, IOPushParameter param)
+      : table_id_(table_id),
+        global_ids_(param.global_ids_, param.num_global_ids_),
+        os_ids_(param.optimizer_stats_ids_, param.num_optimizer_stats_),
+        offsets_(param.offsets_, param.num_offsets_),
+        data_(param.data_),
+        on_complete_context_(param.on_complete_context_),
+        on_push_complete_(param.on_push_complete) {
+    if (param.num_cols_ != 0) {
+      col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_);
+    } else {
+      col_ids_.emplace_back(-1);
+    }
+  }
+};
+
+void MemoryIO::Push(IOPushParameter param) {
+  if (param.num_global_ids_ == 0) {
+    param.on_push_complete(param.on_complete_context_);
+    return;
+  }
+  auto* ctx = new MemoryIOPushContext(GetTableID(param.table_name_), param);
+  for (uint32_t i = 0; i < param.num_global_ids_; i += opt_.chunk_size_) {
+    pool_->Enqueue([i, ctx, this] { DoPush(i, ctx); });
+  }
+}
+
+void MemoryIO::DoPush(uint32_t gid_offset, void* push_ctx) {
+  auto& ctx = *reinterpret_cast<MemoryIOPushContext*>(push_ctx);
+  uint32_t end = std::min(
+      gid_offset + opt_.chunk_size_,
+      static_cast<uint32_t>(ctx.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(ctx.col_ids_.size());
+  auto num_os = static_cast<uint32_t>(ctx.os_ids_.size());
+  uint64_t shard_capacity = opt_.capacity_ / shards_.size();
+  int64_t delta_bytes = 0;
+  int64_t delta_values = 0;
+  int64_t num_evicted = 0;
+  for (uint32_t i = gid_offset; i < end; ++i) {
+    for (uint32_t j = 0; j < num_cols; ++j) {
+      Key key{
+          .table_id_ = ctx.table_id_,
+          .global_id_ = ctx.global_ids_[i],
+          .col_id_ = ctx.col_ids_[j],
+      };
+      auto& shard = GetShard(key);
+      std::unique_lock<std::shared_mutex> lock(shard.mu_);
+      auto [it, inserted] = shard.rows_.try_emplace(key);
+      if (inserted && opt_.capacity_ != 0) {
+        shard.order_.emplace_back(key);
+      }
+      Row& row = it->second;
+      for (uint32_t k = 0; k < num_os; ++k) {
+        uint32_t offset = k + j * num_os + i * num_cols * num_os;
+        uint64_t beg = ctx.offsets_[offset];
+        uint64_t len = ctx.offsets_[offset + 1] - beg;
+        auto* data = reinterpret_cast<const uint8_t*>(ctx.data_) + beg;
+        uint32_t os_id = ctx.os_ids_[k];
+        if (os_id >= row.size()) {
+          row.resize(os_id + 1);
+        }
+        auto& value = row[os_id];
+        if (!value.has_value()) {
+          value.emplace();
+          ++delta_values;
+        }
+        delta_bytes += static_cast<int64_t>(len) -
+            static_cast<int64_t>(value->size());
+        shard.num_bytes_ += len - value->size();
+        // Reuses the buffer if the size does not change.
+        value->assign(data, data + len);
+      }
+      if (opt_.capacity_ == 0) {
+        continue;
+      }
+      // The row just pushed is kept, even if it alone is over capacity.
+      while (shard.num_bytes_ > shard_capacity && shard.order_.size() > 1) {
+        Key oldest = shard.order_.front();
+        shard.order_.pop_front();
+        if (oldest == key) {
+          shard.order_.emplace_back(oldest);
+          continue;
+        }
+        auto victim = shard.rows_.find(oldest);
+        for (auto& value : victim->second) {
+          if (!value.has_value()) {
+            continue;
+          }
+          shard.num_bytes_ -= value->size();
+          delta_bytes -= static_cast<int64_t>(value->size());
+          --delta_values;
+          ++num_evicted;
+        }
+        shard.rows_.erase(victim);
+      }
+    }
+  }
+  num_bytes_ += delta_bytes;
+  num_values_ += delta_values;
+  num_evicted_values_ += num_evicted;
+
+  uint32_t n = end - gid_offset;
+  uint32_t target = ctx.global_ids_.size();
+  if (ctx.num_complete_ids_.fetch_add(n) + n == target) {
+    ctx.on_push_complete_(ctx.on_complete_context_);
+    delete &ctx;
+  }
+}
+
+} // namespace memory_io
+} // namespace tde::details
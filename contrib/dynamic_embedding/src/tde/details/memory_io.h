@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "c10/util/flat_hash_map.h"
+#include "tde/details/io_registry.h"
+#include "tde/details/thread_pool.h"
+
+namespace tde::details {
+
+extern void RegisterMemoryIO();
+
+namespace memory_io {
+
+struct Option {
+ public:
+  uint32_t num_io_threads_{4};
+  uint32_t num_shards_{64};
+  // Number of global ids handled by one IO job.
+  uint32_t chunk_size_{1024};
+  // Bytes of the values kept, split evenly among the shards. Beyond it, the
+  // oldest values of a shard are dropped. 0 means unlimited.
+  uint64_t capacity_{0};
+
+  Option() = default;
+
+  /**
+   * Parse `[name][/?opt=val&&opt=val]`, e.g. `?num_threads=8&&cap=8G`. The
+   * capacity takes an optional unit of K, M, G or T. The name is ignored,
+   * every instance has its own storage.
+   */
+  static Option Parse(std::string_view config_str) {
+    return Option(config_str);
+  }
+
+ private:
+  Option(std::string_view config_str);
+};
+
+struct Key {
+  uint32_t table_id_;
+  int64_t global_id_;
+  int64_t col_id_;
+
+  bool operator==(const Key& o) const {
+    return table_id_ == o.table_id_ && global_id_ == o.global_id_ &&
+        col_id_ == o.col_id_;
+  }
+};
+
+struct KeyHash {
+  size_t operator()(const Key& key) const;
+};
+
+/**
+ * An in memory parameter server.
+ *
+ * The rows are stored in sharded hash maps keyed by (table, global id,
+ * col id), each shard guarded by a reader writer lock. A row holds the
+ * values of its optimizer states, which are sharded by the global id. Pulls and
+ * pushes are split into jobs of `chunk_size_` global ids and run on a thread
+ * pool, so the callbacks are invoked asynchronously, like the other IOs. A
+ * pull job delivers its values with the v2 ABI, one chunk per optimizer
+ * state.
+ *
+ * With a capacity, each shard drops its rows in the order they were first
+ * pushed, so it is meant as the upper tier of a `TieredIO`, where the
+ * dropped rows are pulled from the tiers below. A row is dropped with all
+ * its optimizer states, so that a tier never serves part of a row.
+ */
+class MemoryIO {
+ public:
+  explicit MemoryIO(Option opt);
+
+  ~MemoryIO();
+
+  void Pull(IOPullParameterV2 param);
+
+  void Push(IOPushParameter param);
+
+  /**
+   * Bytes of the stored values.
+   */
+  [[nodiscard]] int64_t NumBytes() const {
+    return num_bytes_;
+  }
+
+  [[nodiscard]] int64_t NumValues() const {
+    return num_values_;
+  }
+
+  /**
+   * Number of values dropped to keep within the capacity, counting every
+   * optimizer state of the dropped rows.
+   */
+  [[nodiscard]] int64_t NumEvictedValues() const {
+    return num_evicted_values_;
+  }
+
+ private:
+  // The values of a row, indexed by the optimizer state id, empty if not
+  // pushed.
+  using Row = std::vector<std::optional<std::vector<uint8_t>>>;
+
+  struct Shard {
+    std::shared_mutex mu_;
+    ska::flat_hash_map<Key, Row, KeyHash> rows_;
+    // The keys of rows_, in the order they were inserted, if the capacity
+    // is limited.
+    std::deque<Key> order_;
+    uint64_t num_bytes_{0};
+  };
+
+  uint32_t GetTableID(const char* table_name);
+  Shard& GetShard(const Key& key);
+
+  void DoPull(uint32_t gid_offset, void* pull_ctx);
+  void DoPush(uint32_t gid_offset, void* push_ctx);
+
+  Option opt_;
+  std::mutex tables_mu_;
+  ska::flat_hash_map<std::string, uint32_t> table_ids_;
+  std::vector<Shard> shards_;
+  std::atomic<int64_t> num_bytes_{0};
+  std::atomic<int64_t> num_values_{0};
+  std::atomic<int64_t> num_evicted_values_{0};
+
+  // Declared last, so that the jobs are drained before the shards are
+  // destroyed.
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace memory_io
+} // namespace tde::details
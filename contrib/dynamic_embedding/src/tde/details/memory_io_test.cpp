@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+#include "tde/details/io.h"
+#include "tde/details/io_test_util.h"
+#include "tde/details/memory_io.h"
+#include "tde/details/notification.h"
+
+namespace tde::details::memory_io {
+
+static int _r = [] {
+  IORegistry::RegisterAllDefaultIOs();
+  return 0;
+}();
+
+TEST(TDE, memory_io_Option) {
+  auto opt = Option::Parse("?num_threads=2&&num_shards=8&&chunk_size=16");
+  ASSERT_EQ(opt.num_io_threads_, 2);
+  ASSERT_EQ(opt.num_shards_, 8);
+  ASSERT_EQ(opt.chunk_size_, 16);
+
+  opt = Option::Parse("");
+  ASSERT_EQ(opt.num_io_threads_, 4);
+  ASSERT_EQ(opt.capacity_, 0);
+
+  ASSERT_EQ(Option::Parse("?cap=100").capacity_, 100);
+  ASSERT_EQ(Option::Parse("?cap=8G").capacity_, 8ULL << 30);
+
+  ASSERT_ANY_THROW(Option::Parse("?no_opt=1"));
+}
+
+TEST(TDE, memory_io_push_pull) {
+  MemoryIO io(Option::Parse("?chunk_size=3"));
+  std::vector<int64_t> global_ids{1, 3, 5, 7, 9, 11, 13};
+  std::vector<float> data;
+  for (int64_t gid : global_ids) {
+    data.emplace_back(gid);
+    data.emplace_back(-gid);
+  }
+  PushRows(io, global_ids, {0}, data);
+  ASSERT_EQ(io.NumValues(), 7);
+  ASSERT_EQ(io.NumBytes(), 7 * 2 * sizeof(float));
+
+  auto result = PullRows(io, {3, 4, 13});
+  ASSERT_EQ(result->Value(0), std::vector<float>({3, -3}));
+  ASSERT_EQ(result->present_[1], k_row_missing);
+  ASSERT_EQ(result->Value(2), std::vector<float>({13, -13}));
+
+  // overwrite with longer rows.
+  PushRows(io, {3}, {0}, {1, 2, 3});
+  ASSERT_EQ(io.NumValues(), 7);
+  ASSERT_EQ(io.NumBytes(), (6 * 2 + 3) * sizeof(float));
+  result = PullRows(io, {3});
+  ASSERT_EQ(result->Value(0), std::vector<float>({1, 2, 3}));
+
+  // optimizer states are stored apart, and each is found or missing.
+  PushRows(io, {3, 15}, {1, 0}, {3, 1, 3, 0, 15, 1, 15, 0});
+  ASSERT_EQ(io.NumValues(), 10);
+  result = PullRows(io, {15, 3, 1}, 2);
+  ASSERT_EQ(result->Value(0, 0), std::vector<float>({15, 0}));
+  ASSERT_EQ(result->Value(0, 1), std::vector<float>({15, 1}));
+  ASSERT_EQ(result->Value(1, 0), std::vector<float>({3, 0}));
+  ASSERT_EQ(result->Value(1, 1), std::vector<float>({3, 1}));
+  ASSERT_EQ(result->Value(2, 0), std::vector<float>({1, -1}));
+  ASSERT_EQ(result->present_[2 * 2 + 1], k_row_missing);
+}
+
+TEST(TDE, memory_io_capacity) {
+  // 3 values of 2 floats.
+  MemoryIO io(Option::Parse("?num_shards=1&&cap=24"));
+  PushRows(io, {1, 2, 3}, {0}, {1, -1, 2, -2, 3, -3});
+  ASSERT_EQ(io.NumValues(), 3);
+  // overwriting a value does not make it newer.
+  PushRows(io, {1}, {0}, {4, -4});
+  PushRows(io, {4, 5}, {0}, {4, -4, 5, -5});
+  ASSERT_EQ(io.NumValues(), 3);
+  ASSERT_EQ(io.NumBytes(), 24);
+  ASSERT_EQ(io.NumEvictedValues(), 2);
+
+  auto result = PullRows(io, {1, 2, 3, 4, 5});
+  ASSERT_EQ(result->present_[0], k_row_missing);
+  ASSERT_EQ(result->present_[1], k_row_missing);
+  ASSERT_EQ(result->Value(2), std::vector<float>({3, -3}));
+  ASSERT_EQ(result->Value(3), std::vector<float>({4, -4}));
+  ASSERT_EQ(result->Value(4), std::vector<float>({5, -5}));
+}
+
+TEST(TDE, memory_io_capacity_rows) {
+  MemoryIO io(Option::Parse("?num_shards=1&&cap=24"));
+  PushRows(io, {1}, {1, 0}, {1, 1, 1, 0});
+  PushRows(io, {2}, {0}, {2, 0});
+  // Dropping one optimizer state of 1 would be enough, but 1 is dropped
+  // whole.
+  PushRows(io, {3}, {0}, {3, 0});
+  ASSERT_EQ(io.NumValues(), 2);
+  ASSERT_EQ(io.NumBytes(), 16);
+  ASSERT_EQ(io.NumEvictedValues(), 2);
+
+  auto result = PullRows(io, {1, 2, 3}, 2);
+  ASSERT_EQ(result->present_[0], k_row_missing);
+  ASSERT_EQ(result->present_[1], k_row_missing);
+  ASSERT_EQ(result->Value(1, 0), std::vector<float>({2, 0}));
+  ASSERT_EQ(result->present_[2 * 2 + 1], k_row_missing);
+  ASSERT_EQ(result->Value(2, 0), std::vector<float>({3, 0}));
+}
+
+TEST(TDE, IO_memory) {
+  constexpr static int64_t global_ids[] = {1, 3, 4};
+  constexpr static uint32_t os_ids[] = {0};
+  constexpr static float params[] = {1, 2, 3, 4, 5, 9};
+  constexpr static uint64_t offsets[] = {
+      0 * sizeof(float),
+      2 * sizeof(float),
+      4 * sizeof(float),
+      6 * sizeof(float)};
+
+  IO io("memory://");
+  Notification notification;
+  io.Push(
+      "table",
+      global_ids,
+      {},
+      os_ids,
+      tcb::span<const uint8_t>(
+          reinterpret_cast<const uint8_t*>(params), sizeof(params)),
+      offsets,
+      [&notification] { notification.Done(); });
+  notification.Wait();
+
+  notification.Clear();
+  io.Pull("table", global_ids, {}, 1, torch::kF32, [&](auto val) {
+    ASSERT_EQ(val.size(), 3);
+    auto opt = torch::TensorOptions().dtype(torch::kF32);
+    ASSERT_TRUE(val[0].allclose(torch::tensor({1, 2}, opt)));
+    ASSERT_TRUE(val[1].allclose(torch::tensor({3, 4}, opt)));
+    ASSERT_TRUE(val[2].allclose(torch::tensor({5, 9}, opt)));
+    notification.Done();
+  });
+  notification.Wait();
+}
+
+} // namespace tde::details::memory_io
@@ -30,4 +30,12 @@ MixedLFULRUStrategy::lxu_record_t MixedLFULRUStrategy::Update(
   return *reinterpret_cast<lxu_record_t*>(&r);
 }
 
+MixedLFULRUStrategy::lxu_record_t MixedLFULRUStrategy::Preload(
+    int64_t freq_power) const {
+  Record r{};
+  r.time_ = time_->load();
+  r.freq_power_ = std::clamp<int64_t>(freq_power, min_lfu_power_, 31);
+  return *reinterpret_cast<lxu_record_t*>(&r);
+}
+
 } // namespace tde::details
@@ -66,11 +66,25 @@ class MixedLFULRUStrategy {
     return static_cast<int64_t>(reinterpret_cast<Record*>(&record)->time_);
   }
 
+  template <typename T>
+  static int64_t FreqPower(T record) {
+    static_assert(sizeof(T) == sizeof(Record));
+    return static_cast<int64_t>(
+        reinterpret_cast<Record*>(&record)->freq_power_);
+  }
+
   lxu_record_t Update(
       int64_t global_id,
       int64_t cache_id,
       std::optional<lxu_record_t> val);
 
+  /**
+   * The record of an id inserted before it is used, e.g., with the frequency
+   * of a previous run. The freq_power is clamped to [min_used_freq_power,
+   * 31], so a negative one gives the record of a new id.
+   */
+  [[nodiscard]] lxu_record_t Preload(int64_t freq_power) const;
+
   struct EvictItem {
     int64_t global_id_;
     lxu_record_t record_;
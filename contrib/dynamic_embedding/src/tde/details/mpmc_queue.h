@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+/**
+ * A bounded multi-producer multi-consumer queue without locks.
+ *
+ * Each cell has a sequence number, which tells whether the cell is free for
+ * the producer of a position, or ready for the consumer of it. So the
+ * producers only contend on the push position, the consumers on the pop
+ * position, and an element is moved once in and once out.
+ */
+template <typename T>
+class MPMCQueue {
+ public:
+  /**
+   * @param capacity is rounded up to a power of 2.
+   */
+  explicit MPMCQueue(size_t capacity) {
+    TORCH_CHECK(capacity != 0, "capacity must not be zero");
+    size_t n = 1;
+    while (n < capacity) {
+      n <<= 1;
+    }
+    mask_ = n - 1;
+    cells_ = std::make_unique<Cell[]>(n);
+    for (size_t i = 0; i < n; ++i) {
+      cells_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  /**
+   * @return false if the queue is full.
+   */
+  bool TryPush(T value) {
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[pos & mask_];
+      size_t seq = cell.seq_.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (push_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value_ = std::move(value);
+          cell.seq_.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @return false if the queue is empty.
+   */
+  bool TryPop(T& value) {
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[pos & mask_];
+      size_t seq = cell.seq_.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (pop_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          value = std::move(cell.value_);
+          cell.seq_.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Whether the queue is empty, including the elements being pushed.
+   */
+  [[nodiscard]] bool Empty() const {
+    return pop_pos_.load(std::memory_order_acquire) >=
+        push_pos_.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq_;
+    T value_;
+  };
+
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  // On their own cache lines, not to be shared by producers and consumers.
+  alignas(64) std::atomic<size_t> push_pos_{0};
+  alignas(64) std::atomic<size_t> pop_pos_{0};
+};
+
+} // namespace tde::details
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tde/details/mpmc_queue.h"
+
+namespace tde::details {
+
+TEST(TDE, mpmc_queue_fifo) {
+  // The capacity is rounded up to 4.
+  MPMCQueue<int> queue(3);
+  ASSERT_TRUE(queue.Empty());
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.TryPush(i));
+  }
+  ASSERT_FALSE(queue.TryPush(4));
+  ASSERT_FALSE(queue.Empty());
+
+  int value;
+  for (int round = 0; round < 3; ++round) {
+    // The cells are reused after they are popped.
+    ASSERT_TRUE(queue.TryPop(value));
+    ASSERT_EQ(value, round);
+    ASSERT_TRUE(queue.TryPush(round + 4));
+  }
+  for (int i = 3; i < 7; ++i) {
+    ASSERT_TRUE(queue.TryPop(value));
+    ASSERT_EQ(value, i);
+  }
+  ASSERT_FALSE(queue.TryPop(value));
+  ASSERT_TRUE(queue.Empty());
+}
+
+TEST(TDE, mpmc_queue_concurrent) {
+  constexpr int num_producers = 4;
+  constexpr int num_consumers = 4;
+  constexpr int num_values = 10000;
+  MPMCQueue<int> queue(64);
+  std::vector<std::atomic<int>> popped(num_producers * num_values);
+  std::atomic<int> num_popped{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < num_producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < num_values; ++i) {
+        while (!queue.TryPush(p * num_values + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < num_consumers; ++c) {
+    threads.emplace_back([&] {
+      int value;
+      while (num_popped.load() < num_producers * num_values) {
+        if (queue.TryPop(value)) {
+          ++popped[value];
+          ++num_popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  // Each value is popped once.
+  for (auto& n : popped) {
+    ASSERT_EQ(n.load(), 1);
+  }
+  ASSERT_TRUE(queue.Empty());
+}
+
+} // namespace tde::details
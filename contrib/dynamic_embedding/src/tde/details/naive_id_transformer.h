@@ -84,12 +84,14 @@ class NaiveIDTransformer {
    * @param cache_ids [out] Cache ID vector
    * @param update update lambda. See `Update` doc.
    * @param fetch fetch lambda. See `Fetch` doc.
-   * @return true if all transformed, otherwise need eviction.
+   * @return number of global ids transformed. If it is less than
+   * global_ids.size(), the transformer is full and needs eviction, and the
+   * ids from it on are not transformed.
    */
   template <
       typename Update = decltype(transform_default::NoUpdate<LXURecord>),
       typename Fetch = decltype(transform_default::NoFetch)>
-  bool Transform(
+  int64_t Transform(
       tcb::span<const int64_t> global_ids,
       tcb::span<int64_t> cache_ids,
       Update update = transform_default::NoUpdate<LXURecord>,
@@ -97,6 +99,8 @@ class NaiveIDTransformer {
 
   void Evict(tcb::span<const int64_t> global_ids);
 
+  [[nodiscard]] bool Contains(int64_t global_id) const;
+
   MoveOnlyFunction<std::optional<record_t>()> Iterator() const;
 
  private:
@@ -55,7 +55,7 @@ inline NaiveIDTransformer<LXURecord, T>::NaiveIDTransformer(
 
 template <typename LXURecord, typename T>
 template <typename Update, typename Fetch>
-inline bool NaiveIDTransformer<LXURecord, T>::Transform(
+inline int64_t NaiveIDTransformer<LXURecord, T>::Transform(
     tcb::span<const int64_t> global_ids,
     tcb::span<int64_t> cache_ids,
     Update update,
@@ -72,7 +72,7 @@ inline bool NaiveIDTransformer<LXURecord, T>::Transform(
     } else {
       // The transformer is full.
       if (C10_UNLIKELY(bitmap_.Full())) {
-        return false;
+        return static_cast<int64_t>(i);
       }
       auto stored_cache_id = bitmap_.NextFreeBit();
       cache_id = stored_cache_id;
@@ -83,7 +83,7 @@ inline bool NaiveIDTransformer<LXURecord, T>::Transform(
     }
     cache_ids[i] = cache_id;
   }
-  return true;
+  return static_cast<int64_t>(global_ids.size());
 }
 
 template <typename LXURecord, typename T>
@@ -100,6 +100,13 @@ inline void NaiveIDTransformer<LXURecord, T>::Evict(
   }
 }
 
+template <typename LXURecord, typename T>
+inline bool NaiveIDTransformer<LXURecord, T>::Contains(
+    int64_t global_id) const {
+  return global_id2cache_value_.find(global_id) !=
+      global_id2cache_value_.end();
+}
+
 template <typename LXURecord, typename T>
 inline auto NaiveIDTransformer<LXURecord, T>::Iterator() const
     -> MoveOnlyFunction<std::optional<record_t>()> {
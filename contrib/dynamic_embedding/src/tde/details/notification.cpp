@@ -2,10 +2,10 @@
 
 namespace tde::details {
 void Notification::Done() {
-  {
-    std::lock_guard<std::mutex> guard(mtx_);
-    set_ = true;
-  }
+  // Notify with the lock held, so the waiter can destroy the notification
+  // right after Wait returns.
+  std::lock_guard<std::mutex> guard(mtx_);
+  set_ = true;
   cv_.notify_all();
 }
 void Notification::Wait() {
@@ -0,0 +1,167 @@
+#include "tde/details/record_io.h"
+#include <atomic>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+void RegisterRecordIO() {
+  auto& reg = IORegistry::Instance();
+
+  {
+    IOProvider provider{};
+    provider.type_ = "record";
+    provider.Initialize = +[](const char* cfg) -> void* {
+      auto opt = record_io::Option::Parse(cfg);
+      return new record_io::RecordIO(opt);
+    };
+    provider.Finalize = +[](void* inst) {
+      delete reinterpret_cast<record_io::RecordIO*>(inst);
+    };
+    provider.version_ = k_io_version_2;
+    provider.PullV2 = +[](void* inst, IOPullParameterV2 param) {
+      reinterpret_cast<record_io::RecordIO*>(inst)->Pull(param);
+    };
+    provider.Push = +[](void* inst, IOPushParameter param) {
+      reinterpret_cast<record_io::RecordIO*>(inst)->Push(param);
+    };
+    reg.Register(provider);
+  }
+}
+
+namespace record_io {
+
+static constexpr std::string_view k_schema_separator = "://";
+
+Option::Option(std::string_view config_str) {
+  auto pos = config_str.find('|');
+  TORCH_CHECK(
+      pos != std::string_view::npos,
+      "record IO config should be path|schema://cfg_string, got ",
+      config_str);
+  path_ = std::string(config_str.substr(0, pos));
+  io_config_ = std::string(config_str.substr(pos + 1));
+  TORCH_CHECK(!path_.empty(), "path of record IO must not be empty");
+  TORCH_CHECK(
+      io_config_.find(k_schema_separator) != std::string::npos,
+      "recorded IO config should be schema://cfg_string, got ",
+      io_config_);
+}
+
+RecordIO::RecordIO(const Option& opt)
+    : writer_(TraceWriter::Open(opt.path_)) {
+  auto pos = opt.io_config_.find(k_schema_separator);
+  std::string rest_cfg = opt.io_config_.substr(pos + k_schema_separator.size());
+  provider_ = IORegistry::Instance().Resolve(opt.io_config_.substr(0, pos));
+  instance_ = provider_.Initialize(rest_cfg.c_str());
+}
+
+RecordIO::~RecordIO() {
+  provider_.Finalize(instance_);
+}
+
+struct RecordPullContext {
+  TraceWriter* writer_;
+  IOPullParameterV2 param_;
+  TraceRecord record_;
+  std::atomic<uint64_t> num_bytes_{0};
+};
+
+static void OnRecordChunkFetched(void* ctx, const IOPullChunk* chunk) {
+  auto* c = reinterpret_cast<RecordPullContext*>(ctx);
+  uint64_t num_bytes =
+      chunk->offsets_[chunk->num_rows_] - chunk->offsets_[0];
+  uint32_t num_os = c->param_.num_optimizer_stats_;
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    if (chunk->present_[i] == k_row_in_destination) {
+      uint32_t row = chunk->row_begin_ + i;
+      auto& dst = c->param_.dsts_[row * num_os + chunk->optimizer_state_];
+      num_bytes += dst.capacity_;
+    }
+  }
+  c->num_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+  c->param_.on_chunk_fetched_(c->param_.on_complete_context_, chunk);
+}
+
+static void OnRecordAllFetched(void* ctx) {
+  std::unique_ptr<RecordPullContext> c(
+      reinterpret_cast<RecordPullContext*>(ctx));
+  c->record_.latency_us_ = c->writer_->NowUs() - c->record_.start_us_;
+  c->record_.num_bytes_ = c->num_bytes_.load();
+  c->writer_->Write(c->record_);
+  c->param_.on_all_fetched_(c->param_.on_complete_context_);
+}
+
+void RecordIO::Pull(IOPullParameterV2 param) {
+  auto* ctx = new RecordPullContext{
+      .writer_ = writer_.get(),
+      .param_ = param,
+      .record_ =
+          TraceRecord{
+              .kind_ = k_trace_pull,
+              .table_name_ = param.table_name_,
+              .col_ids_ = std::vector<int64_t>(
+                  param.col_ids_, param.col_ids_ + param.num_cols_),
+              .global_ids_ = std::vector<int64_t>(
+                  param.global_ids_,
+                  param.global_ids_ + param.num_global_ids_),
+              .num_optimizer_stats_ = param.num_optimizer_stats_,
+              .start_us_ = writer_->NowUs(),
+          },
+  };
+  param.on_complete_context_ = ctx;
+  param.on_chunk_fetched_ = OnRecordChunkFetched;
+  param.on_all_fetched_ = OnRecordAllFetched;
+  PullChunked(provider_, instance_, param);
+}
+
+struct RecordPushContext {
+  TraceWriter* writer_;
+  IOPushParameter param_;
+  TraceRecord record_;
+};
+
+static void OnRecordPushComplete(void* ctx) {
+  std::unique_ptr<RecordPushContext> c(
+      reinterpret_cast<RecordPushContext*>(ctx));
+  c->record_.latency_us_ = c->writer_->NowUs() - c->record_.start_us_;
+  c->writer_->Write(c->record_);
+  c->param_.on_push_complete(c->param_.on_complete_context_);
+}
+
+void RecordIO::Push(IOPushParameter param) {
+  auto* ctx = new RecordPushContext{
+      .writer_ = writer_.get(),
+      .param_ = param,
+      .record_ =
+          TraceRecord{
+              .kind_ = k_trace_push,
+              .table_name_ = param.table_name_,
+              .col_ids_ = std::vector<int64_t>(
+                  param.col_ids_, param.col_ids_ + param.num_cols_),
+              .global_ids_ = std::vector<int64_t>(
+                  param.global_ids_,
+                  param.global_ids_ + param.num_global_ids_),
+              .num_optimizer_stats_ = param.num_optimizer_stats_,
+              .os_ids_ = std::vector<uint32_t>(
+                  param.optimizer_stats_ids_,
+                  param.optimizer_stats_ids_ + param.num_optimizer_stats_),
+              .start_us_ = writer_->NowUs(),
+          },
+  };
+  auto& record = ctx->record_;
+  if (param.num_offsets_ != 0) {
+    record.value_sizes_.reserve(param.num_offsets_ - 1);
+    for (uint32_t i = 1; i < param.num_offsets_; ++i) {
+      record.value_sizes_.emplace_back(
+          param.offsets_[i] - param.offsets_[i - 1]);
+    }
+    record.num_bytes_ =
+        param.offsets_[param.num_offsets_ - 1] - param.offsets_[0];
+  }
+  param.on_complete_context_ = ctx;
+  param.on_push_complete = OnRecordPushComplete;
+  provider_.Push(instance_, param);
+}
+
+} // namespace record_io
+} // namespace tde::details
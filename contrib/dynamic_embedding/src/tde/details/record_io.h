@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include "tde/details/io_registry.h"
+#include "tde/details/trace.h"
+
+namespace tde::details {
+
+extern void RegisterRecordIO();
+
+namespace record_io {
+
+struct Option {
+ public:
+  // Path of the trace.
+  std::string path_;
+  // Config of the recorded IO, e.g., `redis://127.0.0.1:6379/`.
+  std::string io_config_;
+
+  Option() = default;
+
+  /**
+   * Parse `path|schema://cfg`, e.g.,
+   * `/tmp/ps.trace|redis://127.0.0.1:6379/?prefix=model`.
+   */
+  static Option Parse(std::string_view config_str) {
+    return Option(config_str);
+  }
+
+ private:
+  Option(std::string_view config_str);
+};
+
+/**
+ * An IO which forwards the requests to another IO, and records the table,
+ * the ids, the value sizes, the issue time and the latency of each of them
+ * to a trace, see `trace.h`. The values are not recorded.
+ *
+ * The traffic can be replayed against any IO by `Replay`.
+ */
+class RecordIO {
+ public:
+  explicit RecordIO(const Option& opt);
+
+  ~RecordIO();
+
+  RecordIO(const RecordIO&) = delete;
+  RecordIO& operator=(const RecordIO&) = delete;
+
+  void Pull(IOPullParameterV2 param);
+
+  void Push(IOPushParameter param);
+
+ private:
+  std::shared_ptr<TraceWriter> writer_;
+  IOProvider provider_;
+  void* instance_;
+};
+
+} // namespace record_io
+} // namespace tde::details
@@ -0,0 +1,76 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "tde/details/io_test_util.h"
+#include "tde/details/record_io.h"
+#include "tde/details/trace_replay.h"
+
+namespace tde::details::record_io {
+
+static int _r = [] {
+  IORegistry::RegisterAllDefaultIOs();
+  return 0;
+}();
+
+TEST(TDE, record_io_Option) {
+  auto opt = Option::Parse("/tmp/ps.trace|redis://127.0.0.1:6379/?prefix=m");
+  ASSERT_EQ(opt.path_, "/tmp/ps.trace");
+  ASSERT_EQ(opt.io_config_, "redis://127.0.0.1:6379/?prefix=m");
+
+  ASSERT_ANY_THROW(Option::Parse("/tmp/ps.trace"));
+  ASSERT_ANY_THROW(Option::Parse("|memory://"));
+  ASSERT_ANY_THROW(Option::Parse("/tmp/ps.trace|memory"));
+}
+
+TEST(TDE, record_io_record_replay) {
+  std::string path = "/tmp/record_io_test." + std::to_string(getpid());
+  {
+    RecordIO io(Option::Parse(path + "|memory://"));
+    PushRows(io, {1, 2, 3}, {0}, {1, -1, 2, -2, 3, -3});
+    // Requests are forwarded to the recorded IO.
+    auto result = PullRows(io, {3, 4});
+    ASSERT_EQ(
+        result->present_,
+        std::vector<uint8_t>({k_row_present, k_row_missing}));
+  }
+
+  auto records = ReadTrace(path);
+  ASSERT_EQ(records.size(), 2);
+  auto& push = records[0];
+  ASSERT_EQ(push.kind_, k_trace_push);
+  ASSERT_EQ(push.table_name_, "table");
+  ASSERT_EQ(push.global_ids_, std::vector<int64_t>({1, 2, 3}));
+  ASSERT_EQ(push.os_ids_, std::vector<uint32_t>({0}));
+  ASSERT_EQ(push.value_sizes_, std::vector<uint32_t>(3, 2 * sizeof(float)));
+  ASSERT_EQ(push.num_bytes_, 6 * sizeof(float));
+  auto& pull = records[1];
+  ASSERT_EQ(pull.kind_, k_trace_pull);
+  ASSERT_EQ(pull.global_ids_, std::vector<int64_t>({3, 4}));
+  ASSERT_EQ(pull.num_optimizer_stats_, 1);
+  ASSERT_EQ(pull.num_bytes_, 2 * sizeof(float));
+  ASSERT_GE(pull.start_us_, push.start_us_ + push.latency_us_);
+
+  for (bool recorded_pace : {true, false}) {
+    auto result = Replay(
+        records,
+        "memory://",
+        ReplayOption{.recorded_pace_ = recorded_pace, .max_in_flight_ = 1});
+    ASSERT_EQ(result.at("num_pulls"), 1);
+    ASSERT_EQ(result.at("num_pushes"), 1);
+    ASSERT_EQ(result.at("pulled_rows"), 2);
+    ASSERT_EQ(result.at("pushed_bytes"), 6 * sizeof(float));
+    // The push is replayed before the pull, which finds id 3.
+    ASSERT_EQ(result.at("pulled_bytes"), 2 * sizeof(float));
+    ASSERT_EQ(result.at("pull_latency_us.count"), 1);
+    ASSERT_EQ(result.at("recorded_push_latency_us.count"), 1);
+  }
+
+  // The truncated record at the end is dropped.
+  struct stat st {};
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  ASSERT_EQ(truncate(path.c_str(), st.st_size - 8), 0);
+  ASSERT_EQ(ReadTrace(path).size(), 1);
+  unlink(path.c_str());
+}
+
+} // namespace tde::details::record_io
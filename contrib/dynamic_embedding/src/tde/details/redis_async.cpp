@@ -0,0 +1,806 @@
+#include "tde/details/redis_async.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "async.h"
+#include "tde/details/hash_ring.h"
+#include "tde/details/move_only_function.h"
+#include "torch/torch.h"
+
+namespace tde::details::redis_v1 {
+
+using Clock = std::chrono::steady_clock;
+
+// The interval to reconnect a broken connection.
+static constexpr std::chrono::milliseconds k_reconnect_interval{100};
+
+/**
+ * The command of a chunk. The arguments point to buffers_, or to the data
+ * of the request, which is valid until the request completes.
+ */
+struct AsyncCommand {
+  std::vector<std::string> buffers_;
+  std::vector<const char*> argv_;
+  std::vector<size_t> argv_len_;
+  // Called on the event loop with a reply which is not an error, and the
+  // chunk values of the loop.
+  MoveOnlyFunction<void(redisReply*, ChunkValues&)> on_reply_;
+  uint32_t num_retries_{0};
+
+  void AddArg(const char* data, size_t len) {
+    argv_.emplace_back(data);
+    argv_len_.emplace_back(len);
+  }
+
+  void AddArg(const std::string& arg) {
+    AddArg(arg.data(), arg.size());
+  }
+};
+
+struct Connection {
+  EventLoop* loop_{nullptr};
+  // Null if the connection is broken, until it is reconnected.
+  redisAsyncContext* ctx_{nullptr};
+  int fd_{-1};
+  // The events of fd_ watched by epoll.
+  uint32_t events_{0};
+  uint32_t num_outstanding_{0};
+  // When to call redisAsyncHandleTimeout, scheduled by hiredis.
+  std::optional<Clock::time_point> timeout_at_;
+  Clock::time_point reconnect_at_;
+};
+
+/**
+ * An io thread running the connections of an epoll loop. The commands are
+ * submitted by any thread, and wake the loop by an eventfd.
+ */
+class EventLoop {
+ public:
+  explicit EventLoop(const Option& opt);
+
+  /**
+   * Stop after the commands submitted complete.
+   */
+  ~EventLoop();
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  void Submit(std::vector<std::unique_ptr<AsyncCommand>> commands);
+
+ private:
+  void Run();
+
+  /**
+   * Move the commands submitted to pending_.
+   * @return if the loop is stopping.
+   */
+  bool TakeSubmitted();
+
+  /**
+   * Send the pending commands to the least loaded connections, until all
+   * the connections reach max_outstanding.
+   */
+  void Dispatch();
+
+  /**
+   * @return the error, empty if the connection is started.
+   */
+  std::string Connect(Connection& conn);
+
+  void Watch(Connection& conn, uint32_t events);
+  void Wake();
+  [[nodiscard]] int WaitMs() const;
+  [[nodiscard]] uint32_t NumOutstanding() const;
+  void Fail(std::string error);
+  void Close();
+
+  // The hooks of redisAsyncContext, whose data is the connection.
+  static void AddRead(void* data);
+  static void DelRead(void* data);
+  static void AddWrite(void* data);
+  static void DelWrite(void* data);
+  static void Cleanup(void* data);
+  static void ScheduleTimer(void* data, struct timeval tv);
+  static void OnConnect(const redisAsyncContext* ctx, int status);
+  static void OnSetupReply(redisAsyncContext* ctx, void* reply, void*);
+  static void OnReply(redisAsyncContext* ctx, void* reply, void* command);
+
+  const Option& opt_;
+  int epoll_fd_;
+  int event_fd_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  // Only accessed by the loop thread.
+  std::deque<std::unique_ptr<AsyncCommand>> pending_;
+  ChunkValues values_;
+  std::string error_;
+  std::string last_error_;
+
+  std::mutex mu_;
+  std::vector<std::unique_ptr<AsyncCommand>> submitted_;
+  bool stopping_{false};
+
+  std::thread thread_;
+};
+
+EventLoop::EventLoop(const Option& opt)
+    : opt_(opt),
+      epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  try {
+    TORCH_CHECK(
+        epoll_fd_ >= 0 && event_fd_ >= 0,
+        "cannot create the event loop, errno ",
+        errno);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    TORCH_CHECK(
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev) == 0,
+        "cannot watch the eventfd, errno ",
+        errno);
+    for (uint32_t i = 0; i < opt_.num_connections_; ++i) {
+      auto& conn = connections_.emplace_back(std::make_unique<Connection>());
+      conn->loop_ = this;
+      auto error = Connect(*conn);
+      TORCH_CHECK(
+          error.empty(),
+          "connect to redis://",
+          opt_.host_,
+          ":",
+          opt_.port_,
+          " error: ",
+          error);
+    }
+  } catch (...) {
+    Close();
+    throw;
+  }
+  thread_ = std::thread([this] { Run(); });
+}
+
+EventLoop::~EventLoop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  Wake();
+  thread_.join();
+  Close();
+}
+
+void EventLoop::Submit(std::vector<std::unique_ptr<AsyncCommand>> commands) {
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    // The loop is woken already if there are commands not taken.
+    wake = submitted_.empty();
+    for (auto& command : commands) {
+      submitted_.emplace_back(std::move(command));
+    }
+  }
+  if (wake) {
+    Wake();
+  }
+}
+
+void EventLoop::Wake() {
+  uint64_t one = 1;
+  [[maybe_unused]] auto n = write(event_fd_, &one, sizeof(one));
+}
+
+bool EventLoop::TakeSubmitted() {
+  uint64_t count;
+  [[maybe_unused]] auto n = read(event_fd_, &count, sizeof(count));
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& command : submitted_) {
+    pending_.emplace_back(std::move(command));
+  }
+  submitted_.clear();
+  return stopping_;
+}
+
+std::string EventLoop::Connect(Connection& conn) {
+  redisOptions options{};
+  REDIS_OPTIONS_SET_TCP(&options, opt_.host_.c_str(), opt_.port_);
+  struct timeval timeout {};
+  timeout.tv_sec = opt_.timeout_ms_ / 1000;
+  timeout.tv_usec = opt_.timeout_ms_ % 1000 * 1000;
+  options.connect_timeout = &timeout;
+  options.command_timeout = &timeout;
+  redisAsyncContext* ctx = redisAsyncConnectWithOptions(&options);
+  if (ctx == nullptr) {
+    return "cannot allocate redis context";
+  }
+  if (ctx->err) {
+    std::string error = ctx->errstr;
+    redisAsyncFree(ctx);
+    return error;
+  }
+
+  conn.ctx_ = ctx;
+  conn.fd_ = ctx->c.fd;
+  conn.events_ = 0;
+  conn.timeout_at_.reset();
+  ctx->data = &conn;
+  ctx->ev.data = &conn;
+  ctx->ev.addRead = AddRead;
+  ctx->ev.delRead = DelRead;
+  ctx->ev.addWrite = AddWrite;
+  ctx->ev.delWrite = DelWrite;
+  ctx->ev.cleanup = Cleanup;
+  ctx->ev.scheduleTimer = ScheduleTimer;
+  // Watch the write event of the connecting socket.
+  redisAsyncSetConnectCallback(ctx, OnConnect);
+
+  // The commands are sent in order once connected, so AUTH and SELECT are
+  // before the commands of the chunks.
+  if (!opt_.password_.empty()) {
+    std::vector<const char*> argv{"AUTH"};
+    if (!opt_.username_.empty()) {
+      argv.emplace_back(opt_.username_.c_str());
+    }
+    argv.emplace_back(opt_.password_.c_str());
+    redisAsyncCommandArgv(
+        ctx,
+        OnSetupReply,
+        nullptr,
+        static_cast<int>(argv.size()),
+        argv.data(),
+        nullptr);
+  }
+  if (opt_.db_ != 0) {
+    auto db = std::to_string(opt_.db_);
+    const char* argv[] = {"SELECT", db.c_str()};
+    redisAsyncCommandArgv(ctx, OnSetupReply, nullptr, 2, argv, nullptr);
+  }
+  return {};
+}
+
+void EventLoop::Watch(Connection& conn, uint32_t events) {
+  if (events == conn.events_) {
+    return;
+  }
+  int op = EPOLL_CTL_MOD;
+  if (conn.events_ == 0) {
+    op = EPOLL_CTL_ADD;
+  } else if (events == 0) {
+    op = EPOLL_CTL_DEL;
+  }
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.ptr = &conn;
+  if (epoll_ctl(epoll_fd_, op, conn.fd_, &ev) != 0) {
+    Fail("cannot watch the connection, errno " + std::to_string(errno));
+    return;
+  }
+  conn.events_ = events;
+}
+
+void EventLoop::AddRead(void* data) {
+  auto& conn = *static_cast<Connection*>(data);
+  conn.loop_->Watch(conn, conn.events_ | EPOLLIN);
+}
+
+void EventLoop::DelRead(void* data) {
+  auto& conn = *static_cast<Connection*>(data);
+  conn.loop_->Watch(conn, conn.events_ & ~EPOLLIN);
+}
+
+void EventLoop::AddWrite(void* data) {
+  auto& conn = *static_cast<Connection*>(data);
+  conn.loop_->Watch(conn, conn.events_ | EPOLLOUT);
+}
+
+void EventLoop::DelWrite(void* data) {
+  auto& conn = *static_cast<Connection*>(data);
+  conn.loop_->Watch(conn, conn.events_ & ~EPOLLOUT);
+}
+
+void EventLoop::Cleanup(void* data) {
+  // The context is being freed, after the callbacks of its commands are
+  // called with null replies.
+  auto& conn = *static_cast<Connection*>(data);
+  conn.loop_->Watch(conn, 0);
+  conn.ctx_ = nullptr;
+  conn.fd_ = -1;
+  conn.timeout_at_.reset();
+  conn.reconnect_at_ = Clock::now() + k_reconnect_interval;
+}
+
+void EventLoop::ScheduleTimer(void* data, struct timeval tv) {
+  auto& conn = *static_cast<Connection*>(data);
+  conn.timeout_at_ = Clock::now() + std::chrono::seconds(tv.tv_sec) +
+      std::chrono::microseconds(tv.tv_usec);
+}
+
+void EventLoop::OnConnect(const redisAsyncContext* ctx, int status) {
+  if (status != REDIS_OK) {
+    auto& conn = *static_cast<Connection*>(ctx->data);
+    conn.loop_->last_error_ = ctx->errstr;
+  }
+}
+
+void EventLoop::OnSetupReply(redisAsyncContext* ctx, void* reply, void*) {
+  // The setup is redone when reconnected.
+  if (reply == nullptr) {
+    return;
+  }
+  auto* r = static_cast<redisReply*>(reply);
+  if (r->type == REDIS_REPLY_STATUS &&
+      std::string_view(r->str, r->len) == "OK") {
+    return;
+  }
+  auto& conn = *static_cast<Connection*>(ctx->data);
+  conn.loop_->Fail(
+      "auth or select db error: " +
+      (r->str == nullptr ? std::string() : std::string(r->str, r->len)));
+}
+
+void EventLoop::OnReply(redisAsyncContext* ctx, void* reply, void* command) {
+  auto& conn = *static_cast<Connection*>(ctx->data);
+  auto& loop = *conn.loop_;
+  std::unique_ptr<AsyncCommand> cmd(static_cast<AsyncCommand*>(command));
+  --conn.num_outstanding_;
+
+  auto* r = static_cast<redisReply*>(reply);
+  if (r == nullptr || r->type == REDIS_REPLY_ERROR) {
+    if (r != nullptr) {
+      loop.last_error_.assign(r->str, r->len);
+    } else if (ctx->errstr != nullptr && ctx->errstr[0] != '\0') {
+      loop.last_error_ = ctx->errstr;
+    }
+    if (cmd->num_retries_ < loop.opt_.retry_limit_) {
+      ++cmd->num_retries_;
+      loop.pending_.emplace_front(std::move(cmd));
+    } else {
+      loop.Fail(
+          "command failed after " + std::to_string(cmd->num_retries_) +
+          " retries: " + loop.last_error_);
+    }
+    return;
+  }
+
+  try {
+    cmd->on_reply_(static_cast<redisReply*>(reply), loop.values_);
+  } catch (const std::exception& e) {
+    loop.Fail(e.what());
+  }
+}
+
+void EventLoop::Fail(std::string error) {
+  // The error is thrown by the loop, not through the frames of hiredis.
+  if (error_.empty()) {
+    error_ = std::move(error);
+  }
+}
+
+void EventLoop::Dispatch() {
+  while (!pending_.empty()) {
+    Connection* target = nullptr;
+    for (auto& conn : connections_) {
+      if (conn->ctx_ == nullptr ||
+          conn->num_outstanding_ >= opt_.max_outstanding_) {
+        continue;
+      }
+      if (target == nullptr ||
+          conn->num_outstanding_ < target->num_outstanding_) {
+        target = conn.get();
+      }
+    }
+    if (target == nullptr) {
+      return;
+    }
+
+    auto command = std::move(pending_.front());
+    pending_.pop_front();
+    int status = redisAsyncCommandArgv(
+        target->ctx_,
+        OnReply,
+        command.get(),
+        static_cast<int>(command->argv_.size()),
+        command->argv_.data(),
+        command->argv_len_.data());
+    if (status != REDIS_OK) {
+      Fail("cannot send command");
+      return;
+    }
+    // Owned by the callback.
+    command.release();
+    ++target->num_outstanding_;
+  }
+}
+
+int EventLoop::WaitMs() const {
+  std::optional<Clock::time_point> deadline;
+  for (auto& conn : connections_) {
+    std::optional<Clock::time_point> at;
+    if (conn->ctx_ == nullptr) {
+      at = conn->reconnect_at_;
+    } else {
+      at = conn->timeout_at_;
+    }
+    if (at.has_value() && (!deadline.has_value() || *at < *deadline)) {
+      deadline = at;
+    }
+  }
+  if (!deadline.has_value()) {
+    return -1;
+  }
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                *deadline - Clock::now())
+                .count();
+  // Round up, not to wake before the deadline.
+  return static_cast<int>(std::max<int64_t>(ms + 1, 0));
+}
+
+uint32_t EventLoop::NumOutstanding() const {
+  uint32_t n = 0;
+  for (auto& conn : connections_) {
+    n += conn->num_outstanding_;
+  }
+  return n;
+}
+
+void EventLoop::Run() {
+  std::array<epoll_event, 64> events{};
+  bool stopping = false;
+  while (true) {
+    int n = epoll_wait(epoll_fd_, events.data(), events.size(), WaitMs());
+    if (n < 0) {
+      TORCH_CHECK(errno == EINTR, "epoll_wait error, errno ", errno);
+      n = 0;
+    }
+    for (int i = 0; i < n; ++i) {
+      auto* conn = static_cast<Connection*>(events[i].data.ptr);
+      if (conn == nullptr) {
+        stopping = TakeSubmitted();
+        continue;
+      }
+      // The context may be freed by the events before.
+      if (conn->ctx_ != nullptr &&
+          (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+        redisAsyncHandleRead(conn->ctx_);
+      }
+      if (conn->ctx_ != nullptr && (events[i].events & EPOLLOUT) != 0) {
+        redisAsyncHandleWrite(conn->ctx_);
+      }
+    }
+
+    auto now = Clock::now();
+    for (auto& conn : connections_) {
+      if (conn->ctx_ == nullptr) {
+        if (now < conn->reconnect_at_) {
+          continue;
+        }
+        auto error = Connect(*conn);
+        if (!error.empty()) {
+          last_error_ = std::move(error);
+          conn->reconnect_at_ = now + k_reconnect_interval;
+        }
+        continue;
+      }
+      if (conn->timeout_at_.has_value() && now >= *conn->timeout_at_) {
+        conn->timeout_at_.reset();
+        redisAsyncHandleTimeout(conn->ctx_);
+      }
+    }
+
+    Dispatch();
+    TORCH_CHECK(
+        error_.empty(),
+        error_,
+        ", from redis://",
+        opt_.host_,
+        ":",
+        opt_.port_);
+    if (stopping && pending_.empty() && NumOutstanding() == 0) {
+      break;
+    }
+  }
+}
+
+void EventLoop::Close() {
+  for (auto& conn : connections_) {
+    if (conn->ctx_ != nullptr) {
+      redisAsyncFree(conn->ctx_);
+    }
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+  }
+}
+
+namespace {
+
+struct AsyncPullContext {
+  std::atomic<uint32_t> num_complete_ids_{0};
+  uint32_t num_global_ids_;
+  uint32_t num_optimizer_stats_;
+  void* on_complete_context_;
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
+  void (*on_all_fetched_)(void* ctx);
+  const IOPullDestination* dsts_;
+
+  /**
+   * The destinations of the optimizer states of row, or nullptr.
+   */
+  [[nodiscard]] const IOPullDestination* Destinations(uint32_t row) const {
+    if (dsts_ == nullptr) {
+      return nullptr;
+    }
+    return &dsts_[row * num_optimizer_stats_];
+  }
+
+  /**
+   * Deliver the num_rows rows from row_begin of an MGET reply, as a chunk
+   * per optimizer state. It runs on the event loop, so a value which is not
+   * a string, or a reply which is not an array of the values, is delivered
+   * as missing instead of thrown.
+   */
+  void Deliver(
+      redisReply* reply,
+      ChunkValues& values,
+      bool packed,
+      uint32_t row_begin,
+      uint32_t num_rows) const {
+    uint32_t num_os = num_optimizer_stats_;
+    size_t num_keys = packed ? num_rows : size_t{num_rows} * num_os;
+    bool valid =
+        reply->type == REDIS_REPLY_ARRAY && reply->elements == num_keys;
+    auto value_of = [&](size_t k) -> redisReply* {
+      if (!valid || reply->element[k]->type != REDIS_REPLY_STRING) {
+        return nullptr;
+      }
+      return reply->element[k];
+    };
+
+    values.Reset(row_begin, num_os);
+    for (uint32_t i = 0; i < num_rows; ++i) {
+      const IOPullDestination* dsts = Destinations(row_begin + i);
+      if (!packed) {
+        for (uint32_t os = 0; os < num_os; ++os) {
+          if (auto* value = value_of(size_t{i} * num_os + os)) {
+            values.Add(
+                os,
+                value->str,
+                value->len,
+                dsts == nullptr ? nullptr : &dsts[os]);
+          } else {
+            values.AddMissing(os);
+          }
+        }
+        continue;
+      }
+      if (auto* value = value_of(i)) {
+        values.AddPacked(std::string_view(value->str, value->len), dsts);
+        continue;
+      }
+      for (uint32_t os = 0; os < num_os; ++os) {
+        values.AddMissing(os);
+      }
+    }
+    for (uint32_t os = 0; os < num_os; ++os) {
+      IOPullChunk chunk = values.Chunk(os, 0, num_rows);
+      on_chunk_fetched_(on_complete_context_, &chunk);
+    }
+  }
+
+  /**
+   * Count the n global ids of a chunk fetched, the last one completes the
+   * pull.
+   */
+  void Done(uint32_t n) {
+    if (num_complete_ids_.fetch_add(n) + n == num_global_ids_) {
+      on_all_fetched_(on_complete_context_);
+      delete this;
+    }
+  }
+};
+
+struct AsyncPushContext {
+  std::atomic<uint32_t> num_complete_ids_{0};
+  uint32_t num_global_ids_;
+  void* on_complete_context_;
+  void (*on_push_complete_)(void*);
+
+  void Done(uint32_t n) {
+    if (num_complete_ids_.fetch_add(n) + n == num_global_ids_) {
+      on_push_complete_(on_complete_context_);
+      delete this;
+    }
+  }
+};
+
+} // namespace
+
+static std::vector<int64_t> ColIds(uint32_t num_cols, const int64_t* col_ids) {
+  if (num_cols == 0) {
+    return {-1};
+  }
+  return std::vector<int64_t>(col_ids, col_ids + num_cols);
+}
+
+RedisAsync::RedisAsync(Option opt) : opt_(std::move(opt)) {
+  for (uint32_t i = 0; i < opt_.num_io_threads_; ++i) {
+    loops_.emplace_back(std::make_unique<EventLoop>(opt_));
+  }
+}
+
+RedisAsync::~RedisAsync() = default;
+
+void RedisAsync::Submit(std::vector<std::unique_ptr<AsyncCommand>> commands) {
+  // Start from the next loop, so that the requests of a single chunk are
+  // spread over the loops too.
+  uint32_t first = next_loop_.fetch_add(1, std::memory_order_relaxed);
+  std::vector<std::vector<std::unique_ptr<AsyncCommand>>> batches(
+      loops_.size());
+  for (size_t i = 0; i < commands.size(); ++i) {
+    batches[(first + i) % loops_.size()].emplace_back(std::move(commands[i]));
+  }
+  for (size_t i = 0; i < loops_.size(); ++i) {
+    if (!batches[i].empty()) {
+      loops_[i]->Submit(std::move(batches[i]));
+    }
+  }
+}
+
+void RedisAsync::Pull(IOPullParameterV2 param) {
+  if (param.num_global_ids_ == 0) {
+    param.on_all_fetched_(param.on_complete_context_);
+    return;
+  }
+  bool packed = opt_.layout_ == Option::k_layout_packed;
+  uint32_t num_os = param.num_optimizer_stats_;
+  auto col_ids = ColIds(param.num_cols_, param.col_ids_);
+  auto num_cols = static_cast<uint32_t>(col_ids.size());
+  uint32_t chunk_size = CalculateChunkSizeByGlobalIDs(
+      opt_.chunk_size_, param.num_cols_, packed ? 1 : num_os);
+  uint64_t table_hash = HashRing::Hash(param.table_name_);
+
+  auto* ctx = new AsyncPullContext{
+      .num_global_ids_ = param.num_global_ids_,
+      .num_optimizer_stats_ = num_os,
+      .on_complete_context_ = param.on_complete_context_,
+      .on_chunk_fetched_ = param.on_chunk_fetched_,
+      .on_all_fetched_ = param.on_all_fetched_,
+      .dsts_ = param.dsts_,
+  };
+  std::vector<std::unique_ptr<AsyncCommand>> commands;
+  for (uint32_t begin = 0; begin < param.num_global_ids_;
+       begin += chunk_size) {
+    uint32_t end = std::min(begin + chunk_size, param.num_global_ids_);
+    auto command = std::make_unique<AsyncCommand>();
+    // The keys of the rows from `begin * num_cols`, and of their optimizer
+    // states in the per state layout.
+    auto& keys = command->buffers_;
+    for (uint32_t i = begin; i < end; ++i) {
+      int64_t gid = param.global_ids_[i];
+      for (auto col_id : col_ids) {
+        if (packed) {
+          keys.emplace_back(PackedKey(opt_.prefix_, table_hash, gid, col_id));
+          continue;
+        }
+        for (uint32_t os = 0; os < num_os; ++os) {
+          keys.emplace_back(
+              PerStateKey(opt_.prefix_, param.table_name_, gid, col_id, os));
+        }
+      }
+    }
+    command->AddArg("MGET", 4);
+    for (auto& key : keys) {
+      command->AddArg(key);
+    }
+    command->on_reply_ = [ctx,
+                          packed,
+                          row_begin = begin * num_cols,
+                          num_ids = end - begin,
+                          num_rows = (end - begin) * num_cols](
+                             redisReply* reply, ChunkValues& values) {
+      ctx->Deliver(reply, values, packed, row_begin, num_rows);
+      ctx->Done(num_ids);
+    };
+    commands.emplace_back(std::move(command));
+  }
+  Submit(std::move(commands));
+}
+
+void RedisAsync::Push(IOPushParameter param) {
+  bool packed = opt_.layout_ == Option::k_layout_packed;
+  uint32_t num_os = param.num_optimizer_stats_;
+  if (packed) {
+    // A packed value is written as a whole.
+    for (uint32_t i = 0; i < num_os; ++i) {
+      TORCH_CHECK(
+          param.optimizer_stats_ids_[i] == i,
+          "the packed layout only supports pushing all the optimizer states");
+    }
+  }
+  if (param.num_global_ids_ == 0) {
+    param.on_push_complete(param.on_complete_context_);
+    return;
+  }
+  auto col_ids = ColIds(param.num_cols_, param.col_ids_);
+  auto num_cols = static_cast<uint32_t>(col_ids.size());
+  uint32_t chunk_size = CalculateChunkSizeByGlobalIDs(
+      opt_.chunk_size_, param.num_cols_, packed ? 1 : num_os);
+  uint64_t table_hash = HashRing::Hash(param.table_name_);
+  auto* data = reinterpret_cast<const uint8_t*>(param.data_);
+
+  auto* ctx = new AsyncPushContext{
+      .num_global_ids_ = param.num_global_ids_,
+      .on_complete_context_ = param.on_complete_context_,
+      .on_push_complete_ = param.on_push_complete,
+  };
+  std::vector<std::unique_ptr<AsyncCommand>> commands;
+  for (uint32_t begin = 0; begin < param.num_global_ids_;
+       begin += chunk_size) {
+    uint32_t end = std::min(begin + chunk_size, param.num_global_ids_);
+    auto command = std::make_unique<AsyncCommand>();
+    auto& buffers = command->buffers_;
+    command->AddArg("MSET", 4);
+    if (packed) {
+      // The keys and the packed values of the rows.
+      for (uint32_t i = begin; i < end; ++i) {
+        for (uint32_t j = 0; j < num_cols; ++j) {
+          buffers.emplace_back(PackedKey(
+              opt_.prefix_, table_hash, param.global_ids_[i], col_ids[j]));
+          buffers.emplace_back();
+          EncodePackedValue(
+              buffers.back(),
+              num_os,
+              data,
+              param.offsets_ + (uint64_t{i} * num_cols + j) * num_os);
+        }
+      }
+      for (auto& buffer : buffers) {
+        command->AddArg(buffer);
+      }
+    } else {
+      for (uint32_t i = begin; i < end; ++i) {
+        for (auto col_id : col_ids) {
+          for (uint32_t k = 0; k < num_os; ++k) {
+            buffers.emplace_back(PerStateKey(
+                opt_.prefix_,
+                param.table_name_,
+                param.global_ids_[i],
+                col_id,
+                param.optimizer_stats_ids_[k]));
+          }
+        }
+      }
+      // The values are not copied, they are in the order of the keys.
+      const uint64_t* offsets =
+          param.offsets_ + uint64_t{begin} * num_cols * num_os;
+      for (size_t k = 0; k < buffers.size(); ++k) {
+        command->AddArg(buffers[k]);
+        command->AddArg(
+            reinterpret_cast<const char*>(data + offsets[k]),
+            offsets[k + 1] - offsets[k]);
+      }
+    }
+    command->on_reply_ = [ctx, num_ids = end - begin](
+                             redisReply* reply, ChunkValues&) {
+      TORCH_CHECK(
+          reply->type == REDIS_REPLY_STATUS &&
+              std::string_view(reply->str, reply->len) == "OK",
+          "MSET reply should be OK");
+      ctx->Done(num_ids);
+    };
+    commands.emplace_back(std::move(command));
+  }
+  Submit(std::move(commands));
+}
+
+} // namespace tde::details::redis_v1
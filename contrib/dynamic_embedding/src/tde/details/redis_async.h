@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "tde/details/io_registry.h"
+#include "tde/details/redis_io_v1.h"
+
+namespace tde::details::redis_v1 {
+
+struct AsyncCommand;
+class EventLoop;
+
+/**
+ * The async mode of `RedisV1`.
+ *
+ * Each of the `num_threads` io threads runs an epoll event loop of
+ * `connections` async connections. A chunk is one command, an MGET of its
+ * keys or an MSET of its values, in either layout. The chunks of a request
+ * are spread over the event loops, and each loop sends them to its least
+ * loaded connections, with at most `max_outstanding` commands in flight on a
+ * connection. So a few threads keep many chunks in flight, instead of one
+ * per thread.
+ *
+ * A command failed, e.g., by a broken connection, a timeout or an error
+ * reply, is resent up to `retry_limit` times, on a reconnected connection.
+ * The connections are not pinged, the timeouts detect the dead ones.
+ */
+class RedisAsync {
+ public:
+  explicit RedisAsync(Option opt);
+
+  ~RedisAsync();
+
+  RedisAsync(const RedisAsync&) = delete;
+  RedisAsync& operator=(const RedisAsync&) = delete;
+
+  void Pull(IOPullParameterV2 param);
+
+  void Push(IOPushParameter param);
+
+ private:
+  /**
+   * Spread the commands of a request over the event loops.
+   */
+  void Submit(std::vector<std::unique_ptr<AsyncCommand>> commands);
+
+  Option opt_;
+  std::vector<std::unique_ptr<EventLoop>> loops_;
+  std::atomic<uint32_t> next_loop_{0};
+};
+
+} // namespace tde::details::redis_v1
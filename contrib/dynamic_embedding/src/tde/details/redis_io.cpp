@@ -1,26 +1,76 @@
 #include "redis_io.h"
 #include "tde/details/io_registry.h"
 #include "tde/details/redis_io_v1.h"
+#include "tde/details/sharded_io.h"
 
 namespace tde::details {
 
+/**
+ * The provider of a redis instance of one endpoint, i.e., a shard of the
+ * `redis` IO.
+ */
+static IOProvider RedisV1Provider() {
+  IOProvider provider{};
+  provider.type_ = "redis";
+  provider.Finalize =
+      +[](void* inst) { delete reinterpret_cast<redis_v1::RedisV1*>(inst); };
+  provider.version_ = k_io_version_2;
+  provider.PullV2 = +[](void* inst, IOPullParameterV2 param) {
+    reinterpret_cast<redis_v1::RedisV1*>(inst)->Pull(param);
+  };
+  provider.Push = +[](void* inst, IOPushParameter param) {
+    reinterpret_cast<redis_v1::RedisV1*>(inst)->Push(param);
+  };
+  provider.Stats = +[](void* inst, void* ctx, IOStatsEmitter emit) {
+    c10::Dict<std::string, double> stats;
+    reinterpret_cast<redis_v1::RedisV1*>(inst)->Stats(stats);
+    for (const auto& stat : stats) {
+      emit(ctx, stat.key().c_str(), stat.value());
+    }
+  };
+  return provider;
+}
+
 void RegisterRedisIO() {
   auto& reg = IORegistry::Instance();
 
   {
     IOProvider provider{};
     provider.type_ = "redis";
+    // One redis instance, with its own connection threads, per endpoint.
+    // The global ids are sharded over the endpoints by consistent hashing.
     provider.Initialize = +[](const char* cfg) -> void* {
-      auto opt = redis_v1::Option::Parse(cfg);
-      return new redis_v1::RedisV1(opt);
+      auto endpoint_provider = RedisV1Provider();
+      std::vector<ShardedIO::Shard> shards;
+      try {
+        for (auto& opt : redis_v1::Option::ParseEndpoints(cfg)) {
+          auto name = opt.host_ + ":" + std::to_string(opt.port_) + "/" +
+              std::to_string(opt.db_);
+          shards.emplace_back(ShardedIO::Shard{
+              .name_ = std::move(name),
+              .provider_ = endpoint_provider,
+              .instance_ = new redis_v1::RedisV1(opt),
+          });
+        }
+      } catch (...) {
+        for (auto& shard : shards) {
+          endpoint_provider.Finalize(shard.instance_);
+        }
+        throw;
+      }
+      return new ShardedIO(std::move(shards));
     };
     provider.Finalize =
-        +[](void* inst) { delete reinterpret_cast<redis_v1::RedisV1*>(inst); };
-    provider.Pull = +[](void* inst, IOPullParameter param) {
-      reinterpret_cast<redis_v1::RedisV1*>(inst)->Pull(param);
+        +[](void* inst) { delete reinterpret_cast<ShardedIO*>(inst); };
+    provider.version_ = k_io_version_2;
+    provider.PullV2 = +[](void* inst, IOPullParameterV2 param) {
+      reinterpret_cast<ShardedIO*>(inst)->Pull(param);
     };
     provider.Push = +[](void* inst, IOPushParameter param) {
-      reinterpret_cast<redis_v1::RedisV1*>(inst)->Push(param);
+      reinterpret_cast<ShardedIO*>(inst)->Push(param);
+    };
+    provider.Stats = +[](void* inst, void* ctx, IOStatsEmitter emit) {
+      reinterpret_cast<ShardedIO*>(inst)->Stats(ctx, emit);
     };
     reg.Register(provider);
   }
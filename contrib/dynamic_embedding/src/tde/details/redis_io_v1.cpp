@@ -1,9 +1,13 @@
 #include "tde/details/redis_io_v1.h"
+#include <cstring>
 #include <iostream>
 #include <variant>
 #include "lexy/callback.hpp"
 #include "lexy/dsl.hpp"
 #include "tcb/span.hpp"
+#include "tde/details/hash_ring.h"
+#include "tde/details/redis_async.h"
+#include "tde/details/redis_reply_arena.h"
 #include "tde/details/url.h"
 
 namespace tde::details::redis_v1 {
@@ -34,6 +38,46 @@ struct ChunkSizeOpt {
   uint32_t chunk_size_;
 };
 
+struct LayoutOpt {
+  uint32_t layout_;
+};
+
+struct MigrateOpt {
+  uint32_t migrate_;
+};
+
+struct AsyncOpt {
+  uint32_t async_;
+};
+
+struct ConnectionsOpt {
+  uint32_t num_connections_;
+};
+
+struct MaxOutstandingOpt {
+  uint32_t max_outstanding_;
+};
+
+struct ChunkLatencyMsOpt {
+  uint32_t chunk_latency_;
+};
+
+struct MinChunkSizeOpt {
+  uint32_t min_chunk_size_;
+};
+
+struct MaxChunkSizeOpt {
+  uint32_t max_chunk_size_;
+};
+
+struct HedgePercentileOpt {
+  uint32_t hedge_percentile_;
+};
+
+struct HedgeDelayMsOpt {
+  uint32_t hedge_delay_;
+};
+
 using OptVar = std::variant<
     NumThreadsOpt,
     DBOpt,
@@ -41,7 +85,17 @@ using OptVar = std::variant<
     TimeoutMsOpt,
     HeartBeatMsOpt,
     RetryLimitOpt,
-    ChunkSizeOpt>;
+    ChunkSizeOpt,
+    LayoutOpt,
+    MigrateOpt,
+    AsyncOpt,
+    ConnectionsOpt,
+    MaxOutstandingOpt,
+    ChunkLatencyMsOpt,
+    MinChunkSizeOpt,
+    MaxChunkSizeOpt,
+    HedgePercentileOpt,
+    HedgeDelayMsOpt>;
 
 struct OptionSetter {
   void operator()(Option* self, NumThreadsOpt opt) {
@@ -70,6 +124,49 @@ struct OptionSetter {
     TORCH_CHECK(opt.chunk_size_ != 0);
     self->chunk_size_ = opt.chunk_size_;
   }
+  void operator()(Option* self, LayoutOpt opt) {
+    TORCH_CHECK(
+        opt.layout_ == Option::k_layout_per_state ||
+            opt.layout_ == Option::k_layout_packed,
+        "unknown layout ",
+        opt.layout_);
+    self->layout_ = opt.layout_;
+  }
+  void operator()(Option* self, MigrateOpt opt) {
+    self->migrate_ = opt.migrate_ != 0;
+  }
+  void operator()(Option* self, AsyncOpt opt) {
+    self->async_ = opt.async_ != 0;
+  }
+  void operator()(Option* self, ConnectionsOpt opt) {
+    TORCH_CHECK(opt.num_connections_ != 0);
+    self->num_connections_ = opt.num_connections_;
+  }
+  void operator()(Option* self, MaxOutstandingOpt opt) {
+    TORCH_CHECK(opt.max_outstanding_ != 0);
+    self->max_outstanding_ = opt.max_outstanding_;
+  }
+  void operator()(Option* self, ChunkLatencyMsOpt opt) {
+    TORCH_CHECK(opt.chunk_latency_ != 0);
+    self->chunk_latency_ms_ = opt.chunk_latency_;
+  }
+  void operator()(Option* self, MinChunkSizeOpt opt) {
+    TORCH_CHECK(opt.min_chunk_size_ != 0);
+    self->min_chunk_size_ = opt.min_chunk_size_;
+  }
+  void operator()(Option* self, MaxChunkSizeOpt opt) {
+    TORCH_CHECK(opt.max_chunk_size_ != 0);
+    self->max_chunk_size_ = opt.max_chunk_size_;
+  }
+  void operator()(Option* self, HedgePercentileOpt opt) {
+    TORCH_CHECK(
+        opt.hedge_percentile_ != 0 && opt.hedge_percentile_ < 100,
+        "hedge_percentile should be in [1, 99]");
+    self->hedge_percentile_ = opt.hedge_percentile_;
+  }
+  void operator()(Option* self, HedgeDelayMsOpt opt) {
+    self->hedge_delay_ms_ = opt.hedge_delay_;
+  }
 };
 
 namespace option_rules {
@@ -160,6 +257,58 @@ struct ChunkSize {
   constexpr static auto value = lexy::construct<ChunkSizeOpt>;
 };
 
+struct Layout {
+  constexpr static auto rule = LEXY_LIT("layout=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<LayoutOpt>;
+};
+
+struct Migrate {
+  constexpr static auto rule = LEXY_LIT("migrate=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<MigrateOpt>;
+};
+
+struct Async {
+  constexpr static auto rule = LEXY_LIT("async=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<AsyncOpt>;
+};
+
+struct Connections {
+  constexpr static auto rule = LEXY_LIT("connections=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<ConnectionsOpt>;
+};
+
+struct MaxOutstanding {
+  constexpr static auto rule =
+      LEXY_LIT("max_outstanding=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<MaxOutstandingOpt>;
+};
+
+struct ChunkLatency {
+  constexpr static auto rule = LEXY_LIT("chunk_latency=") >> dsl::p<Duration>;
+  constexpr static auto value = lexy::construct<ChunkLatencyMsOpt>;
+};
+
+struct MinChunkSize {
+  constexpr static auto rule = LEXY_LIT("min_chunk_size=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<MinChunkSizeOpt>;
+};
+
+struct MaxChunkSize {
+  constexpr static auto rule = LEXY_LIT("max_chunk_size=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<MaxChunkSizeOpt>;
+};
+
+struct HedgePercentile {
+  constexpr static auto rule =
+      LEXY_LIT("hedge_percentile=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<HedgePercentileOpt>;
+};
+
+struct HedgeDelay {
+  constexpr static auto rule = LEXY_LIT("hedge_delay=") >> dsl::p<Duration>;
+  constexpr static auto value = lexy::construct<HedgeDelayMsOpt>;
+};
+
 struct UnknownOption {
   constexpr static auto name = "unknown option";
 };
@@ -167,7 +316,11 @@ struct UnknownOption {
 struct Option {
   constexpr static auto rule = dsl::p<NumThreads> | dsl::p<DB> |
       dsl::p<Prefix> | dsl::p<Timeout> | dsl::p<HeartBeat> |
-      dsl::p<RetryLimit> | dsl::p<ChunkSize> | dsl::error<UnknownOption>;
+      dsl::p<RetryLimit> | dsl::p<ChunkSize> | dsl::p<Layout> |
+      dsl::p<Migrate> | dsl::p<Async> | dsl::p<Connections> |
+      dsl::p<MaxOutstanding> | dsl::p<ChunkLatency> | dsl::p<MinChunkSize> |
+      dsl::p<MaxChunkSize> | dsl::p<HedgePercentile> | dsl::p<HedgeDelay> |
+      dsl::error<UnknownOption>;
   constexpr static auto value = lexy::construct<OptVar>;
 };
 
@@ -181,7 +334,35 @@ struct Options {
 } // namespace option_rules
 
 Option::Option(std::string_view config_str) {
-  auto url = url_parser::ParseUrl(config_str);
+  // The replicas follow the host, separated by '+', and share its auth and
+  // options.
+  std::string primary(config_str);
+  auto auth_end = config_str.find('@');
+  auto hosts_begin = auth_end == std::string_view::npos ? 0 : auth_end + 1;
+  auto hosts_end =
+      std::min(config_str.find("/?", hosts_begin), config_str.size());
+  auto hosts = config_str.substr(hosts_begin, hosts_end - hosts_begin);
+  auto replicas_begin = hosts.find('+');
+  if (replicas_begin != std::string_view::npos) {
+    primary = std::string(config_str.substr(0, hosts_begin + replicas_begin));
+    primary.append(config_str.substr(hosts_end));
+    auto replicas = hosts.substr(replicas_begin + 1);
+    while (true) {
+      auto pos = replicas.find('+');
+      auto replica = url_parser::ParseUrl(replicas.substr(0, pos));
+      Endpoint endpoint{.host_ = std::move(replica.host_)};
+      if (replica.port_.has_value()) {
+        endpoint.port_ = replica.port_.value();
+      }
+      replicas_.emplace_back(std::move(endpoint));
+      if (pos == std::string_view::npos) {
+        break;
+      }
+      replicas = replicas.substr(pos + 1);
+    }
+  }
+
+  auto url = url_parser::ParseUrl(primary);
   if (url.auth_.has_value()) {
     username_ = std::move(url.auth_->username_);
     if (url.auth_->password_.has_value()) {
@@ -215,52 +396,236 @@ Option::Option(std::string_view config_str) {
           opt_var);
     }
   }
+  TORCH_CHECK(
+      !migrate_ || layout_ == k_layout_packed,
+      "migrate is only supported by the packed layout");
+  TORCH_CHECK(!migrate_ || !async_, "migrate is not supported by async");
+  TORCH_CHECK(
+      chunk_latency_ms_ == 0 || !async_,
+      "chunk_latency is not supported by async");
+  TORCH_CHECK(
+      replicas_.empty() || !async_, "replicas are not supported by async");
+  TORCH_CHECK(
+      replicas_.empty() || !migrate_,
+      "replicas are not supported by migrate, which writes in pulls");
+  TORCH_CHECK(
+      min_chunk_size_ <= chunk_size_ &&
+          (max_chunk_size_ == 0 || chunk_size_ <= max_chunk_size_),
+      "chunk_size ",
+      chunk_size_,
+      " is not in [min_chunk_size, max_chunk_size]");
 }
 
-RedisV1::RedisV1(Option opt) : opt_(std::move(opt)) {
+std::vector<Option> Option::ParseEndpoints(std::string_view config_str) {
+  std::string_view auth;
+  auto auth_end = config_str.find('@');
+  if (auth_end != std::string_view::npos) {
+    auth = config_str.substr(0, auth_end + 1);
+    config_str = config_str.substr(auth_end + 1);
+  }
+  std::string_view param;
+  auto param_begin = config_str.find("/?");
+  if (param_begin != std::string_view::npos) {
+    param = config_str.substr(param_begin);
+    config_str = config_str.substr(0, param_begin);
+  }
+
+  std::vector<Option> endpoints;
+  while (true) {
+    auto pos = config_str.find(',');
+    std::string endpoint(auth);
+    endpoint.append(config_str.substr(0, pos));
+    endpoint.append(param);
+    endpoints.emplace_back(Option(endpoint));
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    config_str = config_str.substr(pos + 1);
+  }
+  return endpoints;
+}
+
+// The chunks queued to an io thread, beyond which the chunks are queued to
+// the next threads.
+static constexpr size_t k_job_queue_capacity = 4096;
+
+// The recent pull chunks, by whose latencies the hedges are scheduled.
+static constexpr uint32_t k_latency_window = 1024;
+
+static AdaptiveChunkOption ChunkOption(const Option& opt) {
+  return AdaptiveChunkOption{
+      .min_size_ = opt.min_chunk_size_,
+      .max_size_ = opt.max_chunk_size_ != 0
+          ? opt.max_chunk_size_
+          : static_cast<uint32_t>(
+                std::min<uint64_t>(opt.chunk_size_ * 16ULL, UINT32_MAX)),
+      .target_latency_us_ = opt.chunk_latency_ms_ * 1000,
+  };
+}
+
+RedisV1::RedisV1(Option opt)
+    : opt_(std::move(opt)),
+      pull_chunk_(opt_.chunk_size_, ChunkOption(opt_)),
+      push_chunk_(opt_.chunk_size_, ChunkOption(opt_)),
+      pull_latency_(k_latency_window, opt_.hedge_percentile_ / 100.0) {
   TORCH_CHECK(opt_.num_io_threads_ != 0, "num_io_threads must not be empty");
   TORCH_CHECK(
       opt_.heart_beat_interval_ms_ != 0,
       "heart beat interval must not be zero.");
+  if (opt_.async_) {
+    async_ = std::make_unique<RedisAsync>(opt_);
+    return;
+  }
   for (size_t i = 0; i < opt_.num_io_threads_; ++i) {
-    StartThread();
-  }
-}
-
-void RedisV1::StartThread() {
-  auto connection = Connect();
-  HeartBeat(connection);
-
-  io_threads_.emplace_back(
-      [connection = std::move(connection), this]() mutable {
-        std::chrono::milliseconds heart_beat(opt_.heart_beat_interval_ms_);
-        while (true) {
-          MoveOnlyFunction<void(redis::ContextPtr&)> todo;
-          bool heartbeat_timeout;
-          {
-            std::unique_lock<std::mutex> lock(this->jobs_mutex_);
-            heartbeat_timeout = !jobs_not_empty_.wait_for(
-                lock, heart_beat, [this] { return !jobs_.empty(); });
-            if (!heartbeat_timeout) {
-              todo = std::move(jobs_.front());
-              jobs_.pop_front();
-            }
-          }
+    job_queues_.emplace_back(std::make_unique<JobQueue>(k_job_queue_capacity));
+  }
+  Endpoint primary{.host_ = opt_.host_, .port_ = opt_.port_};
+  for (uint32_t i = 0; i < opt_.num_io_threads_; ++i) {
+    StartThread(job_queues_, i, primary);
+  }
+  if (opt_.replicas_.empty()) {
+    return;
+  }
+  // Each replica has an io thread at least.
+  auto num_replicas = static_cast<uint32_t>(opt_.replicas_.size());
+  uint32_t num_hedge_threads = std::max(opt_.num_io_threads_, num_replicas);
+  for (uint32_t i = 0; i < num_hedge_threads; ++i) {
+    hedge_queues_.emplace_back(
+        std::make_unique<JobQueue>(k_job_queue_capacity));
+  }
+  for (uint32_t i = 0; i < num_hedge_threads; ++i) {
+    StartThread(hedge_queues_, i, opt_.replicas_[i % num_replicas]);
+  }
+  hedge_thread_ = std::thread([this] { RunHedges(); });
+}
 
-          if (heartbeat_timeout) {
-            HeartBeat(connection);
-            continue;
-          }
+void RedisV1::StartThread(
+    JobQueues& queues,
+    uint32_t index,
+    Endpoint endpoint) {
+  auto connection = Connect(endpoint);
+  HeartBeat(connection, endpoint);
+
+  io_threads_.emplace_back([connection = std::move(connection),
+                            endpoint = std::move(endpoint),
+                            &queues,
+                            index,
+                            this]() mutable {
+    std::chrono::milliseconds heart_beat(opt_.heart_beat_interval_ms_);
+    auto& queue = *queues[index];
+    ReplyArena arena;
+    ChunkValues values;
+    while (true) {
+      Job job;
+      if (PopJob(queues, index, job)) {
+        RunJob(job, connection, arena, values);
+        continue;
+      }
+      if (stopping_.load()) {
+        break;
+      }
 
-          if (!todo) {
-            break;
-          }
-          todo(connection);
-        }
-      });
+      // Announce sleeping before looking at the queues again, so that a
+      // job pushed meanwhile is either popped, or wakes the thread.
+      queue.sleeping_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (PopJob(queues, index, job)) {
+        queue.sleeping_.store(false, std::memory_order_relaxed);
+        RunJob(job, connection, arena, values);
+        continue;
+      }
+      bool heartbeat_timeout;
+      {
+        std::unique_lock<std::mutex> lock(queue.mu_);
+        heartbeat_timeout = !queue.not_empty_.wait_for(
+            lock, heart_beat, [&queue, this] {
+              return !queue.jobs_.Empty() || stopping_.load();
+            });
+      }
+      queue.sleeping_.store(false, std::memory_order_relaxed);
+      if (heartbeat_timeout) {
+        HeartBeat(connection, endpoint);
+      }
+    }
+  });
+}
+
+void RedisV1::Enqueue(JobQueues& queues, uint32_t thread, Job job) {
+  auto n = static_cast<uint32_t>(queues.size());
+  while (true) {
+    for (uint32_t i = 0; i < n; ++i) {
+      if (queues[(thread + i) % n]->jobs_.TryPush(job)) {
+        return;
+      }
+    }
+    // All the queues are full.
+    WakeSleeping(queues);
+    std::this_thread::yield();
+  }
 }
 
-void RedisV1::HeartBeat(redis::ContextPtr& connection) {
+void RedisV1::WakeSleeping(JobQueues& queues) {
+  // Pairs with the fence of a thread going to sleep.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (auto& queue : queues) {
+    if (queue->sleeping_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(queue->mu_);
+      queue->not_empty_.notify_one();
+    }
+  }
+}
+
+bool RedisV1::PopJob(JobQueues& queues, uint32_t thread, Job& job) {
+  auto n = static_cast<uint32_t>(queues.size());
+  for (uint32_t i = 0; i < n; ++i) {
+    if (queues[(thread + i) % n]->jobs_.TryPop(job)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RedisV1::RunJob(
+    const Job& job,
+    redis::ContextPtr& connection,
+    ReplyArena& arena,
+    ChunkValues& values) {
+  auto start = std::chrono::steady_clock::now();
+  bool delivered = true;
+  switch (job.kind_) {
+    case JobKind::kFetch:
+      delivered =
+          DoFetch(job.gid_offset_, job.ctx_, connection, arena, values);
+      break;
+    case JobKind::kPush:
+      DoPush(job.gid_offset_, job.ctx_, connection);
+      break;
+    case JobKind::kFetchPacked:
+      delivered = DoFetchPacked(
+          job.gid_offset_, job.ctx_, connection, arena, values);
+      break;
+    case JobKind::kPushPacked:
+      DoPushPacked(job.gid_offset_, job.ctx_, connection);
+      break;
+  }
+  if (job.hedge_ && delivered) {
+    num_hedge_wins_.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (job.chunk_size_ == 0) {
+    return;
+  }
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  if (job.kind_ == JobKind::kFetch || job.kind_ == JobKind::kFetchPacked) {
+    pull_chunk_.Record(job.chunk_size_, latency.count());
+  } else {
+    push_chunk_.Record(job.chunk_size_, latency.count());
+  }
+}
+
+void RedisV1::HeartBeat(
+    redis::ContextPtr& connection,
+    const Endpoint& endpoint) {
   for (uint32_t retry = 0; retry < opt_.retry_limit_; ++retry) {
     try {
       auto reply = redis::ReplyPtr(reinterpret_cast<redisReply*>(
@@ -272,28 +637,29 @@ void RedisV1::HeartBeat(redis::ContextPtr& connection) {
       TORCH_CHECK(rsp == "PONG", "ping/pong error");
     } catch (...) {
       // reconnect if heart beat error
-      connection = Connect();
+      connection = Connect(endpoint);
     }
   }
 }
 
-redis::ContextPtr RedisV1::Connect() const {
+redis::ContextPtr RedisV1::Connect(const Endpoint& endpoint) const {
   redis::ContextPtr connection;
   if (opt_.timeout_ms_ == 0) {
-    connection =
-        redis::ContextPtr(redisConnect(opt_.host_.c_str(), opt_.port_));
+    connection = redis::ContextPtr(
+        redisConnect(endpoint.host_.c_str(), endpoint.port_));
   } else {
     struct timeval interval {};
     interval.tv_sec = opt_.timeout_ms_ / 1000;
     interval.tv_usec = opt_.timeout_ms_ % 1000 * 1000;
     connection = redis::ContextPtr(
-        redisConnectWithTimeout(opt_.host_.c_str(), opt_.port_, interval));
+        redisConnectWithTimeout(
+            endpoint.host_.c_str(), endpoint.port_, interval));
   }
   TORCH_CHECK(
       !connection->err,
       "connect to %s:%d error occurred %s",
-      opt_.host_,
-      opt_.port_,
+      endpoint.host_,
+      endpoint.port_,
       connection->errstr);
 
   if (!opt_.password_.empty()) {
@@ -321,16 +687,36 @@ redis::ContextPtr RedisV1::Connect() const {
 }
 
 RedisV1::~RedisV1() {
-  for (uint32_t i = 0; i < opt_.num_io_threads_; ++i) {
-    jobs_.emplace_back();
+  // The hedges not issued yet are dropped, then the io threads stop after the
+  // jobs are done.
+  if (hedge_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(hedge_mu_);
+      hedge_stopping_ = true;
+    }
+    hedge_cv_.notify_one();
+    hedge_thread_.join();
+  }
+  stopping_ = true;
+  for (auto* queues : {&job_queues_, &hedge_queues_}) {
+    for (auto& queue : *queues) {
+      std::lock_guard<std::mutex> lock(queue->mu_);
+      queue->not_empty_.notify_one();
+    }
   }
-  jobs_not_empty_.notify_all();
   for (auto& th : io_threads_) {
     th.join();
   }
 }
 
-static uint32_t CalculateChunkSizeByGlobalIDs(
+// Commands of a value in the per state layout. The ids are formatted as long
+// long, so that the global ids beyond int32 are not truncated.
+static constexpr const char* k_get_per_state =
+    "GET %s_table_%s_gid_%lld_cid_%lld_osid_%u";
+static constexpr const char* k_set_per_state =
+    "SET %s_table_%s_gid_%lld_cid_%lld_osid_%u %b";
+
+uint32_t CalculateChunkSizeByGlobalIDs(
     uint32_t chunk_size,
     uint32_t num_cols,
     uint32_t num_os) {
@@ -347,15 +733,19 @@ struct RedisV1PullContext {
   std::vector<int64_t> col_ids_;
   uint32_t num_optimizer_stats_;
   void* on_complete_context_;
-  void (*on_global_id_fetched_)(
-      void* ctx,
-      uint32_t gid_offset,
-      uint32_t optimizer_state,
-      void* data,
-      uint32_t data_len);
+  void (*on_chunk_fetched_)(void* ctx, const IOPullChunk* chunk);
   void (*on_all_fetched_)(void* ctx);
-
-  explicit RedisV1PullContext(uint32_t chunk_size, IOPullParameter param)
+  const IOPullDestination* dsts_;
+  // The jobs and the hedges of the chunks not done yet.
+  std::atomic<uint32_t> num_refs_{0};
+  // With replicas, the latencies of the chunks from start_ are recorded in
+  // latency_, and if the chunks are hedged, delivered_ tells the chunks
+  // delivered by an attempt.
+  std::chrono::steady_clock::time_point start_;
+  LatencyWindow* latency_{nullptr};
+  std::unique_ptr<std::atomic<bool>[]> delivered_;
+
+  explicit RedisV1PullContext(uint32_t chunk_size, IOPullParameterV2 param)
       : chunk_size_(CalculateChunkSizeByGlobalIDs(
             chunk_size,
             param.num_cols_,
@@ -366,8 +756,9 @@ struct RedisV1PullContext {
             param.global_ids_ + param.num_global_ids_),
         num_optimizer_stats_(param.num_optimizer_stats_),
         on_complete_context_(param.on_complete_context_),
-        on_global_id_fetched_(param.on_global_id_fetched_),
-        on_all_fetched_(param.on_all_fetched_) {
+        on_chunk_fetched_(param.on_chunk_fetched_),
+        on_all_fetched_(param.on_all_fetched_),
+        dsts_(param.dsts_) {
     if (param.num_cols_ == 0) {
       col_ids_.emplace_back(-1);
     } else {
@@ -375,88 +766,354 @@ struct RedisV1PullContext {
           param.col_ids_, param.col_ids_ + param.num_cols_);
     }
   }
+
+  /**
+   * Claim the delivery of the chunk from gid_offset.
+   * @return false if another attempt of the chunk claimed it.
+   */
+  bool Claim(uint32_t gid_offset) {
+    if (delivered_ != nullptr &&
+        delivered_[gid_offset / chunk_size_].exchange(true)) {
+      return false;
+    }
+    if (latency_ != nullptr) {
+      latency_->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count());
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool Delivered(uint32_t gid_offset) const {
+    return delivered_[gid_offset / chunk_size_].load();
+  }
+
+  /**
+   * Count the n ids of a chunk delivered, and notify after the last one.
+   */
+  void Complete(uint32_t n) {
+    uint32_t target = global_ids_.size();
+    if (num_complete_ids_.fetch_add(n) + n == target) {
+      on_all_fetched_(on_complete_context_);
+    }
+  }
+
+  /**
+   * Drop the reference of a job or a hedge, and delete the context after
+   * the last one.
+   */
+  void Release() {
+    if (num_refs_.fetch_sub(1) == 1) {
+      delete this;
+    }
+  }
+
+  /**
+   * The destinations of the optimizer states of row, or nullptr.
+   */
+  [[nodiscard]] const IOPullDestination* Destinations(uint32_t row) const {
+    if (dsts_ == nullptr) {
+      return nullptr;
+    }
+    return &dsts_[row * num_optimizer_stats_];
+  }
+
+  /**
+   * The destination of the optimizer state os of row, or nullptr.
+   */
+  [[nodiscard]] const IOPullDestination* Destination(
+      uint32_t row,
+      uint32_t os) const {
+    if (dsts_ == nullptr) {
+      return nullptr;
+    }
+    return &dsts_[row * num_optimizer_stats_ + os];
+  }
+
+  /**
+   * Deliver the rows [begin, end) of values, as a chunk per optimizer
+   * state.
+   */
+  void Deliver(const ChunkValues& values, uint32_t begin, uint32_t end)
+      const {
+    for (uint32_t os = 0; os < num_optimizer_stats_; ++os) {
+      IOPullChunk chunk = values.Chunk(os, begin, end);
+      on_chunk_fetched_(on_complete_context_, &chunk);
+    }
+  }
 };
 
+/**
+ * Adds the value of a GET, a string or a nil, to the values of its
+ * optimizer state.
+ */
+struct GetTarget {
+  ChunkValues* values_;
+  uint32_t os_;
+  const IOPullDestination* dst_;
+
+  static void OnValue(void* ctx, const char* str, size_t len) {
+    auto& target = *reinterpret_cast<GetTarget*>(ctx);
+    if (str == nullptr) {
+      target.values_->AddMissing(target.os_);
+    } else {
+      target.values_->Add(target.os_, str, len, target.dst_);
+    }
+  }
+};
+
+/**
+ * Adds the packed values of an MGET, strings or nils, to the values of the
+ * rows from row_.
+ */
+struct MGetTarget {
+  ChunkValues* values_;
+  const RedisV1PullContext* fetch_param_;
+  uint32_t row_;
+
+  static void OnValue(void* ctx, const char* str, size_t len) {
+    auto& target = *reinterpret_cast<MGetTarget*>(ctx);
+    uint32_t row = target.row_++;
+    if (str == nullptr) {
+      for (uint32_t os = 0; os < target.fetch_param_->num_optimizer_stats_;
+           ++os) {
+        target.values_->AddMissing(os);
+      }
+      return;
+    }
+    // A corrupted value is missing, not thrown through the reader.
+    target.values_->AddPacked(
+        std::string_view(str, len), target.fetch_param_->Destinations(row));
+  }
+};
+
+/**
+ * Adapts the chunks of a pull to the callbacks of a v1 pull.
+ */
+struct RedisV1PullV1Context {
+  void* on_complete_context_;
+  void (*on_global_id_fetched_)(
+      void* ctx,
+      uint32_t offset,
+      uint32_t optimizer_state,
+      void* data,
+      uint32_t data_len);
+  void (*on_all_fetched_)(void* ctx);
+};
+
+static void OnChunkFetchedV1(void* ctx, const IOPullChunk* chunk) {
+  auto* c = reinterpret_cast<RedisV1PullV1Context*>(ctx);
+  auto* data = reinterpret_cast<char*>(const_cast<void*>(chunk->data_));
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    bool present = chunk->present_[i] != k_row_missing;
+    uint64_t begin = chunk->offsets_[i];
+    c->on_global_id_fetched_(
+        c->on_complete_context_,
+        chunk->row_begin_ + i,
+        chunk->optimizer_state_,
+        present ? data + begin : nullptr,
+        present ? chunk->offsets_[i + 1] - begin : 0);
+  }
+}
+
+static void OnAllFetchedV1(void* ctx) {
+  auto* c = reinterpret_cast<RedisV1PullV1Context*>(ctx);
+  c->on_all_fetched_(c->on_complete_context_);
+  delete c;
+}
+
 void RedisV1::Pull(IOPullParameter param) {
-  auto* fetch_param = new RedisV1PullContext(opt_.chunk_size_, param);
+  auto* ctx = new RedisV1PullV1Context{
+      .on_complete_context_ = param.on_complete_context_,
+      .on_global_id_fetched_ = param.on_global_id_fetched_,
+      .on_all_fetched_ = param.on_all_fetched_,
+  };
+  Pull(IOPullParameterV2{
+      .table_name_ = param.table_name_,
+      .num_cols_ = param.num_cols_,
+      .num_global_ids_ = param.num_global_ids_,
+      .col_ids_ = param.col_ids_,
+      .global_ids_ = param.global_ids_,
+      .num_optimizer_stats_ = param.num_optimizer_stats_,
+      .on_complete_context_ = ctx,
+      .on_chunk_fetched_ = OnChunkFetchedV1,
+      .on_all_fetched_ = OnAllFetchedV1,
+      .dsts_ = nullptr,
+  });
+}
+
+void RedisV1::Pull(IOPullParameterV2 param) {
+  if (async_ != nullptr) {
+    async_->Pull(param);
+    return;
+  }
+  uint32_t chunk_size = pull_chunk_.Get();
+  auto* fetch_param = new RedisV1PullContext(chunk_size, param);
+  bool packed = opt_.layout_ == Option::k_layout_packed;
+  if (packed) {
+    // One key per (gid, col).
+    fetch_param->chunk_size_ =
+        CalculateChunkSizeByGlobalIDs(chunk_size, param.num_cols_, 1);
+  }
+  uint32_t num_ids_per_chunk = fetch_param->chunk_size_;
+  uint32_t num_chunks =
+      (param.num_global_ids_ + num_ids_per_chunk - 1) / num_ids_per_chunk;
+  // The hedges are scheduled once the latencies of the chunks are known.
+  uint64_t hedge_delay_us = 0;
+  if (!hedge_queues_.empty()) {
+    fetch_param->start_ = std::chrono::steady_clock::now();
+    fetch_param->latency_ = &pull_latency_;
+    uint64_t percentile_us = pull_latency_.Quantile();
+    if (percentile_us != 0) {
+      hedge_delay_us = std::max<uint64_t>(
+          percentile_us, opt_.hedge_delay_ms_ * uint64_t(1000));
+      fetch_param->delivered_ =
+          std::make_unique<std::atomic<bool>[]>(num_chunks);
+      // Both attempts of a chunk could write the destinations.
+      fetch_param->dsts_ = nullptr;
+    }
+  }
+  // The context is deleted after the last job or hedge, which can be done
+  // before the loop ends.
+  fetch_param->num_refs_ = hedge_delay_us != 0 ? num_chunks * 2 : num_chunks;
+  auto kind = packed ? JobKind::kFetchPacked : JobKind::kFetch;
+  uint32_t thread = next_thread_.fetch_add(1, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < param.num_global_ids_; i += num_ids_per_chunk) {
+    bool full = param.num_global_ids_ - i >= num_ids_per_chunk;
+    Enqueue(
+        job_queues_,
+        thread++,
+        Job{
+            .kind_ = kind,
+            .chunk_size_ = full ? chunk_size : 0,
+            .gid_offset_ = i,
+            .ctx_ = fetch_param});
+  }
+  WakeSleeping(job_queues_);
+  if (hedge_delay_us == 0) {
+    return;
+  }
+  auto deadline = fetch_param->start_ +
+      std::chrono::microseconds(static_cast<int64_t>(hedge_delay_us));
   {
-    std::lock_guard<std::mutex> guard(this->jobs_mutex_);
-    for (uint32_t i = 0; i < param.num_global_ids_;
-         i += fetch_param->chunk_size_) {
-      jobs_.emplace_back([i, fetch_param, this](redis::ContextPtr& connection) {
-        DoFetch(i, fetch_param, connection);
+    std::lock_guard<std::mutex> lock(hedge_mu_);
+    for (uint32_t i = 0; i < param.num_global_ids_; i += num_ids_per_chunk) {
+      hedges_.push(Hedge{
+          .deadline_ = deadline,
+          .kind_ = kind,
+          .gid_offset_ = i,
+          .ctx_ = fetch_param,
       });
     }
   }
-  jobs_not_empty_.notify_all();
+  hedge_cv_.notify_one();
+}
+
+void RedisV1::RunHedges() {
+  std::unique_lock<std::mutex> lock(hedge_mu_);
+  while (true) {
+    if (hedges_.empty()) {
+      if (hedge_stopping_) {
+        break;
+      }
+      hedge_cv_.wait(lock);
+      continue;
+    }
+    Hedge hedge = hedges_.top();
+    if (!hedge_stopping_ &&
+        std::chrono::steady_clock::now() < hedge.deadline_) {
+      hedge_cv_.wait_until(lock, hedge.deadline_);
+      continue;
+    }
+    hedges_.pop();
+    bool stopping = hedge_stopping_;
+    lock.unlock();
+    IssueHedge(hedge, stopping);
+    lock.lock();
+  }
+}
+
+void RedisV1::IssueHedge(const Hedge& hedge, bool stopping) {
+  auto* fetch_param = reinterpret_cast<RedisV1PullContext*>(hedge.ctx_);
+  if (stopping || fetch_param->Delivered(hedge.gid_offset_)) {
+    fetch_param->Release();
+    return;
+  }
+  num_hedges_.fetch_add(1, std::memory_order_relaxed);
+  // The job takes over the reference of the hedge.
+  Enqueue(
+      hedge_queues_,
+      next_hedge_thread_.fetch_add(1, std::memory_order_relaxed),
+      Job{
+          .kind_ = hedge.kind_,
+          .gid_offset_ = hedge.gid_offset_,
+          .ctx_ = fetch_param,
+          .hedge_ = true,
+      });
+  WakeSleeping(hedge_queues_);
 }
 
-void RedisV1::DoFetch(
+bool RedisV1::DoFetch(
     uint32_t gid_offset,
     void* fetch_param_void,
-    redis::ContextPtr& connection) const {
+    redis::ContextPtr& connection,
+    ReplyArena& arena,
+    ChunkValues& values) const {
   auto& fetch_param = *reinterpret_cast<RedisV1PullContext*>(fetch_param_void);
 
   uint32_t end = std::min(
       gid_offset + fetch_param.chunk_size_,
       static_cast<uint32_t>(fetch_param.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(fetch_param.col_ids_.size());
 
   auto loop = [&](auto&& callback) {
     for (uint32_t i = gid_offset; i < end; ++i) {
       int64_t gid = fetch_param.global_ids_[i];
-      for (uint32_t j = 0; j < fetch_param.col_ids_.size(); ++j) {
+      for (uint32_t j = 0; j < num_cols; ++j) {
         auto& col_id = fetch_param.col_ids_[j];
         for (uint32_t os_id = 0; os_id < fetch_param.num_optimizer_stats_;
              ++os_id) {
-          callback(i * fetch_param.col_ids_.size() + j, gid, col_id, os_id);
+          callback(i * num_cols + j, gid, col_id, os_id);
         }
       }
     }
   };
 
-  loop([&](uint32_t offset, int64_t gid, uint32_t col_id, uint32_t os_id) {
+  loop([&](uint32_t offset, int64_t gid, int64_t col_id, uint32_t os_id) {
     redisAppendCommand(
         connection.get(),
-        "GET %s_table_%s_gid_%d_cid_%d_osid_%d",
+        k_get_per_state,
         opt_.prefix_.c_str(),
         fetch_param.table_name_.c_str(),
-        gid,
-        col_id,
+        static_cast<long long>(gid),
+        static_cast<long long>(col_id),
         os_id);
   });
 
-  void* reply;
-  loop([&](uint32_t offset, int64_t gid, uint32_t col_id, uint32_t os_id) {
-    int status = redisGetReply(connection.get(), &reply);
-    TORCH_CHECK(
-        status != REDIS_ERR,
-        "get reply error: %s, from redis %s, %d",
-        connection->errstr,
-        opt_.host_,
-        opt_.port_);
-    auto reply_ptr = redis::ReplyPtr(reinterpret_cast<redisReply*>(reply));
-
-    if (reply_ptr->type == REDIS_REPLY_NIL) {
-      fetch_param.on_global_id_fetched_(
-          fetch_param.on_complete_context_, offset, os_id, nullptr, 0);
-    } else {
-      fetch_param.on_global_id_fetched_(
-          fetch_param.on_complete_context_,
-          offset,
-          os_id,
-          reply_ptr->str,
-          reply_ptr->len);
+  // The replies are all read before they are delivered, so that they are
+  // dropped if another attempt of the chunk delivered it first.
+  arena.Reset();
+  values.Reset(gid_offset * num_cols, fetch_param.num_optimizer_stats_);
+  loop([&](uint32_t offset, int64_t gid, int64_t col_id, uint32_t os_id) {
+    GetTarget target{
+        .values_ = &values,
+        .os_ = os_id,
+        .dst_ = fetch_param.Destination(offset, os_id),
+    };
+    redisReply* reply =
+        arena.GetReply(connection.get(), GetTarget::OnValue, &target);
+    // An error reply of a value is not a value.
+    if (reply->type != REDIS_REPLY_STRING && reply->type != REDIS_REPLY_NIL) {
+      values.AddMissing(os_id);
     }
   });
-
-  uint32_t n = end - gid_offset;
-  uint32_t target = fetch_param.global_ids_.size();
-
-  if (fetch_param.num_complete_ids_.fetch_add(n) + n ==
-      target) { // last fetch complete
-    fetch_param.on_all_fetched_(fetch_param.on_complete_context_);
-    delete &fetch_param;
+  bool claimed = fetch_param.Claim(gid_offset);
+  if (claimed) {
+    fetch_param.Deliver(values, 0, (end - gid_offset) * num_cols);
+    fetch_param.Complete(end - gid_offset);
   }
+  fetch_param.Release();
+  return claimed;
 }
 
 struct RedisV1PushContext {
@@ -493,17 +1150,53 @@ struct RedisV1PushContext {
 };
 
 void RedisV1::Push(IOPushParameter param) {
-  auto* ctx = new RedisV1PushContext(opt_.chunk_size_, param);
-  {
-    std::lock_guard<std::mutex> guard(this->jobs_mutex_);
-    for (uint32_t i = 0; i < param.num_global_ids_; i += ctx->chunk_size_) {
-      jobs_.emplace_back([i, ctx, this](redis::ContextPtr& connection) {
-        DoPush(i, ctx, connection);
-      });
+  if (async_ != nullptr) {
+    async_->Push(param);
+    return;
+  }
+  bool packed = opt_.layout_ == Option::k_layout_packed;
+  if (packed) {
+    // A packed value is written as a whole.
+    for (uint32_t i = 0; i < param.num_optimizer_stats_; ++i) {
+      TORCH_CHECK(
+          param.optimizer_stats_ids_[i] == i,
+          "the packed layout only supports pushing all the optimizer states");
     }
   }
-  jobs_not_empty_.notify_all();
+  uint32_t chunk_size = push_chunk_.Get();
+  auto* ctx = new RedisV1PushContext(chunk_size, param);
+  if (packed) {
+    ctx->chunk_size_ =
+        CalculateChunkSizeByGlobalIDs(chunk_size, param.num_cols_, 1);
+  }
+  uint32_t num_ids_per_chunk = ctx->chunk_size_;
+  auto kind = packed ? JobKind::kPushPacked : JobKind::kPush;
+  uint32_t thread = next_thread_.fetch_add(1, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < param.num_global_ids_; i += num_ids_per_chunk) {
+    bool full = param.num_global_ids_ - i >= num_ids_per_chunk;
+    Enqueue(
+        job_queues_,
+        thread++,
+        Job{
+            .kind_ = kind,
+            .chunk_size_ = full ? chunk_size : 0,
+            .gid_offset_ = i,
+            .ctx_ = ctx});
+  }
+  WakeSleeping(job_queues_);
 }
+
+void RedisV1::Stats(c10::Dict<std::string, double>& out) const {
+  pull_chunk_.Export("pull_chunk", out);
+  push_chunk_.Export("push_chunk", out);
+  if (hedge_queues_.empty()) {
+    return;
+  }
+  out.insert_or_assign("hedge.num_issued", num_hedges_.load());
+  out.insert_or_assign("hedge.num_won", num_hedge_wins_.load());
+  out.insert_or_assign("hedge.percentile_us", pull_latency_.Quantile());
+}
+
 void RedisV1::DoPush(
     uint32_t gid_offset,
     void* push_ctx_ptr,
@@ -537,11 +1230,11 @@ void RedisV1::DoPush(
 
     redisAppendCommand(
         connection.get(),
-        "SET %s_table_%s_gid_%d_cid_%d_osid_%d %b",
+        k_set_per_state,
         opt_.prefix_.c_str(),
         push_ctx.table_name_.c_str(),
-        gid,
-        cid,
+        static_cast<long long>(gid),
+        static_cast<long long>(cid),
         os_id,
         reinterpret_cast<const uint8_t*>(push_ctx.data_) + beg,
         static_cast<size_t>(end - beg));
@@ -567,6 +1260,390 @@ void RedisV1::DoPush(
     delete &push_ctx;
   }
 }
+std::string PerStateKey(
+    std::string_view prefix,
+    std::string_view table_name,
+    int64_t gid,
+    int64_t col,
+    uint32_t os) {
+  std::string key(prefix);
+  key.append("_table_");
+  key.append(table_name);
+  key.append("_gid_");
+  key.append(std::to_string(gid));
+  key.append("_cid_");
+  key.append(std::to_string(col));
+  key.append("_osid_");
+  key.append(std::to_string(os));
+  return key;
+}
+
+std::string PackedKey(
+    std::string_view prefix,
+    uint64_t table_hash,
+    int64_t gid,
+    int64_t col) {
+  std::string key(prefix);
+  key.append(reinterpret_cast<const char*>(&table_hash), sizeof(table_hash));
+  key.append(reinterpret_cast<const char*>(&gid), sizeof(gid));
+  if (col != -1) {
+    key.append(reinterpret_cast<const char*>(&col), sizeof(col));
+  }
+  return key;
+}
+
+void EncodePackedValue(
+    std::string& out,
+    uint32_t num_states,
+    const uint8_t* data,
+    const uint64_t* offsets) {
+  out.append(reinterpret_cast<const char*>(&num_states), sizeof(num_states));
+  for (uint32_t i = 0; i < num_states; ++i) {
+    auto len = static_cast<uint32_t>(offsets[i + 1] - offsets[i]);
+    out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+  }
+  out.append(
+      reinterpret_cast<const char*>(data + offsets[0]),
+      offsets[num_states] - offsets[0]);
+}
+
+std::optional<uint32_t> TryDecodePackedValue(
+    std::string_view value,
+    uint32_t max_states,
+    const char** states,
+    uint32_t* lens) {
+  uint32_t num_states;
+  if (value.size() < sizeof(num_states)) {
+    return std::nullopt;
+  }
+  memcpy(&num_states, value.data(), sizeof(num_states));
+  uint64_t pos = sizeof(num_states) + uint64_t{num_states} * sizeof(uint32_t);
+  if (value.size() < pos) {
+    return std::nullopt;
+  }
+  for (uint32_t i = 0; i < num_states; ++i) {
+    uint32_t len;
+    memcpy(&len, value.data() + (i + 1) * sizeof(uint32_t), sizeof(len));
+    if (pos + len > value.size()) {
+      return std::nullopt;
+    }
+    if (i < max_states) {
+      states[i] = value.data() + pos;
+      lens[i] = len;
+    }
+    pos += len;
+  }
+  if (pos != value.size()) {
+    return std::nullopt;
+  }
+  return std::min(num_states, max_states);
+}
+
+uint32_t DecodePackedValue(
+    std::string_view value,
+    uint32_t max_states,
+    const char** states,
+    uint32_t* lens) {
+  auto num_states = TryDecodePackedValue(value, max_states, states, lens);
+  TORCH_CHECK(num_states.has_value(), "corrupted packed value");
+  return *num_states;
+}
+
+void ChunkValues::Reset(uint32_t row_begin, uint32_t num_optimizer_states) {
+  row_begin_ = row_begin;
+  num_optimizer_states_ = num_optimizer_states;
+  if (states_.size() < num_optimizer_states) {
+    states_.resize(num_optimizer_states);
+  }
+  for (uint32_t os = 0; os < num_optimizer_states; ++os) {
+    auto& state = states_[os];
+    state.data_.clear();
+    state.offsets_.assign(1, 0);
+    state.present_.clear();
+  }
+  packed_states_.resize(num_optimizer_states);
+  packed_lens_.resize(num_optimizer_states);
+}
+
+void ChunkValues::Add(
+    uint32_t os,
+    const char* data,
+    size_t len,
+    const IOPullDestination* dst) {
+  auto& state = states_[os];
+  if (dst != nullptr && dst->capacity_ == len) {
+    memcpy(dst->data_, data, len);
+    state.present_.emplace_back(k_row_in_destination);
+  } else {
+    state.data_.insert(state.data_.end(), data, data + len);
+    state.present_.emplace_back(k_row_present);
+  }
+  state.offsets_.emplace_back(state.data_.size());
+}
+
+void ChunkValues::AddMissing(uint32_t os) {
+  auto& state = states_[os];
+  state.present_.emplace_back(k_row_missing);
+  state.offsets_.emplace_back(state.data_.size());
+}
+
+bool ChunkValues::AddPacked(
+    std::string_view value,
+    const IOPullDestination* dsts) {
+  auto num_states = TryDecodePackedValue(
+      value,
+      num_optimizer_states_,
+      packed_states_.data(),
+      packed_lens_.data());
+  for (uint32_t os = 0; os < num_optimizer_states_; ++os) {
+    if (os < num_states.value_or(0)) {
+      Add(os,
+          packed_states_[os],
+          packed_lens_[os],
+          dsts == nullptr ? nullptr : &dsts[os]);
+    } else {
+      AddMissing(os);
+    }
+  }
+  return num_states.has_value();
+}
+
+IOPullChunk ChunkValues::Chunk(uint32_t os, uint32_t begin, uint32_t end)
+    const {
+  auto& state = states_[os];
+  return IOPullChunk{
+      .row_begin_ = row_begin_ + begin,
+      .num_rows_ = end - begin,
+      .optimizer_state_ = os,
+      .data_ = state.data_.data(),
+      .offsets_ = state.offsets_.data() + begin,
+      .present_ = state.present_.data() + begin,
+  };
+}
+
+redis::ReplyPtr RedisV1::GetReply(redis::ContextPtr& connection) const {
+  void* reply;
+  int status = redisGetReply(connection.get(), &reply);
+  TORCH_CHECK(
+      status != REDIS_ERR,
+      "get reply error: ",
+      connection->errstr,
+      ", from redis://",
+      opt_.host_,
+      ":",
+      opt_.port_);
+  return redis::ReplyPtr(reinterpret_cast<redisReply*>(reply));
+}
+
+bool RedisV1::DoFetchPacked(
+    uint32_t gid_offset,
+    void* fetch_param_void,
+    redis::ContextPtr& connection,
+    ReplyArena& arena,
+    ChunkValues& values) const {
+  auto& fetch_param = *reinterpret_cast<RedisV1PullContext*>(fetch_param_void);
+  uint32_t end = std::min(
+      gid_offset + fetch_param.chunk_size_,
+      static_cast<uint32_t>(fetch_param.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(fetch_param.col_ids_.size());
+  uint32_t num_os = fetch_param.num_optimizer_stats_;
+  uint64_t table_hash = HashRing::Hash(fetch_param.table_name_);
+
+  // The k-th key is of row `gid_offset * num_cols + k`.
+  std::vector<std::string> keys;
+  std::vector<const char*> argv{"MGET"};
+  std::vector<size_t> argv_len{4};
+  for (uint32_t i = gid_offset; i < end; ++i) {
+    for (auto col_id : fetch_param.col_ids_) {
+      keys.emplace_back(PackedKey(
+          opt_.prefix_, table_hash, fetch_param.global_ids_[i], col_id));
+    }
+  }
+  for (auto& key : keys) {
+    argv.emplace_back(key.data());
+    argv_len.emplace_back(key.size());
+  }
+  redisAppendCommandArgv(
+      connection.get(), argv.size(), argv.data(), argv_len.data());
+  // The values are decoded into the chunk values, unless the missing ones
+  // are migrated, then they are added in the order of the rows after the
+  // migration.
+  arena.Reset();
+  uint32_t row_begin = gid_offset * num_cols;
+  values.Reset(row_begin, num_os);
+  MGetTarget target{
+      .values_ = &values,
+      .fetch_param_ = &fetch_param,
+      .row_ = row_begin,
+  };
+  redisReply* reply = opt_.migrate_
+      ? arena.GetReply(connection.get())
+      : arena.GetReply(connection.get(), MGetTarget::OnValue, &target);
+  TORCH_CHECK(
+      reply->type == REDIS_REPLY_ARRAY && reply->elements == keys.size(),
+      "MGET should return an array of ",
+      keys.size(),
+      " values, from redis://",
+      opt_.host_,
+      ":",
+      opt_.port_);
+  std::vector<uint32_t> missing;
+  for (uint32_t k = 0; k < keys.size(); ++k) {
+    auto type = reply->element[k]->type;
+    TORCH_CHECK(
+        type == REDIS_REPLY_STRING || type == REDIS_REPLY_NIL,
+        "MGET should return strings, but actual type is ",
+        type);
+    if (opt_.migrate_ && type == REDIS_REPLY_NIL) {
+      missing.emplace_back(k);
+    }
+  }
+  if (!fetch_param.Claim(gid_offset)) {
+    fetch_param.Release();
+    return false;
+  }
+
+  if (!opt_.migrate_) {
+    fetch_param.Deliver(values, 0, keys.size());
+    fetch_param.Complete(end - gid_offset);
+    fetch_param.Release();
+    return true;
+  }
+
+  // Read the missing rows from the per state layout, and write the rows
+  // found, with all their optimizer states, in the packed layout.
+  for (auto k : missing) {
+    int64_t gid = fetch_param.global_ids_[gid_offset + k / num_cols];
+    int64_t col_id = fetch_param.col_ids_[k % num_cols];
+    for (uint32_t os = 0; os < num_os; ++os) {
+      redisAppendCommand(
+          connection.get(),
+          k_get_per_state,
+          opt_.prefix_.c_str(),
+          fetch_param.table_name_.c_str(),
+          static_cast<long long>(gid),
+          static_cast<long long>(col_id),
+          os);
+    }
+  }
+  std::vector<redisReply*> os_replies;
+  for (size_t i = 0; i < missing.size() * num_os; ++i) {
+    os_replies.emplace_back(arena.GetReply(connection.get()));
+  }
+  std::vector<std::string> migrated_keys;
+  std::vector<std::string> migrated_values;
+  auto os_reply = os_replies.begin();
+  for (uint32_t k = 0; k < keys.size(); ++k) {
+    uint32_t row = row_begin + k;
+    auto* value = reply->element[k];
+    if (value->type == REDIS_REPLY_STRING) {
+      values.AddPacked(
+          std::string_view(value->str, value->len),
+          fetch_param.Destinations(row));
+      continue;
+    }
+    bool complete = true;
+    std::string data;
+    std::vector<uint64_t> offsets{0};
+    for (uint32_t os = 0; os < num_os; ++os, ++os_reply) {
+      bool found = (*os_reply)->type == REDIS_REPLY_STRING;
+      complete &= found;
+      if (found) {
+        values.Add(
+            os,
+            (*os_reply)->str,
+            (*os_reply)->len,
+            fetch_param.Destination(row, os));
+        data.append((*os_reply)->str, (*os_reply)->len);
+      } else {
+        values.AddMissing(os);
+      }
+      offsets.emplace_back(data.size());
+    }
+    if (!complete) {
+      continue;
+    }
+    migrated_keys.emplace_back(std::move(keys[k]));
+    migrated_values.emplace_back();
+    EncodePackedValue(
+        migrated_values.back(),
+        num_os,
+        reinterpret_cast<const uint8_t*>(data.data()),
+        offsets.data());
+  }
+  fetch_param.Deliver(values, 0, keys.size());
+
+  if (!migrated_keys.empty()) {
+    argv.assign({"MSET"});
+    argv_len.assign({4});
+    for (size_t i = 0; i < migrated_keys.size(); ++i) {
+      argv.emplace_back(migrated_keys[i].data());
+      argv_len.emplace_back(migrated_keys[i].size());
+      argv.emplace_back(migrated_values[i].data());
+      argv_len.emplace_back(migrated_values[i].size());
+    }
+    redisAppendCommandArgv(
+        connection.get(), argv.size(), argv.data(), argv_len.data());
+    auto mset_reply = GetReply(connection);
+    CheckStatus("migrate error", connection, mset_reply);
+  }
+
+  fetch_param.Complete(end - gid_offset);
+  fetch_param.Release();
+  return true;
+}
+
+void RedisV1::DoPushPacked(
+    uint32_t gid_offset,
+    void* push_ctx_ptr,
+    redis::ContextPtr& connection) const {
+  auto& push_ctx = *reinterpret_cast<RedisV1PushContext*>(push_ctx_ptr);
+  uint32_t end = std::min(
+      gid_offset + push_ctx.chunk_size_,
+      static_cast<uint32_t>(push_ctx.global_ids_.size()));
+  auto num_cols = static_cast<uint32_t>(push_ctx.col_ids_.size());
+  auto num_os = static_cast<uint32_t>(push_ctx.os_ids_.size());
+  uint64_t table_hash = HashRing::Hash(push_ctx.table_name_);
+  auto* data = reinterpret_cast<const uint8_t*>(push_ctx.data_);
+
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  for (uint32_t i = gid_offset; i < end; ++i) {
+    for (uint32_t j = 0; j < num_cols; ++j) {
+      keys.emplace_back(PackedKey(
+          opt_.prefix_,
+          table_hash,
+          push_ctx.global_ids_[i],
+          push_ctx.col_ids_[j]));
+      values.emplace_back();
+      EncodePackedValue(
+          values.back(),
+          num_os,
+          data,
+          push_ctx.offsets_.data() + (i * num_cols + j) * num_os);
+    }
+  }
+  std::vector<const char*> argv{"MSET"};
+  std::vector<size_t> argv_len{4};
+  for (size_t i = 0; i < keys.size(); ++i) {
+    argv.emplace_back(keys[i].data());
+    argv_len.emplace_back(keys[i].size());
+    argv.emplace_back(values[i].data());
+    argv_len.emplace_back(values[i].size());
+  }
+  redisAppendCommandArgv(
+      connection.get(), argv.size(), argv.data(), argv_len.data());
+  auto reply = GetReply(connection);
+  CheckStatus("MSET error", connection, reply);
+
+  uint32_t n = end - gid_offset;
+  uint32_t target = push_ctx.global_ids_.size();
+  if (push_ctx.num_complete_ids_.fetch_add(n) + n == target) {
+    push_ctx.on_push_complete_(push_ctx.on_complete_context_);
+    delete &push_ctx;
+  }
+}
+
 void RedisV1::CheckStatus(
     std::string_view label,
     redis::ContextPtr& connection,
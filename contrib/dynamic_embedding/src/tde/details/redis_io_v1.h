@@ -1,15 +1,32 @@
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <vector>
 #include "hiredis.h"
+#include "tde/details/adaptive_chunk.h"
 #include "tde/details/io_registry.h"
-#include "tde/details/move_only_function.h"
+#include "tde/details/latency_window.h"
+#include "tde/details/mpmc_queue.h"
 
 namespace tde::details::redis_v1 {
 
+class RedisAsync;
+class ReplyArena;
+
+struct Endpoint {
+  std::string host_;
+  uint16_t port_{6379};
+};
+
 struct Option {
  public:
   std::string host_;
@@ -23,6 +40,36 @@ struct Option {
   uint32_t heart_beat_interval_ms_{100000};
   uint32_t retry_limit_{3};
   uint32_t chunk_size_{100};
+  // The layout of the values, see `RedisV1`.
+  uint32_t layout_{k_layout_per_state};
+  // With the packed layout, read the ids missing there from the per state
+  // layout, and write them in the packed layout.
+  bool migrate_{false};
+  // Run the chunks on event loops of async connections, see `RedisAsync`.
+  bool async_{false};
+  // In the async mode, the number of connections of each io thread, and the
+  // number of commands in flight on each connection.
+  uint32_t num_connections_{4};
+  uint32_t max_outstanding_{8};
+  // Adapt the chunk size toward this latency of a chunk, within
+  // [min_chunk_size, max_chunk_size], see `AdaptiveChunkSize`. 0 for the
+  // fixed chunk_size. The max defaults to 16 times chunk_size.
+  uint32_t chunk_latency_ms_{0};
+  uint32_t min_chunk_size_{1};
+  uint32_t max_chunk_size_{0};
+  // The replicas of the endpoint, which serve the hedged pulls.
+  std::vector<Endpoint> replicas_;
+  // With replicas, a pull chunk outstanding past this percentile of the
+  // latencies of the recent pull chunks, and past hedge_delay, is re-issued
+  // to a replica.
+  uint32_t hedge_percentile_{95};
+  uint32_t hedge_delay_ms_{1};
+
+  // One key per (gid, col, optimizer state), formatted as text.
+  static constexpr uint32_t k_layout_per_state = 1;
+  // One value per (gid, col) of all the optimizer states, under a binary
+  // key.
+  static constexpr uint32_t k_layout_packed = 2;
 
   Option() = default;
 
@@ -30,10 +77,134 @@ struct Option {
     return Option(config_str);
   }
 
+  /**
+   * Parse the endpoints of
+   * `[user[:password]@]host[:port][,host[:port]...][/?opt=val&&opt=val]`,
+   * which share the auth and the options. The replicas of an endpoint
+   * follow its host, e.g., `host:port+replica:port+replica:port`.
+   */
+  static std::vector<Option> ParseEndpoints(std::string_view config_str);
+
  private:
   Option(std::string_view config_str);
 };
 
+/**
+ * The number of global ids of a chunk of chunk_size values.
+ */
+uint32_t CalculateChunkSizeByGlobalIDs(
+    uint32_t chunk_size,
+    uint32_t num_cols,
+    uint32_t num_os);
+
+/**
+ * The text key of (gid, col, optimizer state) in the per state layout.
+ */
+std::string PerStateKey(
+    std::string_view prefix,
+    std::string_view table_name,
+    int64_t gid,
+    int64_t col,
+    uint32_t os);
+
+/**
+ * The binary key of (gid, col) in the packed layout: the prefix, then
+ * table_hash, gid and, if col is not -1, col, each in 8 bytes.
+ */
+std::string PackedKey(
+    std::string_view prefix,
+    uint64_t table_hash,
+    int64_t gid,
+    int64_t col);
+
+/**
+ * Append the packed value of num_states optimizer states to out. The packed
+ * value is the number of states and the size of each state, in uint32_t,
+ * followed by the states. The i-th state is
+ * `data[offsets[i], offsets[i + 1])`.
+ */
+void EncodePackedValue(
+    std::string& out,
+    uint32_t num_states,
+    const uint8_t* data,
+    const uint64_t* offsets);
+
+/**
+ * Split a packed value into at most max_states optimizer states.
+ * @return the number of states written to states and lens.
+ */
+uint32_t DecodePackedValue(
+    std::string_view value,
+    uint32_t max_states,
+    const char** states,
+    uint32_t* lens);
+
+/**
+ * `DecodePackedValue`, but a corrupted value is nullopt instead of an error.
+ */
+std::optional<uint32_t> TryDecodePackedValue(
+    std::string_view value,
+    uint32_t max_states,
+    const char** states,
+    uint32_t* lens);
+
+/**
+ * The values of the consecutive rows of a pull chunk, in a buffer per
+ * optimizer state, so that they are delivered as one `IOPullChunk` per
+ * optimizer state instead of one per value. The buffers are kept by
+ * `Reset`, so once they fit the values of a chunk, adding them does not
+ * allocate.
+ */
+class ChunkValues {
+ public:
+  /**
+   * Forget the values, the rows added next start from row_begin.
+   */
+  void Reset(uint32_t row_begin, uint32_t num_optimizer_states);
+
+  /**
+   * Add the value of optimizer state os of its next row. If dst is not
+   * null and the value fills it, the value is copied into dst instead, and
+   * the row is `k_row_in_destination`.
+   */
+  void Add(
+      uint32_t os,
+      const char* data,
+      size_t len,
+      const IOPullDestination* dst);
+
+  void AddMissing(uint32_t os);
+
+  /**
+   * Add the optimizer states of the next row from a packed value, see
+   * `Add`. dsts are the destinations of the states of the row, or null.
+   * The states not in the value are missing.
+   * @return false if the value is corrupted, then all the states are
+   * missing.
+   */
+  bool AddPacked(std::string_view value, const IOPullDestination* dsts);
+
+  /**
+   * The rows [begin, end) of optimizer state os, counted from row_begin.
+   * Valid until the values change.
+   */
+  [[nodiscard]] IOPullChunk Chunk(uint32_t os, uint32_t begin, uint32_t end)
+      const;
+
+ private:
+  struct State {
+    std::vector<char> data_;
+    std::vector<uint64_t> offsets_;
+    std::vector<uint8_t> present_;
+  };
+
+  uint32_t row_begin_{0};
+  uint32_t num_optimizer_states_{0};
+  std::vector<State> states_;
+  std::vector<const char*> packed_states_;
+  std::vector<uint32_t> packed_lens_;
+};
+
 namespace redis {
 struct ContextDeleter {
   void operator()(void* ctx) {
@@ -58,6 +229,49 @@ using ReplyPtr = std::unique_ptr<redisReply, ReplyDeleter>;
 
 } // namespace redis
 
+/**
+ * An IO storing values in redis, with a pool of connections, each of which
+ * pipelines the commands of a chunk of global ids.
+ *
+ * With `layout=1`, each value of (gid, col, optimizer state) is stored
+ * under a text key `<prefix>_table_<table>_gid_<gid>_cid_<col>_osid_<os>`,
+ * one GET or SET each.
+ *
+ * With `layout=2`, all the optimizer states of (gid, col) are packed into
+ * one value, see `PackedValue`, stored under a binary key of the prefix,
+ * the hash of the table name, the gid and the col if it is not -1, and a
+ * chunk is read or written by one MGET or MSET. A row of n optimizer states
+ * costs one key instead of n. Pushes must write all the optimizer states.
+ * `migrate=1` reads the ids missing in layout 2 from layout 1, and writes
+ * them in layout 2, so the tables of layout 1 are migrated as they are
+ * pulled.
+ *
+ * Each io thread has its own lock-free queue of chunks. The chunks of a
+ * request are spread round robin over the queues, and an idle thread steals
+ * the chunks queued to the others before sleeping, so a busy connection does
+ * not hold back the chunks. A chunk is a small value in the queue, not a
+ * heap allocated function, and only a sleeping thread is woken.
+ *
+ * With `async=1`, the chunks are not run one at a time by blocking
+ * connections, but pipelined by the event loops of `RedisAsync`.
+ *
+ * With `chunk_latency`, the chunk size of the pulls and of the pushes are
+ * adapted on their own by the latency of their full chunks, see
+ * `AdaptiveChunkSize`. A request is split by the chunk size when it starts.
+ *
+ * Each io thread decodes the replies of its pulls into a `ReplyArena`
+ * reused by its chunks, and the values straight into the `ChunkValues` of
+ * the thread, or into the destinations of a v2 pull, if their sizes match.
+ * A chunk is delivered as one `IOPullChunk` per optimizer state.
+ *
+ * With replicas, the pulls are hedged: a chunk not fetched yet past the
+ * `hedge_percentile` of the latencies of the recent chunks, from the start
+ * of their pulls, is fetched again by the io threads of the replicas, and
+ * the values first fetched are delivered. So a slow connection or server
+ * does not stall the pull. The pushes are only written to the primary, and
+ * the values are not decoded into the destinations, which both attempts of
+ * a chunk could write.
+ */
 class RedisV1 {
  public:
   explicit RedisV1(Option opt);
@@ -66,33 +280,165 @@ class RedisV1 {
 
   void Pull(IOPullParameter param);
 
+  void Pull(IOPullParameterV2 param);
+
   void Push(IOPushParameter param);
 
+  /**
+   * Add `pull_chunk.<stat>` and `push_chunk.<stat>` to out, see
+   * `AdaptiveChunkSize::Export`. With replicas, also add `hedge.num_issued`
+   * and `hedge.num_won`, the chunks re-issued to the replicas and the ones
+   * fetched by them first, and `hedge.percentile_us`, the percentile of the
+   * latencies of the recent chunks, 0 until it is known.
+   */
+  void Stats(c10::Dict<std::string, double>& out) const;
+
  private:
-  void StartThread();
-  void HeartBeat(redis::ContextPtr& connection);
-  [[nodiscard]] redis::ContextPtr Connect() const;
+  enum class JobKind : uint8_t {
+    kFetch = 0,
+    kPush = 1,
+    kFetchPacked = 2,
+    kPushPacked = 3,
+  };
+
+  /**
+   * A chunk of a request, from gid_offset.
+   */
+  struct Job {
+    JobKind kind_{JobKind::kFetch};
+    // The chunk size of the request, adapted by the latency of the job. 0
+    // for the last chunk of a request, if it is partial.
+    uint32_t chunk_size_{0};
+    uint32_t gid_offset_{0};
+    void* ctx_{nullptr};
+    // Re-issued to a replica.
+    bool hedge_{false};
+  };
 
-  void DoFetch(
+  struct JobQueue {
+    explicit JobQueue(size_t capacity) : jobs_(capacity) {}
+
+    MPMCQueue<Job> jobs_;
+    // Set by the thread before it waits for jobs_, so that it is only
+    // notified, under mu_, if it is sleeping.
+    std::atomic<bool> sleeping_{false};
+    std::mutex mu_;
+    std::condition_variable not_empty_;
+  };
+
+  using JobQueues = std::vector<std::unique_ptr<JobQueue>>;
+
+  /**
+   * A chunk of a pull to re-issue to a replica at deadline_, if it is not
+   * fetched yet.
+   */
+  struct Hedge {
+    std::chrono::steady_clock::time_point deadline_;
+    JobKind kind_;
+    uint32_t gid_offset_;
+    void* ctx_;
+
+    bool operator>(const Hedge& other) const {
+      return deadline_ > other.deadline_;
+    }
+  };
+
+  void StartThread(JobQueues& queues, uint32_t index, Endpoint endpoint);
+
+  /**
+   * Push the job to the queue of the thread, or the next ones if it is
+   * full. The threads are woken by `WakeSleeping` after the jobs of a
+   * request are pushed.
+   */
+  void Enqueue(JobQueues& queues, uint32_t thread, Job job);
+
+  /**
+   * Wake the threads sleeping, which look for jobs in all the queues.
+   */
+  void WakeSleeping(JobQueues& queues);
+
+  /**
+   * Pop a job of the thread, or steal one from the other threads.
+   */
+  bool PopJob(JobQueues& queues, uint32_t thread, Job& job);
+
+  void RunJob(
+      const Job& job,
+      redis::ContextPtr& connection,
+      ReplyArena& arena,
+      ChunkValues& values);
+  void HeartBeat(redis::ContextPtr& connection, const Endpoint& endpoint);
+  [[nodiscard]] redis::ContextPtr Connect(const Endpoint& endpoint) const;
+
+  /**
+   * Re-issue the hedges to the replicas at their deadlines.
+   */
+  void RunHedges();
+
+  /**
+   * Re-issue a hedge, unless its chunk is fetched or the io is stopping.
+   */
+  void IssueHedge(const Hedge& hedge, bool stopping);
+
+  /**
+   * @return false if the values were delivered by another attempt of the
+   * chunk, see hedging.
+   */
+  bool DoFetch(
       uint32_t gid_offset,
       void* fetch_param,
-      redis::ContextPtr& connection) const;
+      redis::ContextPtr& connection,
+      ReplyArena& arena,
+      ChunkValues& values) const;
 
   void DoPush(
       uint32_t gid_offset,
       void* push_ctx,
       redis::ContextPtr& connection) const;
 
+  bool DoFetchPacked(
+      uint32_t gid_offset,
+      void* fetch_param,
+      redis::ContextPtr& connection,
+      ReplyArena& arena,
+      ChunkValues& values) const;
+
+  void DoPushPacked(
+      uint32_t gid_offset,
+      void* push_ctx,
+      redis::ContextPtr& connection) const;
+
+  /**
+   * Wait for the reply of a pipelined command.
+   */
+  redis::ReplyPtr GetReply(redis::ContextPtr& connection) const;
+
   void CheckStatus(
       std::string_view label,
       redis::ContextPtr& connection,
       redis::ReplyPtr& reply) const;
 
   Option opt_;
+  AdaptiveChunkSize pull_chunk_;
+  AdaptiveChunkSize push_chunk_;
   std::vector<std::thread> io_threads_;
-  std::deque<MoveOnlyFunction<void(redis::ContextPtr&)>> jobs_;
-  std::condition_variable jobs_not_empty_;
-  std::mutex jobs_mutex_;
+  JobQueues job_queues_;
+  std::atomic<uint32_t> next_thread_{0};
+  std::atomic<bool> stopping_{false};
+  std::unique_ptr<RedisAsync> async_;
+
+  // The io threads of the replicas, and the latencies of the pull chunks by
+  // which the hedges are scheduled.
+  JobQueues hedge_queues_;
+  std::atomic<uint32_t> next_hedge_thread_{0};
+  LatencyWindow pull_latency_;
+  std::thread hedge_thread_;
+  std::mutex hedge_mu_;
+  std::condition_variable hedge_cv_;
+  std::priority_queue<Hedge, std::vector<Hedge>, std::greater<>> hedges_;
+  bool hedge_stopping_{false};
+  std::atomic<uint64_t> num_hedges_{0};
+  std::atomic<uint64_t> num_hedge_wins_{0};
 };
 
 } // namespace tde::details::redis_v1
@@ -0,0 +1,174 @@
+#include <numeric>
+#include <thread>
+#include "benchmark/benchmark.h"
+#include "tde/details/histogram.h"
+#include "tde/details/notification.h"
+#include "tde/details/redis_io_v1.h"
+
+namespace tde::details::redis_v1 {
+
+// Needs a redis-server on 127.0.0.1:6379. Small chunks make the dispatch of
+// the chunks to the io threads a large part of the latency of a pull.
+void BM_RedisV1Pull(benchmark::State& state) {
+  auto num_ids = static_cast<uint32_t>(state.range(0));
+  auto chunk_size = state.range(1);
+  auto num_threads = state.range(2);
+  RedisV1 redis(Option::Parse(
+      "127.0.0.1:6379/?prefix=bench&&chunk_size=" + std::to_string(chunk_size) +
+      "&&num_threads=" + std::to_string(num_threads)));
+  std::vector<int64_t> global_ids(num_ids);
+  std::iota(global_ids.begin(), global_ids.end(), 0);
+
+  for (auto _ : state) {
+    Notification notification;
+    redis.Pull(IOPullParameter{
+        .table_name_ = "table",
+        .num_global_ids_ = num_ids,
+        .global_ids_ = global_ids.data(),
+        .num_optimizer_stats_ = 1,
+        .on_complete_context_ = &notification,
+        .on_global_id_fetched_ =
+            +[](void*, uint32_t, uint32_t, void* data, uint32_t) {
+              benchmark::DoNotOptimize(data);
+            },
+        .on_all_fetched_ =
+            +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+    });
+    notification.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_ids);
+}
+
+BENCHMARK(BM_RedisV1Pull)
+    ->ArgNames({"num_ids", "chunk_size", "num_threads"})
+    ->Args({4096, 1, 4})
+    ->Args({4096, 8, 4})
+    ->Args({4096, 64, 4})
+    ->Args({4096, 8, 16})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Pulls rows of dim floats, decoded into their destinations.
+void BM_RedisV1PullToDestinations(benchmark::State& state) {
+  auto num_ids = static_cast<uint32_t>(state.range(0));
+  auto dim = static_cast<uint32_t>(state.range(1));
+  RedisV1 redis(Option::Parse("127.0.0.1:6379/?prefix=bench_dst"));
+  std::vector<int64_t> global_ids(num_ids);
+  std::iota(global_ids.begin(), global_ids.end(), 0);
+  std::vector<float> rows(num_ids * dim, 1);
+  std::vector<uint64_t> offsets(num_ids + 1);
+  for (uint32_t i = 0; i <= num_ids; ++i) {
+    offsets[i] = i * dim * sizeof(float);
+  }
+  uint32_t os_id = 0;
+  Notification pushed;
+  redis.Push(IOPushParameter{
+      .table_name_ = "table",
+      .num_global_ids_ = num_ids,
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = 1,
+      .optimizer_stats_ids_ = &os_id,
+      .num_offsets_ = num_ids + 1,
+      .offsets_ = offsets.data(),
+      .data_ = rows.data(),
+      .on_complete_context_ = &pushed,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+  });
+  pushed.Wait();
+
+  std::vector<IOPullDestination> dsts(num_ids);
+  for (uint32_t i = 0; i < num_ids; ++i) {
+    dsts[i] = IOPullDestination{
+        .data_ = &rows[i * dim],
+        .capacity_ = dim * sizeof(float),
+    };
+  }
+  for (auto _ : state) {
+    Notification notification;
+    redis.Pull(IOPullParameterV2{
+        .table_name_ = "table",
+        .num_global_ids_ = num_ids,
+        .global_ids_ = global_ids.data(),
+        .num_optimizer_stats_ = 1,
+        .on_complete_context_ = &notification,
+        .on_chunk_fetched_ =
+            +[](void*, const IOPullChunk* chunk) {
+              benchmark::DoNotOptimize(chunk->present_[0]);
+            },
+        .on_all_fetched_ =
+            +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+        .dsts_ = dsts.data(),
+    });
+    notification.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_ids);
+  state.SetBytesProcessed(state.iterations() * rows.size() * sizeof(float));
+}
+
+BENCHMARK(BM_RedisV1PullToDestinations)
+    ->ArgNames({"num_ids", "dim"})
+    ->Args({4096, 16})
+    ->Args({4096, 128})
+    ->Args({1024, 1024})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Needs a replica of 127.0.0.1:6379 on 127.0.0.1:6380, e.g.,
+// `redis-server --port 6380 --replicaof 127.0.0.1 6379`. The primary is
+// stalled by `DEBUG SLEEP` for 20ms every 100ms, and the pulls are hedged
+// to the replica if hedge is 1.
+void BM_RedisV1HedgedPull(benchmark::State& state) {
+  auto num_ids = static_cast<uint32_t>(state.range(0));
+  bool hedge = state.range(1) != 0;
+  RedisV1 redis(Option::Parse(
+      std::string("127.0.0.1:6379") + (hedge ? "+127.0.0.1:6380" : "") +
+      "/?prefix=bench&&num_threads=4&&hedge_percentile=95"));
+  std::vector<int64_t> global_ids(num_ids);
+  std::iota(global_ids.begin(), global_ids.end(), 0);
+
+  std::atomic<bool> stopping{false};
+  std::thread stall([&stopping] {
+    auto* connection = redisConnect("127.0.0.1", 6379);
+    while (!stopping.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      freeReplyObject(redisCommand(connection, "DEBUG SLEEP 0.02"));
+    }
+    redisFree(connection);
+  });
+
+  Histogram latency_us;
+  for (auto _ : state) {
+    ScopedLatency latency(latency_us);
+    Notification notification;
+    redis.Pull(IOPullParameter{
+        .table_name_ = "table",
+        .num_global_ids_ = num_ids,
+        .global_ids_ = global_ids.data(),
+        .num_optimizer_stats_ = 1,
+        .on_complete_context_ = &notification,
+        .on_global_id_fetched_ =
+            +[](void*, uint32_t, uint32_t, void* data, uint32_t) {
+              benchmark::DoNotOptimize(data);
+            },
+        .on_all_fetched_ =
+            +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+    });
+    notification.Wait();
+  }
+  stopping = true;
+  stall.join();
+  state.counters["p50_us"] = latency_us.Quantile(0.5);
+  state.counters["p99_us"] = latency_us.Quantile(0.99);
+  state.SetItemsProcessed(state.iterations() * num_ids);
+}
+
+BENCHMARK(BM_RedisV1HedgedPull)
+    ->ArgNames({"num_ids", "hedge"})
+    ->Args({1024, 0})
+    ->Args({1024, 1})
+    ->Unit(benchmark::kMillisecond)
+    ->MinTime(5)
+    ->UseRealTime();
+
+} // namespace tde::details::redis_v1
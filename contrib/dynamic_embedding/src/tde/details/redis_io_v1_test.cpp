@@ -1,3 +1,5 @@
+#include <atomic>
+#include <numeric>
 #include "gtest/gtest.h"
 #include "tcb/span.hpp"
 #include "tde/details/notification.h"
@@ -23,6 +25,186 @@ TEST(TDE, redis_v1_Option_ParseError) {
   ASSERT_ANY_THROW(Option::Parse("192.168.3.1:3948/?timeout=3d"));
 }
 
+TEST(TDE, redis_v1_Option_layout) {
+  auto opt = Option::Parse("127.0.0.1/?layout=2&&migrate=1");
+  ASSERT_EQ(opt.layout_, Option::k_layout_packed);
+  ASSERT_TRUE(opt.migrate_);
+  ASSERT_EQ(Option::Parse("127.0.0.1").layout_, Option::k_layout_per_state);
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?layout=3"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?migrate=1"));
+}
+
+TEST(TDE, redis_v1_Option_async) {
+  auto opt = Option::Parse(
+      "127.0.0.1/?async=1&&num_threads=2&&connections=3&&max_outstanding=16");
+  ASSERT_TRUE(opt.async_);
+  ASSERT_EQ(opt.num_io_threads_, 2);
+  ASSERT_EQ(opt.num_connections_, 3);
+  ASSERT_EQ(opt.max_outstanding_, 16);
+  ASSERT_FALSE(Option::Parse("127.0.0.1").async_);
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?async=1&&max_outstanding=0"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?async=1&&connections=0"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?async=1&&layout=2&&migrate=1"));
+}
+
+TEST(TDE, redis_v1_Option_chunk_latency) {
+  auto opt = Option::Parse(
+      "127.0.0.1/?chunk_size=64&&chunk_latency=5ms&&min_chunk_size=8&&"
+      "max_chunk_size=512");
+  ASSERT_EQ(opt.chunk_latency_ms_, 5);
+  ASSERT_EQ(opt.min_chunk_size_, 8);
+  ASSERT_EQ(opt.max_chunk_size_, 512);
+  ASSERT_EQ(Option::Parse("127.0.0.1").chunk_latency_ms_, 0);
+  // chunk_size is not in the bounds.
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?chunk_size=8&&min_chunk_size=9"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?chunk_size=8&&max_chunk_size=7"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1/?async=1&&chunk_latency=5ms"));
+}
+
+TEST(TDE, redis_v1_Option_replicas) {
+  auto opts = Option::ParseEndpoints(
+      "user:pass@10.0.0.1:3948+10.0.0.11+10.0.0.12:3949,10.0.0.2/"
+      "?hedge_percentile=99&&hedge_delay=2ms");
+  ASSERT_EQ(opts.size(), 2);
+  ASSERT_EQ(opts[0].host_, "10.0.0.1");
+  ASSERT_EQ(opts[0].port_, 3948);
+  ASSERT_EQ(opts[0].username_, "user");
+  ASSERT_EQ(opts[0].replicas_.size(), 2);
+  ASSERT_EQ(opts[0].replicas_[0].host_, "10.0.0.11");
+  ASSERT_EQ(opts[0].replicas_[0].port_, 6379);
+  ASSERT_EQ(opts[0].replicas_[1].host_, "10.0.0.12");
+  ASSERT_EQ(opts[0].replicas_[1].port_, 3949);
+  ASSERT_EQ(opts[0].hedge_percentile_, 99);
+  ASSERT_EQ(opts[0].hedge_delay_ms_, 2);
+  ASSERT_EQ(opts[1].host_, "10.0.0.2");
+  ASSERT_TRUE(opts[1].replicas_.empty());
+
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1+"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1+127.0.0.2/?hedge_percentile=100"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1+127.0.0.2/?async=1"));
+  ASSERT_ANY_THROW(Option::Parse("127.0.0.1+127.0.0.2/?layout=2&&migrate=1"));
+}
+
+TEST(TDE, redis_v1_packed_value) {
+  constexpr static float data[] = {0, 1, 2, 3, 4};
+  constexpr static uint64_t offsets[] = {
+      1 * sizeof(float), 3 * sizeof(float), 5 * sizeof(float)};
+  std::string value;
+  EncodePackedValue(
+      value, 2, reinterpret_cast<const uint8_t*>(data), offsets);
+  ASSERT_EQ(value.size(), 3 * sizeof(uint32_t) + 4 * sizeof(float));
+
+  const char* states[2];
+  uint32_t lens[2];
+  ASSERT_EQ(DecodePackedValue(value, 2, states, lens), 2);
+  for (uint32_t i = 0; i < 2; ++i) {
+    ASSERT_EQ(lens[i], 2 * sizeof(float));
+    ASSERT_EQ(reinterpret_cast<const float*>(states[i])[0], 1 + i * 2);
+    ASSERT_EQ(reinterpret_cast<const float*>(states[i])[1], 2 + i * 2);
+  }
+  // Only the states asked for are returned.
+  ASSERT_EQ(DecodePackedValue(value, 1, states, lens), 1);
+  ASSERT_ANY_THROW(DecodePackedValue(
+      std::string_view(value.data(), value.size() - 1), 2, states, lens));
+  ASSERT_FALSE(TryDecodePackedValue(
+                   std::string_view(value.data(), value.size() - 1),
+                   2,
+                   states,
+                   lens)
+                   .has_value());
+
+  // Global ids are not truncated, and the keys of cols are different.
+  int64_t large_gid = (int64_t{1} << 32) + 1;
+  ASSERT_NE(PackedKey("p", 3, 1, -1), PackedKey("p", 3, large_gid, -1));
+  ASSERT_NE(PackedKey("p", 3, 1, -1), PackedKey("p", 3, 1, 0));
+  ASSERT_EQ(PackedKey("p", 3, 1, -1).size(), 1 + 2 * sizeof(int64_t));
+}
+
+static std::vector<float> ChunkRow(const IOPullChunk& chunk, uint32_t i) {
+  auto* data = reinterpret_cast<const char*>(chunk.data_);
+  auto* begin = reinterpret_cast<const float*>(data + chunk.offsets_[i]);
+  auto* end = reinterpret_cast<const float*>(data + chunk.offsets_[i + 1]);
+  return std::vector<float>(begin, end);
+}
+
+TEST(TDE, redis_v1_ChunkValues) {
+  constexpr static float data[] = {0, 1, 2, 3, 4, 5};
+  auto* bytes = reinterpret_cast<const char*>(data);
+  float row[2] = {};
+  IOPullDestination dsts[] = {
+      {.data_ = nullptr, .capacity_ = 0},
+      {.data_ = row, .capacity_ = sizeof(row)},
+  };
+
+  ChunkValues values;
+  values.Reset(10, 2);
+  values.Add(0, bytes, 2 * sizeof(float), nullptr);
+  values.Add(1, bytes + 2 * sizeof(float), 2 * sizeof(float), nullptr);
+  values.AddMissing(0);
+  // The value fills its destination.
+  values.Add(1, bytes + 4 * sizeof(float), 2 * sizeof(float), &dsts[1]);
+  std::string packed;
+  constexpr static uint64_t offsets[] = {0, 4 * sizeof(float)};
+  EncodePackedValue(
+      packed, 1, reinterpret_cast<const uint8_t*>(data), offsets);
+  // The states not in the value are missing.
+  ASSERT_TRUE(values.AddPacked(packed, nullptr));
+
+  auto chunk = values.Chunk(0, 0, 3);
+  ASSERT_EQ(chunk.row_begin_, 10);
+  ASSERT_EQ(chunk.num_rows_, 3);
+  ASSERT_EQ(chunk.optimizer_state_, 0);
+  ASSERT_EQ(chunk.present_[0], k_row_present);
+  ASSERT_EQ(ChunkRow(chunk, 0), std::vector<float>({0, 1}));
+  ASSERT_EQ(chunk.present_[1], k_row_missing);
+  ASSERT_EQ(ChunkRow(chunk, 1), std::vector<float>());
+  ASSERT_EQ(chunk.present_[2], k_row_present);
+  ASSERT_EQ(ChunkRow(chunk, 2), std::vector<float>({0, 1, 2, 3}));
+
+  chunk = values.Chunk(1, 1, 3);
+  ASSERT_EQ(chunk.row_begin_, 11);
+  ASSERT_EQ(chunk.num_rows_, 2);
+  ASSERT_EQ(chunk.present_[0], k_row_in_destination);
+  ASSERT_EQ(ChunkRow(chunk, 0), std::vector<float>());
+  ASSERT_EQ(row[0], 4);
+  ASSERT_EQ(row[1], 5);
+  ASSERT_EQ(chunk.present_[1], k_row_missing);
+
+  // A corrupted value is missing, and the buffers are reused.
+  values.Reset(0, 2);
+  ASSERT_FALSE(values.AddPacked(
+      std::string_view(packed.data(), packed.size() - 1), nullptr));
+  for (uint32_t os = 0; os < 2; ++os) {
+    chunk = values.Chunk(os, 0, 1);
+    ASSERT_EQ(chunk.row_begin_, 0);
+    ASSERT_EQ(chunk.present_[0], k_row_missing);
+    ASSERT_EQ(chunk.offsets_[0], chunk.offsets_[1]);
+  }
+}
+
+TEST(TDE, redis_v1_Option_ParseEndpoints) {
+  auto opts = Option::ParseEndpoints(
+      "user:pass@192.168.3.1:3948,192.168.3.2,redis_b:3949/?db=3&&prefix=m");
+  ASSERT_EQ(opts.size(), 3);
+  ASSERT_EQ(opts[0].host_, "192.168.3.1");
+  ASSERT_EQ(opts[0].port_, 3948);
+  ASSERT_EQ(opts[1].host_, "192.168.3.2");
+  ASSERT_EQ(opts[1].port_, 6379);
+  ASSERT_EQ(opts[2].host_, "redis_b");
+  ASSERT_EQ(opts[2].port_, 3949);
+  for (auto& opt : opts) {
+    ASSERT_EQ(opt.username_, "user");
+    ASSERT_EQ(opt.password_, "pass");
+    ASSERT_EQ(opt.db_, 3);
+    ASSERT_EQ(opt.prefix_, "m");
+  }
+
+  opts = Option::ParseEndpoints("192.168.3.1:3948");
+  ASSERT_EQ(opts.size(), 1);
+  ASSERT_EQ(opts[0].port_, 3948);
+  ASSERT_ANY_THROW(Option::ParseEndpoints("192.168.3.1,,192.168.3.2"));
+}
+
 struct PullContext {
   Notification* notification_;
   std::function<void(uint32_t, uint32_t, void*, uint32_t)> on_data_;
@@ -106,4 +288,274 @@ TEST(TDE, redis_v1_push_pull) {
   redis.Pull(pull);
   notification.Wait();
 }
+
+/**
+ * Pull global_ids of 2 optimizer states from redis.
+ * @return the values, empty if missing.
+ */
+static std::vector<std::vector<float>> PullRows(
+    RedisV1& redis,
+    const std::vector<int64_t>& global_ids) {
+  std::vector<std::vector<float>> rows(global_ids.size() * 2);
+  Notification notification;
+  PullContext ctx{
+      .notification_ = &notification,
+      .on_data_ =
+          [&](uint32_t offset, uint32_t os_id, void* data, uint32_t len) {
+            auto* ptr = reinterpret_cast<const float*>(data);
+            rows[offset * 2 + os_id].assign(ptr, ptr + len / sizeof(float));
+          }};
+  redis.Pull(IOPullParameter{
+      .table_name_ = "table",
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = 2,
+      .on_complete_context_ = &ctx,
+      .on_global_id_fetched_ =
+          +[](void* ctx,
+              uint32_t offset,
+              uint32_t os_id,
+              void* data,
+              uint32_t len) {
+            reinterpret_cast<PullContext*>(ctx)->on_data_(
+                offset, os_id, data, len);
+          },
+      .on_all_fetched_ =
+          +[](void* ctx) {
+            reinterpret_cast<PullContext*>(ctx)->notification_->Done();
+          }});
+  notification.Wait();
+  return rows;
+}
+
+TEST(TDE, redis_v1_packed_migrate) {
+  // Global ids beyond int32 are not truncated in either layout.
+  int64_t large_gid = (int64_t{1} << 32) + 1;
+  std::vector<int64_t> global_ids{large_gid, 1};
+  constexpr static uint32_t os_ids[] = {0, 1};
+  constexpr static float params[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  constexpr static uint64_t offsets[] = {
+      0 * sizeof(float),
+      2 * sizeof(float),
+      4 * sizeof(float),
+      6 * sizeof(float),
+      8 * sizeof(float)};
+  {
+    RedisV1 redis(Option::Parse("127.0.0.1:6379/?prefix=packed_migrate"));
+    Notification notification;
+    redis.Push(IOPushParameter{
+        .table_name_ = "table",
+        .num_global_ids_ = 1,
+        .global_ids_ = global_ids.data(),
+        .num_optimizer_stats_ = 2,
+        .optimizer_stats_ids_ = os_ids,
+        .num_offsets_ = 3,
+        .offsets_ = offsets,
+        .data_ = params,
+        .on_complete_context_ = &notification,
+        .on_push_complete =
+            +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+    });
+    notification.Wait();
+  }
+
+  RedisV1 redis(Option::Parse(
+      "127.0.0.1:6379/?prefix=packed_migrate&&layout=2&&migrate=1"));
+  Notification notification;
+  redis.Push(IOPushParameter{
+      .table_name_ = "table",
+      .num_global_ids_ = 1,
+      .global_ids_ = global_ids.data() + 1,
+      .num_optimizer_stats_ = 2,
+      .optimizer_stats_ids_ = os_ids,
+      .num_offsets_ = 3,
+      .offsets_ = offsets + 2,
+      .data_ = params,
+      .on_complete_context_ = &notification,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+  });
+  notification.Wait();
+
+  // The first id is read from layout 1, and written in layout 2.
+  auto rows = PullRows(redis, global_ids);
+  ASSERT_EQ(rows[0], std::vector<float>({1, 2}));
+  ASSERT_EQ(rows[1], std::vector<float>({3, 4}));
+  ASSERT_EQ(rows[2], std::vector<float>({5, 6}));
+  ASSERT_EQ(rows[3], std::vector<float>({7, 8}));
+
+  RedisV1 packed(
+      Option::Parse("127.0.0.1:6379/?prefix=packed_migrate&&layout=2"));
+  ASSERT_EQ(PullRows(packed, global_ids), rows);
+}
+
+TEST(TDE, redis_v1_async_push_pull) {
+  std::vector<int64_t> global_ids(100);
+  std::iota(global_ids.begin(), global_ids.end(), 0);
+  constexpr static uint32_t os_ids[] = {0, 1};
+  // 2 optimizer states of 2 floats per id.
+  std::vector<float> params(global_ids.size() * 4);
+  std::iota(params.begin(), params.end(), 0);
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i <= global_ids.size() * 2; ++i) {
+    offsets.emplace_back(i * 2 * sizeof(float));
+  }
+
+  for (std::string layout : {"1", "2"}) {
+    // Small chunks over a few connections, so that many chunks are in
+    // flight, and wait for the free connections.
+    RedisV1 redis(Option::Parse(
+        "127.0.0.1:6379/?prefix=async&&async=1&&num_threads=2&&"
+        "connections=2&&max_outstanding=2&&chunk_size=2&&layout=" +
+        layout));
+    Notification notification;
+    redis.Push(IOPushParameter{
+        .table_name_ = "table",
+        .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+        .global_ids_ = global_ids.data(),
+        .num_optimizer_stats_ = 2,
+        .optimizer_stats_ids_ = os_ids,
+        .num_offsets_ = static_cast<uint32_t>(offsets.size()),
+        .offsets_ = offsets.data(),
+        .data_ = params.data(),
+        .on_complete_context_ = &notification,
+        .on_push_complete =
+            +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+    });
+    notification.Wait();
+
+    auto rows = PullRows(redis, global_ids);
+    for (size_t i = 0; i < rows.size(); ++i) {
+      ASSERT_EQ(rows[i], std::vector<float>({2.0f * i, 2.0f * i + 1}));
+    }
+  }
+}
+
+TEST(TDE, redis_v1_hedged_push_pull) {
+  std::vector<int64_t> global_ids(100);
+  std::iota(global_ids.begin(), global_ids.end(), 0);
+  constexpr static uint32_t os_ids[] = {0, 1};
+  std::vector<float> params(global_ids.size() * 4);
+  std::iota(params.begin(), params.end(), 0);
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i <= global_ids.size() * 2; ++i) {
+    offsets.emplace_back(i * 2 * sizeof(float));
+  }
+
+  // The server is its own replica, and most chunks are hedged once the
+  // latencies are known, so both attempts of a chunk race.
+  RedisV1 redis(Option::Parse(
+      "127.0.0.1:6379+127.0.0.1:6379/?prefix=hedge&&chunk_size=2&&"
+      "hedge_percentile=1"));
+  Notification notification;
+  redis.Push(IOPushParameter{
+      .table_name_ = "table",
+      .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+      .global_ids_ = global_ids.data(),
+      .num_optimizer_stats_ = 2,
+      .optimizer_stats_ids_ = os_ids,
+      .num_offsets_ = static_cast<uint32_t>(offsets.size()),
+      .offsets_ = offsets.data(),
+      .data_ = params.data(),
+      .on_complete_context_ = &notification,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->Done(); },
+  });
+  notification.Wait();
+
+  for (int i = 0; i < 10; ++i) {
+    auto rows = PullRows(redis, global_ids);
+    for (size_t j = 0; j < rows.size(); ++j) {
+      ASSERT_EQ(rows[j], std::vector<float>({2.0f * j, 2.0f * j + 1}));
+    }
+  }
+  c10::Dict<std::string, double> stats;
+  redis.Stats(stats);
+  ASSERT_GT(stats.at("hedge.percentile_us"), 0);
+  ASSERT_GT(stats.at("hedge.num_issued"), 0);
+  ASSERT_LE(stats.at("hedge.num_won"), stats.at("hedge.num_issued"));
+}
+
+struct ChunkPullContext {
+  Notification notification_;
+  std::atomic<uint32_t> num_chunks_{0};
+  // 2 optimizer states of 2 floats per id, empty if missing.
+  std::vector<std::vector<float>> rows_;
+};
+
+TEST(TDE, redis_v1_pull_chunks) {
+  std::vector<int64_t> global_ids(100);
+  std::iota(global_ids.begin(), global_ids.end(), 0);
+  constexpr static uint32_t os_ids[] = {0, 1};
+  std::vector<float> params(global_ids.size() * 4);
+  std::iota(params.begin(), params.end(), 0);
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i <= global_ids.size() * 2; ++i) {
+    offsets.emplace_back(i * 2 * sizeof(float));
+  }
+
+  for (std::string mode : {"", "&&async=1"}) {
+    for (std::string layout : {"1", "2"}) {
+      RedisV1 redis(Option::Parse(
+          "127.0.0.1:6379/?prefix=chunks&&chunk_size=64&&layout=" + layout +
+          mode));
+      Notification notification;
+      redis.Push(IOPushParameter{
+          .table_name_ = "table",
+          .num_global_ids_ = static_cast<uint32_t>(global_ids.size()),
+          .global_ids_ = global_ids.data(),
+          .num_optimizer_stats_ = 2,
+          .optimizer_stats_ids_ = os_ids,
+          .num_offsets_ = static_cast<uint32_t>(offsets.size()),
+          .offsets_ = offsets.data(),
+          .data_ = params.data(),
+          .on_complete_context_ = &notification,
+          .on_push_complete =
+              +[](void* ctx) {
+                reinterpret_cast<Notification*>(ctx)->Done();
+              },
+      });
+      notification.Wait();
+
+      // The id beyond the pushed ones is missing.
+      std::vector<int64_t> pull_ids = global_ids;
+      pull_ids.emplace_back(1000);
+      ChunkPullContext ctx;
+      ctx.rows_.resize(pull_ids.size() * 2);
+      redis.Pull(IOPullParameterV2{
+          .table_name_ = "table",
+          .num_global_ids_ = static_cast<uint32_t>(pull_ids.size()),
+          .global_ids_ = pull_ids.data(),
+          .num_optimizer_stats_ = 2,
+          .on_complete_context_ = &ctx,
+          .on_chunk_fetched_ =
+              +[](void* ctx, const IOPullChunk* chunk) {
+                auto& c = *reinterpret_cast<ChunkPullContext*>(ctx);
+                c.num_chunks_.fetch_add(1);
+                for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+                  if (chunk->present_[i] == k_row_missing) {
+                    continue;
+                  }
+                  c.rows_[(chunk->row_begin_ + i) * 2 +
+                          chunk->optimizer_state_] = ChunkRow(*chunk, i);
+                }
+              },
+          .on_all_fetched_ =
+              +[](void* ctx) {
+                reinterpret_cast<ChunkPullContext*>(ctx)
+                    ->notification_.Done();
+              },
+      });
+      ctx.notification_.Wait();
+
+      // A chunk of rows per optimizer state, not a callback per value.
+      ASSERT_LT(ctx.num_chunks_.load(), pull_ids.size());
+      for (size_t i = 0; i < global_ids.size() * 2; ++i) {
+        ASSERT_EQ(ctx.rows_[i], std::vector<float>({2.0f * i, 2.0f * i + 1}));
+      }
+      ASSERT_TRUE(ctx.rows_[global_ids.size() * 2].empty());
+      ASSERT_TRUE(ctx.rows_[global_ids.size() * 2 + 1].empty());
+    }
+  }
+}
 } // namespace tde::details::redis_v1
@@ -0,0 +1,172 @@
+#include "tde/details/redis_reply_arena.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include "torch/torch.h"
+
+namespace tde::details::redis_v1 {
+
+redisReplyObjectFunctions ReplyArena::k_functions{
+    .createString = CreateString,
+    .createArray = CreateArray,
+    .createInteger = CreateInteger,
+    .createDouble = CreateDouble,
+    .createNil = CreateNil,
+    .createBool = CreateBool,
+    .freeObject = FreeObject,
+};
+
+redisReply* ReplyArena::GetReply(
+    redisContext* connection,
+    const IOPullDestination* dst) {
+  dst_ = dst;
+  return Read(connection);
+}
+
+redisReply* ReplyArena::GetReply(
+    redisContext* connection,
+    ValueSink sink,
+    void* sink_ctx) {
+  sink_ = sink;
+  sink_ctx_ = sink_ctx;
+  return Read(connection);
+}
+
+redisReply* ReplyArena::Read(redisContext* connection) {
+  redisReader* reader = connection->reader;
+  redisReplyObjectFunctions* fn = reader->fn;
+  void* privdata = reader->privdata;
+  reader->fn = &k_functions;
+  reader->privdata = this;
+  void* reply = nullptr;
+  int status = redisGetReply(connection, &reply);
+  if (status != REDIS_OK) {
+    // A partial reply is in the arena, and must not be freed by the reader.
+    reader->reply = nullptr;
+  }
+  reader->fn = fn;
+  reader->privdata = privdata;
+  dst_ = nullptr;
+  sink_ = nullptr;
+  sink_ctx_ = nullptr;
+  TORCH_CHECK(status == REDIS_OK, "get reply error: ", connection->errstr);
+  return static_cast<redisReply*>(reply);
+}
+
+size_t ReplyArena::capacity() const {
+  size_t capacity = 0;
+  for (auto& block : blocks_) {
+    capacity += block.size_;
+  }
+  return capacity;
+}
+
+void* ReplyArena::Allocate(size_t size, size_t align) {
+  while (block_ < blocks_.size()) {
+    auto& block = blocks_[block_];
+    size_t begin = (pos_ + align - 1) / align * align;
+    if (begin + size <= block.size_) {
+      pos_ = begin + size;
+      return block.data_.get() + begin;
+    }
+    ++block_;
+    pos_ = 0;
+  }
+  // The blocks are aligned for any reply by new.
+  size_t block_size = std::max(size, k_block_size);
+  blocks_.emplace_back(Block{
+      .data_ = std::make_unique<char[]>(block_size),
+      .size_ = block_size,
+  });
+  block_ = blocks_.size() - 1;
+  pos_ = size;
+  return blocks_.back().data_.get();
+}
+
+redisReply* ReplyArena::CreateReply(const redisReadTask* task) {
+  auto* arena = reinterpret_cast<ReplyArena*>(task->privdata);
+  auto* reply = new (arena->Allocate(sizeof(redisReply), alignof(redisReply)))
+      redisReply{};
+  reply->type = task->type;
+  if (task->parent != nullptr) {
+    auto* parent = reinterpret_cast<redisReply*>(task->parent->obj);
+    parent->element[task->idx] = reply;
+  }
+  return reply;
+}
+
+void* ReplyArena::CreateString(
+    const redisReadTask* task,
+    char* str,
+    size_t len) {
+  auto* arena = reinterpret_cast<ReplyArena*>(task->privdata);
+  redisReply* reply = CreateReply(task);
+  reply->len = len;
+  if (arena->sink_ != nullptr && task->type == REDIS_REPLY_STRING) {
+    arena->sink_(arena->sink_ctx_, str, len);
+    return reply;
+  }
+  const IOPullDestination* dst = arena->dst_;
+  if (task->parent == nullptr && task->type == REDIS_REPLY_STRING &&
+      dst != nullptr && dst->capacity_ == len) {
+    reply->str = reinterpret_cast<char*>(dst->data_);
+  } else {
+    reply->str = reinterpret_cast<char*>(arena->Allocate(len + 1, 1));
+    reply->str[len] = '\0';
+  }
+  memcpy(reply->str, str, len);
+  return reply;
+}
+
+void* ReplyArena::CreateArray(const redisReadTask* task, size_t elements) {
+  auto* arena = reinterpret_cast<ReplyArena*>(task->privdata);
+  redisReply* reply = CreateReply(task);
+  reply->elements = elements;
+  if (elements != 0) {
+    reply->element = reinterpret_cast<redisReply**>(
+        arena->Allocate(elements * sizeof(redisReply*), alignof(redisReply*)));
+    std::fill_n(reply->element, elements, nullptr);
+  }
+  return reply;
+}
+
+void* ReplyArena::CreateInteger(const redisReadTask* task, long long value) {
+  redisReply* reply = CreateReply(task);
+  reply->integer = value;
+  return reply;
+}
+
+void* ReplyArena::CreateDouble(
+    const redisReadTask* task,
+    double value,
+    char* str,
+    size_t len) {
+  auto* arena = reinterpret_cast<ReplyArena*>(task->privdata);
+  redisReply* reply = CreateReply(task);
+  reply->dval = value;
+  reply->str = reinterpret_cast<char*>(arena->Allocate(len + 1, 1));
+  memcpy(reply->str, str, len);
+  reply->str[len] = '\0';
+  reply->len = len;
+  return reply;
+}
+
+void* ReplyArena::CreateNil(const redisReadTask* task) {
+  auto* arena = reinterpret_cast<ReplyArena*>(task->privdata);
+  if (arena->sink_ != nullptr) {
+    arena->sink_(arena->sink_ctx_, nullptr, 0);
+  }
+  return CreateReply(task);
+}
+
+void* ReplyArena::CreateBool(const redisReadTask* task, int value) {
+  redisReply* reply = CreateReply(task);
+  reply->integer = value != 0;
+  return reply;
+}
+
+void ReplyArena::FreeObject(void*) {
+  // The replies are reused by Reset.
+}
+
+} // namespace tde::details::redis_v1
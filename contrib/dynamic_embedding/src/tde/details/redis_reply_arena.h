@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "hiredis.h"
+#include "tde/details/io_registry.h"
+
+namespace tde::details::redis_v1 {
+
+/**
+ * Decodes the replies of a connection into reusable blocks, instead of a
+ * heap allocated `redisReply` and string per value.
+ *
+ * `GetReply` reads a reply with the arena as the reply object functions of
+ * the reader of the connection, so the reply, its elements and its strings
+ * are built in the arena, and are valid until `Reset`. The blocks are kept
+ * by `Reset`, so once they fit the replies of a chunk, reading the chunk
+ * does not allocate. Only the replies read by `GetReply` are in the arena,
+ * the other replies of the connection are freed by `freeReplyObject` as
+ * usual.
+ */
+class ReplyArena {
+ public:
+  static constexpr size_t k_block_size = 64 * 1024;
+
+  ReplyArena() = default;
+
+  ReplyArena(const ReplyArena&) = delete;
+  ReplyArena& operator=(const ReplyArena&) = delete;
+
+  /**
+   * Read the next reply of connection into the arena. It must not be freed
+   * by `freeReplyObject`.
+   *
+   * If the reply is a string of the size of the capacity of dst, it is
+   * decoded into dst instead, and its `str` is `dst->data_`.
+   */
+  redisReply* GetReply(
+      redisContext* connection,
+      const IOPullDestination* dst = nullptr);
+
+  /**
+   * Receives the strings and the nils of a reply, in their order in the
+   * reply. str is null for a nil, and is only valid during the call.
+   */
+  using ValueSink = void (*)(void* ctx, const char* str, size_t len);
+
+  /**
+   * Read the next reply of connection into the arena, but pass its strings
+   * and nils to sink instead, e.g., the values of a GET or of an MGET. Their
+   * replies are in the arena without str. The other replies, e.g., an
+   * error, are in the arena as usual.
+   */
+  redisReply* GetReply(
+      redisContext* connection,
+      ValueSink sink,
+      void* sink_ctx);
+
+  /**
+   * Forget the replies, and reuse their memory.
+   */
+  void Reset() {
+    block_ = 0;
+    pos_ = 0;
+  }
+
+  /**
+   * The bytes of the blocks.
+   */
+  [[nodiscard]] size_t capacity() const;
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data_;
+    size_t size_;
+  };
+
+  void* Allocate(size_t size, size_t align);
+
+  static redisReply* CreateReply(const redisReadTask* task);
+  static void* CreateString(const redisReadTask* task, char* str, size_t len);
+  static void* CreateArray(const redisReadTask* task, size_t elements);
+  static void* CreateInteger(const redisReadTask* task, long long value);
+  static void* CreateDouble(
+      const redisReadTask* task,
+      double value,
+      char* str,
+      size_t len);
+  static void* CreateNil(const redisReadTask* task);
+  static void* CreateBool(const redisReadTask* task, int value);
+  static void FreeObject(void* reply);
+
+  /**
+   * Read the next reply with dst_ or sink_, and reset them.
+   */
+  redisReply* Read(redisContext* connection);
+
+  static redisReplyObjectFunctions k_functions;
+
+  std::vector<Block> blocks_;
+  size_t block_{0};
+  size_t pos_{0};
+  const IOPullDestination* dst_{nullptr};
+  ValueSink sink_{nullptr};
+  void* sink_ctx_{nullptr};
+};
+
+} // namespace tde::details::redis_v1
@@ -0,0 +1,145 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tde/details/redis_io_v1.h"
+#include "tde/details/redis_reply_arena.h"
+
+namespace tde::details::redis_v1 {
+
+/**
+ * A connection whose replies are written by the test, through the other end
+ * of a socket pair.
+ */
+struct FakeConnection {
+  FakeConnection() {
+    int fds[2];
+    TORCH_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    peer_ = fds[1];
+    connection_ = redis::ContextPtr(redisConnectFd(fds[0]));
+    TORCH_CHECK(connection_ != nullptr && connection_->err == 0);
+  }
+
+  ~FakeConnection() {
+    close(peer_);
+  }
+
+  void Reply(std::string_view resp) const {
+    auto n = write(peer_, resp.data(), resp.size());
+    TORCH_CHECK(n == static_cast<ssize_t>(resp.size()));
+  }
+
+  int peer_;
+  redis::ContextPtr connection_;
+};
+
+TEST(TDE, ReplyArena_replies) {
+  FakeConnection fake;
+  ReplyArena arena;
+
+  fake.Reply("$5\r\nhello\r\n:42\r\n$-1\r\n");
+  redisReply* reply = arena.GetReply(fake.connection_.get());
+  ASSERT_EQ(reply->type, REDIS_REPLY_STRING);
+  ASSERT_EQ(std::string_view(reply->str, reply->len), "hello");
+  reply = arena.GetReply(fake.connection_.get());
+  ASSERT_EQ(reply->type, REDIS_REPLY_INTEGER);
+  ASSERT_EQ(reply->integer, 42);
+  reply = arena.GetReply(fake.connection_.get());
+  ASSERT_EQ(reply->type, REDIS_REPLY_NIL);
+
+  fake.Reply("*3\r\n$3\r\nabc\r\n$-1\r\n$2\r\nde\r\n");
+  reply = arena.GetReply(fake.connection_.get());
+  ASSERT_EQ(reply->type, REDIS_REPLY_ARRAY);
+  ASSERT_EQ(reply->elements, 3);
+  ASSERT_EQ(std::string_view(reply->element[0]->str), "abc");
+  ASSERT_EQ(reply->element[1]->type, REDIS_REPLY_NIL);
+  ASSERT_EQ(std::string_view(reply->element[2]->str), "de");
+
+  // The replies not read by the arena are allocated as usual.
+  fake.Reply("+OK\r\n");
+  void* status = nullptr;
+  ASSERT_EQ(redisGetReply(fake.connection_.get(), &status), REDIS_OK);
+  auto status_ptr = redis::ReplyPtr(reinterpret_cast<redisReply*>(status));
+  ASSERT_EQ(status_ptr->type, REDIS_REPLY_STATUS);
+  ASSERT_EQ(std::string_view(status_ptr->str, status_ptr->len), "OK");
+}
+
+TEST(TDE, ReplyArena_destination) {
+  FakeConnection fake;
+  ReplyArena arena;
+  char row[4] = {};
+  IOPullDestination dst{.data_ = row, .capacity_ = sizeof(row)};
+
+  fake.Reply("$4\r\nabcd\r\n$3\r\nxyz\r\n");
+  redisReply* reply = arena.GetReply(fake.connection_.get(), &dst);
+  ASSERT_EQ(reply->str, row);
+  ASSERT_EQ(std::string_view(row, sizeof(row)), "abcd");
+
+  // A value of another size is not written into the destination.
+  reply = arena.GetReply(fake.connection_.get(), &dst);
+  ASSERT_NE(reply->str, row);
+  ASSERT_EQ(std::string_view(reply->str, reply->len), "xyz");
+  ASSERT_EQ(std::string_view(row, sizeof(row)), "abcd");
+}
+
+TEST(TDE, ReplyArena_sink) {
+  FakeConnection fake;
+  ReplyArena arena;
+  std::vector<std::string> values;
+  auto sink = +[](void* ctx, const char* str, size_t len) {
+    auto& values = *reinterpret_cast<std::vector<std::string>*>(ctx);
+    values.emplace_back(str == nullptr ? "nil" : std::string(str, len));
+  };
+
+  fake.Reply("*3\r\n$3\r\nabc\r\n$-1\r\n$2\r\nde\r\n$1\r\nf\r\n");
+  redisReply* reply = arena.GetReply(fake.connection_.get(), sink, &values);
+  ASSERT_EQ(reply->type, REDIS_REPLY_ARRAY);
+  ASSERT_EQ(reply->elements, 3);
+  ASSERT_EQ(reply->element[0]->str, nullptr);
+  ASSERT_EQ(reply->element[0]->len, 3);
+  ASSERT_EQ(reply->element[1]->type, REDIS_REPLY_NIL);
+  reply = arena.GetReply(fake.connection_.get(), sink, &values);
+  ASSERT_EQ(reply->type, REDIS_REPLY_STRING);
+  ASSERT_EQ(values, std::vector<std::string>({"abc", "nil", "de", "f"}));
+
+  // An error is a reply, not a value.
+  fake.Reply("-ERR wrong type\r\n");
+  reply = arena.GetReply(fake.connection_.get(), sink, &values);
+  ASSERT_EQ(reply->type, REDIS_REPLY_ERROR);
+  ASSERT_EQ(std::string_view(reply->str, reply->len), "ERR wrong type");
+  ASSERT_EQ(values.size(), 4);
+
+  // The sink is only used by its read.
+  fake.Reply("$1\r\ng\r\n");
+  reply = arena.GetReply(fake.connection_.get());
+  ASSERT_EQ(std::string_view(reply->str, reply->len), "g");
+  ASSERT_EQ(values.size(), 4);
+}
+
+TEST(TDE, ReplyArena_reset) {
+  FakeConnection fake;
+  ReplyArena arena;
+  std::string value(ReplyArena::k_block_size + 1, 'v');
+  std::string resp =
+      "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+
+  auto read_chunk = [&] {
+    arena.Reset();
+    for (int i = 0; i < 3; ++i) {
+      fake.Reply(resp);
+      redisReply* reply = arena.GetReply(fake.connection_.get());
+      ASSERT_EQ(std::string_view(reply->str, reply->len), value);
+    }
+  };
+  read_chunk();
+  size_t capacity = arena.capacity();
+  ASSERT_GE(capacity, value.size() * 3);
+  // The chunks of the same replies reuse the blocks.
+  read_chunk();
+  read_chunk();
+  ASSERT_EQ(arena.capacity(), capacity);
+}
+
+} // namespace tde::details::redis_v1
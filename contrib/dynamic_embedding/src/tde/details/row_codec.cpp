@@ -0,0 +1,393 @@
+#include "tde/details/row_codec.h"
+#include <c10/util/BFloat16.h>
+#include <c10/util/Half.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "torch/torch.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define TDE_ROW_CODEC_AVX2
+#endif
+
+namespace tde::details {
+
+static constexpr uint8_t k_row_magic = 0xDE;
+
+namespace row_codec_impl {
+
+static void FloatToHalf(const float* src, uint32_t n, uint16_t* dst) {
+  for (uint32_t i = 0; i < n; ++i) {
+    dst[i] = c10::detail::fp16_ieee_from_fp32_value(src[i]);
+  }
+}
+
+static void HalfToFloat(const uint16_t* src, uint32_t n, float* dst) {
+  for (uint32_t i = 0; i < n; ++i) {
+    dst[i] = c10::detail::fp16_ieee_to_fp32_value(src[i]);
+  }
+}
+
+static void FloatToBF16(const float* src, uint32_t n, uint16_t* dst) {
+  for (uint32_t i = 0; i < n; ++i) {
+    dst[i] = c10::detail::round_to_nearest_even(src[i]);
+  }
+}
+
+static void BF16ToFloat(const uint16_t* src, uint32_t n, float* dst) {
+  for (uint32_t i = 0; i < n; ++i) {
+    dst[i] = c10::detail::f32_from_bits(src[i]);
+  }
+}
+
+static void MinMax(const float* src, uint32_t n, float* min, float* max) {
+  for (uint32_t i = 0; i < n; ++i) {
+    *min = std::min(*min, src[i]);
+    *max = std::max(*max, src[i]);
+  }
+}
+
+static void Quantize(
+    const float* src,
+    uint32_t n,
+    float inv_scale,
+    float bias,
+    uint8_t* dst) {
+  for (uint32_t i = 0; i < n; ++i) {
+    float q = std::nearbyint((src[i] - bias) * inv_scale);
+    dst[i] = static_cast<uint8_t>(std::clamp(q, 0.0f, 255.0f));
+  }
+}
+
+static void Dequantize(
+    const uint8_t* src,
+    uint32_t n,
+    float scale,
+    float bias,
+    float* dst) {
+  for (uint32_t i = 0; i < n; ++i) {
+    dst[i] = static_cast<float>(src[i]) * scale + bias;
+  }
+}
+
+#ifdef TDE_ROW_CODEC_AVX2
+
+#define TDE_AVX2 __attribute__((target("avx2,f16c")))
+
+TDE_AVX2 static void FloatToHalfAVX2(
+    const float* src,
+    uint32_t n,
+    uint16_t* dst) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm256_cvtps_ph(
+        _mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+  }
+  FloatToHalf(src + i, n - i, dst + i);
+}
+
+TDE_AVX2 static void HalfToFloatAVX2(
+    const uint16_t* src,
+    uint32_t n,
+    float* dst) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  HalfToFloat(src + i, n - i, dst + i);
+}
+
+TDE_AVX2 static void FloatToBF16AVX2(
+    const float* src,
+    uint32_t n,
+    uint16_t* dst) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i bias = _mm256_set1_epi32(0x7FFF);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_castps_si256(_mm256_loadu_ps(src + i));
+    // round to nearest even
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(x, 16), one);
+    x = _mm256_add_epi32(x, _mm256_add_epi32(lsb, bias));
+    x = _mm256_srli_epi32(x, 16);
+    // [x0-3, x0-3 | x4-7, x4-7] -> [x0-3, x4-7 | ...]
+    __m256i packed = _mm256_packus_epi32(x, x);
+    packed = _mm256_permute4x64_epi64(packed, 0xD8);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(packed));
+  }
+  FloatToBF16(src + i, n - i, dst + i);
+}
+
+TDE_AVX2 static void BF16ToFloatAVX2(
+    const uint16_t* src,
+    uint32_t n,
+    float* dst) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m256i x = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+    _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(x));
+  }
+  BF16ToFloat(src + i, n - i, dst + i);
+}
+
+TDE_AVX2 static void MinMaxAVX2(
+    const float* src,
+    uint32_t n,
+    float* min,
+    float* max) {
+  __m256 vmin = _mm256_set1_ps(*min);
+  __m256 vmax = _mm256_set1_ps(*max);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(src + i);
+    vmin = _mm256_min_ps(vmin, x);
+    vmax = _mm256_max_ps(vmax, x);
+  }
+  alignas(32) float mins[8];
+  alignas(32) float maxs[8];
+  _mm256_store_ps(mins, vmin);
+  _mm256_store_ps(maxs, vmax);
+  for (int k = 0; k < 8; ++k) {
+    *min = std::min(*min, mins[k]);
+    *max = std::max(*max, maxs[k]);
+  }
+  MinMax(src + i, n - i, min, max);
+}
+
+TDE_AVX2 static void QuantizeAVX2(
+    const float* src,
+    uint32_t n,
+    float inv_scale,
+    float bias,
+    uint8_t* dst) {
+  const __m256 vinv_scale = _mm256_set1_ps(inv_scale);
+  const __m256 vbias = _mm256_set1_ps(bias);
+  const __m256i vzero = _mm256_setzero_si256();
+  const __m256i vmax = _mm256_set1_epi32(255);
+  const __m256i gather = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(src + i);
+    x = _mm256_mul_ps(_mm256_sub_ps(x, vbias), vinv_scale);
+    __m256i q = _mm256_cvtps_epi32(x);
+    q = _mm256_min_epi32(_mm256_max_epi32(q, vzero), vmax);
+    // 8 x int32 -> 8 x uint8, each 128 bits lane holds 4 values.
+    q = _mm256_packus_epi32(q, q);
+    q = _mm256_packus_epi16(q, q);
+    q = _mm256_permutevar8x32_epi32(q, gather);
+    _mm_storel_epi64(
+        reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(q));
+  }
+  Quantize(src + i, n - i, inv_scale, bias, dst + i);
+}
+
+TDE_AVX2 static void DequantizeAVX2(
+    const uint8_t* src,
+    uint32_t n,
+    float scale,
+    float bias,
+    float* dst) {
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256 vbias = _mm256_set1_ps(bias);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+    __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(q));
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(x, vscale), vbias));
+  }
+  Dequantize(src + i, n - i, scale, bias, dst + i);
+}
+
+#undef TDE_AVX2
+
+static bool HasAVX2() {
+  static const bool has_avx2 =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+  return has_avx2;
+}
+
+#define TDE_ROW_CODEC_DISPATCH(func, ...) \
+  do {                                    \
+    if (HasAVX2()) {                      \
+      func##AVX2(__VA_ARGS__);            \
+    } else {                              \
+      func(__VA_ARGS__);                  \
+    }                                     \
+  } while (0)
+
+#else
+
+#define TDE_ROW_CODEC_DISPATCH(func, ...) func(__VA_ARGS__)
+
+#endif
+
+} // namespace row_codec_impl
+
+RowEncoding ParseRowEncoding(std::string_view name) {
+  if (name == "fp32") {
+    return RowEncoding::kFP32;
+  } else if (name == "fp16") {
+    return RowEncoding::kFP16;
+  } else if (name == "bf16") {
+    return RowEncoding::kBF16;
+  } else if (name == "int8") {
+    return RowEncoding::kInt8RowWise;
+  }
+  TORCH_CHECK(
+      false, "unknown encoding ", name, ", should be fp32, fp16, bf16 or int8");
+}
+
+uint32_t EncodedRowSize(RowEncoding encoding, uint32_t num_elems) {
+  switch (encoding) {
+    case RowEncoding::kFP32:
+      return num_elems * sizeof(float);
+    case RowEncoding::kFP16:
+    case RowEncoding::kBF16:
+      return sizeof(RowHeader) + num_elems * sizeof(uint16_t);
+    case RowEncoding::kInt8RowWise:
+      return sizeof(RowHeader) + 2 * sizeof(float) + num_elems;
+  }
+  TORCH_CHECK(false, "unknown encoding ", static_cast<int>(encoding));
+}
+
+void EncodeRow(
+    RowEncoding encoding,
+    const float* src,
+    uint32_t num_elems,
+    uint8_t* dst) {
+  using namespace row_codec_impl;
+  if (encoding == RowEncoding::kFP32) {
+    memcpy(dst, src, num_elems * sizeof(float));
+    return;
+  }
+  RowHeader header{
+      .magic_ = k_row_magic,
+      .encoding_ = encoding,
+      .reserved_ = 0,
+      .num_elems_ = num_elems,
+  };
+  memcpy(dst, &header, sizeof(header));
+  uint8_t* payload = dst + sizeof(header);
+  // The payload may be unaligned, the SIMD implementations use unaligned
+  // loads and stores.
+  switch (encoding) {
+    case RowEncoding::kFP16:
+      TDE_ROW_CODEC_DISPATCH(
+          FloatToHalf, src, num_elems, reinterpret_cast<uint16_t*>(payload));
+      break;
+    case RowEncoding::kBF16:
+      TDE_ROW_CODEC_DISPATCH(
+          FloatToBF16, src, num_elems, reinterpret_cast<uint16_t*>(payload));
+      break;
+    case RowEncoding::kInt8RowWise: {
+      float min = std::numeric_limits<float>::infinity();
+      float max = -std::numeric_limits<float>::infinity();
+      TDE_ROW_CODEC_DISPATCH(MinMax, src, num_elems, &min, &max);
+      if (num_elems == 0) {
+        min = max = 0;
+      }
+      float scale = (max - min) / 255.0f;
+      float inv_scale = scale == 0 ? 0 : 1.0f / scale;
+      memcpy(payload, &scale, sizeof(float));
+      memcpy(payload + sizeof(float), &min, sizeof(float));
+      TDE_ROW_CODEC_DISPATCH(
+          Quantize,
+          src,
+          num_elems,
+          inv_scale,
+          min,
+          payload + 2 * sizeof(float));
+      break;
+    }
+    default:
+      TORCH_CHECK(false, "unknown encoding ", static_cast<int>(encoding));
+  }
+}
+
+/**
+ * Returns true and sets header if the row starts with a valid header.
+ */
+static bool ReadHeader(
+    const uint8_t* src,
+    uint32_t len,
+    uint32_t num_elems,
+    RowHeader& header) {
+  header = RowHeader{};
+  if (len >= sizeof(header)) {
+    memcpy(&header, src, sizeof(header));
+  }
+  return header.magic_ == k_row_magic &&
+      header.encoding_ != RowEncoding::kFP32 &&
+      header.num_elems_ == num_elems &&
+      header.encoding_ <= RowEncoding::kInt8RowWise &&
+      len == EncodedRowSize(header.encoding_, num_elems);
+}
+
+bool IsRawRow(const uint8_t* src, uint32_t len, uint32_t num_elems) {
+  RowHeader header{};
+  return len == num_elems * sizeof(float) &&
+      !ReadHeader(src, len, num_elems, header);
+}
+
+void DecodeRow(
+    const uint8_t* src,
+    uint32_t len,
+    float* dst,
+    uint32_t num_elems) {
+  using namespace row_codec_impl;
+  RowHeader header{};
+  if (!ReadHeader(src, len, num_elems, header)) {
+    TORCH_CHECK(
+        len == num_elems * sizeof(float),
+        "invalid row of ",
+        len,
+        " bytes, expect an encoded row of ",
+        num_elems,
+        " elements");
+    memcpy(dst, src, len);
+    return;
+  }
+
+  const uint8_t* payload = src + sizeof(header);
+  switch (header.encoding_) {
+    case RowEncoding::kFP16:
+      TDE_ROW_CODEC_DISPATCH(
+          HalfToFloat,
+          reinterpret_cast<const uint16_t*>(payload),
+          num_elems,
+          dst);
+      break;
+    case RowEncoding::kBF16:
+      TDE_ROW_CODEC_DISPATCH(
+          BF16ToFloat,
+          reinterpret_cast<const uint16_t*>(payload),
+          num_elems,
+          dst);
+      break;
+    case RowEncoding::kInt8RowWise: {
+      float scale;
+      float bias;
+      memcpy(&scale, payload, sizeof(float));
+      memcpy(&bias, payload + sizeof(float), sizeof(float));
+      TDE_ROW_CODEC_DISPATCH(
+          Dequantize,
+          payload + 2 * sizeof(float),
+          num_elems,
+          scale,
+          bias,
+          dst);
+      break;
+    }
+    default:
+      TORCH_CHECK(
+          false, "unknown encoding ", static_cast<int>(header.encoding_));
+  }
+}
+
+} // namespace tde::details
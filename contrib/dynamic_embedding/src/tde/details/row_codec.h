@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace tde::details {
+
+/**
+ * Wire format of the rows stored in parameter servers.
+ *
+ * Except for kFP32, an encoded row starts with a `RowHeader`, so the rows of
+ * different encodings can be stored in the same table and decoded safely.
+ * kFP32 rows are raw floats without header, which is the format before
+ * encodings are introduced.
+ */
+enum class RowEncoding : uint8_t {
+  kFP32 = 0,
+  kFP16 = 1,
+  kBF16 = 2,
+  // Row-wise uint8 quantization. The payload is float scale, float bias, and
+  // the quantized values. value = quantized * scale + bias.
+  kInt8RowWise = 3,
+};
+
+struct RowHeader {
+  uint8_t magic_;
+  RowEncoding encoding_;
+  uint16_t reserved_;
+  uint32_t num_elems_;
+};
+static_assert(sizeof(RowHeader) == 8);
+
+/**
+ * Parse encoding name. Supported names are fp32, fp16, bf16 and int8.
+ */
+RowEncoding ParseRowEncoding(std::string_view name);
+
+/**
+ * Returns the number of bytes of an encoded row.
+ */
+uint32_t EncodedRowSize(RowEncoding encoding, uint32_t num_elems);
+
+/**
+ * Encode `num_elems` floats into `dst`, which must hold
+ * `EncodedRowSize(encoding, num_elems)` bytes.
+ */
+void EncodeRow(
+    RowEncoding encoding,
+    const float* src,
+    uint32_t num_elems,
+    uint8_t* dst);
+
+/**
+ * Returns true if the row is raw floats, i.e., decoding it is a copy.
+ */
+bool IsRawRow(const uint8_t* src, uint32_t len, uint32_t num_elems);
+
+/**
+ * Decode a row of any encoding into `num_elems` floats.
+ * Throws if the row is not a valid row of `num_elems` elements.
+ */
+void DecodeRow(
+    const uint8_t* src,
+    uint32_t len,
+    float* dst,
+    uint32_t num_elems);
+
+} // namespace tde::details
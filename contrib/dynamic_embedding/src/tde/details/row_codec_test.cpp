@@ -0,0 +1,86 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "tde/details/row_codec.h"
+
+namespace tde::details {
+
+static void TestRoundTrip(RowEncoding encoding, float tolerance) {
+  std::default_random_engine engine(0);
+  std::uniform_real_distribution<float> dist(-3, 5);
+  // cover the sizes that are not multiple of SIMD width.
+  for (uint32_t n : {1, 7, 8, 9, 128, 131}) {
+    std::vector<float> src(n);
+    std::vector<float> dst(n);
+    for (auto& v : src) {
+      v = dist(engine);
+    }
+    std::vector<uint8_t> encoded(EncodedRowSize(encoding, n));
+    EncodeRow(encoding, src.data(), n, encoded.data());
+    DecodeRow(encoded.data(), encoded.size(), dst.data(), n);
+    for (uint32_t i = 0; i < n; ++i) {
+      ASSERT_NEAR(src[i], dst[i], tolerance) << "n=" << n << ", i=" << i;
+    }
+  }
+}
+
+TEST(TDE, row_codec_fp32) {
+  TestRoundTrip(RowEncoding::kFP32, 0);
+  ASSERT_EQ(EncodedRowSize(RowEncoding::kFP32, 128), 128 * sizeof(float));
+}
+
+TEST(TDE, row_codec_fp16) {
+  TestRoundTrip(RowEncoding::kFP16, 5e-3);
+}
+
+TEST(TDE, row_codec_bf16) {
+  TestRoundTrip(RowEncoding::kBF16, 4e-2);
+}
+
+TEST(TDE, row_codec_int8) {
+  // (max - min) / 255 / 2
+  TestRoundTrip(RowEncoding::kInt8RowWise, 8.0 / 255 / 2 + 1e-5);
+}
+
+TEST(TDE, row_codec_constant_row) {
+  std::vector<float> src(16, 1.5);
+  std::vector<float> dst(16);
+  std::vector<uint8_t> encoded(EncodedRowSize(RowEncoding::kInt8RowWise, 16));
+  EncodeRow(RowEncoding::kInt8RowWise, src.data(), 16, encoded.data());
+  DecodeRow(encoded.data(), encoded.size(), dst.data(), 16);
+  ASSERT_EQ(src, dst);
+}
+
+TEST(TDE, row_codec_mixed_encodings) {
+  // Rows of different encodings can be decoded by the same reader.
+  std::vector<float> src = {1, 2, 3, 4};
+  for (auto encoding :
+       {RowEncoding::kFP32,
+        RowEncoding::kFP16,
+        RowEncoding::kBF16,
+        RowEncoding::kInt8RowWise}) {
+    std::vector<uint8_t> encoded(EncodedRowSize(encoding, 4));
+    EncodeRow(encoding, src.data(), 4, encoded.data());
+    std::vector<float> dst(4);
+    DecodeRow(encoded.data(), encoded.size(), dst.data(), 4);
+    ASSERT_EQ(src, dst);
+    // The fp16 row of 4 elements has the same size as the raw row.
+    ASSERT_EQ(
+        IsRawRow(encoded.data(), encoded.size(), 4),
+        encoding == RowEncoding::kFP32);
+  }
+}
+
+TEST(TDE, row_codec_bad_row) {
+  std::vector<uint8_t> encoded(EncodedRowSize(RowEncoding::kFP16, 8));
+  std::vector<float> src(8, 1);
+  std::vector<float> dst(8);
+  EncodeRow(RowEncoding::kFP16, src.data(), 8, encoded.data());
+  // wrong number of elements
+  ASSERT_ANY_THROW(DecodeRow(encoded.data(), encoded.size(), dst.data(), 7));
+  ASSERT_ANY_THROW(ParseRowEncoding("fp8"));
+  ASSERT_EQ(ParseRowEncoding("int8"), RowEncoding::kInt8RowWise);
+}
+
+} // namespace tde::details
@@ -0,0 +1,269 @@
+#include "tde/details/sharded_io.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+HashRing ShardedIO::MakeRing(
+    std::vector<Shard>& shards,
+    uint32_t num_virtual_nodes) {
+  try {
+    std::vector<std::string> names;
+    for (auto& shard : shards) {
+      names.emplace_back(shard.name_);
+    }
+    return HashRing(names, num_virtual_nodes);
+  } catch (...) {
+    for (auto& shard : shards) {
+      shard.provider_.Finalize(shard.instance_);
+    }
+    throw;
+  }
+}
+
+ShardedIO::ShardedIO(std::vector<Shard> shards, uint32_t num_virtual_nodes)
+    : shards_(std::move(shards)),
+      ring_(MakeRing(shards_, num_virtual_nodes)) {}
+
+ShardedIO::~ShardedIO() {
+  for (auto& shard : shards_) {
+    shard.provider_.Finalize(shard.instance_);
+  }
+}
+
+std::vector<std::vector<uint32_t>> ShardedIO::Split(
+    const char* table_name,
+    uint32_t num_global_ids,
+    const int64_t* global_ids) const {
+  std::vector<std::vector<uint32_t>> gid_indices(shards_.size());
+  uint64_t table_hash = HashRing::Hash(table_name);
+  for (uint32_t i = 0; i < num_global_ids; ++i) {
+    gid_indices[ShardOf(table_hash, global_ids[i])].emplace_back(i);
+  }
+  return gid_indices;
+}
+
+struct ShardedPullContext {
+  IOPullParameterV2 param_;
+  // max(num_cols, 1)
+  uint32_t num_cols_;
+  std::atomic<uint32_t> num_pending_;
+};
+
+/**
+ * The part of a pull sent to a shard.
+ */
+struct ShardPullContext {
+  ShardedPullContext* parent_;
+  std::vector<int64_t> global_ids_;
+  // The indices of global_ids_ in the pull.
+  std::vector<uint32_t> gid_indices_;
+  std::vector<IOPullDestination> dsts_;
+};
+
+static void OnShardChunkFetched(void* ctx, const IOPullChunk* chunk) {
+  auto* c = reinterpret_cast<ShardPullContext*>(ctx);
+  auto& param = c->parent_->param_;
+  uint32_t num_cols = c->parent_->num_cols_;
+
+  // The rows of the shard are delivered as the runs contiguous in the pull.
+  uint32_t run_begin = 0;
+  uint32_t run_size = 0;
+  uint32_t run_row = 0;
+  auto deliver_run = [&] {
+    if (run_size == 0) {
+      return;
+    }
+    IOPullChunk run{
+        .row_begin_ = run_row,
+        .num_rows_ = run_size,
+        .optimizer_state_ = chunk->optimizer_state_,
+        .data_ = chunk->data_,
+        .offsets_ = chunk->offsets_ + run_begin,
+        .present_ = chunk->present_ + run_begin,
+    };
+    param.on_chunk_fetched_(param.on_complete_context_, &run);
+    run_size = 0;
+  };
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    uint32_t row = chunk->row_begin_ + i;
+    uint32_t pull_row =
+        c->gid_indices_[row / num_cols] * num_cols + row % num_cols;
+    if (run_size != 0 && pull_row != run_row + run_size) {
+      deliver_run();
+    }
+    if (run_size == 0) {
+      run_begin = i;
+      run_row = pull_row;
+    }
+    ++run_size;
+  }
+  deliver_run();
+}
+
+static void OnShardAllFetched(void* ctx) {
+  auto* c = reinterpret_cast<ShardPullContext*>(ctx);
+  auto* parent = c->parent_;
+  delete c;
+  if (parent->num_pending_.fetch_sub(1) == 1) {
+    parent->param_.on_all_fetched_(parent->param_.on_complete_context_);
+    delete parent;
+  }
+}
+
+void ShardedIO::Pull(IOPullParameterV2 param) {
+  if (shards_.size() == 1) {
+    PullChunked(shards_[0].provider_, shards_[0].instance_, param);
+    return;
+  }
+  auto gid_indices =
+      Split(param.table_name_, param.num_global_ids_, param.global_ids_);
+  uint32_t num_parts = 0;
+  for (auto& indices : gid_indices) {
+    num_parts += !indices.empty();
+  }
+  if (num_parts == 0) {
+    param.on_all_fetched_(param.on_complete_context_);
+    return;
+  }
+
+  auto* parent = new ShardedPullContext{
+      .param_ = param,
+      .num_cols_ = std::max(param.num_cols_, 1U),
+      .num_pending_{num_parts},
+  };
+  uint32_t num_dsts = parent->num_cols_ * param.num_optimizer_stats_;
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    if (gid_indices[s].empty()) {
+      continue;
+    }
+    auto* ctx = new ShardPullContext{
+        .parent_ = parent,
+        .gid_indices_ = std::move(gid_indices[s]),
+    };
+    for (auto i : ctx->gid_indices_) {
+      ctx->global_ids_.emplace_back(param.global_ids_[i]);
+      if (param.dsts_ != nullptr) {
+        auto* dsts = param.dsts_ + i * num_dsts;
+        ctx->dsts_.insert(ctx->dsts_.end(), dsts, dsts + num_dsts);
+      }
+    }
+    PullChunked(
+        shards_[s].provider_,
+        shards_[s].instance_,
+        IOPullParameterV2{
+            .table_name_ = param.table_name_,
+            .num_cols_ = param.num_cols_,
+            .num_global_ids_ = static_cast<uint32_t>(ctx->global_ids_.size()),
+            .col_ids_ = param.col_ids_,
+            .global_ids_ = ctx->global_ids_.data(),
+            .num_optimizer_stats_ = param.num_optimizer_stats_,
+            .on_complete_context_ = ctx,
+            .on_chunk_fetched_ = OnShardChunkFetched,
+            .on_all_fetched_ = OnShardAllFetched,
+            .dsts_ = param.dsts_ == nullptr ? nullptr : ctx->dsts_.data(),
+        });
+  }
+}
+
+/**
+ * The parts of a push, whose values are gathered per shard.
+ */
+struct ShardedPushContext {
+  IOPushParameter param_;
+  std::atomic<uint32_t> num_pending_;
+  std::vector<std::vector<int64_t>> global_ids_;
+  std::vector<std::vector<uint64_t>> offsets_;
+  std::vector<std::vector<uint8_t>> data_;
+};
+
+static void OnShardPushComplete(void* ctx) {
+  auto* c = reinterpret_cast<ShardedPushContext*>(ctx);
+  if (c->num_pending_.fetch_sub(1) == 1) {
+    c->param_.on_push_complete(c->param_.on_complete_context_);
+    delete c;
+  }
+}
+
+void ShardedIO::Push(IOPushParameter param) {
+  if (shards_.size() == 1) {
+    shards_[0].provider_.Push(shards_[0].instance_, param);
+    return;
+  }
+  auto gid_indices =
+      Split(param.table_name_, param.num_global_ids_, param.global_ids_);
+  uint32_t num_parts = 0;
+  for (auto& indices : gid_indices) {
+    num_parts += !indices.empty();
+  }
+  if (num_parts == 0) {
+    param.on_push_complete(param.on_complete_context_);
+    return;
+  }
+
+  auto* ctx = new ShardedPushContext{
+      .param_ = param,
+      .num_pending_{num_parts},
+  };
+  ctx->global_ids_.resize(shards_.size());
+  ctx->offsets_.resize(shards_.size());
+  ctx->data_.resize(shards_.size());
+  uint32_t num_values =
+      std::max(param.num_cols_, 1U) * param.num_optimizer_stats_;
+  auto* data = reinterpret_cast<const uint8_t*>(param.data_);
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    auto& offsets = ctx->offsets_[s];
+    auto& shard_data = ctx->data_[s];
+    offsets.emplace_back(0);
+    for (auto i : gid_indices[s]) {
+      ctx->global_ids_[s].emplace_back(param.global_ids_[i]);
+      auto* begin = param.offsets_ + i * num_values;
+      shard_data.insert(
+          shard_data.end(), data + begin[0], data + begin[num_values]);
+      for (uint32_t k = 1; k <= num_values; ++k) {
+        offsets.emplace_back(offsets.back() + begin[k] - begin[k - 1]);
+      }
+    }
+  }
+
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    if (gid_indices[s].empty()) {
+      continue;
+    }
+    IOPushParameter part = param;
+    part.num_global_ids_ = ctx->global_ids_[s].size();
+    part.global_ids_ = ctx->global_ids_[s].data();
+    part.num_offsets_ = ctx->offsets_[s].size();
+    part.offsets_ = ctx->offsets_[s].data();
+    part.data_ = ctx->data_[s].data();
+    part.on_complete_context_ = ctx;
+    part.on_push_complete = OnShardPushComplete;
+    shards_[s].provider_.Push(shards_[s].instance_, part);
+  }
+}
+
+void ShardedIO::Stats(void* ctx, IOStatsEmitter emit) const {
+  struct ShardStatsContext {
+    const std::string& prefix_;
+    void* ctx_;
+    IOStatsEmitter emit_;
+  };
+  for (auto& shard : shards_) {
+    if (shard.provider_.Stats == nullptr) {
+      continue;
+    }
+    std::string prefix = shard.name_ + ".";
+    ShardStatsContext shard_ctx{prefix, ctx, emit};
+    shard.provider_.Stats(
+        shard.instance_,
+        &shard_ctx,
+        +[](void* ctx, const char* key, double value) {
+          auto* c = reinterpret_cast<ShardStatsContext*>(ctx);
+          c->emit_(c->ctx_, (c->prefix_ + key).c_str(), value);
+        });
+  }
+}
+
+} // namespace tde::details
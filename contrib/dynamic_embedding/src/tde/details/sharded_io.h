@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "tde/details/hash_ring.h"
+#include "tde/details/io_registry.h"
+
+namespace tde::details {
+
+/**
+ * An IO over several shards, e.g., one redis instance per endpoint, each of
+ * which stores a part of the global ids of a table.
+ *
+ * A global id of a table is owned by a shard picked by consistent hashing of
+ * (table, global id), so all the columns and optimizer states of a global id
+ * are in the same shard, and adding a shard only moves the ids it takes
+ * over.
+ *
+ * A pull or a push is split by shard, and the shards are requested at the
+ * same time, each of which pipelines its part on its own connections. A pull
+ * completes when all the shards complete.
+ */
+class ShardedIO {
+ public:
+  struct Shard {
+    // The name on the hash ring, e.g., `host:port/db`.
+    std::string name_;
+    IOProvider provider_;
+    void* instance_;
+  };
+
+  /**
+   * Take the ownership of the instances of shards, which are finalized by the
+   * destructor, or here if the names are not valid.
+   */
+  explicit ShardedIO(
+      std::vector<Shard> shards,
+      uint32_t num_virtual_nodes = HashRing::k_default_num_virtual_nodes);
+
+  ~ShardedIO();
+
+  ShardedIO(const ShardedIO&) = delete;
+  ShardedIO& operator=(const ShardedIO&) = delete;
+
+  [[nodiscard]] size_t num_shards() const {
+    return shards_.size();
+  }
+
+  /**
+   * @return the index of the shard of global_id, where table_hash is
+   * `HashRing::Hash(table_name)`.
+   */
+  [[nodiscard]] uint32_t ShardOf(uint64_t table_hash, int64_t global_id) const {
+    return ring_.Find(HashRing::Hash(table_hash, global_id));
+  }
+
+  void Pull(IOPullParameterV2 param);
+
+  void Push(IOPushParameter param);
+
+  /**
+   * Emit the stats of the shards, as `<shard name>.<key>`.
+   */
+  void Stats(void* ctx, IOStatsEmitter emit) const;
+
+ private:
+  /**
+   * The indices of the global ids of each shard.
+   */
+  std::vector<std::vector<uint32_t>> Split(
+      const char* table_name,
+      uint32_t num_global_ids,
+      const int64_t* global_ids) const;
+
+  static HashRing MakeRing(
+      std::vector<Shard>& shards,
+      uint32_t num_virtual_nodes);
+
+  std::vector<Shard> shards_;
+  HashRing ring_;
+};
+
+} // namespace tde::details
@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+#include "tde/details/io_test_util.h"
+#include "tde/details/sharded_io.h"
+
+namespace tde::details {
+
+static int _r = [] {
+  IORegistry::RegisterAllDefaultIOs();
+  return 0;
+}();
+
+/**
+ * Shards of memory://, which stand in for redis endpoints.
+ */
+static std::unique_ptr<ShardedIO> MakeShardedIO(
+    uint32_t num_shards,
+    std::vector<ShardedIO::Shard>& shards) {
+  auto provider = IORegistry::Instance().Resolve("memory");
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    shards.emplace_back(ShardedIO::Shard{
+        .name_ = "shard" + std::to_string(i),
+        .provider_ = provider,
+        .instance_ = provider.Initialize("?chunk_size=4"),
+    });
+  }
+  return std::make_unique<ShardedIO>(shards);
+}
+
+/**
+ * Push rows of 2 optimizer states, whose values are `{gid, os}`.
+ */
+template <typename IO>
+static void Push(IO&& io, const std::vector<int64_t>& global_ids) {
+  std::vector<float> data;
+  for (auto gid : global_ids) {
+    for (uint32_t os = 0; os < 2; ++os) {
+      data.emplace_back(gid);
+      data.emplace_back(os);
+    }
+  }
+  PushRows(io, global_ids, {0, 1}, data);
+}
+
+TEST(TDE, sharded_io) {
+  std::vector<ShardedIO::Shard> shards;
+  auto io = MakeShardedIO(3, shards);
+  std::vector<int64_t> pushed;
+  for (int64_t gid = 0; gid < 100; ++gid) {
+    pushed.emplace_back(gid * 7);
+  }
+  Push([&](auto param) { io->Push(param); }, pushed);
+
+  // Every id is owned by one shard.
+  uint64_t table_hash = HashRing::Hash("table");
+  std::vector<std::vector<int64_t>> owned(3);
+  for (auto gid : pushed) {
+    owned[io->ShardOf(table_hash, gid)].emplace_back(gid);
+  }
+  for (uint32_t s = 0; s < 3; ++s) {
+    ASSERT_FALSE(owned[s].empty());
+    auto& shard = shards[s];
+    auto result = PullRows(
+        [&](auto param) {
+          shard.provider_.PullV2(shard.instance_, param);
+        },
+        pushed,
+        2);
+    for (size_t i = 0; i < pushed.size(); ++i) {
+      bool is_owned = io->ShardOf(table_hash, pushed[i]) == s;
+      ASSERT_EQ(result->present_[i * 2] == k_row_present, is_owned);
+    }
+  }
+
+  std::vector<int64_t> global_ids{-1};
+  global_ids.insert(global_ids.end(), pushed.begin(), pushed.end());
+  auto result = PullRows([&](auto param) { io->Pull(param); }, global_ids, 2);
+  for (size_t i = 0; i < global_ids.size(); ++i) {
+    for (uint32_t os = 0; os < 2; ++os) {
+      ASSERT_EQ(result->num_deliveries_[i * 2 + os], 1);
+      if (i == 0) {
+        ASSERT_EQ(result->present_[i * 2 + os], k_row_missing);
+      } else {
+        ASSERT_EQ(
+            result->values_[i * 2 + os],
+            std::vector<float>({static_cast<float>(global_ids[i]),
+                                static_cast<float>(os)}));
+      }
+    }
+  }
+
+  // The destinations of the ids are passed to their shards.
+  std::vector<float> dsts(global_ids.size() * 2 * 2, -1);
+  result = PullRows([&](auto param) { io->Pull(param); }, global_ids, 2, &dsts);
+  for (size_t i = 1; i < global_ids.size(); ++i) {
+    for (uint32_t os = 0; os < 2; ++os) {
+      ASSERT_EQ(result->present_[i * 2 + os], k_row_in_destination);
+      ASSERT_EQ(dsts[(i * 2 + os) * 2], global_ids[i]);
+      ASSERT_EQ(dsts[(i * 2 + os) * 2 + 1], os);
+    }
+  }
+  ASSERT_EQ(dsts[0], -1);
+}
+
+} // namespace tde::details
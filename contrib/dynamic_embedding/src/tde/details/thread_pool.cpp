@@ -0,0 +1,51 @@
+#include "tde/details/thread_pool.h"
+#include "torch/torch.h"
+
+namespace tde::details {
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+  TORCH_CHECK(num_threads != 0, "num_threads must not be zero");
+  threads_.reserve(num_threads);
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this] {
+      while (true) {
+        Job job;
+        {
+          std::unique_lock<std::mutex> lock(jobs_mutex_);
+          jobs_not_empty_.wait(lock, [this] { return !jobs_.empty(); });
+          job = std::move(jobs_.front());
+          jobs_.pop_front();
+        }
+        // empty job means stop.
+        if (!job) {
+          break;
+        }
+        job();
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(jobs_mutex_);
+    for (size_t i = 0; i < threads_.size(); ++i) {
+      jobs_.emplace_back();
+    }
+  }
+  jobs_not_empty_.notify_all();
+  for (auto& th : threads_) {
+    th.join();
+  }
+}
+
+void ThreadPool::Enqueue(Job job) {
+  TORCH_CHECK(job, "job must not be empty");
+  {
+    std::lock_guard<std::mutex> guard(jobs_mutex_);
+    jobs_.emplace_back(std::move(job));
+  }
+  jobs_not_empty_.notify_one();
+}
+
+} // namespace tde::details
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tde/details/move_only_function.h"
+
+namespace tde::details {
+
+/**
+ * A fixed size thread pool.
+ *
+ * Jobs are executed in FIFO order. It is used to run the work which should
+ * not block the IO threads, e.g., scattering fetched rows into the embedding
+ * tensors.
+ */
+class ThreadPool {
+ public:
+  using Job = MoveOnlyFunction<void()>;
+
+  explicit ThreadPool(uint32_t num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) noexcept = delete;
+  ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+  /**
+   * Enqueue a job to the pool.
+   * @param job must not be empty.
+   */
+  void Enqueue(Job job);
+
+ private:
+  std::vector<std::thread> threads_;
+  std::deque<Job> jobs_;
+  std::condition_variable jobs_not_empty_;
+  std::mutex jobs_mutex_;
+};
+
+} // namespace tde::details
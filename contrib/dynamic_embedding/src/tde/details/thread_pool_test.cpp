@@ -0,0 +1,36 @@
+#include <atomic>
+#include "gtest/gtest.h"
+#include "tde/details/notification.h"
+#include "tde/details/thread_pool.h"
+
+namespace tde::details {
+
+TEST(TDE, thread_pool) {
+  std::atomic<int> counter{0};
+  Notification notification;
+  {
+    ThreadPool pool(4);
+    for (int i = 0; i < 100; ++i) {
+      pool.Enqueue([&] {
+        if (counter.fetch_add(1) + 1 == 100) {
+          notification.Done();
+        }
+      });
+    }
+    notification.Wait();
+  }
+  ASSERT_EQ(counter.load(), 100);
+}
+
+TEST(TDE, thread_pool_drain_on_destroy) {
+  std::atomic<int> counter{0};
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 10; ++i) {
+      pool.Enqueue([&] { counter.fetch_add(1); });
+    }
+  }
+  ASSERT_EQ(counter.load(), 10);
+}
+
+} // namespace tde::details
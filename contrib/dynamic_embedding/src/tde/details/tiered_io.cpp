@@ -0,0 +1,584 @@
+#include "tde/details/tiered_io.h"
+#include <cstring>
+#include <variant>
+#include "lexy/callback.hpp"
+#include "lexy/dsl.hpp"
+#include "tde/details/memory_io.h"
+#include "tde/details/url.h"
+#include "torch/torch.h"
+
+namespace tde::details {
+
+void RegisterTieredIO() {
+  auto& reg = IORegistry::Instance();
+
+  {
+    IOProvider provider{};
+    provider.type_ = "tiered";
+    provider.Initialize = +[](const char* cfg) -> void* {
+      auto opt = tiered_io::Option::Parse(cfg);
+      return new tiered_io::TieredIO(opt);
+    };
+    provider.Finalize = +[](void* inst) {
+      delete reinterpret_cast<tiered_io::TieredIO*>(inst);
+    };
+    provider.version_ = k_io_version_2;
+    provider.PullV2 = +[](void* inst, IOPullParameterV2 param) {
+      reinterpret_cast<tiered_io::TieredIO*>(inst)->Pull(param);
+    };
+    provider.Push = +[](void* inst, IOPushParameter param) {
+      reinterpret_cast<tiered_io::TieredIO*>(inst)->Push(param);
+    };
+    reg.Register(provider);
+  }
+}
+
+namespace tiered_io {
+
+static constexpr std::string_view k_schema_separator = "://";
+static constexpr char k_tier_separator = '|';
+
+struct WriteBackOpt {
+  uint32_t write_back_;
+};
+struct PromoteOpt {
+  uint32_t promote_;
+};
+
+using OptVar = std::variant<WriteBackOpt, PromoteOpt>;
+
+struct OptionSetter {
+  void operator()(Option* self, WriteBackOpt opt) {
+    self->write_back_ = opt.write_back_ != 0;
+  }
+  void operator()(Option* self, PromoteOpt opt) {
+    self->promote_ = opt.promote_ != 0;
+  }
+};
+
+namespace option_rules {
+namespace dsl = lexy::dsl;
+struct Integer {
+  constexpr static auto rule =
+      dsl::integer<uint32_t>(dsl::digits<>.no_leading_zero());
+  constexpr static auto value = lexy::construct<uint32_t>;
+};
+
+struct WriteBack {
+  constexpr static auto rule = LEXY_LIT("write_back=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<WriteBackOpt>;
+};
+
+struct Promote {
+  constexpr static auto rule = LEXY_LIT("promote=") >> dsl::p<Integer>;
+  constexpr static auto value = lexy::construct<PromoteOpt>;
+};
+
+struct UnknownOption {
+  constexpr static auto name = "unknown option";
+};
+
+struct Option {
+  constexpr static auto rule =
+      dsl::p<WriteBack> | dsl::p<Promote> | dsl::error<UnknownOption>;
+  constexpr static auto value = lexy::construct<OptVar>;
+};
+
+struct Options {
+  constexpr static auto rule =
+      dsl::list(dsl::p<Option>, dsl::sep(LEXY_LIT("&&")));
+
+  constexpr static auto value = lexy::as_list<std::vector<OptVar>>;
+};
+
+} // namespace option_rules
+
+Option::Option(std::string_view config_str) {
+  std::vector<std::string_view> segments;
+  while (true) {
+    auto pos = config_str.find(k_tier_separator);
+    segments.emplace_back(config_str.substr(0, pos));
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    config_str = config_str.substr(pos + 1);
+  }
+
+  auto tier_begin = segments.begin();
+  if (!segments.front().empty() && segments.front()[0] == '?') {
+    ++tier_begin;
+    std::ostringstream err_oss_;
+    url_parser::ErrorCollector collector{err_oss_};
+
+    auto result = lexy::parse<option_rules::Options>(
+        lexy::string_input(segments.front().substr(1)), collector);
+    auto err_str = err_oss_.str();
+
+    TORCH_CHECK(
+        result.has_value() && err_str.empty(), "parse param error ", err_str);
+
+    for (auto&& opt_var : result.value()) {
+      std::visit(
+          [this](auto&& opt) {
+            OptionSetter setter;
+            setter(this, std::move(opt));
+          },
+          opt_var);
+    }
+  }
+
+  for (auto it = tier_begin; it != segments.end(); ++it) {
+    TORCH_CHECK(
+        it->find(k_schema_separator) != std::string_view::npos,
+        "tier config should be schema://cfg_string, got ",
+        *it);
+    tiers_.emplace_back(*it);
+  }
+  TORCH_CHECK(!tiers_.empty(), "tiered IO needs at least one tier");
+  // An unbounded memory tier ends up with a copy of the tiers below.
+  for (size_t i = 0; i + 1 < tiers_.size(); ++i) {
+    std::string_view tier = tiers_[i];
+    auto pos = tier.find(k_schema_separator);
+    TORCH_CHECK(
+        tier.substr(0, pos) != "memory" ||
+            memory_io::Option::Parse(
+                tier.substr(pos + k_schema_separator.size()))
+                    .capacity_ != 0,
+        "the memory tier ",
+        tier,
+        " above the last tier needs a cap, e.g., memory://?cap=8G");
+  }
+}
+
+OwnedPush::OwnedPush(const IOPushParameter& param)
+    : table_name_(param.table_name_),
+      global_ids_(param.global_ids_, param.global_ids_ + param.num_global_ids_),
+      col_ids_(param.col_ids_, param.col_ids_ + param.num_cols_),
+      os_ids_(
+          param.optimizer_stats_ids_,
+          param.optimizer_stats_ids_ + param.num_optimizer_stats_),
+      offsets_(param.offsets_, param.offsets_ + param.num_offsets_) {
+  if (offsets_.empty()) {
+    return;
+  }
+  // Only the values in between the offsets are copied.
+  uint64_t begin = offsets_.front();
+  auto* data = reinterpret_cast<const uint8_t*>(param.data_);
+  data_.assign(data + begin, data + offsets_.back());
+  for (auto& offset : offsets_) {
+    offset -= begin;
+  }
+}
+
+IOPushParameter OwnedPush::Param() const {
+  return IOPushParameter{
+      .table_name_ = table_name_.c_str(),
+      .num_cols_ = static_cast<uint32_t>(col_ids_.size()),
+      .num_global_ids_ = static_cast<uint32_t>(global_ids_.size()),
+      .col_ids_ = col_ids_.data(),
+      .global_ids_ = global_ids_.data(),
+      .num_optimizer_stats_ = static_cast<uint32_t>(os_ids_.size()),
+      .optimizer_stats_ids_ = os_ids_.data(),
+      .num_offsets_ = static_cast<uint32_t>(offsets_.size()),
+      .offsets_ = offsets_.data(),
+      .data_ = data_.data(),
+  };
+}
+
+/**
+ * A pull going through the tiers. The rows of a tier are the rows of the
+ * global ids pulled from it, which are the global ids missing in the tiers
+ * above.
+ */
+struct PullContext {
+  TieredIO* io_;
+  IOPullParameterV2 param_;
+  std::string table_name_;
+  std::vector<int64_t> col_ids_;
+  // max(num_cols, 1)
+  uint32_t num_cols_;
+  // Whether the rows of the pull are delivered to the caller.
+  std::vector<uint8_t> delivered_;
+
+  size_t tier_{0};
+  // The global ids pulled from the current tier, and their indices in the
+  // pull.
+  std::vector<int64_t> global_ids_;
+  std::vector<uint32_t> gid_indices_;
+  // The destinations of the rows of the current tier, the destinations of
+  // the pull for the first tier, and dsts_ for the others.
+  const IOPullDestination* tier_dsts_{nullptr};
+  std::vector<IOPullDestination> dsts_;
+  // Whether the rows of the current tier are found, by optimizer state 0.
+  std::vector<uint8_t> found_;
+  // The values of (row, optimizer state) of the current tier to promote.
+  std::vector<std::vector<uint8_t>> values_;
+
+  // The current tier and the promotions in flight.
+  std::atomic<uint32_t> num_pending_{1};
+
+  [[nodiscard]] bool last_tier() const {
+    return tier_ + 1 == io_->tiers_.size();
+  }
+
+  [[nodiscard]] bool promote() const {
+    return tier_ != 0 && io_->opt_.promote_;
+  }
+
+  /**
+   * The row of the pull of the given row of the current tier.
+   */
+  [[nodiscard]] uint32_t PullRow(uint32_t row) const {
+    return gid_indices_[row / num_cols_] * num_cols_ + row % num_cols_;
+  }
+
+  void OnTierFetched() {
+    io_->OnTierFetched(this);
+  }
+
+  /**
+   * Finish the current tier or a promotion. The last one completes the pull.
+   */
+  void Finish() {
+    if (num_pending_.fetch_sub(1) == 1) {
+      param_.on_all_fetched_(param_.on_complete_context_);
+      delete this;
+    }
+  }
+};
+
+static void OnTierChunkFetched(void* ctx, const IOPullChunk* chunk) {
+  auto c = reinterpret_cast<PullContext*>(ctx);
+  uint32_t num_os = c->param_.num_optimizer_stats_;
+  uint32_t os = chunk->optimizer_state_;
+  auto* data = reinterpret_cast<const uint8_t*>(chunk->data_);
+  bool promote = c->promote();
+  bool last_tier = c->last_tier();
+
+  // Deliver the runs of rows, which are contiguous in the pull, not missing
+  // unless this is the last tier, and not delivered by the tiers above.
+  uint32_t run_begin = 0;
+  uint32_t run_size = 0;
+  uint32_t run_row = 0;
+  auto deliver_run = [&] {
+    if (run_size == 0) {
+      return;
+    }
+    IOPullChunk run{
+        .row_begin_ = run_row,
+        .num_rows_ = run_size,
+        .optimizer_state_ = os,
+        .data_ = chunk->data_,
+        .offsets_ = chunk->offsets_ + run_begin,
+        .present_ = chunk->present_ + run_begin,
+    };
+    c->param_.on_chunk_fetched_(c->param_.on_complete_context_, &run);
+    run_size = 0;
+  };
+
+  for (uint32_t i = 0; i < chunk->num_rows_; ++i) {
+    uint32_t row = chunk->row_begin_ + i;
+    uint8_t present = chunk->present_[i];
+    if (os == 0) {
+      c->found_[row] = present != k_row_missing;
+    }
+    if (promote && present != k_row_missing) {
+      auto& value = c->values_[row * num_os + os];
+      if (present == k_row_in_destination) {
+        auto& dst = c->tier_dsts_[row * num_os + os];
+        auto* ptr = reinterpret_cast<const uint8_t*>(dst.data_);
+        value.assign(ptr, ptr + dst.capacity_);
+      } else {
+        value.assign(
+            data + chunk->offsets_[i], data + chunk->offsets_[i + 1]);
+      }
+    }
+
+    uint32_t pull_row = c->PullRow(row);
+    if (c->delivered_[pull_row] ||
+        (present == k_row_missing && !last_tier)) {
+      deliver_run();
+      continue;
+    }
+    if (run_size != 0 && pull_row != run_row + run_size) {
+      deliver_run();
+    }
+    if (run_size == 0) {
+      run_begin = i;
+      run_row = pull_row;
+    }
+    ++run_size;
+  }
+  deliver_run();
+}
+
+static void OnTierAllFetched(void* ctx) {
+  reinterpret_cast<PullContext*>(ctx)->OnTierFetched();
+}
+
+TieredIO::TieredIO(const Option& opt) : opt_(opt) {
+  auto& reg = IORegistry::Instance();
+  try {
+    for (auto& config : opt_.tiers_) {
+      auto pos = config.find(k_schema_separator);
+      std::string rest_cfg = config.substr(pos + k_schema_separator.size());
+      IOProvider provider = reg.Resolve(config.substr(0, pos));
+      tiers_.emplace_back(Tier{
+          .provider_ = provider,
+          .instance_ = provider.Initialize(rest_cfg.c_str()),
+      });
+    }
+  } catch (...) {
+    for (auto& tier : tiers_) {
+      tier.provider_.Finalize(tier.instance_);
+    }
+    throw;
+  }
+}
+
+TieredIO::~TieredIO() {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    background_cv_.wait(lock, [this] { return num_background_pushes_ == 0; });
+  }
+  for (auto& tier : tiers_) {
+    tier.provider_.Finalize(tier.instance_);
+  }
+}
+
+void TieredIO::Pull(IOPullParameterV2 param) {
+  if (tiers_.size() == 1) {
+    PullChunked(tiers_[0].provider_, tiers_[0].instance_, param);
+    return;
+  }
+  auto* ctx = new PullContext{
+      .io_ = this,
+      .param_ = param,
+      .table_name_ = param.table_name_,
+      .col_ids_ = std::vector<int64_t>(
+          param.col_ids_, param.col_ids_ + param.num_cols_),
+      .num_cols_ = std::max(param.num_cols_, 1U),
+      .global_ids_ = std::vector<int64_t>(
+          param.global_ids_, param.global_ids_ + param.num_global_ids_),
+  };
+  ctx->delivered_.resize(param.num_global_ids_ * ctx->num_cols_);
+  ctx->gid_indices_.resize(param.num_global_ids_);
+  for (uint32_t i = 0; i < param.num_global_ids_; ++i) {
+    ctx->gid_indices_[i] = i;
+  }
+  ctx->tier_dsts_ = param.dsts_;
+  PullTier(ctx);
+}
+
+void TieredIO::PullTier(PullContext* ctx) {
+  uint32_t num_rows = ctx->global_ids_.size() * ctx->num_cols_;
+  ctx->found_.assign(num_rows, 0);
+  ctx->values_.clear();
+  if (ctx->promote()) {
+    ctx->values_.resize(num_rows * ctx->param_.num_optimizer_stats_);
+  }
+  Tier& tier = tiers_[ctx->tier_];
+  PullChunked(
+      tier.provider_,
+      tier.instance_,
+      IOPullParameterV2{
+          .table_name_ = ctx->table_name_.c_str(),
+          .num_cols_ = ctx->param_.num_cols_,
+          .num_global_ids_ = static_cast<uint32_t>(ctx->global_ids_.size()),
+          .col_ids_ = ctx->col_ids_.data(),
+          .global_ids_ = ctx->global_ids_.data(),
+          .num_optimizer_stats_ = ctx->param_.num_optimizer_stats_,
+          .on_complete_context_ = ctx,
+          .on_chunk_fetched_ = OnTierChunkFetched,
+          .on_all_fetched_ = OnTierAllFetched,
+          .dsts_ = ctx->tier_dsts_,
+      });
+}
+
+void TieredIO::OnTierFetched(PullContext* ctx) {
+  uint32_t num_cols = ctx->num_cols_;
+  uint32_t num_os = ctx->param_.num_optimizer_stats_;
+  std::vector<int64_t> missing_gids;
+  std::vector<uint32_t> missing_gid_indices;
+  std::vector<IOPullDestination> missing_dsts;
+  auto promoted = ctx->promote() ? std::make_shared<OwnedPush>() : nullptr;
+  for (uint32_t i = 0; i < ctx->global_ids_.size(); ++i) {
+    bool all_found = true;
+    bool any_delivered = false;
+    for (uint32_t j = 0; j < num_cols; ++j) {
+      uint32_t row = i * num_cols + j;
+      uint32_t pull_row = ctx->PullRow(row);
+      all_found &= ctx->found_[row] != 0;
+      any_delivered |= ctx->delivered_[pull_row] != 0;
+      if (ctx->found_[row]) {
+        ctx->delivered_[pull_row] = 1;
+      }
+    }
+    if (!all_found) {
+      missing_gids.emplace_back(ctx->global_ids_[i]);
+      missing_gid_indices.emplace_back(ctx->gid_indices_[i]);
+      if (ctx->tier_dsts_ != nullptr) {
+        auto* dsts = ctx->tier_dsts_ + i * num_cols * num_os;
+        missing_dsts.insert(missing_dsts.end(), dsts, dsts + num_cols * num_os);
+      }
+      continue;
+    }
+    // Rows partially found in the tiers above are not promoted.
+    if (promoted == nullptr || any_delivered) {
+      continue;
+    }
+    bool complete = true;
+    for (uint32_t k = 0; k < num_cols * num_os; ++k) {
+      complete &= !ctx->values_[i * num_cols * num_os + k].empty();
+    }
+    if (!complete) {
+      continue;
+    }
+    promoted->global_ids_.emplace_back(ctx->global_ids_[i]);
+    for (uint32_t k = 0; k < num_cols * num_os; ++k) {
+      auto& value = ctx->values_[i * num_cols * num_os + k];
+      promoted->data_.insert(promoted->data_.end(), value.begin(), value.end());
+      promoted->offsets_.emplace_back(promoted->data_.size());
+    }
+  }
+
+  if (promoted != nullptr && !promoted->global_ids_.empty()) {
+    promoted->table_name_ = ctx->table_name_;
+    promoted->col_ids_ = ctx->col_ids_;
+    for (uint32_t k = 0; k < num_os; ++k) {
+      promoted->os_ids_.emplace_back(k);
+    }
+    promoted->offsets_.insert(promoted->offsets_.begin(), 0);
+    ctx->num_pending_.fetch_add(1);
+    PushTiers(0, ctx->tier_, promoted->Param(), [ctx, promoted] {
+      ctx->Finish();
+    });
+  }
+
+  if (missing_gids.empty() || ctx->last_tier()) {
+    ctx->Finish();
+    return;
+  }
+  ++ctx->tier_;
+  ctx->global_ids_ = std::move(missing_gids);
+  ctx->gid_indices_ = std::move(missing_gid_indices);
+  if (ctx->tier_dsts_ != nullptr) {
+    ctx->dsts_ = std::move(missing_dsts);
+    ctx->tier_dsts_ = ctx->dsts_.data();
+  }
+  if (ctx->tier_ == 1 && opt_.write_back_) {
+    PullAfterWriteBacks(ctx);
+    return;
+  }
+  PullTier(ctx);
+}
+
+void TieredIO::PullAfterWriteBacks(PullContext* ctx) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (num_written_back_ != num_write_backs_) {
+      blocked_pulls_.emplace_back(num_write_backs_, ctx);
+      return;
+    }
+  }
+  PullTier(ctx);
+}
+
+struct TieredPushContext {
+  std::atomic<uint32_t> num_pending_;
+  MoveOnlyFunction<void()> on_complete_;
+};
+
+static void OnTierPushComplete(void* ctx) {
+  auto c = reinterpret_cast<TieredPushContext*>(ctx);
+  if (c->num_pending_.fetch_sub(1) == 1) {
+    c->on_complete_();
+    delete c;
+  }
+}
+
+void TieredIO::PushTiers(
+    size_t begin,
+    size_t end,
+    IOPushParameter param,
+    MoveOnlyFunction<void()> on_complete) {
+  if (begin == end) {
+    on_complete();
+    return;
+  }
+  auto* ctx = new TieredPushContext{
+      .num_pending_{static_cast<uint32_t>(end - begin)},
+      .on_complete_ = std::move(on_complete),
+  };
+  param.on_complete_context_ = ctx;
+  param.on_push_complete = OnTierPushComplete;
+  for (size_t i = begin; i < end; ++i) {
+    tiers_[i].provider_.Push(tiers_[i].instance_, param);
+  }
+}
+
+void TieredIO::Push(IOPushParameter param) {
+  if (!opt_.write_back_ || tiers_.size() == 1) {
+    PushTiers(0, tiers_.size(), param, [param] {
+      param.on_push_complete(param.on_complete_context_);
+    });
+    return;
+  }
+  EnqueueWriteBack(std::make_shared<OwnedPush>(param));
+  PushTiers(0, 1, param, [param] {
+    param.on_push_complete(param.on_complete_context_);
+  });
+}
+
+void TieredIO::EnqueueWriteBack(std::shared_ptr<OwnedPush> push) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++num_background_pushes_;
+    ++num_write_backs_;
+    write_backs_.emplace_back(push);
+    // The lower tiers are written in order, the next write-back starts when
+    // the one in flight completes.
+    if (write_backs_.size() != 1) {
+      return;
+    }
+  }
+  StartWriteBack(std::move(push));
+}
+
+void TieredIO::StartWriteBack(std::shared_ptr<OwnedPush> push) {
+  IOPushParameter param = push->Param();
+  PushTiers(1, tiers_.size(), param, [this, push = std::move(push)] {
+    OnBackgroundPushComplete();
+  });
+}
+
+void TieredIO::OnBackgroundPushComplete() {
+  std::shared_ptr<OwnedPush> next;
+  std::vector<PullContext*> unblocked;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    write_backs_.pop_front();
+    if (!write_backs_.empty()) {
+      next = write_backs_.front();
+    }
+    ++num_written_back_;
+    while (!blocked_pulls_.empty() &&
+           blocked_pulls_.front().first <= num_written_back_) {
+      unblocked.emplace_back(blocked_pulls_.front().second);
+      blocked_pulls_.pop_front();
+    }
+    --num_background_pushes_;
+    // Notify under the lock, the destructor can run as soon as it is
+    // released.
+    background_cv_.notify_all();
+  }
+  if (next != nullptr) {
+    StartWriteBack(std::move(next));
+  }
+  for (auto* ctx : unblocked) {
+    PullTier(ctx);
+  }
+}
+
+} // namespace tiered_io
+} // namespace tde::details
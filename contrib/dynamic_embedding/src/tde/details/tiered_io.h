@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "tde/details/io_registry.h"
+#include "tde/details/move_only_function.h"
+
+namespace tde::details {
+
+extern void RegisterTieredIO();
+
+namespace tiered_io {
+
+struct Option {
+ public:
+  // Configs of the tiers, fastest first, e.g., `memory://`.
+  std::vector<std::string> tiers_;
+  // Complete a push once the first tier has it, and write the lower tiers in
+  // the background. Otherwise, a push completes when all the tiers have it.
+  bool write_back_{false};
+  // Push the rows found in a lower tier to the tiers above.
+  bool promote_{true};
+
+  Option() = default;
+
+  /**
+   * Parse `[?opt=val&&opt=val|]tier|tier...`, e.g.,
+   * `?write_back=1|memory://|redis://127.0.0.1:6379/?prefix=model`. The tiers
+   * are separated by `|`, each of which is the config of an IO provider.
+   */
+  static Option Parse(std::string_view config_str) {
+    return Option(config_str);
+  }
+
+ private:
+  Option(std::string_view config_str);
+};
+
+/**
+ * Values pushed to the tiers after the pushing caller returns, with their
+ * own copy of the parameters.
+ */
+struct OwnedPush {
+  std::string table_name_;
+  std::vector<int64_t> global_ids_;
+  std::vector<int64_t> col_ids_;
+  std::vector<uint32_t> os_ids_;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint8_t> data_;
+
+  OwnedPush() = default;
+  /**
+   * Copy the parameters and the pushed values of param.
+   */
+  explicit OwnedPush(const IOPushParameter& param);
+
+  /**
+   * The push parameter of the values, without the completion callback.
+   */
+  [[nodiscard]] IOPushParameter Param() const;
+};
+
+struct PullContext;
+
+/**
+ * A composite IO of several tiers of IO providers, e.g., memory over a local
+ * file over redis, which store the same tables.
+ *
+ * A pull reads the first tier, and the ids missing there are read from the
+ * next tier, and so on. The rows found in a lower tier are promoted, i.e.,
+ * pushed to the tiers above, before the pull completes, so that the next
+ * pull of a hot id hits the first tier, and a push following the pull is
+ * not overwritten by the promotion.
+ *
+ * A push writes all the tiers. With `write_back_`, the lower tiers are
+ * written in the background from a copy of the values, in the order of the
+ * pushes, and the destructor waits for them.
+ *
+ * The upper tiers are bounded by evicting their values, e.g.,
+ * `memory://?cap=8G`, and a memory tier above the last one must have a cap.
+ * As an evicted value may still be in a write-back, a pull missing the first
+ * tier reads the tiers below after the write-backs enqueued before it.
+ */
+class TieredIO {
+ public:
+  explicit TieredIO(const Option& opt);
+
+  ~TieredIO();
+
+  TieredIO(const TieredIO&) = delete;
+  TieredIO& operator=(const TieredIO&) = delete;
+
+  void Pull(IOPullParameterV2 param);
+
+  void Push(IOPushParameter param);
+
+ private:
+  friend struct PullContext;
+
+  struct Tier {
+    IOProvider provider_;
+    void* instance_;
+  };
+
+  /**
+   * Pull the ids of ctx from its current tier.
+   */
+  void PullTier(PullContext* ctx);
+  /**
+   * Called when ctx finishes pulling its current tier. Promote the rows
+   * found, and pull the missing ids from the next tier.
+   */
+  void OnTierFetched(PullContext* ctx);
+  /**
+   * Push param to the tiers [begin, end), and invoke on_complete when all
+   * of them complete.
+   */
+  void PushTiers(
+      size_t begin,
+      size_t end,
+      IOPushParameter param,
+      MoveOnlyFunction<void()> on_complete);
+  /**
+   * Pull ctx from the second tier, after the write-backs enqueued so far.
+   */
+  void PullAfterWriteBacks(PullContext* ctx);
+  void EnqueueWriteBack(std::shared_ptr<OwnedPush> push);
+  void StartWriteBack(std::shared_ptr<OwnedPush> push);
+  void OnBackgroundPushComplete();
+
+  Option opt_;
+  std::vector<Tier> tiers_;
+  std::mutex mu_;
+  std::condition_variable background_cv_;
+  // Number of write-backs not finished.
+  uint32_t num_background_pushes_{0};
+  // The write-backs to the lower tiers. The front one is in flight.
+  std::deque<std::shared_ptr<OwnedPush>> write_backs_;
+  // Number of write-backs enqueued and finished since the construction.
+  uint64_t num_write_backs_{0};
+  uint64_t num_written_back_{0};
+  // The pulls waiting for the write-backs, with the number of write-backs
+  // to finish before each of them.
+  std::deque<std::pair<uint64_t, PullContext*>> blocked_pulls_;
+};
+
+} // namespace tiered_io
+} // namespace tde::details
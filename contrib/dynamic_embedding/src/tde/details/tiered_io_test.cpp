@@ -0,0 +1,217 @@
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "gtest/gtest.h"
+#include "tde/details/io_test_util.h"
+#include "tde/details/tiered_io.h"
+
+namespace tde::details::tiered_io {
+
+/**
+ * Storage of the `tiered_test` IO, which is shared by the instances of the
+ * same name, so that a test can inspect the tiers.
+ */
+struct Store {
+  std::mutex mu_;
+  std::map<int64_t, std::vector<float>> rows_;
+  std::vector<int64_t> pulled_ids_;
+  // Hold the pushes in held_pushes_, until the test runs them.
+  bool hold_pushes_{false};
+  std::vector<std::function<void()>> held_pushes_;
+};
+
+static Store& GetStore(const std::string& name) {
+  static std::map<std::string, Store> stores;
+  return stores[name];
+}
+
+/**
+ * A v1 provider of one optimizer state without columns.
+ */
+static int _r = [] {
+  IORegistry::RegisterAllDefaultIOs();
+  IOProvider provider{};
+  provider.type_ = "tiered_test";
+  provider.Initialize = +[](const char* cfg) -> void* {
+    return &GetStore(cfg);
+  };
+  provider.Finalize = +[](void*) {};
+  provider.Pull = +[](void* inst, IOPullParameter param) {
+    auto& store = *reinterpret_cast<Store*>(inst);
+    for (uint32_t i = 0; i < param.num_global_ids_; ++i) {
+      std::vector<float> row;
+      {
+        std::lock_guard<std::mutex> lock(store.mu_);
+        store.pulled_ids_.emplace_back(param.global_ids_[i]);
+        auto it = store.rows_.find(param.global_ids_[i]);
+        if (it != store.rows_.end()) {
+          row = it->second;
+        }
+      }
+      param.on_global_id_fetched_(
+          param.on_complete_context_,
+          i,
+          0,
+          row.data(),
+          row.size() * sizeof(float));
+    }
+    param.on_all_fetched_(param.on_complete_context_);
+  };
+  provider.Push = +[](void* inst, IOPushParameter param) {
+    auto& store = *reinterpret_cast<Store*>(inst);
+    auto push = [&store, param] {
+      {
+        std::lock_guard<std::mutex> lock(store.mu_);
+        auto* data = reinterpret_cast<const uint8_t*>(param.data_);
+        for (uint32_t i = 0; i < param.num_global_ids_; ++i) {
+          auto* begin = data + param.offsets_[i];
+          auto* end = data + param.offsets_[i + 1];
+          store.rows_[param.global_ids_[i]].assign(
+              reinterpret_cast<const float*>(begin),
+              reinterpret_cast<const float*>(end));
+        }
+      }
+      param.on_push_complete(param.on_complete_context_);
+    };
+    {
+      std::lock_guard<std::mutex> lock(store.mu_);
+      if (store.hold_pushes_) {
+        store.held_pushes_.emplace_back(std::move(push));
+        return;
+      }
+    }
+    push();
+  };
+  IORegistry::Instance().Register(provider);
+  return 0;
+}();
+
+TEST(TDE, tiered_io_Option) {
+  auto opt = Option::Parse(
+      "?write_back=1&&promote=0|memory://?cap=1G|memory://?chunk_size=8");
+  ASSERT_EQ(
+      opt.tiers_,
+      std::vector<std::string>(
+          {"memory://?cap=1G", "memory://?chunk_size=8"}));
+  ASSERT_TRUE(opt.write_back_);
+  ASSERT_FALSE(opt.promote_);
+
+  opt = Option::Parse("memory://");
+  ASSERT_EQ(opt.tiers_.size(), 1);
+  ASSERT_FALSE(opt.write_back_);
+  ASSERT_TRUE(opt.promote_);
+
+  ASSERT_ANY_THROW(Option::Parse("?write_back=1"));
+  ASSERT_ANY_THROW(Option::Parse("?no_opt=1|memory://"));
+  ASSERT_ANY_THROW(Option::Parse("memory"));
+  // A memory tier above the last one must be bounded.
+  ASSERT_ANY_THROW(Option::Parse("memory://|memory://"));
+}
+
+TEST(TDE, tiered_io_read_through) {
+  GetStore("rt_b").rows_ = {{1, {1, -1}}, {2, {2, -2}}, {3, {0, 0}}};
+  GetStore("rt_a").rows_ = {{3, {3, -3}}};
+  TieredIO io(Option::Parse("tiered_test://rt_a|tiered_test://rt_b"));
+  auto result = PullRows(io, {1, 2, 3, 4});
+  ASSERT_EQ(result->Value(0), std::vector<float>({1, -1}));
+  ASSERT_EQ(result->Value(1), std::vector<float>({2, -2}));
+  // The first tier has the latest value.
+  ASSERT_EQ(result->Value(2), std::vector<float>({3, -3}));
+  ASSERT_EQ(result->present_[3], k_row_missing);
+  // Every row is delivered once.
+  ASSERT_EQ(result->num_deliveries_, std::vector<int>({1, 1, 1, 1}));
+  ASSERT_EQ(GetStore("rt_b").pulled_ids_, std::vector<int64_t>({1, 2, 4}));
+
+  // The rows found in the second tier are promoted.
+  ASSERT_EQ(GetStore("rt_a").rows_.size(), 3);
+  ASSERT_EQ(GetStore("rt_a").rows_[2], std::vector<float>({2, -2}));
+  GetStore("rt_b").pulled_ids_.clear();
+  result = PullRows(io, {1, 2});
+  ASSERT_EQ(result->Value(1), std::vector<float>({2, -2}));
+  ASSERT_TRUE(GetStore("rt_b").pulled_ids_.empty());
+}
+
+TEST(TDE, tiered_io_write_through) {
+  TieredIO io(Option::Parse("tiered_test://wt_a|tiered_test://wt_b"));
+  PushRows(io, {1, 2}, {0}, {1, -1, 2, -2});
+  for (auto name : {"wt_a", "wt_b"}) {
+    ASSERT_EQ(GetStore(name).rows_.size(), 2);
+    ASSERT_EQ(GetStore(name).rows_[2], std::vector<float>({2, -2}));
+  }
+}
+
+TEST(TDE, tiered_io_write_back) {
+  {
+    TieredIO io(Option::Parse(
+        "?write_back=1|tiered_test://wb_a|memory://?cap=1M|"
+        "tiered_test://wb_b"));
+    std::vector<float> data{1, -1, 2, -2};
+    PushRows(io, {1, 2}, {0}, data);
+    // The pushed data can be freed once the push completes.
+    data.assign(data.size(), 0);
+    ASSERT_EQ(GetStore("wb_a").rows_.size(), 2);
+    PushRows(io, {2}, {0}, {3, -3});
+  }
+  // The destructor waits for the write-backs, which are in order.
+  ASSERT_EQ(GetStore("wb_b").rows_.size(), 2);
+  ASSERT_EQ(GetStore("wb_b").rows_[1], std::vector<float>({1, -1}));
+  ASSERT_EQ(GetStore("wb_b").rows_[2], std::vector<float>({3, -3}));
+}
+
+TEST(TDE, tiered_io_evicted) {
+  auto& store = GetStore("ev_b");
+  store.hold_pushes_ = true;
+  TieredIO io(Option::Parse(
+      "?write_back=1|memory://?num_shards=1&&cap=8|tiered_test://ev_b"));
+  // 1 is evicted from the first tier by 2, before it is written back.
+  PushRows(io, {1}, {0}, {1, -1});
+  PushRows(io, {2}, {0}, {2, -2});
+  std::unique_ptr<PullResult> result;
+  std::thread puller([&] { result = PullRows(io, {1}); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::vector<std::function<void()>> held;
+  {
+    std::lock_guard<std::mutex> lock(store.mu_);
+    // The second tier is not read before the write-backs.
+    EXPECT_TRUE(store.pulled_ids_.empty());
+    store.hold_pushes_ = false;
+    held.swap(store.held_pushes_);
+  }
+  for (auto& push : held) {
+    push();
+  }
+  puller.join();
+  ASSERT_EQ(result->Value(0), std::vector<float>({1, -1}));
+}
+
+TEST(TDE, tiered_io_optimizer_states) {
+  // The first tier holds 3 values of 2 floats.
+  TieredIO io(Option::Parse("memory://?num_shards=1&&cap=24|memory://"));
+  PushRows(io, {1}, {1, 0}, {1, 1, 1, 0});
+  // 1 is dropped from the first tier with both of its optimizer states.
+  PushRows(io, {2, 3}, {0}, {2, 0, 3, 0});
+  auto result = PullRows(io, {1}, 2);
+  ASSERT_EQ(result->num_deliveries_, std::vector<int>({1, 1}));
+  ASSERT_EQ(result->Value(0, 0), std::vector<float>({1, 0}));
+  ASSERT_EQ(result->Value(0, 1), std::vector<float>({1, 1}));
+}
+
+TEST(TDE, tiered_io_pull_into) {
+  TieredIO io(Option::Parse("tiered_test://pi_a|memory://"));
+  PushRows(io, {1, 2}, {0}, {1, -1, 2, -2});
+  GetStore("pi_a").rows_.clear();
+
+  // memory:// writes the rows into the destinations, which are promoted.
+  std::vector<float> dsts(4, 0);
+  auto result = PullRows(io, {2, 3}, 1, &dsts);
+  ASSERT_EQ(
+      result->present_,
+      std::vector<uint8_t>({k_row_in_destination, k_row_missing}));
+  ASSERT_EQ(dsts, std::vector<float>({2, -2, 0, 0}));
+  ASSERT_EQ(GetStore("pi_a").rows_.size(), 1);
+  ASSERT_EQ(GetStore("pi_a").rows_[2], std::vector<float>({2, -2}));
+}
+
+} // namespace tde::details::tiered_io
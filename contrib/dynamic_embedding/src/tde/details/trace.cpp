@@ -0,0 +1,181 @@
+#include "tde/details/trace.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+static uint64_t SteadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static uint64_t Padded(uint64_t size) {
+  return (size + 7) / 8 * 8;
+}
+
+static void Append(std::vector<uint8_t>& buf, const void* data, size_t size) {
+  auto* ptr = reinterpret_cast<const uint8_t*>(data);
+  buf.insert(buf.end(), ptr, ptr + size);
+  buf.resize(Padded(buf.size()));
+}
+
+std::shared_ptr<TraceWriter> TraceWriter::Open(const std::string& path) {
+  static std::mutex mu;
+  static std::unordered_map<std::string, std::weak_ptr<TraceWriter>> writers;
+  std::lock_guard<std::mutex> lock(mu);
+  auto& writer = writers[path];
+  auto ptr = writer.lock();
+  if (ptr == nullptr) {
+    ptr = std::make_shared<TraceWriter>(path);
+    writer = ptr;
+  }
+  return ptr;
+}
+
+TraceWriter::TraceWriter(const std::string& path)
+    : fd_(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+      open_time_ns_(SteadyNowNs()) {
+  TORCH_CHECK(fd_ >= 0, "cannot open ", path, ", errno ", errno);
+  TraceFileHeader header{
+      .magic_ = k_trace_magic,
+      .version_ = k_trace_version,
+  };
+  WriteAll(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+}
+
+TraceWriter::~TraceWriter() {
+  close(fd_);
+}
+
+uint64_t TraceWriter::NowUs() const {
+  return (SteadyNowNs() - open_time_ns_) / 1000;
+}
+
+void TraceWriter::WriteAll(const uint8_t* data, size_t size) {
+  while (size != 0) {
+    ssize_t n = write(fd_, data, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    TORCH_CHECK(n > 0, "cannot write trace, errno ", errno);
+    data += n;
+    size -= n;
+  }
+}
+
+void TraceWriter::Write(const TraceRecord& record) {
+  TraceRecordHeader header{
+      .kind_ = record.kind_,
+      .table_name_len_ = static_cast<uint32_t>(record.table_name_.size()),
+      .num_cols_ = static_cast<uint32_t>(record.col_ids_.size()),
+      .num_global_ids_ = static_cast<uint32_t>(record.global_ids_.size()),
+      .num_optimizer_stats_ = record.num_optimizer_stats_,
+      .num_values_ = static_cast<uint32_t>(record.value_sizes_.size()),
+      .start_us_ = record.start_us_,
+      .latency_us_ = record.latency_us_,
+      .num_bytes_ = record.num_bytes_,
+  };
+  std::vector<uint8_t> buf;
+  Append(buf, &header, sizeof(header));
+  Append(buf, record.table_name_.data(), record.table_name_.size());
+  Append(buf, record.col_ids_.data(), record.col_ids_.size() * 8);
+  Append(buf, record.global_ids_.data(), record.global_ids_.size() * 8);
+  if (record.kind_ == k_trace_push) {
+    Append(buf, record.os_ids_.data(), record.os_ids_.size() * 4);
+    Append(buf, record.value_sizes_.data(), record.value_sizes_.size() * 4);
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  WriteAll(buf.data(), buf.size());
+}
+
+std::vector<TraceRecord> ReadTrace(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  TORCH_CHECK(fd >= 0, "cannot open ", path, ", errno ", errno);
+  std::vector<uint8_t> content;
+  uint8_t buf[64 * 1024];
+  while (true) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(fd);
+      TORCH_CHECK(n == 0, "cannot read ", path, ", errno ", errno);
+      break;
+    }
+    content.insert(content.end(), buf, buf + n);
+  }
+
+  TraceFileHeader file_header{};
+  TORCH_CHECK(content.size() >= sizeof(file_header), "bad trace ", path);
+  memcpy(&file_header, content.data(), sizeof(file_header));
+  TORCH_CHECK(
+      file_header.magic_ == k_trace_magic &&
+          file_header.version_ == k_trace_version,
+      path,
+      " is not a trace of version ",
+      k_trace_version);
+
+  std::vector<TraceRecord> records;
+  uint64_t pos = sizeof(file_header);
+  // Copy the next part of size bytes to dst.
+  auto take = [&](void* dst, uint64_t size) {
+    if (size != 0) {
+      memcpy(dst, content.data() + pos, size);
+    }
+    pos += Padded(size);
+  };
+  // The last record is dropped if it is truncated, e.g., the recording
+  // process is killed.
+  while (pos + sizeof(TraceRecordHeader) <= content.size()) {
+    TraceRecordHeader header{};
+    memcpy(&header, content.data() + pos, sizeof(header));
+    TORCH_CHECK(
+        header.kind_ == k_trace_pull || header.kind_ == k_trace_push,
+        "bad trace ",
+        path);
+    uint64_t num_cols = header.num_cols_;
+    uint64_t num_global_ids = header.num_global_ids_;
+    uint64_t num_os = header.num_optimizer_stats_;
+    uint64_t num_values = header.num_values_;
+    uint64_t record_size = sizeof(header) + Padded(header.table_name_len_) +
+        num_cols * 8 + num_global_ids * 8;
+    if (header.kind_ == k_trace_push) {
+      record_size += Padded(num_os * 4) + Padded(num_values * 4);
+    }
+    if (pos + record_size > content.size()) {
+      break;
+    }
+    pos += sizeof(header);
+
+    TraceRecord record{
+        .kind_ = header.kind_,
+        .table_name_ = std::string(header.table_name_len_, '\0'),
+        .col_ids_ = std::vector<int64_t>(header.num_cols_),
+        .global_ids_ = std::vector<int64_t>(header.num_global_ids_),
+        .num_optimizer_stats_ = header.num_optimizer_stats_,
+        .start_us_ = header.start_us_,
+        .latency_us_ = header.latency_us_,
+        .num_bytes_ = header.num_bytes_,
+    };
+    take(record.table_name_.data(), header.table_name_len_);
+    take(record.col_ids_.data(), num_cols * 8);
+    take(record.global_ids_.data(), num_global_ids * 8);
+    if (header.kind_ == k_trace_push) {
+      record.os_ids_.resize(header.num_optimizer_stats_);
+      record.value_sizes_.resize(header.num_values_);
+      take(record.os_ids_.data(), num_os * 4);
+      take(record.value_sizes_.data(), num_values * 4);
+    }
+    records.emplace_back(std::move(record));
+  }
+  return records;
+}
+
+} // namespace tde::details
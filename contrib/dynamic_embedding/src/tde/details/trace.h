@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tde::details {
+
+static constexpr uint64_t k_trace_magic = 0x45434152545f4544; // "DE_TRACE"
+static constexpr uint32_t k_trace_version = 1;
+
+static constexpr uint32_t k_trace_pull = 0;
+static constexpr uint32_t k_trace_push = 1;
+
+struct TraceFileHeader {
+  uint64_t magic_;
+  uint32_t version_;
+  uint32_t reserved_;
+};
+
+/**
+ * The header of a request in a trace, followed by the table name, the col
+ * ids, the global ids, and for a push, the optimizer state ids and the size
+ * of each value. Each part is padded to 8 bytes.
+ */
+struct TraceRecordHeader {
+  uint32_t kind_;
+  uint32_t table_name_len_;
+  uint32_t num_cols_;
+  uint32_t num_global_ids_;
+  uint32_t num_optimizer_stats_;
+  // Number of value sizes, 0 for a pull.
+  uint32_t num_values_;
+  // When the request is issued, in microseconds since the trace is opened.
+  uint64_t start_us_;
+  uint64_t latency_us_;
+  // Bytes pulled or pushed.
+  uint64_t num_bytes_;
+};
+
+/**
+ * A pull or a push of an IO, without the values.
+ */
+struct TraceRecord {
+  uint32_t kind_{k_trace_pull};
+  std::string table_name_;
+  std::vector<int64_t> col_ids_;
+  std::vector<int64_t> global_ids_;
+  uint32_t num_optimizer_stats_{0};
+  // For a push, the optimizer state ids, and the sizes in bytes of the
+  // values in the order of the push.
+  std::vector<uint32_t> os_ids_;
+  std::vector<uint32_t> value_sizes_;
+  uint64_t start_us_{0};
+  uint64_t latency_us_{0};
+  uint64_t num_bytes_{0};
+};
+
+/**
+ * Appends records to a trace file. Thread safe.
+ *
+ * The writers of the same path are shared, see `Open`, so that the IOs of
+ * all the tables of a process record to one trace with one clock.
+ */
+class TraceWriter {
+ public:
+  /**
+   * @return the writer of path, created, truncating the file, if there is
+   * no writer of path alive.
+   */
+  static std::shared_ptr<TraceWriter> Open(const std::string& path);
+
+  explicit TraceWriter(const std::string& path);
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  /**
+   * Microseconds since the trace is opened.
+   */
+  [[nodiscard]] uint64_t NowUs() const;
+
+  void Write(const TraceRecord& record);
+
+ private:
+  void WriteAll(const uint8_t* data, size_t size);
+
+  int fd_;
+  uint64_t open_time_ns_;
+  std::mutex mu_;
+};
+
+/**
+ * Read the records of a trace, in the order they are written, i.e., the
+ * order the requests complete. A truncated record at the end is dropped.
+ */
+std::vector<TraceRecord> ReadTrace(const std::string& path);
+
+} // namespace tde::details
@@ -0,0 +1,202 @@
+#include "tde/details/trace_replay.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include "tde/details/histogram.h"
+#include "tde/details/io_registry.h"
+
+namespace tde::details {
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t ElapsedUs(Clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             Clock::now() - since)
+      .count();
+}
+
+namespace {
+
+struct ReplayState {
+  std::mutex mu_;
+  std::condition_variable cv_;
+  uint32_t num_in_flight_{0};
+  std::atomic<uint64_t> pulled_bytes_{0};
+  Histogram pull_latency_us_;
+  Histogram push_latency_us_;
+
+  void Finish() {
+    std::lock_guard<std::mutex> lock(mu_);
+    --num_in_flight_;
+    // Notify under the lock, the state can be destroyed as soon as it is
+    // released.
+    cv_.notify_all();
+  }
+};
+
+struct ReplayRequest {
+  ReplayState* state_;
+  Clock::time_point start_;
+  std::vector<uint64_t> offsets_;
+};
+
+} // namespace
+
+static void OnReplayChunkFetched(void* ctx, const IOPullChunk* chunk) {
+  auto* request = reinterpret_cast<ReplayRequest*>(ctx);
+  request->state_->pulled_bytes_.fetch_add(
+      chunk->offsets_[chunk->num_rows_] - chunk->offsets_[0],
+      std::memory_order_relaxed);
+}
+
+static void OnReplayAllFetched(void* ctx) {
+  std::unique_ptr<ReplayRequest> request(reinterpret_cast<ReplayRequest*>(ctx));
+  request->state_->pull_latency_us_.Record(ElapsedUs(request->start_));
+  request->state_->Finish();
+}
+
+static void OnReplayPushComplete(void* ctx) {
+  std::unique_ptr<ReplayRequest> request(reinterpret_cast<ReplayRequest*>(ctx));
+  request->state_->push_latency_us_.Record(ElapsedUs(request->start_));
+  request->state_->Finish();
+}
+
+c10::Dict<std::string, double> Replay(
+    const std::vector<TraceRecord>& records,
+    const std::string& io_config,
+    const ReplayOption& opt) {
+  TORCH_CHECK(opt.max_in_flight_ != 0, "max_in_flight must not be zero");
+  static constexpr std::string_view k_schema_separator = "://";
+  auto pos = io_config.find(k_schema_separator);
+  TORCH_CHECK(
+      pos != std::string::npos,
+      "config should be schema://cfg_string, got ",
+      io_config);
+  IOProvider provider =
+      IORegistry::Instance().Resolve(io_config.substr(0, pos));
+  std::string rest_cfg = io_config.substr(pos + k_schema_separator.size());
+  std::unique_ptr<void, void (*)(void*)> instance(
+      provider.Initialize(rest_cfg.c_str()), provider.Finalize);
+
+  // The records are written when the requests complete.
+  std::vector<uint32_t> order(records.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return records[a].start_us_ < records[b].start_us_;
+  });
+
+  // The pushed values, shared by all the pushes.
+  uint64_t max_push_bytes = 0;
+  for (auto& record : records) {
+    if (record.kind_ == k_trace_push) {
+      max_push_bytes = std::max(max_push_bytes, record.num_bytes_);
+    }
+  }
+  std::vector<uint8_t> zeros(max_push_bytes);
+
+  ReplayState state;
+  Histogram recorded_pull_latency_us;
+  Histogram recorded_push_latency_us;
+  uint64_t num_pulls = 0, num_pushes = 0;
+  uint64_t pulled_rows = 0, pushed_rows = 0, pushed_bytes = 0;
+  uint64_t first_start_us = records.empty() ? 0 : records[order[0]].start_us_;
+  auto begin = Clock::now();
+  for (auto i : order) {
+    auto& record = records[i];
+    if (opt.recorded_pace_) {
+      std::this_thread::sleep_until(
+          begin +
+          std::chrono::microseconds(record.start_us_ - first_start_us));
+    }
+    {
+      std::unique_lock<std::mutex> lock(state.mu_);
+      state.cv_.wait(
+          lock, [&] { return state.num_in_flight_ < opt.max_in_flight_; });
+      ++state.num_in_flight_;
+    }
+
+    auto* request = new ReplayRequest{
+        .state_ = &state,
+        .start_ = Clock::now(),
+    };
+    if (record.kind_ == k_trace_pull) {
+      ++num_pulls;
+      pulled_rows += record.global_ids_.size();
+      recorded_pull_latency_us.Record(record.latency_us_);
+      PullChunked(
+          provider,
+          instance.get(),
+          IOPullParameterV2{
+              .table_name_ = record.table_name_.c_str(),
+              .num_cols_ = static_cast<uint32_t>(record.col_ids_.size()),
+              .num_global_ids_ =
+                  static_cast<uint32_t>(record.global_ids_.size()),
+              .col_ids_ = record.col_ids_.data(),
+              .global_ids_ = record.global_ids_.data(),
+              .num_optimizer_stats_ = record.num_optimizer_stats_,
+              .on_complete_context_ = request,
+              .on_chunk_fetched_ = OnReplayChunkFetched,
+              .on_all_fetched_ = OnReplayAllFetched,
+              .dsts_ = nullptr,
+          });
+      continue;
+    }
+
+    ++num_pushes;
+    pushed_rows += record.global_ids_.size();
+    pushed_bytes += record.num_bytes_;
+    recorded_push_latency_us.Record(record.latency_us_);
+    auto& offsets = request->offsets_;
+    offsets.reserve(record.value_sizes_.size() + 1);
+    offsets.emplace_back(0);
+    for (auto size : record.value_sizes_) {
+      offsets.emplace_back(offsets.back() + size);
+    }
+    provider.Push(
+        instance.get(),
+        IOPushParameter{
+            .table_name_ = record.table_name_.c_str(),
+            .num_cols_ = static_cast<uint32_t>(record.col_ids_.size()),
+            .num_global_ids_ = static_cast<uint32_t>(record.global_ids_.size()),
+            .col_ids_ = record.col_ids_.data(),
+            .global_ids_ = record.global_ids_.data(),
+            .num_optimizer_stats_ = record.num_optimizer_stats_,
+            .optimizer_stats_ids_ = record.os_ids_.data(),
+            .num_offsets_ = static_cast<uint32_t>(offsets.size()),
+            .offsets_ = offsets.data(),
+            .data_ = zeros.data(),
+            .on_complete_context_ = request,
+            .on_push_complete = OnReplayPushComplete,
+        });
+  }
+  {
+    std::unique_lock<std::mutex> lock(state.mu_);
+    state.cv_.wait(lock, [&] { return state.num_in_flight_ == 0; });
+  }
+  double duration_s = ElapsedUs(begin) / 1e6;
+
+  c10::Dict<std::string, double> result;
+  uint64_t pulled_bytes = state.pulled_bytes_.load();
+  result.insert("num_pulls", num_pulls);
+  result.insert("num_pushes", num_pushes);
+  result.insert("pulled_rows", pulled_rows);
+  result.insert("pushed_rows", pushed_rows);
+  result.insert("pulled_bytes", pulled_bytes);
+  result.insert("pushed_bytes", pushed_bytes);
+  result.insert("duration_s", duration_s);
+  // Avoid dividing by zero for empty traces.
+  double duration = std::max(duration_s, 1e-9);
+  result.insert("requests_per_s", (num_pulls + num_pushes) / duration);
+  result.insert("rows_per_s", (pulled_rows + pushed_rows) / duration);
+  result.insert("bytes_per_s", (pulled_bytes + pushed_bytes) / duration);
+  state.pull_latency_us_.Export("pull_latency_us", result);
+  state.push_latency_us_.Export("push_latency_us", result);
+  recorded_pull_latency_us.Export("recorded_pull_latency_us", result);
+  recorded_push_latency_us.Export("recorded_push_latency_us", result);
+  return result;
+}
+
+} // namespace tde::details
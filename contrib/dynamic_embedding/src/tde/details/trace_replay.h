@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "tde/details/trace.h"
+#include "torch/torch.h"
+
+namespace tde::details {
+
+struct ReplayOption {
+  // Issue the requests at the pace they are recorded, otherwise as fast as
+  // possible.
+  bool recorded_pace_{true};
+  // Max number of requests in flight, which delays the requests when the IO
+  // is slower than the recorded one.
+  uint32_t max_in_flight_{64};
+};
+
+/**
+ * Replay the requests of a trace against the IO of io_config, e.g.,
+ * `redis://127.0.0.1:6379/?chunk_size=256`, in the order they are issued.
+ * Pushes write zeros of the recorded value sizes, and pulls do not have
+ * destinations.
+ *
+ * @return metrics of the replay:
+ *  - num_pulls, num_pushes, pulled_rows, pushed_rows, pulled_bytes,
+ *    pushed_bytes, duration_s;
+ *  - requests_per_s, rows_per_s and bytes_per_s, over the duration;
+ *  - pull_latency_us.* and push_latency_us.*, see `Histogram::Export`;
+ *  - recorded_pull_latency_us.* and recorded_push_latency_us.*, the
+ *    latencies in the trace, for comparison.
+ */
+c10::Dict<std::string, double> Replay(
+    const std::vector<TraceRecord>& records,
+    const std::string& io_config,
+    const ReplayOption& opt);
+
+} // namespace tde::details
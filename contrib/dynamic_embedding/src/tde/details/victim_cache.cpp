@@ -0,0 +1,84 @@
+#include "tde/details/victim_cache.h"
+#include <cstring>
+#include "torch/torch.h"
+
+namespace tde::details {
+
+VictimCache::VictimCache(uint32_t capacity, uint32_t row_size)
+    : capacity_(capacity),
+      row_size_(row_size),
+      data_(static_cast<size_t>(capacity) * row_size),
+      slot_global_ids_(capacity),
+      slot_versions_(capacity),
+      free_slots_(capacity) {
+  for (uint32_t i = 0; i < capacity; ++i) {
+    free_slots_[i] = capacity - i - 1;
+  }
+}
+
+bool VictimCache::Take(int64_t global_id, float* row) {
+  auto it = slots_.find(global_id);
+  if (it == slots_.end()) {
+    return false;
+  }
+  uint32_t slot = it->second;
+  memcpy(
+      row,
+      data_.data() + static_cast<size_t>(slot) * row_size_,
+      row_size_ * sizeof(float));
+  slots_.erase(it);
+  Release(slot);
+  return true;
+}
+
+void VictimCache::Erase(int64_t global_id) {
+  auto it = slots_.find(global_id);
+  if (it == slots_.end()) {
+    return;
+  }
+  uint32_t slot = it->second;
+  slots_.erase(it);
+  Release(slot);
+}
+
+float* VictimCache::Insert(int64_t global_id) {
+  TORCH_CHECK(!free_slots_.empty(), "victim cache is full");
+  uint32_t slot = free_slots_.back();
+  auto [_, inserted] = slots_.emplace(global_id, slot);
+  TORCH_CHECK(inserted, "global id ", global_id, " is in victim cache");
+  free_slots_.pop_back();
+  slot_global_ids_[slot] = global_id;
+  order_.emplace_back(slot, slot_versions_[slot]);
+  return data_.data() + static_cast<size_t>(slot) * row_size_;
+}
+
+int64_t VictimCache::PopOldest(float* row) {
+  TORCH_CHECK(!slots_.empty(), "victim cache is empty");
+  while (true) {
+    auto [slot, version] = order_.front();
+    order_.pop_front();
+    if (slot_versions_[slot] != version) {
+      continue;
+    }
+    int64_t global_id = slot_global_ids_[slot];
+    Take(global_id, row);
+    return global_id;
+  }
+}
+
+void VictimCache::Release(uint32_t slot) {
+  ++slot_versions_[slot];
+  free_slots_.emplace_back(slot);
+  // Drop the stale entries if they dominate.
+  if (order_.size() > 2 * static_cast<size_t>(capacity_)) {
+    std::deque<std::pair<uint32_t, uint64_t>> order;
+    for (auto& entry : order_) {
+      if (slot_versions_[entry.first] == entry.second) {
+        order.emplace_back(entry);
+      }
+    }
+    order_ = std::move(order);
+  }
+}
+
+} // namespace tde::details
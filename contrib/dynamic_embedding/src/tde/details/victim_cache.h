@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "c10/util/flat_hash_map.h"
+
+namespace tde::details {
+
+/**
+ * A bounded buffer of evicted rows in host memory.
+ *
+ * Each row holds all optimizer states of a global id. Rows leave the cache
+ * either by `Take`, when the id is fetched again, or by `PopOldest`, in the
+ * order they are inserted.
+ */
+class VictimCache {
+ public:
+  /**
+   * @param capacity max number of rows.
+   * @param row_size number of floats in a row.
+   */
+  VictimCache(uint32_t capacity, uint32_t row_size);
+
+  [[nodiscard]] uint32_t capacity() const {
+    return capacity_;
+  }
+
+  [[nodiscard]] size_t size() const {
+    return slots_.size();
+  }
+
+  /**
+   * Copy the row of global_id to `row` and remove it.
+   * @return false if the row is not in the cache.
+   */
+  bool Take(int64_t global_id, float* row);
+
+  void Erase(int64_t global_id);
+
+  /**
+   * Insert a row for global_id, which must not be in the cache. The cache
+   * must not be full.
+   * @return where to write the row.
+   */
+  float* Insert(int64_t global_id);
+
+  /**
+   * Copy the oldest row to `row` and remove it. The cache must not be empty.
+   * @return the global id of the row.
+   */
+  int64_t PopOldest(float* row);
+
+ private:
+  void Release(uint32_t slot);
+
+  uint32_t capacity_;
+  uint32_t row_size_;
+  std::vector<float> data_;
+  std::vector<int64_t> slot_global_ids_;
+  // Bumped when a slot is released, so that the stale entries of order_ can
+  // be told.
+  std::vector<uint64_t> slot_versions_;
+  std::vector<uint32_t> free_slots_;
+  ska::flat_hash_map<int64_t, uint32_t> slots_;
+  // (slot, version) in insertion order.
+  std::deque<std::pair<uint32_t, uint64_t>> order_;
+};
+
+} // namespace tde::details
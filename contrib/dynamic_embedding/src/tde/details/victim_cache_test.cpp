@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "tde/details/victim_cache.h"
+
+namespace tde::details {
+
+TEST(TDE, victim_cache) {
+  VictimCache cache(3, 2);
+  for (int64_t i = 0; i < 3; ++i) {
+    float* row = cache.Insert(i);
+    row[0] = i;
+    row[1] = -i;
+  }
+  ASSERT_EQ(cache.size(), 3);
+  ASSERT_ANY_THROW(cache.Insert(3));
+
+  float row[2];
+  ASSERT_TRUE(cache.Take(1, row));
+  ASSERT_EQ(row[0], 1);
+  ASSERT_EQ(row[1], -1);
+  ASSERT_FALSE(cache.Take(1, row));
+  ASSERT_EQ(cache.size(), 2);
+
+  cache.Insert(1)[0] = 10;
+  // 0 is the oldest, 1 is inserted again after 2.
+  ASSERT_EQ(cache.PopOldest(row), 0);
+  ASSERT_EQ(row[0], 0);
+  ASSERT_EQ(cache.PopOldest(row), 2);
+  ASSERT_EQ(cache.PopOldest(row), 1);
+  ASSERT_EQ(row[0], 10);
+  ASSERT_EQ(cache.size(), 0);
+  ASSERT_ANY_THROW(cache.PopOldest(row));
+}
+
+TEST(TDE, victim_cache_churn) {
+  VictimCache cache(4, 1);
+  // Insert and take repeatedly, which leaves many stale entries in order.
+  cache.Insert(-1)[0] = -1;
+  for (int64_t i = 0; i < 1000; ++i) {
+    cache.Insert(i)[0] = i;
+    float row;
+    ASSERT_TRUE(cache.Take(i, &row));
+    ASSERT_EQ(row, i);
+  }
+  cache.Erase(-1);
+  ASSERT_EQ(cache.size(), 0);
+  cache.Insert(7)[0] = 7;
+  float row;
+  ASSERT_EQ(cache.PopOldest(&row), 7);
+}
+
+} // namespace tde::details
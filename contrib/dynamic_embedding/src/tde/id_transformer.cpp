@@ -1,22 +1,32 @@
 #include "tde/id_transformer.h"
+#include <algorithm>
+#include <cmath>
 #include "tde/details/move_only_function.h"
 namespace tde {
 
 IDTransformer::IDTransformer(int64_t num_embedding, nlohmann::json json)
-    : transformer_(num_embedding, std::move(json)),
+    : pin_(json.value("pin", false)),
+      evict_headroom_(json.value("evict_headroom", 0.125)),
+      transformer_(num_embedding, std::move(json)),
       time_(-1),
       last_save_time_(-1) {}
 
 c10::intrusive_ptr<TransformResult> IDTransformer::Transform(
     c10::intrusive_ptr<TensorList> global_id_list,
     c10::intrusive_ptr<TensorList> cache_id_list,
-    int64_t time) {
+    int64_t time,
+    int64_t offset) {
   std::lock_guard<std::mutex> lock(mu_);
   torch::NoGradGuard no_grad;
   TORCH_CHECK(time >= 0);
   TORCH_CHECK(time >= time_, "Time cannot go backward");
+  TORCH_CHECK(offset >= 0);
   time_ = time;
   TORCH_CHECK(global_id_list->size() == cache_id_list->size());
+  if (!pin_) {
+    // A batch given up after a failure.
+    ReleaseLocked(time - 1);
+  }
   transformer_.strategy_.UpdateTime(static_cast<uint32_t>(time));
   {
     int64_t total_num_embeddings = std::accumulate(
@@ -38,24 +48,64 @@ c10::intrusive_ptr<TransformResult> IDTransformer::Transform(
 
   std::atomic<int64_t> next_fetch_offset{0};
   bool ok = true;
+  // The offset of the current tensor over all the ids.
+  int64_t begin = 0;
+  int64_t num_transformed = offset;
   for (int64_t i = 0; i < global_id_list->size(); ++i) {
     auto& global_ids = (*global_id_list)[i];
     auto& cache_ids = (*cache_id_list)[i];
-    ok = transformer_.Transform(
+    int64_t numel = global_ids.numel();
+    if (begin + numel <= offset) {
+      begin += numel;
+      continue;
+    }
+    int64_t start = std::max<int64_t>(offset - begin, 0);
+    int64_t n = transformer_.Transform(
         tcb::span{
-            global_ids.data_ptr<int64_t>(),
-            static_cast<size_t>(global_ids.numel())},
+            global_ids.data_ptr<int64_t>() + start,
+            static_cast<size_t>(numel - start)},
         tcb::span{
-            cache_ids.data_ptr<int64_t>(),
-            static_cast<size_t>(cache_ids.numel())},
+            cache_ids.data_ptr<int64_t>() + start,
+            static_cast<size_t>(numel - start)},
         [&](int64_t global_id, int64_t cache_id) {
-          int64_t offset = next_fetch_offset.fetch_add(1);
-          ids_to_fetch_[2 * offset] = global_id;
-          ids_to_fetch_[2 * offset + 1] = cache_id;
+          int64_t fetch_offset = next_fetch_offset.fetch_add(1);
+          ids_to_fetch_[2 * fetch_offset] = global_id;
+          ids_to_fetch_[2 * fetch_offset + 1] = cache_id;
         });
+    num_transformed = begin + start + n;
+    ok = start + n == numel;
     if (!ok) {
       break;
     }
+    begin += numel;
+  }
+
+  // Keep the ids transformed from eviction until the batch is done.
+  if (pin_ || !ok) {
+    PinLocked(*cache_id_list, offset, num_transformed, time);
+  }
+  if (!pin_ && ok) {
+    ReleaseLocked(time);
+  }
+
+  int64_t num_to_evict = 0;
+  if (!ok) {
+    // The distinct ids from the first one that does not fit on, which are not
+    // in the transformer.
+    ska::flat_hash_set<int64_t> missing;
+    begin = 0;
+    for (auto& global_ids : *global_id_list) {
+      int64_t numel = global_ids.numel();
+      auto* ids = global_ids.data_ptr<int64_t>();
+      for (int64_t j = std::max<int64_t>(num_transformed - begin, 0); j < numel;
+           ++j) {
+        if (!transformer_.Contains(ids[j])) {
+          missing.emplace(ids[j]);
+        }
+      }
+      begin += numel;
+    }
+    num_to_evict = static_cast<int64_t>(missing.size());
   }
 
   return c10::make_intrusive<TransformResult>(
@@ -63,7 +113,69 @@ c10::intrusive_ptr<TransformResult> IDTransformer::Transform(
       at::from_blob(
           ids_to_fetch_.data(),
           {next_fetch_offset.load(), 2},
-          torch::TensorOptions().dtype(c10::kLong).device(c10::kCPU)));
+          torch::TensorOptions().dtype(c10::kLong).device(c10::kCPU)),
+      num_transformed,
+      num_to_evict);
+}
+
+void IDTransformer::PinLocked(
+    const TensorList& cache_ids,
+    int64_t begin,
+    int64_t end,
+    int64_t time) {
+  if (begin == end) {
+    return;
+  }
+  if (pinned_batches_.empty() || pinned_batches_.back().first != time) {
+    pinned_batches_.emplace_back(time, std::vector<int64_t>());
+  }
+  auto& pinned = pinned_batches_.back().second;
+  // The offset of the current tensor over all the ids.
+  int64_t offset = 0;
+  for (auto& tensor : cache_ids) {
+    int64_t numel = tensor.numel();
+    int64_t first = std::max(begin - offset, int64_t(0));
+    int64_t last = std::min(end - offset, numel);
+    if (first < last) {
+      auto* ids = tensor.data_ptr<int64_t>();
+      pinned.insert(pinned.end(), ids + first, ids + last);
+      transformer_.Pin({ids + first, static_cast<size_t>(last - first)});
+    }
+    offset += numel;
+  }
+}
+
+c10::intrusive_ptr<TransformResult> IDTransformer::Preload(
+    torch::Tensor global_ids,
+    torch::Tensor freq_powers,
+    int64_t time) {
+  std::lock_guard<std::mutex> lock(mu_);
+  torch::NoGradGuard no_grad;
+  TORCH_CHECK(time >= 0);
+  TORCH_CHECK(time >= time_, "Time cannot go backward");
+  time_ = time;
+  transformer_.strategy_.UpdateTime(static_cast<uint32_t>(time));
+  global_ids = global_ids.to(torch::kLong).contiguous();
+  freq_powers = freq_powers.to(torch::kLong).contiguous();
+  std::vector<int64_t> cache_ids(global_ids.numel());
+  std::vector<int64_t> ids_to_fetch;
+  int64_t num_preloaded = transformer_.Preload(
+      tcb::span{
+          global_ids.data_ptr<int64_t>(),
+          static_cast<size_t>(global_ids.numel())},
+      tcb::span{
+          freq_powers.data_ptr<int64_t>(),
+          static_cast<size_t>(freq_powers.numel())},
+      cache_ids,
+      [&](int64_t global_id, int64_t cache_id) {
+        ids_to_fetch.emplace_back(global_id);
+        ids_to_fetch.emplace_back(cache_id);
+      });
+  int64_t num_ids_to_fetch = ids_to_fetch.size() / 2;
+  return c10::make_intrusive<TransformResult>(
+      num_preloaded == global_ids.numel(),
+      torch::tensor(ids_to_fetch, torch::dtype(torch::kLong))
+          .reshape({num_ids_to_fetch, 2}));
 }
 
 torch::Tensor IDTransformer::Evict(int64_t num_to_evict) {
@@ -75,6 +187,12 @@ torch::Tensor IDTransformer::Evict(int64_t num_to_evict) {
       .reshape({num_ids_to_evict, 2});
 }
 
+torch::Tensor IDTransformer::EvictAtLeast(int64_t num_to_evict) {
+  auto headroom = static_cast<int64_t>(
+      std::ceil(static_cast<double>(num_to_evict) * evict_headroom_));
+  return Evict(num_to_evict + headroom);
+}
+
 torch::Tensor IDTransformer::Save() {
   std::lock_guard<std::mutex> lock(mu_);
   torch::NoGradGuard no_grad;
@@ -84,4 +202,24 @@ torch::Tensor IDTransformer::Save() {
   return torch::tensor(ids, torch::dtype(torch::kLong)).reshape({num_ids, 2});
 }
 
+void IDTransformer::Release(int64_t time) {
+  std::lock_guard<std::mutex> lock(mu_);
+  ReleaseLocked(time);
+}
+
+void IDTransformer::ReleaseLocked(int64_t time) {
+  while (!pinned_batches_.empty() && pinned_batches_.front().first <= time) {
+    transformer_.Unpin(pinned_batches_.front().second);
+    pinned_batches_.pop_front();
+  }
+}
+
+torch::Tensor IDTransformer::Ranked(int64_t num) {
+  std::lock_guard<std::mutex> lock(mu_);
+  torch::NoGradGuard no_grad;
+  std::vector<int64_t> ids = transformer_.Ranked(num);
+  int64_t num_ids = ids.size() / 2;
+  return torch::tensor(ids, torch::dtype(torch::kLong)).reshape({num_ids, 2});
+}
+
 } // namespace tde
@@ -1,35 +1,112 @@
 #pragma once
 #include <torch/custom_class.h>
 #include <torch/torch.h>
+#include <deque>
+#include <utility>
 #include "tde/details/id_transformer_variant.h"
 #include "tde/tensor_list.h"
 
 namespace tde {
 
 struct TransformResult : public torch::CustomClassHolder {
-  TransformResult(bool success, torch::Tensor ids_to_fetch)
-      : success_(success), ids_to_fetch_(ids_to_fetch) {}
+  TransformResult(
+      bool success,
+      torch::Tensor ids_to_fetch,
+      int64_t num_transformed = 0,
+      int64_t num_to_evict = 0)
+      : success_(success),
+        ids_to_fetch_(ids_to_fetch),
+        num_transformed_(num_transformed),
+        num_to_evict_(num_to_evict) {}
   bool success_;
   torch::Tensor ids_to_fetch_;
+  // The offset over all the ids to resume from, and the number of free cache
+  // ids the rest of the ids still need, when not successful.
+  int64_t num_transformed_;
+  int64_t num_to_evict_;
 };
 
+/**
+ * The json config has the `lxu_strategy` and the `id_transformer` configs,
+ * see `details::IDTransformer`, and optionally `pin`. If `pin` is true, the
+ * cache ids of every batch are pinned by `Transform` until the batch is
+ * released, so that the evictions for the batches transformed ahead do not
+ * take the cache ids of the batches in flight.
+ *
+ * `evict_headroom` is the ratio of the extra ids evicted by `EvictAtLeast`,
+ * 0.125 by default.
+ */
 class IDTransformer : public torch::CustomClassHolder {
  public:
   IDTransformer(int64_t num_embeddings, nlohmann::json json);
+
+  /**
+   * Transform the ids from offset on, counted over all the tensors of
+   * global_ids. If the transformer is full, the result has the offset to
+   * resume from after `EvictAtLeast` of its num_to_evict. The ids transformed
+   * before the offset are pinned until the batch is transformed, or released
+   * if `pin` is set.
+   */
   c10::intrusive_ptr<TransformResult> Transform(
       c10::intrusive_ptr<TensorList> global_ids,
       c10::intrusive_ptr<TensorList> cache_ids,
+      int64_t time,
+      int64_t offset);
+
+  /**
+   * Insert global ids ranked by hotness before training, e.g., the ids of
+   * `Ranked` of a previous run. freq_powers is empty, or the frequency power
+   * of each id. The ids after the first one that does not fit are skipped,
+   * and the result is not successful.
+   *
+   * @return the ids to fetch, as `Transform`.
+   */
+  c10::intrusive_ptr<TransformResult> Preload(
+      torch::Tensor global_ids,
+      torch::Tensor freq_powers,
       int64_t time);
 
+  /**
+   * Evict num_to_evict ids, or fewer if some are pinned.
+   */
   torch::Tensor Evict(int64_t num_to_evict);
+
+  /**
+   * Evict num_to_evict ids and a headroom of `evict_headroom` of it, so that
+   * the next batches do not fail right away.
+   */
+  torch::Tensor EvictAtLeast(int64_t num_to_evict);
   torch::Tensor Save();
 
+  /**
+   * Unpin the cache ids of the batches transformed at or before time.
+   */
+  void Release(int64_t time);
+
+  /**
+   * The num hottest ids as rows of (global id, frequency power), all the ids
+   * if num is negative.
+   */
+  torch::Tensor Ranked(int64_t num);
+
  private:
+  void PinLocked(
+      const TensorList& cache_ids,
+      int64_t begin,
+      int64_t end,
+      int64_t time);
+  void ReleaseLocked(int64_t time);
+
   std::mutex mu_;
+  // Read before the config is moved to transformer_.
+  bool pin_;
+  double evict_headroom_;
   details::IDTransformer transformer_;
   std::vector<int64_t> ids_to_fetch_;
   int64_t time_;
   int64_t last_save_time_;
+  // (time, cache ids) of the batches not released, in the order of time.
+  std::deque<std::pair<int64_t, std::vector<int64_t>>> pinned_batches_;
 };
 
 } // namespace tde
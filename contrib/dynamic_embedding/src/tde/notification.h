@@ -1,20 +1,37 @@
 #pragma once
 #include <torch/torch.h>
+#include <exception>
 #include "tde/details/notification.h"
 
 namespace tde {
 
 class Notification : public torch::CustomClassHolder {
  public:
-  void Done() {
+  /**
+   * @param error the exception of the work, rethrown by `Wait`.
+   */
+  void Done(std::exception_ptr error = nullptr) {
+    error_ = std::move(error);
     return notification_.Done();
   }
   void Wait() {
+    notification_.Wait();
+    if (error_ != nullptr) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+  /**
+   * Wait without rethrowing the exception of the work.
+   */
+  void WaitDone() {
     return notification_.Wait();
   }
 
  private:
   details::Notification notification_;
+  // Written before Done, read after Wait.
+  std::exception_ptr error_;
 };
 
 } // namespace tde
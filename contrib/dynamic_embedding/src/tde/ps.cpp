@@ -1,8 +1,43 @@
 #include "tde/ps.h"
+#include <numeric>
 #include "tde/details/io.h"
+#include "tde/details/thread_pool.h"
 
 namespace tde {
 
+static constexpr uint32_t k_num_completion_threads = 4;
+
+/**
+ * The global id of the row holding the size of the negative filter. The
+ * pages of the filter are the rows of global id 0, 1, ...
+ */
+static constexpr int64_t k_negative_filter_header_id = -1;
+
+static std::string NegativeFilterTable(const std::string& table_name) {
+  return table_name + ".__seen_ids__";
+}
+
+/**
+ * The pool to run the work triggered by IO completions, so that the IO
+ * threads are not blocked.
+ */
+static details::ThreadPool& CompletionPool() {
+  static details::ThreadPool pool(k_num_completion_threads);
+  return pool;
+}
+
+PS::~PS() {
+  // The IO callbacks refer to this PS. Wait for them before destroying. The
+  // errors of the fetches never waited are dropped, as a destructor must not
+  // throw.
+  for (auto& fetch : fetch_notifications_) {
+    fetch.notification_->WaitDone();
+  }
+  for (auto& job : inflight_evicts_) {
+    job->Wait();
+  }
+}
+
 c10::intrusive_ptr<FetchHandle> PS::Fetch(
     torch::Tensor ids_to_fetch,
     int64_t time,
@@ -10,48 +45,133 @@ c10::intrusive_ptr<FetchHandle> PS::Fetch(
     double weight_init_min,
     double weight_init_max) {
   std::lock_guard<std::mutex> lock(mu_);
+  return DoFetch(
+      ids_to_fetch, time, reinit, weight_init_min, weight_init_max, nullptr);
+}
+
+c10::intrusive_ptr<PreloadHandle> PS::Preload(
+    torch::Tensor ids_to_fetch,
+    int64_t time,
+    bool reinit,
+    double weight_init_min,
+    double weight_init_max) {
+  std::lock_guard<std::mutex> lock(mu_);
+  TORCH_CHECK(ids_to_fetch.dim() == 2);
+  ids_to_fetch = ids_to_fetch.contiguous();
+  int64_t num_ids = ids_to_fetch.size(0);
+  auto preload = c10::make_intrusive<PreloadHandle>(num_ids);
+  // The pending fetches are waited in the order of their steps.
+  TORCH_CHECK(
+      fetch_notifications_.empty() || fetch_notifications_.back().time_ <= time,
+      "preload at step ",
+      time,
+      " after fetches of step ",
+      fetch_notifications_.back().time_);
+  for (int64_t begin = 0; begin < num_ids; begin += num_ids_per_chunk_) {
+    int64_t end = std::min(begin + num_ids_per_chunk_, num_ids);
+    DoFetch(
+        ids_to_fetch.slice(0, begin, end),
+        time,
+        reinit,
+        weight_init_min,
+        weight_init_max,
+        preload);
+  }
+  return preload;
+}
+
+c10::intrusive_ptr<FetchHandle> PS::DoFetch(
+    const torch::Tensor& ids_to_fetch,
+    int64_t time,
+    bool reinit,
+    double weight_init_min,
+    double weight_init_max,
+    c10::intrusive_ptr<PreloadHandle> preload) {
   torch::NoGradGuard no_grad;
   TORCH_CHECK(ids_to_fetch.dim() == 2);
-  std::vector<int64_t> col_ids{0};
   Filter(ids_to_fetch);
+  FetchFromVictimCache();
+  FetchFromEvictHazards();
+  FetchFromNegativeFilter(reinit, weight_init_min, weight_init_max);
+  if (preload) {
+    // The ids not in the local shards, or not pulled, are done.
+    preload->Add(ids_to_fetch.size(0) - cache_ids_to_fetch_or_evict_.size());
+  }
   if (cache_ids_to_fetch_or_evict_.empty()) {
     return c10::make_intrusive<FetchHandle>(time, c10::intrusive_ptr<PS>());
   }
-  fetch_notifications_.emplace_back(time, c10::make_intrusive<Notification>());
+  // The fetches of the steps after the earliest pending one are prefetches.
+  auto priority = fetch_notifications_.empty() ||
+          fetch_notifications_.front().time_ == time
+      ? details::IOPriority::kFetch
+      : details::IOPriority::kPrefetch;
+  fetch_notifications_.emplace_back(PendingFetch{
+      .time_ = time,
+      .notification_ = c10::make_intrusive<Notification>(),
+      .cache_ids_ = cache_ids_to_fetch_or_evict_,
+  });
   c10::intrusive_ptr<Notification> notification =
-      fetch_notifications_.back().second;
-  uint32_t num_os_ids = os_ids_.size();
-  io_.Pull(
-      table_name_,
-      global_ids_to_fetch_or_evict_,
-      col_ids,
-      num_os_ids,
-      torch::kF32,
+      fetch_notifications_.back().notification_;
+  // Rows of shards in host memory are fetched in place, other rows are
+  // fetched into a buffer and scattered.
+  std::vector<details::IOPullDestination> dsts;
+  bool in_place = GetDestinations(cache_ids_to_fetch_or_evict_, dsts);
+  auto on_fetched =
       [=, this, cache_ids_to_fetch = std::move(cache_ids_to_fetch_or_evict_)](
-          auto&& val) {
-        TORCH_CHECK(val.size() == cache_ids_to_fetch.size());
-        for (uint32_t i = 0; i < cache_ids_to_fetch.size(); ++i) {
-          int64_t cache_id = cache_ids_to_fetch[i];
-          auto& fetched = val[i];
-          if (!fetched.defined()) {
-            if (reinit) {
-              std::vector<torch::Tensor> tensors = GetTensorViews(cache_id);
-              tensors[0].uniform_(weight_init_min, weight_init_max);
-              // optimizer states will be set to zero
-              for (uint32_t j = 1; j < num_os_ids; ++j) {
-                tensors[j].zero_();
+          details::BatchedPullResult fetched) mutable {
+        // Do not block the IO thread by the scatter, which may copy the rows
+        // to GPU.
+        CompletionPool().Enqueue(
+            [=,
+             this,
+             cache_ids_to_fetch = std::move(cache_ids_to_fetch),
+             fetched = std::move(fetched)] {
+              // An exception would terminate the pool thread, so it is
+              // rethrown by the wait of the fetch instead, e.g., an OOM when
+              // copying the rows to GPU.
+              std::exception_ptr error;
+              try {
+                torch::NoGradGuard no_grad;
+                ScatterFetched(
+                    cache_ids_to_fetch,
+                    fetched,
+                    reinit,
+                    weight_init_min,
+                    weight_init_max);
+              } catch (...) {
+                error = std::current_exception();
               }
-            }
-            continue;
-          }
-
-          std::vector<torch::Tensor> tensors = GetTensorViews(cache_id);
-          for (uint32_t j = 0; j < num_os_ids; ++j) {
-            tensors[j].copy_(fetched.slice(0, j, j + 1));
-          }
-        }
-        notification->Done();
-      });
+              if (preload) {
+                if (error != nullptr) {
+                  preload->Fail(error);
+                } else {
+                  preload->Add(cache_ids_to_fetch.size());
+                }
+              }
+              notification->Done(std::move(error));
+            });
+      };
+  if (in_place) {
+    io_.PullInto(
+        table_name_,
+        global_ids_to_fetch_or_evict_,
+        col_ids_,
+        os_ids_.size(),
+        torch::kF32,
+        std::move(dsts),
+        std::move(on_fetched),
+        priority);
+  } else {
+    io_.PullBatched(
+        table_name_,
+        global_ids_to_fetch_or_evict_,
+        col_ids_,
+        os_ids_.size(),
+        torch::kF32,
+        col_size_,
+        std::move(on_fetched),
+        priority);
+  }
   // `unsafe_reclain_from_nonowning` is the `instrusive_ptr` version of
   // `enable_shared_from_this`
   return c10::make_intrusive<FetchHandle>(
@@ -59,6 +179,7 @@ c10::intrusive_ptr<FetchHandle> PS::Fetch(
 }
 
 void PS::Filter(const torch::Tensor& tensor) {
+  details::ScopedLatency latency(filter_us_);
   cache_ids_to_fetch_or_evict_.clear();
   global_ids_to_fetch_or_evict_.clear();
   TORCH_CHECK(tensor.is_contiguous());
@@ -75,80 +196,686 @@ void PS::Filter(const torch::Tensor& tensor) {
   }
 }
 
+void PS::FetchFromEvictHazards() {
+  ReapEvictJobs();
+  if (evict_hazards_.empty()) {
+    return;
+  }
+  uint32_t num_os_ids = os_ids_.size();
+  size_t num_to_fetch = 0;
+  for (size_t i = 0; i < global_ids_to_fetch_or_evict_.size(); ++i) {
+    int64_t global_id = global_ids_to_fetch_or_evict_[i];
+    int64_t cache_id = cache_ids_to_fetch_or_evict_[i];
+    auto it = evict_hazards_.find(global_id);
+    if (it == evict_hazards_.end()) {
+      global_ids_to_fetch_or_evict_[num_to_fetch] = global_id;
+      cache_ids_to_fetch_or_evict_[num_to_fetch] = cache_id;
+      ++num_to_fetch;
+      continue;
+    }
+    // The staged row is newer than the one in the parameter server.
+    auto [job, row] = it->second;
+    std::vector<torch::Tensor> tensors = GetTensorViews(cache_id);
+    for (uint32_t j = 0; j < num_os_ids; ++j) {
+      float* staged = job->data_.data() + (row * num_os_ids + j) * col_size_;
+      tensors[j].copy_(torch::from_blob(staged, {1, col_size_}, torch::kF32));
+    }
+  }
+  global_ids_to_fetch_or_evict_.resize(num_to_fetch);
+  cache_ids_to_fetch_or_evict_.resize(num_to_fetch);
+}
+
+void PS::FetchFromNegativeFilter(
+    bool reinit,
+    double weight_init_min,
+    double weight_init_max) {
+  if (negative_filter_ == nullptr) {
+    return;
+  }
+  std::vector<int64_t> absent_cache_ids;
+  size_t num_to_fetch = 0;
+  for (size_t i = 0; i < global_ids_to_fetch_or_evict_.size(); ++i) {
+    int64_t global_id = global_ids_to_fetch_or_evict_[i];
+    int64_t cache_id = cache_ids_to_fetch_or_evict_[i];
+    if (!negative_filter_->MayContain(global_id)) {
+      absent_cache_ids.emplace_back(cache_id);
+      continue;
+    }
+    global_ids_to_fetch_or_evict_[num_to_fetch] = global_id;
+    cache_ids_to_fetch_or_evict_[num_to_fetch] = cache_id;
+    ++num_to_fetch;
+  }
+  global_ids_to_fetch_or_evict_.resize(num_to_fetch);
+  cache_ids_to_fetch_or_evict_.resize(num_to_fetch);
+  if (absent_cache_ids.empty()) {
+    return;
+  }
+
+  auto num_absent = static_cast<int64_t>(absent_cache_ids.size());
+  num_negative_filter_skips_ += num_absent;
+  details::BatchedPullResult absent{
+      .found_ = torch::zeros({num_absent}, torch::kBool),
+  };
+  ScatterFetched(
+      absent_cache_ids, absent, reinit, weight_init_min, weight_init_max);
+}
+
+bool PS::LoadNegativeFilter(bool new_table) {
+  auto pull = [this](std::vector<int64_t> global_ids, int64_t row_size) {
+    details::Notification notification;
+    details::BatchedPullResult loaded;
+    io_.PullBatched(
+        NegativeFilterTable(table_name_),
+        global_ids,
+        col_ids_,
+        1,
+        torch::kLong,
+        row_size,
+        [&](details::BatchedPullResult result) {
+          loaded = std::move(result);
+          notification.Done();
+        });
+    notification.Wait();
+    return loaded;
+  };
+  uint32_t num_pages = negative_filter_->num_pages();
+  uint32_t page_words = negative_filter_->page_words();
+  std::vector<int64_t> page_ids(num_pages);
+  std::iota(page_ids.begin(), page_ids.end(), 0);
+  auto header = pull({k_negative_filter_header_id}, 1);
+  auto loaded = pull(std::move(page_ids), page_words);
+
+  const bool* found = loaded.found_.data_ptr<bool>();
+  if (!header.found_.data_ptr<bool>()[0]) {
+    TORCH_CHECK(
+        std::find(found, found + num_pages, true) == found + num_pages,
+        "the negative filter of ",
+        table_name_,
+        " has pages but no header");
+    if (!new_table) {
+      return false;
+    }
+    details::Notification notification;
+    PushNegativeFilter([&notification] { notification.Done(); });
+    notification.Wait();
+    return true;
+  }
+  int64_t num_blocks = header.rows_.data_ptr<int64_t>()[0];
+  TORCH_CHECK(
+      num_blocks == static_cast<int64_t>(negative_filter_->num_blocks()),
+      "the negative filter of ",
+      table_name_,
+      " is stored with ",
+      num_blocks,
+      " blocks, but negative_filter_ids gives ",
+      negative_filter_->num_blocks());
+  negative_filter_header_pushed_ = true;
+  const int64_t* rows = loaded.rows_.data_ptr<int64_t>();
+  for (uint32_t i = 0; i < num_pages; ++i) {
+    if (found[i]) {
+      negative_filter_->MergePage(
+          i, reinterpret_cast<const uint64_t*>(rows + i * page_words));
+    }
+  }
+  return true;
+}
+
+void PS::PushNegativeFilter(details::MoveOnlyFunction<void()> on_pushed) {
+  std::lock_guard<std::mutex> lock(negative_filter_mu_);
+  negative_filter_waiters_.emplace_back(std::move(on_pushed));
+  if (!negative_filter_pushing_) {
+    negative_filter_pushing_ = true;
+    StartNegativeFilterPush();
+  }
+}
+
+void PS::StartNegativeFilterPush() {
+  // The header is pushed with the first push, so that it exists as soon as
+  // any page does. A new table pushes it alone.
+  struct Pages {
+    std::vector<int64_t> global_ids_;
+    std::vector<uint64_t> words_;
+    std::vector<uint64_t> offsets_{0};
+    uint32_t os_id_{0};
+    std::vector<details::MoveOnlyFunction<void()>> on_pushed_;
+  };
+  auto pages = std::make_shared<Pages>();
+  pages->on_pushed_.swap(negative_filter_waiters_);
+  auto add_row = [&pages](int64_t global_id, tcb::span<const uint64_t> row) {
+    pages->global_ids_.emplace_back(global_id);
+    pages->words_.insert(pages->words_.end(), row.begin(), row.end());
+    pages->offsets_.emplace_back(pages->words_.size() * sizeof(uint64_t));
+  };
+  if (!negative_filter_header_pushed_) {
+    uint64_t num_blocks = negative_filter_->num_blocks();
+    add_row(k_negative_filter_header_id, {&num_blocks, 1});
+    negative_filter_header_pushed_ = true;
+  }
+  for (uint32_t page : negative_filter_->TakeDirtyPages()) {
+    add_row(page, negative_filter_->Page(page));
+  }
+  io_.Push(
+      NegativeFilterTable(table_name_),
+      pages->global_ids_,
+      col_ids_,
+      {&pages->os_id_, 1},
+      {reinterpret_cast<const uint8_t*>(pages->words_.data()),
+       pages->words_.size() * sizeof(uint64_t)},
+      pages->offsets_,
+      [this, pages] {
+        CompletionPool().Enqueue([this, pages] {
+          {
+            // The pages changed during this push go with the next one.
+            std::lock_guard<std::mutex> lock(negative_filter_mu_);
+            if (negative_filter_waiters_.empty()) {
+              negative_filter_pushing_ = false;
+            } else {
+              StartNegativeFilterPush();
+            }
+          }
+          // The callbacks may finish the last job keeping this PS alive, so
+          // nothing is touched after them.
+          for (auto& on_pushed : pages->on_pushed_) {
+            on_pushed();
+          }
+        });
+      });
+}
+
+void PS::FetchFromVictimCache() {
+  if (victim_cache_.size() == 0) {
+    return;
+  }
+  int64_t row_size = static_cast<int64_t>(os_ids_.size()) * col_size_;
+  std::vector<int64_t> hit_cache_ids;
+  std::vector<float> hit_rows;
+  size_t num_to_fetch = 0;
+  for (size_t i = 0; i < global_ids_to_fetch_or_evict_.size(); ++i) {
+    int64_t global_id = global_ids_to_fetch_or_evict_[i];
+    int64_t cache_id = cache_ids_to_fetch_or_evict_[i];
+    hit_rows.resize((hit_cache_ids.size() + 1) * row_size);
+    if (victim_cache_.Take(
+            global_id, hit_rows.data() + hit_cache_ids.size() * row_size)) {
+      hit_cache_ids.emplace_back(cache_id);
+      continue;
+    }
+    global_ids_to_fetch_or_evict_[num_to_fetch] = global_id;
+    cache_ids_to_fetch_or_evict_[num_to_fetch] = cache_id;
+    ++num_to_fetch;
+  }
+  global_ids_to_fetch_or_evict_.resize(num_to_fetch);
+  cache_ids_to_fetch_or_evict_.resize(num_to_fetch);
+  if (hit_cache_ids.empty()) {
+    return;
+  }
+
+  auto num_hits = static_cast<int64_t>(hit_cache_ids.size());
+  details::BatchedPullResult hits{
+      .rows_ = torch::from_blob(
+                   hit_rows.data(),
+                   {num_hits, static_cast<int64_t>(os_ids_.size()), col_size_},
+                   torch::kF32)
+                   .permute({1, 0, 2}),
+      .found_ = torch::ones({num_hits}, torch::kBool),
+  };
+  ScatterFetched(hit_cache_ids, hits, false, 0, 0);
+}
+
 void PS::Evict(torch::Tensor ids_to_evict) {
   std::lock_guard<std::mutex> lock(mu_);
+  details::ScopedLatency latency(evict_us_);
   torch::NoGradGuard no_grad;
   TORCH_CHECK(ids_to_evict.dim() == 2);
-  // make sure all previous fetches are done.
-  SyncFetch();
+  Filter(ids_to_evict);
+  if (!global_ids_to_fetch_or_evict_.empty()) {
+    // make sure the fetches writing to the evicting rows are done.
+    SyncFetchOverlapped(cache_ids_to_fetch_or_evict_);
+    auto job = std::make_shared<EvictJob>();
+    job->global_ids_ = global_ids_to_fetch_or_evict_;
+    job->data_.resize(
+        job->global_ids_.size() * os_ids_.size() * col_size_);
+    StageRows(cache_ids_to_fetch_or_evict_, job->data_.data());
+    StartEvictJob(std::move(job));
+  }
+  // The rows in the victim cache are not in the parameter server yet.
+  FlushVictimCache();
+  for (auto& job : inflight_evicts_) {
+    job->Wait();
+  }
+  ReapEvictJobs();
+}
 
-  std::vector<int64_t> col_ids{0};
-  // remove this copy!
+c10::intrusive_ptr<EvictHandle> PS::EvictAsync(torch::Tensor ids_to_evict) {
+  std::lock_guard<std::mutex> lock(mu_);
+  details::ScopedLatency latency(evict_us_);
+  torch::NoGradGuard no_grad;
+  TORCH_CHECK(ids_to_evict.dim() == 2);
   Filter(ids_to_evict);
   if (global_ids_to_fetch_or_evict_.empty()) {
+    return c10::make_intrusive<EvictHandle>(nullptr);
+  }
+  // make sure the fetches writing to the evicting rows are done.
+  SyncFetchOverlapped(cache_ids_to_fetch_or_evict_);
+  if (victim_cache_.capacity() != 0) {
+    return EvictToVictimCache();
+  }
+  auto job = std::make_shared<EvictJob>();
+  job->global_ids_ = global_ids_to_fetch_or_evict_;
+  job->data_.resize(job->global_ids_.size() * os_ids_.size() * col_size_);
+  StageRows(cache_ids_to_fetch_or_evict_, job->data_.data());
+  return StartEvictJob(std::move(job));
+}
+
+c10::intrusive_ptr<EvictHandle> PS::EvictToVictimCache() {
+  size_t row_size = os_ids_.size() * col_size_;
+  size_t num_ids = global_ids_to_fetch_or_evict_.size();
+  // The ids beyond the capacity are written back directly.
+  size_t num_direct =
+      num_ids - std::min<size_t>(num_ids, victim_cache_.capacity());
+  size_t num_cached = num_ids - num_direct;
+  // The rows of the ids evicted again are stale.
+  for (size_t i = num_direct; i < num_ids; ++i) {
+    victim_cache_.Erase(global_ids_to_fetch_or_evict_[i]);
+  }
+  size_t num_popped =
+      victim_cache_.size() + num_cached > victim_cache_.capacity()
+      ? victim_cache_.size() + num_cached - victim_cache_.capacity()
+      : 0;
+
+  auto job = std::make_shared<EvictJob>();
+  job->data_.resize((num_popped + num_direct) * row_size);
+  for (size_t i = 0; i < num_popped; ++i) {
+    job->global_ids_.emplace_back(
+        victim_cache_.PopOldest(job->data_.data() + i * row_size));
+  }
+  job->global_ids_.insert(
+      job->global_ids_.end(),
+      global_ids_to_fetch_or_evict_.begin(),
+      global_ids_to_fetch_or_evict_.begin() + num_direct);
+  StageRows(
+      {cache_ids_to_fetch_or_evict_.data(), num_direct},
+      job->data_.data() + num_popped * row_size);
+
+  std::vector<float> staged(num_cached * row_size);
+  StageRows(
+      {cache_ids_to_fetch_or_evict_.data() + num_direct, num_cached},
+      staged.data());
+  for (size_t i = 0; i < num_cached; ++i) {
+    memcpy(
+        victim_cache_.Insert(global_ids_to_fetch_or_evict_[num_direct + i]),
+        staged.data() + i * row_size,
+        row_size * sizeof(float));
+  }
+
+  if (job->global_ids_.empty()) {
+    return c10::make_intrusive<EvictHandle>(nullptr);
+  }
+  return StartEvictJob(std::move(job));
+}
+
+void PS::FlushVictimCache() {
+  if (victim_cache_.size() == 0) {
     return;
   }
+  size_t row_size = os_ids_.size() * col_size_;
+  auto job = std::make_shared<EvictJob>();
+  job->data_.resize(victim_cache_.size() * row_size);
+  for (size_t i = 0; victim_cache_.size() != 0; ++i) {
+    job->global_ids_.emplace_back(
+        victim_cache_.PopOldest(job->data_.data() + i * row_size));
+  }
+  StartEvictJob(std::move(job));
+}
+
+c10::intrusive_ptr<EvictHandle> PS::StartEvictJob(
+    std::shared_ptr<EvictJob> job) {
+  ReapEvictJobs();
+  // The IO does not keep the order of pushes. If an id is evicted again
+  // while its last eviction is in flight, wait for the last one.
+  for (int64_t global_id : job->global_ids_) {
+    if (auto it = evict_hazards_.find(global_id); it != evict_hazards_.end()) {
+      it->second.first->Wait();
+    }
+  }
+
+  uint32_t num_os_ids = os_ids_.size();
+  uint32_t num_ids_to_evict = job->global_ids_.size();
+  uint64_t row_bytes = details::EncodedRowSize(encoding_, col_size_);
+  if (encoding_ != details::RowEncoding::kFP32) {
+    int64_t num_values = static_cast<int64_t>(num_ids_to_evict) * num_os_ids;
+    job->encoded_.resize(num_values * row_bytes);
+    at::parallel_for(0, num_values, 1024, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        details::EncodeRow(
+            encoding_,
+            job->data_.data() + i * col_size_,
+            col_size_,
+            job->encoded_.data() + i * row_bytes);
+      }
+    });
+  }
+  job->offsets_.resize(num_ids_to_evict * num_os_ids + 1);
+  for (size_t i = 0; i < job->offsets_.size(); ++i) {
+    job->offsets_[i] = i * row_bytes;
+  }
 
+  for (uint32_t i = 0; i < num_ids_to_evict; ++i) {
+    evict_hazards_[job->global_ids_[i]] = {job.get(), i};
+  }
+  inflight_evicts_.emplace_back(job);
+  auto handle = c10::make_intrusive<EvictHandle>(job);
+  if (negative_filter_ == nullptr) {
+    PushEvictChunks(std::move(job));
+    return handle;
+  }
+  {
+    std::lock_guard<std::mutex> lock(negative_filter_mu_);
+    for (int64_t global_id : job->global_ids_) {
+      negative_filter_->Insert(global_id);
+    }
+  }
+  // The filter is pushed before the rows, so that a PS restarting from the
+  // stored filter never takes a stored row as new.
+  PushNegativeFilter(
+      [this, job = std::move(job)] { PushEvictChunks(job); });
+  return handle;
+}
+
+void PS::PushEvictChunks(std::shared_ptr<EvictJob> job) {
+  uint32_t begin;
+  uint32_t num_ids_in_chunk;
+  for (int64_t i = 0; i < evict_depth_; ++i) {
+    if (!NextEvictChunk(*job, begin, num_ids_in_chunk)) {
+      break;
+    }
+    PushEvictChunk(job, begin, num_ids_in_chunk);
+  }
+}
+
+void PS::StageRows(tcb::span<const int64_t> cache_ids, float* data) {
+  details::ScopedLatency latency(stage_us_);
   uint32_t num_os_ids = os_ids_.size();
-  uint32_t num_ids_to_fetch = global_ids_to_fetch_or_evict_.size();
-
-  details::Notification notification;
-  // Done first so that the Wait after preparing the first chunk won't stuck.
-  notification.Done();
-  // The shared data for all chunks.
-  std::vector<uint64_t> offsets;
-  offsets.reserve(num_ids_per_chunk_ * num_os_ids * col_ids.size() + 1);
-  std::vector<float> data(
-      num_ids_per_chunk_ * num_os_ids * col_ids.size() * col_size_);
-
-  for (uint32_t i = 0; i < num_ids_to_fetch; i += num_ids_per_chunk_) {
-    uint32_t num_ids_in_chunk = std::min(
-        static_cast<uint32_t>(num_ids_per_chunk_), num_ids_to_fetch - i);
-    uint32_t data_size = num_ids_in_chunk * num_os_ids * col_ids.size();
-    uint32_t offsets_size = num_ids_in_chunk * num_os_ids * col_ids.size() + 1;
-
-    offsets.clear();
-    offsets.emplace_back(0);
-    for (uint32_t j = i; j < i + num_ids_in_chunk; ++j) {
-      int64_t cache_id = cache_ids_to_fetch_or_evict_[j];
-      std::vector<torch::Tensor> tensors = GetTensorViews(cache_id);
-      for (uint32_t k : os_ids_) {
-        // this cause 2 copy. is this avoidable?
-        torch::Tensor tensor = tensors[k].cpu();
-        // need to change this when considering col
-        memcpy(
-            reinterpret_cast<uint8_t*>(data.data()) + offsets.back(),
-            tensor.data_ptr<float>(),
-            tensor.numel() * tensor.element_size());
-        offsets.emplace_back(
-            offsets.back() + tensor.numel() * tensor.element_size());
+  auto num_rows = static_cast<int64_t>(cache_ids.size());
+  auto long_opt = torch::TensorOptions().dtype(torch::kLong);
+  torch::Tensor staged = torch::from_blob(
+      data,
+      {num_rows, static_cast<int64_t>(num_os_ids), col_size_},
+      torch::kF32);
+  std::vector<int64_t> src_rows;
+  std::vector<int64_t> dst_rows;
+  for (auto& shard : *shards_) {
+    src_rows.clear();
+    dst_rows.clear();
+    for (int64_t i = 0; i < num_rows; ++i) {
+      if (shard.Has(cache_ids[i])) {
+        src_rows.emplace_back(cache_ids[i] - shard.row_start_);
+        dst_rows.emplace_back(i);
       }
     }
-    // waiting for the Push of last chunk finishes.
-    notification.Wait();
-    notification.Clear();
-    io_.Push(
-        table_name_,
-        tcb::span{global_ids_to_fetch_or_evict_.data() + i, num_ids_in_chunk},
-        col_ids,
-        os_ids_,
-        tcb::span{
-            reinterpret_cast<uint8_t*>(data.data()), data_size * sizeof(float)},
-        tcb::span{offsets.data(), offsets_size},
-        [&notification] { notification.Done(); });
+    if (src_rows.empty()) {
+      continue;
+    }
+    auto n = static_cast<int64_t>(src_rows.size());
+    torch::Tensor src = torch::from_blob(src_rows.data(), {n}, long_opt);
+    torch::Tensor dst = torch::from_blob(dst_rows.data(), {n}, long_opt);
+    for (uint32_t j = 0; j < num_os_ids; ++j) {
+      torch::Tensor& tensor = (*shard.tensors_)[j];
+      staged.select(1, j).index_copy_(
+          0, dst, tensor.index_select(0, src.to(tensor.device())).cpu());
+    }
+  }
+}
+
+bool PS::NextEvictChunk(
+    EvictJob& job,
+    uint32_t& begin,
+    uint32_t& num_ids_in_chunk) {
+  auto num_ids = static_cast<uint32_t>(job.global_ids_.size());
+  uint32_t chunk_size = evict_chunk_.Get();
+  begin = job.next_id_.load();
+  do {
+    if (begin >= num_ids) {
+      return false;
+    }
+    num_ids_in_chunk = std::min(chunk_size, num_ids - begin);
+  } while (
+      !job.next_id_.compare_exchange_weak(begin, begin + num_ids_in_chunk));
+  return true;
+}
+
+void PS::PushEvictChunk(
+    std::shared_ptr<EvictJob> job,
+    uint32_t begin,
+    uint32_t num_ids_in_chunk) {
+  uint32_t num_values_per_id = os_ids_.size() * col_ids_.size();
+  // The offsets are absolute, so the data is the whole staged data.
+  tcb::span<const int64_t> global_ids{
+      job->global_ids_.data() + begin, num_ids_in_chunk};
+  tcb::span<const uint8_t> data =
+      job->encoded_.empty()
+      ? tcb::span<const uint8_t>{reinterpret_cast<const uint8_t*>(
+                                     job->data_.data()),
+                                 job->data_.size() * sizeof(float)}
+      : tcb::span<const uint8_t>{job->encoded_.data(), job->encoded_.size()};
+  tcb::span<const uint64_t> offsets{
+      job->offsets_.data() + begin * num_values_per_id,
+      num_ids_in_chunk * num_values_per_id + 1};
+  io_.Push(
+      table_name_,
+      global_ids,
+      col_ids_,
+      os_ids_,
+      data,
+      offsets,
+      [this,
+       job = std::move(job),
+       num_ids_in_chunk,
+       start = std::chrono::steady_clock::now()] {
+        evict_chunk_.Record(
+            num_ids_in_chunk,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+        uint32_t next;
+        uint32_t num_ids_in_next;
+        if (NextEvictChunk(*job, next, num_ids_in_next)) {
+          // The IO may complete the push synchronously, so push the next
+          // chunk in the completion pool to avoid deep recursion.
+          CompletionPool().Enqueue([this, job, next, num_ids_in_next] {
+            PushEvictChunk(job, next, num_ids_in_next);
+          });
+        }
+        auto num_ids = static_cast<uint32_t>(job->global_ids_.size());
+        if (job->num_pushed_ids_.fetch_add(num_ids_in_chunk) +
+                num_ids_in_chunk ==
+            num_ids) {
+          job->finished_ = true;
+          job->notification_.Done();
+        }
+      });
+}
+
+details::AdaptiveChunkOption PS::EvictChunkOption(
+    const nlohmann::json& config,
+    int64_t chunk_size,
+    int64_t row_size) {
+  auto num_rows = [row_size](int64_t size) {
+    return static_cast<uint32_t>(
+        std::clamp<int64_t>(size / row_size, 1, UINT32_MAX));
+  };
+  return details::AdaptiveChunkOption{
+      .min_size_ = num_rows(config.value("min_chunk_size", row_size)),
+      .max_size_ = num_rows(config.value("max_chunk_size", chunk_size * 16)),
+      .target_latency_us_ = config.value("target_chunk_latency_us", 0U),
+  };
+}
+
+void PS::ReapEvictJobs() {
+  for (auto it = inflight_evicts_.begin(); it != inflight_evicts_.end();) {
+    auto& job = *it;
+    if (!job->finished_) {
+      ++it;
+      continue;
+    }
+    for (int64_t global_id : job->global_ids_) {
+      auto hazard = evict_hazards_.find(global_id);
+      if (hazard != evict_hazards_.end() &&
+          hazard->second.first == job.get()) {
+        evict_hazards_.erase(hazard);
+      }
+    }
+    it = inflight_evicts_.erase(it);
   }
-  notification.Wait();
 }
 
 void PS::SyncFetch(int64_t time) {
+  details::ScopedLatency latency(wait_us_);
   while (!fetch_notifications_.empty()) {
-    auto& [t, notification] = fetch_notifications_.front();
-    if (t != time && time >= 0) {
+    auto& fetch = fetch_notifications_.front();
+    if (fetch.time_ != time && time >= 0) {
       break;
     }
-    notification->Wait();
+    auto notification = std::move(fetch.notification_);
     fetch_notifications_.pop_front();
+    // Rethrow the error of the fetch once.
+    notification->Wait();
+  }
+}
+
+void PS::SyncFetchOverlapped(const std::vector<int64_t>& cache_ids) {
+  if (fetch_notifications_.empty()) {
+    return;
+  }
+  ska::flat_hash_set<int64_t> evicting(cache_ids.begin(), cache_ids.end());
+  for (auto& fetch : fetch_notifications_) {
+    if (std::any_of(
+            fetch.cache_ids_.begin(),
+            fetch.cache_ids_.end(),
+            [&](int64_t cache_id) { return evicting.count(cache_id) != 0; })) {
+      // The error of the fetch is rethrown by its own wait.
+      fetch.notification_->WaitDone();
+    }
+  }
+}
+
+void PS::ScatterFetched(
+    const std::vector<int64_t>& cache_ids,
+    const details::BatchedPullResult& fetched,
+    bool reinit,
+    double weight_init_min,
+    double weight_init_max) {
+  details::ScopedLatency latency(scatter_us_);
+  const bool* found = fetched.found_.data_ptr<bool>();
+  auto num_rows = static_cast<int64_t>(cache_ids.size());
+  auto long_opt = torch::TensorOptions().dtype(torch::kLong);
+  std::vector<int64_t> src_rows;
+  std::vector<int64_t> dst_rows;
+  std::vector<int64_t> missing_rows;
+  for (auto& shard : *shards_) {
+    src_rows.clear();
+    dst_rows.clear();
+    missing_rows.clear();
+    for (int64_t i = 0; i < num_rows; ++i) {
+      int64_t cache_id = cache_ids[i];
+      if (!shard.Has(cache_id)) {
+        continue;
+      }
+      if (found[i]) {
+        src_rows.emplace_back(i);
+        dst_rows.emplace_back(cache_id - shard.row_start_);
+      } else if (reinit) {
+        missing_rows.emplace_back(cache_id - shard.row_start_);
+      }
+    }
+
+    if (!dst_rows.empty() && fetched.rows_.defined()) {
+      auto num_found = static_cast<int64_t>(dst_rows.size());
+      torch::Tensor dst =
+          torch::from_blob(dst_rows.data(), {num_found}, long_opt);
+      // If all rows are found and are in this shard, the fetched rows can be
+      // copied without gathering.
+      torch::Tensor src;
+      if (num_found != num_rows) {
+        src = torch::from_blob(src_rows.data(), {num_found}, long_opt);
+      }
+      for (uint32_t j = 0; j < os_ids_.size(); ++j) {
+        torch::Tensor& tensor = (*shard.tensors_)[j];
+        torch::Tensor rows = fetched.rows_.select(0, j);
+        if (src.defined()) {
+          rows = rows.index_select(0, src);
+        }
+        tensor.index_copy_(
+            0, dst.to(tensor.device()), rows.to(tensor.device()));
+      }
+    }
+
+    if (!missing_rows.empty()) {
+      auto num_missing = static_cast<int64_t>(missing_rows.size());
+      torch::Tensor dst =
+          torch::from_blob(missing_rows.data(), {num_missing}, long_opt);
+      torch::Tensor& weight = (*shard.tensors_)[0];
+      weight.index_copy_(
+          0,
+          dst.to(weight.device()),
+          torch::empty({num_missing, weight.size(1)}, weight.options())
+              .uniform_(weight_init_min, weight_init_max));
+      // optimizer states will be set to zero
+      for (uint32_t j = 1; j < os_ids_.size(); ++j) {
+        torch::Tensor& tensor = (*shard.tensors_)[j];
+        tensor.index_fill_(0, dst.to(tensor.device()), 0);
+      }
+    }
+  }
+}
+
+bool PS::GetDestinations(
+    const std::vector<int64_t>& cache_ids,
+    std::vector<details::IOPullDestination>& dsts) {
+  for (auto& shard : *shards_) {
+    for (auto& tensor : *shard.tensors_) {
+      if (!tensor.device().is_cpu() || tensor.scalar_type() != torch::kF32 ||
+          tensor.dim() != 2 || tensor.size(1) != col_size_ ||
+          tensor.stride(1) != 1) {
+        return false;
+      }
+    }
+  }
+  uint64_t row_bytes = col_size_ * sizeof(float);
+  dsts.resize(cache_ids.size() * os_ids_.size());
+  for (size_t i = 0; i < cache_ids.size(); ++i) {
+    int64_t cache_id = cache_ids[i];
+    auto it = std::find_if(
+        shards_->begin(), shards_->end(), [cache_id](auto& shard) {
+          return shard.Has(cache_id);
+        });
+    TORCH_CHECK(it != shards_->end(), "no shard holds cache id ", cache_id);
+    for (size_t j = 0; j < os_ids_.size(); ++j) {
+      torch::Tensor& tensor = (*it->tensors_)[j];
+      dsts[i * os_ids_.size() + j] = details::IOPullDestination{
+          .data_ = tensor.data_ptr<float>() +
+              (cache_id - it->row_start_) * tensor.stride(0),
+          .capacity_ = row_bytes,
+      };
+    }
+  }
+  return true;
+}
+
+c10::Dict<std::string, double> PS::Stats() {
+  c10::Dict<std::string, double> stats = io_.Stats();
+  std::string prefix = "ps." + table_name_ + ".";
+  filter_us_.Export(prefix + "filter_us", stats);
+  stage_us_.Export(prefix + "stage_us", stats);
+  scatter_us_.Export(prefix + "scatter_us", stats);
+  wait_us_.Export(prefix + "wait_us", stats);
+  evict_us_.Export(prefix + "evict_us", stats);
+  evict_chunk_.Export(prefix + "evict_chunk", stats);
+  if (negative_filter_ != nullptr) {
+    stats.insert_or_assign(
+        prefix + "negative_filter.num_skipped_ids",
+        static_cast<double>(num_negative_filter_skips_.load()));
   }
+  return stats;
 }
 
 std::vector<torch::Tensor> PS::GetTensorViews(int64_t cache_id) {
@@ -2,9 +2,19 @@
 #include <torch/custom_class.h>
 #include <torch/torch.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <deque>
+#include <exception>
+#include <memory>
 #include <utility>
+#include "nlohmann/json.hpp"
+#include "tde/details/adaptive_chunk.h"
+#include "tde/details/bloom_filter.h"
+#include "tde/details/histogram.h"
 #include "tde/details/io.h"
+#include "tde/details/row_codec.h"
+#include "tde/details/victim_cache.h"
 #include "tde/notification.h"
 #include "tde/tensor_list.h"
 
@@ -13,6 +23,8 @@ namespace tde {
 struct LocalShard {
   int64_t row_start_;
   int64_t row_size_;
+  int64_t col_start_;
+  int64_t col_size_;
   c10::intrusive_ptr<TensorList> tensors_;
 
   [[nodiscard]] bool Has(int64_t cache_id) const {
@@ -41,10 +53,11 @@ class LocalShardList : public torch::CustomClassHolder {
       int64_t row_size,
       int64_t col_size,
       c10::intrusive_ptr<TensorList> tensors) {
-    // col_start/col_size not used for now.
     shards_.emplace_back(LocalShard{
         .row_start_ = row_start,
         .row_size_ = row_size,
+        .col_start_ = col_start,
+        .col_size_ = col_size,
         .tensors_ = std::move(tensors)});
   }
 
@@ -60,7 +73,78 @@ class LocalShardList : public torch::CustomClassHolder {
 };
 
 class FetchHandle;
+class EvictHandle;
+class PreloadHandle;
+
+/**
+ * The rows staged by one eviction. The data is owned by the job until all
+ * chunks are pushed, so the caller can go on training meanwhile.
+ */
+struct EvictJob {
+  std::vector<int64_t> global_ids_;
+  // Layout is [global_id][optimizer_state][col_size].
+  std::vector<float> data_;
+  // The rows in wire format. Empty if the encoding is fp32, where data_ is
+  // pushed directly.
+  std::vector<uint8_t> encoded_;
+  // Byte offsets of each (global id, optimizer state) in the pushed data.
+  std::vector<uint64_t> offsets_;
+  // The chunks are taken from next_id_ by their pushes, so their sizes can
+  // change as the job goes.
+  std::atomic<uint32_t> next_id_{0};
+  std::atomic<uint32_t> num_pushed_ids_{0};
+  std::atomic<bool> finished_{false};
+  details::Notification notification_;
+
+  void Wait() {
+    notification_.Wait();
+  }
+};
 
+/**
+ * PS of one column slice of an embedding table.
+ *
+ * All the local shards must have the same columns. The values are pushed and
+ * pulled with the `col_start` of the shards as the column id, so the ranks
+ * holding different column slices of a column-wise or table-wise-row-wise
+ * sharded table only move their own slices. Row-wise sharded tables use
+ * column id 0.
+ *
+ * The optional json config supports:
+ *   - evict_depth: number of chunks pushed concurrently during eviction.
+ *     Default is 2.
+ *   - target_chunk_latency_us: adapt the size of the eviction chunks toward
+ *     this latency of a push, see `AdaptiveChunkSize`. The size starts from
+ *     `chunk_size`, and stays within min_chunk_size and max_chunk_size, in
+ *     the same unit. Default is 0, i.e., the size is fixed. The bounds
+ *     default to one row and 16 times `chunk_size`.
+ *   - encoding: the encoding of rows stored in the parameter server, one of
+ *     fp32, fp16, bf16 and int8 (row-wise quantized). Default is fp32.
+ *     Fetching decodes rows of any encoding.
+ *   - victim_cache_size: number of rows kept in host memory after
+ *     `EvictAsync`. Fetching them does not touch the parameter server. They
+ *     are written back when pushed out of the cache, or by `Evict`. Default
+ *     is 0, i.e., no victim cache.
+ *   - max_inflight_bytes, max_inflight_requests: the IO budget, see
+ *     `IOBudget`. Fetches of the earliest pending step go first, then the
+ *     fetches of the steps ahead, then the write-backs. Default is 0, i.e.,
+ *     unlimited.
+ *   - block_on_budget: block `Fetch` and `EvictAsync` when over budget,
+ *     instead of deferring the requests. Default is false.
+ *   - negative_filter_ids: keep a bloom filter of the ids ever pushed, sized
+ *     for this many ids, and do not pull the ids which are definitely not in
+ *     the parameter server. They are reinitialized locally if `reinit` is
+ *     set. The filter is stored next to the rows, in the table
+ *     `<table>.__seen_ids__`, loaded on construction and pushed by each
+ *     eviction before its rows.
+ *     If no filter is stored, the filter is disabled, as the table may have
+ *     rows pushed without it. It must have the same value across restarts,
+ *     and this PS must be the only writer of its rows, e.g., the table is
+ *     not row-wise sharded. Default is 0, i.e., no filter.
+ *   - negative_filter_new_table: the table has no rows yet, so a missing
+ *     negative filter is created empty instead of disabled. Default is
+ *     false.
+ */
 class PS : public torch::CustomClassHolder {
  public:
   PS(std::string table_name,
@@ -68,31 +152,256 @@ class PS : public torch::CustomClassHolder {
      int64_t col_size,
      int64_t num_optimizer_stats,
      const std::string& io_config,
-     int64_t chunk_size)
+     int64_t chunk_size,
+     const nlohmann::json& config = nlohmann::json::object())
       : table_name_(std::move(table_name)),
         shards_(std::move(shards)),
         col_size_(col_size),
         os_ids_(num_optimizer_stats),
-        io_(io_config),
-        num_ids_per_chunk_(chunk_size / col_size_ / num_optimizer_stats) {
+        io_(io_config,
+            details::IOBudgetOption{
+                .max_inflight_bytes_ = config.value("max_inflight_bytes", 0UL),
+                .max_inflight_requests_ =
+                    config.value("max_inflight_requests", 0U),
+                .block_ = config.value("block_on_budget", false),
+            }),
+        num_ids_per_chunk_(chunk_size / col_size_ / num_optimizer_stats),
+        evict_chunk_(
+            num_ids_per_chunk_,
+            EvictChunkOption(
+                config, chunk_size, col_size_ * num_optimizer_stats)),
+        evict_depth_(config.value("evict_depth", 2)),
+        encoding_(details::ParseRowEncoding(
+            config.value("encoding", std::string("fp32")))),
+        victim_cache_(
+            config.value("victim_cache_size", 0),
+            num_optimizer_stats * col_size_) {
     TORCH_CHECK(num_ids_per_chunk_ > 0, "chunk size too small");
+    TORCH_CHECK(evict_depth_ > 0, "evict_depth must be positive");
     for (int64_t i = 0; i < num_optimizer_stats; ++i) {
       os_ids_[i] = i;
     }
+    int64_t col_start = 0;
+    if (shards_->begin() != shards_->end()) {
+      col_start = shards_->begin()->col_start_;
+    }
+    for (auto& shard : *shards_) {
+      TORCH_CHECK(
+          shard.col_start_ == col_start && shard.col_size_ == col_size_,
+          "local shards of a PS must have the same columns, expect [",
+          col_start,
+          ", ",
+          col_start + col_size_,
+          "), got [",
+          shard.col_start_,
+          ", ",
+          shard.col_start_ + shard.col_size_,
+          ")");
+    }
+    col_ids_ = {col_start};
+    if (auto expected_ids = config.value("negative_filter_ids", 0UL);
+        expected_ids != 0) {
+      negative_filter_ = std::make_unique<details::BloomFilter>(expected_ids);
+      bool new_table = config.value("negative_filter_new_table", false);
+      if (!LoadNegativeFilter(new_table)) {
+        TORCH_WARN(
+            "the negative filter of ",
+            table_name_,
+            " is not stored, all the ids are pulled. Set",
+            " negative_filter_new_table if the table has no rows yet.");
+        negative_filter_.reset();
+      }
+    }
   }
 
+  ~PS() override;
+
   c10::intrusive_ptr<FetchHandle> Fetch(
       torch::Tensor ids_to_fetch,
       int64_t time,
       bool reinit,
       double weight_init_min,
       double weight_init_max);
+
+  /**
+   * Fetch the rows of the hot ids before training, e.g., the ids inserted by
+   * `IDTransformer::Preload`. The ids are fetched in chunks of `chunk_size`,
+   * which are all issued at once, so they are pulled by all the IO threads in
+   * parallel, as fetches of step `time`, which must not be before the steps
+   * of the pending fetches.
+   *
+   * @return handle to the progress, in ids whose rows are in place.
+   */
+  c10::intrusive_ptr<PreloadHandle> Preload(
+      torch::Tensor ids_to_fetch,
+      int64_t time,
+      bool reinit,
+      double weight_init_min,
+      double weight_init_max);
+
+  /**
+   * Evict ids to the parameter server and wait until all the evictions, this
+   * one and the asynchronous ones before, are done. The rows in the victim
+   * cache are written back as well.
+   */
   void Evict(torch::Tensor ids_to_evict);
 
+  /**
+   * Stage the rows of `ids_to_evict` and push them in the background.
+   *
+   * The rows can be overwritten by the caller as soon as this method
+   * returns. Fetching an id whose eviction is still in flight is served from
+   * the staged rows.
+   *
+   * With the victim cache, the rows are kept in the cache and only the rows
+   * pushed out of it are written back, which the returned handle waits for.
+   */
+  c10::intrusive_ptr<EvictHandle> EvictAsync(torch::Tensor ids_to_evict);
+
   void SyncFetch(int64_t time = -1);
 
+  /**
+   * Snapshot of the metrics of this PS and its IO. The keys of this PS are
+   * `ps.<table>.<metric>.<stat>`, where the metrics are the microseconds
+   * spent in filtering the ids, staging the rows to evict, scattering the
+   * fetched rows, waiting for fetches and evicting. See `IO::Stats` for the
+   * keys of the IO. The eviction chunks are `ps.<table>.evict_chunk.<stat>`,
+   * see `AdaptiveChunkSize::Export`, whose size is in rows. With the
+   * negative filter, `ps.<table>.negative_filter.num_skipped_ids` counts the
+   * ids not pulled.
+   */
+  c10::Dict<std::string, double> Stats();
+
  private:
+  struct PendingFetch {
+    int64_t time_;
+    c10::intrusive_ptr<Notification> notification_;
+    // The cache ids written by the fetch. Evicting them needs to wait.
+    std::vector<int64_t> cache_ids_;
+  };
+
+  /**
+   * Fetch without locking. The ids whose rows are in place are added to
+   * preload, if any.
+   */
+  c10::intrusive_ptr<FetchHandle> DoFetch(
+      const torch::Tensor& ids_to_fetch,
+      int64_t time,
+      bool reinit,
+      double weight_init_min,
+      double weight_init_max,
+      c10::intrusive_ptr<PreloadHandle> preload);
+  /**
+   * Remove the ids which are definitely not in the parameter server from the
+   * ids to fetch, and reinitialize their rows if `reinit` is set.
+   */
+  void FetchFromNegativeFilter(
+      bool reinit,
+      double weight_init_min,
+      double weight_init_max);
+  /**
+   * Merge the filter stored in the parameter server into the negative filter.
+   * If no filter is stored, any id may be in the parameter server, so return
+   * false, unless `new_table` is set, in which case the empty filter is
+   * stored.
+   */
+  bool LoadNegativeFilter(bool new_table);
+  /**
+   * Push the pages of the negative filter changed since the last push, then
+   * call `on_pushed` on the completion threads. Never waits: if a push is in
+   * flight, the pages are pushed by the next one, started once it completes,
+   * so that a page is never overwritten by an older copy, and the pages
+   * changed meanwhile are pushed together.
+   */
+  void PushNegativeFilter(details::MoveOnlyFunction<void()> on_pushed);
+  /**
+   * Push the dirty pages of the negative filter for the waiting callbacks,
+   * with the header if it is not stored yet. Requires negative_filter_mu_.
+   */
+  void StartNegativeFilterPush();
+  /**
+   * Wait for the pending fetches writing to the cache ids being evicted.
+   */
+  void SyncFetchOverlapped(const std::vector<int64_t>& cache_ids);
+  /**
+   * Copy the rows whose eviction is in flight from the staged data, and
+   * remove them from the ids to fetch.
+   */
+  void FetchFromEvictHazards();
+  /**
+   * Copy the rows in the victim cache, and remove them from the ids to fetch.
+   */
+  void FetchFromVictimCache();
+  /**
+   * Stage the rows of the filtered ids into the victim cache. The rows
+   * pushed out of the cache, and the rows beyond its capacity, are written
+   * back.
+   */
+  c10::intrusive_ptr<EvictHandle> EvictToVictimCache();
+  /**
+   * Write back all the rows in the victim cache.
+   */
+  void FlushVictimCache();
+  /**
+   * Push the staged rows of job in the background.
+   */
+  c10::intrusive_ptr<EvictHandle> StartEvictJob(std::shared_ptr<EvictJob> job);
+  /**
+   * Forget the finished evictions.
+   */
+  void ReapEvictJobs();
+  /**
+   * Push the first `evict_depth_` chunks of job, each push starts the next.
+   */
+  void PushEvictChunks(std::shared_ptr<EvictJob> job);
+  /**
+   * Take the next chunk of job, of the current size of the eviction chunks.
+   * @return false if all the chunks of job are taken.
+   */
+  bool NextEvictChunk(
+      EvictJob& job,
+      uint32_t& begin,
+      uint32_t& num_ids_in_chunk);
+  void PushEvictChunk(
+      std::shared_ptr<EvictJob> job,
+      uint32_t begin,
+      uint32_t num_ids_in_chunk);
+  /**
+   * The bounds and the target latency of the eviction chunks, in rows of
+   * row_size values.
+   */
+  static details::AdaptiveChunkOption EvictChunkOption(
+      const nlohmann::json& config,
+      int64_t chunk_size,
+      int64_t row_size);
+  /**
+   * Copy the rows of cache_ids to data, whose layout is
+   * [cache_ids.size(), num_optimizer_states, col_size].
+   */
+  void StageRows(tcb::span<const int64_t> cache_ids, float* data);
+
+  /**
+   * Point the destinations of a pull to the rows of cache_ids in the local
+   * shards, so that the IO writes the fetched rows in place.
+   * @return false if some shard is not a contiguous float tensor in host
+   * memory, which the rows cannot be written into directly.
+   */
+  bool GetDestinations(
+      const std::vector<int64_t>& cache_ids,
+      std::vector<details::IOPullDestination>& dsts);
+
   std::vector<torch::Tensor> GetTensorViews(int64_t cache_id);
+  /**
+   * Scatter the fetched rows into local shards. Rows that are not found in
+   * the parameter server are reinitialized if `reinit` is set. If the rows
+   * of `fetched` are undefined, the found rows are already in place.
+   */
+  void ScatterFetched(
+      const std::vector<int64_t>& cache_ids,
+      const details::BatchedPullResult& fetched,
+      bool reinit,
+      double weight_init_min,
+      double weight_init_max);
   std::vector<int64_t> global_ids_to_fetch_or_evict_;
   std::vector<int64_t> cache_ids_to_fetch_or_evict_;
 
@@ -102,11 +411,33 @@ class PS : public torch::CustomClassHolder {
   std::string table_name_;
   c10::intrusive_ptr<LocalShardList> shards_;
   int64_t col_size_;
+  std::vector<int64_t> col_ids_;
   std::vector<uint32_t> os_ids_;
   int64_t num_ids_per_chunk_;
+  details::AdaptiveChunkSize evict_chunk_;
+  int64_t evict_depth_;
+  details::RowEncoding encoding_;
+  details::VictimCache victim_cache_;
+  // The ids ever pushed, null if the negative filter is disabled.
+  std::unique_ptr<details::BloomFilter> negative_filter_;
+  std::atomic<int64_t> num_negative_filter_skips_{0};
+  // Guards the negative filter, whose pages are copied by the pushes on the
+  // completion threads, and the states of its pushes below.
+  std::mutex negative_filter_mu_;
+  // The callbacks of the next push of the negative filter.
+  std::vector<details::MoveOnlyFunction<void()>> negative_filter_waiters_;
+  bool negative_filter_pushing_{false};
+  bool negative_filter_header_pushed_{false};
   details::IO io_;
-  std::deque<std::pair<int64_t, c10::intrusive_ptr<Notification>>>
-      fetch_notifications_;
+  std::deque<PendingFetch> fetch_notifications_;
+  std::deque<std::shared_ptr<EvictJob>> inflight_evicts_;
+  // global id -> (job, row in job) of the latest in flight eviction.
+  ska::flat_hash_map<int64_t, std::pair<EvictJob*, uint32_t>> evict_hazards_;
+  details::Histogram filter_us_;
+  details::Histogram stage_us_;
+  details::Histogram scatter_us_;
+  details::Histogram wait_us_;
+  details::Histogram evict_us_;
 };
 
 struct FetchHandle : public torch::CustomClassHolder {
@@ -123,4 +454,81 @@ struct FetchHandle : public torch::CustomClassHolder {
   c10::intrusive_ptr<PS> ps_; // not owned
 };
 
+/**
+ * Progress of `PS::Preload`.
+ */
+class PreloadHandle : public torch::CustomClassHolder {
+ public:
+  explicit PreloadHandle(int64_t num_ids) : num_ids_(num_ids) {}
+
+  [[nodiscard]] int64_t NumIds() const {
+    return num_ids_;
+  }
+
+  int64_t NumLoaded() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return num_loaded_;
+  }
+
+  void Add(int64_t num_loaded) {
+    std::lock_guard<std::mutex> lock(mu_);
+    num_loaded_ += num_loaded;
+    if (num_loaded_ == num_ids_) {
+      cv_.notify_all();
+    }
+  }
+
+  /**
+   * Wait until all the rows are in place, or for at most timeout_ms if it is
+   * not negative. Rethrow the error of a failed fetch.
+   * @return true if all the rows are in place.
+   */
+  bool Wait(int64_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mu_);
+    auto done = [this] {
+      return num_loaded_ == num_ids_ || error_ != nullptr;
+    };
+    if (timeout_ms < 0) {
+      cv_.wait(lock, done);
+    } else if (!cv_.wait_for(
+                   lock, std::chrono::milliseconds(timeout_ms), done)) {
+      return false;
+    }
+    if (error_ != nullptr) {
+      std::rethrow_exception(error_);
+    }
+    return true;
+  }
+
+  /**
+   * Fail the preload, the error is rethrown by `Wait`.
+   */
+  void Fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (error_ == nullptr) {
+      error_ = std::move(error);
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  int64_t num_ids_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  int64_t num_loaded_{0};
+  std::exception_ptr error_;
+};
+
+struct EvictHandle : public torch::CustomClassHolder {
+ public:
+  explicit EvictHandle(std::shared_ptr<EvictJob> job) : job_(std::move(job)) {}
+  void Wait() {
+    if (job_ != nullptr)
+      job_->Wait();
+  }
+
+ private:
+  std::shared_ptr<EvictJob> job_;
+};
+
 } // namespace tde
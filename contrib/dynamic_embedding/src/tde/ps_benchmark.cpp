@@ -0,0 +1,121 @@
+#include <torch/torch.h>
+#include <chrono>
+#include <thread>
+#include "benchmark/benchmark.h"
+#include "tde/details/thread_pool.h"
+#include "tde/ps.h"
+
+namespace tde {
+
+/**
+ * An IO provider that completes each push after a fixed latency. It
+ * simulates a parameter server with `k_num_io_threads` connections.
+ */
+struct DelayIO {
+  static constexpr uint32_t k_num_io_threads = 4;
+
+  explicit DelayIO(const char* cfg)
+      : latency_(std::stoul(cfg)), pool_(k_num_io_threads) {}
+
+  void Push(details::IOPushParameter param) {
+    pool_.Enqueue([this, param] {
+      std::this_thread::sleep_for(latency_);
+      param.on_push_complete(param.on_complete_context_);
+    });
+  }
+
+  std::chrono::microseconds latency_;
+  details::ThreadPool pool_;
+};
+
+static int _r = [] {
+  details::IORegistry::RegisterAllDefaultIOs();
+  details::IOProvider provider{};
+  provider.type_ = "delay";
+  provider.Initialize = +[](const char* cfg) -> void* {
+    return new DelayIO(cfg);
+  };
+  provider.Finalize =
+      +[](void* inst) { delete reinterpret_cast<DelayIO*>(inst); };
+  provider.Pull = +[](void* inst, details::IOPullParameter param) {
+    TORCH_CHECK(false, "delay io does not support pull");
+  };
+  provider.Push = +[](void* inst, details::IOPushParameter param) {
+    reinterpret_cast<DelayIO*>(inst)->Push(param);
+  };
+  details::IORegistry::Instance().Register(provider);
+  return 0;
+}();
+
+static void BM_PSEvict(benchmark::State& state) {
+  constexpr int64_t num_embeddings = 1 << 16;
+  constexpr int64_t dim = 128;
+  constexpr int64_t chunk_size = 1024 * dim;
+  int64_t evict_depth = state.range(0);
+
+  auto tensors = c10::make_intrusive<TensorList>();
+  tensors->push_back(torch::rand({num_embeddings, dim}));
+  auto shards = c10::make_intrusive<LocalShardList>();
+  shards->emplace_back(0, 0, num_embeddings, dim, tensors);
+  auto ps = c10::make_intrusive<PS>(
+      "table",
+      shards,
+      dim,
+      1,
+      "delay://1000",
+      chunk_size,
+      nlohmann::json{{"evict_depth", evict_depth}});
+
+  torch::Tensor ids = torch::arange(num_embeddings, torch::kLong)
+                          .reshape({num_embeddings, 1})
+                          .repeat({1, 2})
+                          .contiguous();
+  for (auto _ : state) {
+    ps->Evict(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * num_embeddings);
+  state.SetBytesProcessed(
+      state.iterations() * num_embeddings * dim * sizeof(float));
+}
+
+BENCHMARK(BM_PSEvict)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgNames({"evict_depth"})
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16);
+
+/**
+ * Evict and fetch all rows through the built-in memory IO, which is the
+ * throughput of the PS without network.
+ */
+static void BM_PSMemory(benchmark::State& state) {
+  constexpr int64_t num_embeddings = 1 << 16;
+  constexpr int64_t dim = 128;
+  constexpr int64_t chunk_size = 1024 * dim;
+
+  auto tensors = c10::make_intrusive<TensorList>();
+  tensors->push_back(torch::rand({num_embeddings, dim}));
+  auto shards = c10::make_intrusive<LocalShardList>();
+  shards->emplace_back(0, 0, num_embeddings, dim, tensors);
+  auto ps = c10::make_intrusive<PS>(
+      "table", shards, dim, 1, "memory://", chunk_size);
+
+  torch::Tensor ids = torch::arange(num_embeddings, torch::kLong)
+                          .reshape({num_embeddings, 1})
+                          .repeat({1, 2})
+                          .contiguous();
+  for (auto _ : state) {
+    ps->Evict(ids);
+    ps->Fetch(ids, 0, false, 0, 0)->Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_embeddings * 2);
+  state.SetBytesProcessed(
+      state.iterations() * num_embeddings * dim * sizeof(float) * 2);
+}
+
+BENCHMARK(BM_PSMemory)->Unit(benchmark::kMillisecond);
+
+} // namespace tde
@@ -36,12 +36,29 @@ def transform_loop(dataloader, transform_fn, out_queue, done_event):
 
 
 class DataLoaderIter:
-    def __init__(self, dataloader, transform_fn, num_prefetch=0):
+    def __init__(self, dataloader, transform_fn, num_prefetch=0, release_fn=None):
+        """
+        Args:
+            release_fn: called once for each batch transformed, in order, when the
+                next batch is requested or the iterator is destroyed, as the
+                training of the batch is done by then.
+        """
         self._data_queue = queue.Queue(maxsize=num_prefetch)
         self._done_event = threading.Event()
+        self._release_fn = release_fn
+        # The number of batches transformed, counted by the transform thread.
+        self._lock = threading.Lock()
+        self._num_transformed = 0
+        self._num_returned = 0
+        self._num_released = 0
         self._transform_thread = threading.Thread(
             target=transform_loop,
-            args=(dataloader, transform_fn, self._data_queue, self._done_event),
+            args=(
+                dataloader,
+                self._counted(transform_fn),
+                self._data_queue,
+                self._done_event,
+            ),
         )
         self._transform_thread.start()
 
@@ -53,15 +70,47 @@ class DataLoaderIter:
 
     def __del__(self):
         self._done_event.set()
+        if self._release_fn is not None:
+            # The transform thread may be waiting for a release.
+            self._release(self._transformed())
+            self._transform_thread.join()
+            self._release(self._transformed())
 
     def _get_data(self):
         if not self._transform_thread.is_alive():
             raise RuntimeError("Transform thread exited unexpectedly")
+        # The training of the previous batch is done, release it before waiting,
+        # as the transform of this batch may be waiting for the release.
+        self._release(self._num_returned)
         data, handles = self._data_queue.get()
+        self._num_returned += 1
         for handle in handles:
             handle.wait()
         return data
 
+    def _counted(self, transform_fn):
+        def fn(data):
+            result = transform_fn(data)
+            with self._lock:
+                self._num_transformed += 1
+            return result
+
+        return fn
+
+    def _transformed(self):
+        with self._lock:
+            return self._num_transformed
+
+    def _release(self, num_batches):
+        """
+        Release the batches until the first `num_batches` ones are released.
+        """
+        if self._release_fn is None:
+            return
+        while self._num_released < num_batches:
+            self._release_fn()
+            self._num_released += 1
+
 
 class DataLoader:
     def __init__(
@@ -119,7 +168,10 @@ class DataLoader:
 
     def __iter__(self):
         return DataLoaderIter(
-            self._dataloader, self._transform_fn, num_prefetch=self._num_prefetch
+            self._dataloader,
+            self._transform_fn,
+            num_prefetch=self._num_prefetch,
+            release_fn=self._id_transformer_group.release,
         )
 
     def __len__(self):
@@ -190,6 +242,9 @@ def wrap(
         transform_config=transform_config,
         ps_config=ps_config,
         parallel=parallel,
+        # The batches are transformed ahead of training by `num_prefetch`, their
+        # ids are kept until the training of the batch is done.
+        pin=True,
     )
     paths = list(configs_dict.keys())
     # Attach the id transformer group to module for saving.
@@ -15,7 +15,17 @@ __all__ = []
 
 
 class IDTransformer:
-    def __init__(self, num_embedding, eviction_config=None, transform_config=None):
+    def __init__(
+        self, num_embedding, eviction_config=None, transform_config=None, pin=False
+    ):
+        """
+        Args:
+            num_embedding: number of cache ids.
+            eviction_config: config of the eviction strategy.
+            transform_config: config of the transform strategy.
+            pin: whether `transform` pins the cache ids of the batches until they
+                are released by `release`, so that `evict` skips them.
+        """
         self._num_embedding = num_embedding
         if not eviction_config:
             eviction_config = {"type": "mixed_lru_lfu"}
@@ -25,26 +35,66 @@ class IDTransformer:
             {
                 "lxu_strategy": eviction_config,
                 "id_transformer": transform_config,
+                "pin": pin,
             }
         )
         self._transformer = torch.classes.tde.IDTransformer(num_embedding, config)
 
-    def transform(self, global_ids: TensorList, cache_ids: TensorList, time: int):
+    def transform(
+        self, global_ids: TensorList, cache_ids: TensorList, time: int, offset=0
+    ):
         """
         Transform `global_ids` and store the results in `cache_ids`.
+
+        If the transformer is full, the result is not successful, and has
+        `num_transformed`, the offset over all the ids to resume from, and
+        `num_to_evict`, the number of free cache ids the rest of the ids need.
+        The ids before the offset are kept from eviction until the batch is
+        transformed.
         """
         return self._transformer.transform(
-            global_ids.tensor_list, cache_ids.tensor_list, time
+            global_ids.tensor_list, cache_ids.tensor_list, time, offset
         )
 
+    def preload(self, global_ids: torch.Tensor, freq_powers=None, time: int = 0):
+        """
+        Insert `global_ids` ranked by hotness, e.g. the ids of `ranked` of a
+        previous run, with their frequency powers if `freq_powers` is given.
+        The ids after the first one that does not fit are skipped, and the result
+        is not successful.
+        """
+        if freq_powers is None:
+            freq_powers = torch.empty((0,), dtype=torch.long)
+        return self._transformer.preload(global_ids, freq_powers, time)
+
     def evict(self, num_to_evict):
         """
         Evict `num_to_evict` ids from the transformer.
         """
         return self._transformer.evict(num_to_evict)
 
+    def evict_at_least(self, num_to_evict):
+        """
+        Evict `num_to_evict` ids and a small headroom, e.g. `num_to_evict` of a
+        failed `transform`.
+        """
+        return self._transformer.evict_at_least(num_to_evict)
+
     def save(self):
         """
         Get ids to save.
         """
         return self._transformer.save()
+
+    def release(self, time: int):
+        """
+        Unpin the cache ids of the batches transformed at or before `time`.
+        """
+        self._transformer.release(time)
+
+    def ranked(self, num: int = -1):
+        """
+        Get the `num` hottest ids, all the ids if `num` is negative, as rows of
+        (global id, frequency power), hottest first.
+        """
+        return self._transformer.ranked(num)
@@ -1,10 +1,12 @@
-from typing import List, Tuple, Union
+import collections
+import threading
+from typing import Dict, List, Tuple, Union
 
 import torch
 from torchrec import EmbeddingBagConfig, EmbeddingConfig, KeyedJaggedTensor
 
 from .id_transformer import IDTransformer, TensorList
-from .ps import PSCollection
+from .ps import PreloadHandles, PSCollection
 
 
 __all__ = []
@@ -17,6 +19,7 @@ class IDTransformerCollection:
         eviction_config=None,
         transform_config=None,
         ps_collection: PSCollection = None,
+        pin: bool = False,
     ):
         """
         IDTransformerCollection could transform the input of a `Embedding(Bag)Collection`.
@@ -29,7 +32,12 @@ class IDTransformerCollection:
             eviction_config: config of the eviction strategy for IDTransformers.
             transformer_config: config of the transform strategy for IDTransformers.
             ps_collection: `PSCollection` of the collection, if `None`, won't do eviction or fetch.
-                By default, IDTransformerCollection will evict half the ids when full.
+                When full, IDTransformerCollection evicts about as many ids as the
+                rest of the batch needs, and resumes the transform where it stopped.
+            pin: whether to keep the ids of each transformed batch from eviction until
+                the batch is released by `release`, which is needed when the batches
+                are transformed ahead of training. When the ids of a batch cannot fit
+                because of the pinned ids, `transform` waits for a release.
         """
         self._configs = tables
         self._ps_collection = ps_collection
@@ -51,6 +59,7 @@ class IDTransformerCollection:
                     num_embedding=config.num_embeddings,
                     eviction_config=eviction_config,
                     transform_config=transform_config,
+                    pin=pin,
                 )
             )
         self._feature_names: List[List[str]] = [
@@ -58,6 +67,11 @@ class IDTransformerCollection:
         ]
         self._ever_evicted = False
         self._time = 0
+        self._pin = pin
+        # The times of the batches not released, guarded by `_released`.
+        self._inflight = collections.deque()
+        self._num_released = 0
+        self._released = threading.Condition()
 
     def transform(
         self, global_features: KeyedJaggedTensor
@@ -77,6 +91,10 @@ class IDTransformerCollection:
         }
         offset_per_key = global_features.offset_per_key()
 
+        time = self._time
+        if self._pin:
+            with self._released:
+                self._inflight.append(time)
         fetch_handles = []
         for i, transformer in enumerate(self._transformers):
             feature_names = self._feature_names[i]
@@ -93,7 +111,7 @@ class IDTransformerCollection:
             ]
 
             result = transformer.transform(
-                TensorList(global_ids), TensorList(cache_ids), self._time
+                TensorList(global_ids), TensorList(cache_ids), time
             )
             if self._ps_collection is not None:
                 table_name = self._table_names[i]
@@ -101,37 +119,56 @@ class IDTransformerCollection:
                 if result.ids_to_fetch.numel() > 0:
                     handle = ps.fetch(
                         result.ids_to_fetch,
-                        self._time,
+                        time,
                         self._ever_evicted,
                         self._configs[i].get_weight_init_min(),
                         self._configs[i].get_weight_init_max(),
                     )
                     fetch_handles.append(handle)
-                if not result.success:
-                    # TODO(zilinzhu): make this configurable
-                    ids_to_evict = transformer.evict(transformer._num_embedding // 2)
-                    ps.evict(ids_to_evict)
+                # Set when evicting `num_to_evict` ids made no progress, e.g. the
+                # group of an id is full in a cacheline transformer.
+                evict_half = False
+                while not result.success:
+                    offset = result.num_transformed
+                    if evict_half:
+                        # TODO(zilinzhu): make this configurable
+                        ids_to_evict = transformer.evict(
+                            transformer._num_embedding // 2
+                        )
+                    else:
+                        ids_to_evict = transformer.evict_at_least(result.num_to_evict)
+                    # The write-back drains in the background, fetches of the
+                    # evicting ids are served from the staged rows.
+                    ps.evict_async(ids_to_evict)
                     self._ever_evicted = True
 
-                    # retry after eviction.
+                    # resume after eviction.
                     result = transformer.transform(
-                        TensorList(global_ids), TensorList(cache_ids), self._time
+                        TensorList(global_ids), TensorList(cache_ids), time, offset
                     )
-                    if not result.success:
-                        raise RuntimeError(
-                            "Failed to transform global ids after eviction. "
-                            f"Maybe the num_embedding of table {table_name} is too small?"
-                        )
-                    if result.ids_to_fetch is not None:
+                    if result.ids_to_fetch.numel() > 0:
                         fetch_handles.append(
                             ps.fetch(
                                 result.ids_to_fetch,
-                                self._time,
+                                time,
                                 self._ever_evicted,
                                 self._configs[i].get_weight_init_min(),
                                 self._configs[i].get_weight_init_max(),
                             )
                         )
+                    if result.success or result.num_transformed > offset:
+                        evict_half = False
+                    elif not evict_half:
+                        evict_half = True
+                    # The pinned ids are not evicted, wait for the batches in
+                    # flight to be released.
+                    elif self._wait_for_release():
+                        evict_half = False
+                    else:
+                        raise RuntimeError(
+                            "Failed to transform global ids after eviction. "
+                            f"Maybe the num_embedding of table {table_name} is too small?"
+                        )
 
         cache_values = KeyedJaggedTensor(
             keys=global_features.keys(),
@@ -142,6 +179,83 @@ class IDTransformerCollection:
         self._time += 1
         return cache_values, fetch_handles
 
+    def release(self):
+        """
+        Release the earliest batch transformed, so that its ids can be evicted.
+        Only needed if the collection is created with `pin=True`.
+        """
+        if not self._pin:
+            return
+        with self._released:
+            if not self._inflight:
+                return
+            time = self._inflight.popleft()
+            for transformer in self._transformers:
+                transformer.release(time)
+            self._num_released += 1
+            self._released.notify_all()
+
+    def _wait_for_release(self) -> bool:
+        """
+        Wait until a batch in flight, other than the one being transformed, is
+        released.
+
+        Return:
+            False if there is no such batch.
+        """
+        if not self._pin:
+            return False
+        with self._released:
+            if len(self._inflight) <= 1:
+                return False
+            num_released = self._num_released
+            self._released.wait_for(lambda: self._num_released != num_released)
+            return True
+
+    def preload(self, ranked_ids: Dict[str, torch.Tensor]) -> PreloadHandles:
+        """
+        Warm start the tables with their hottest ids before training.
+
+        Args:
+            ranked_ids: dict keyed by table name of the ids ranked by hotness,
+                either global ids, or rows of (global id, frequency power) as
+                returned by `ranked`. The ids that do not fit are skipped.
+
+        Return:
+            PreloadHandles: the progress of fetching the rows.
+        """
+        handles = []
+        for i, transformer in enumerate(self._transformers):
+            table_name = self._table_names[i]
+            if table_name not in ranked_ids:
+                continue
+            ids = ranked_ids[table_name]
+            if ids.dim() == 2:
+                result = transformer.preload(ids[:, 0], ids[:, 1], self._time)
+            else:
+                result = transformer.preload(ids, None, self._time)
+            if self._ps_collection is not None and result.ids_to_fetch.numel() > 0:
+                handles.append(
+                    self._ps_collection[table_name].preload(
+                        result.ids_to_fetch,
+                        self._time,
+                        self._ever_evicted,
+                        self._configs[i].get_weight_init_min(),
+                        self._configs[i].get_weight_init_max(),
+                    )
+                )
+        return PreloadHandles(handles)
+
+    def ranked(self, num: int = -1) -> Dict[str, torch.Tensor]:
+        """
+        The `num` hottest ids of each table, see `IDTransformer.ranked`, which
+        can be preloaded by the next run.
+        """
+        return {
+            table_name: transformer.ranked(num)
+            for table_name, transformer in zip(self._table_names, self._transformers)
+        }
+
     def save(self):
         if self._ps_collection is None:
             return
@@ -1,12 +1,13 @@
 import queue
 import threading
-from typing import Dict, List, Union
+from typing import Callable, Dict, List, Union
 
+import torch
 from torchrec import EmbeddingBagConfig, EmbeddingConfig, KeyedJaggedTensor
 from torchrec.distributed.model_parallel import DistributedModelParallel
 
 from .id_transformer_collection import IDTransformerCollection
-from .ps import PSCollection
+from .ps import PreloadHandles, PSCollection
 from .utils import _get_sharded_modules_recursive
 
 
@@ -46,6 +47,7 @@ class IDTransformerGroup:
         transform_config=None,
         ps_config=None,
         parallel=True,
+        pin=False,
     ):
         """
         IDTransformerGroup stores the IDTransformer for all sharded modules in a DMP module.
@@ -60,6 +62,8 @@ class IDTransformerGroup:
             transformer_config: configuration for the transformer. Default is `{"type": "naive"}`
             parallel: Whether the IDTransformerCollections will run paralell. When set to True,
                 IDTransformerGroup will start a thread for each IDTransformerCollection.
+            pin: whether to keep the ids of each transformed batch from eviction until
+                `release`, see `IDTransformerCollection`.
 
         Example:
             class Model(nn.Module):
@@ -103,7 +107,7 @@ class IDTransformerGroup:
                 path, sharded_module, params_plan, url, ps_config
             )
             id_transformer_collection = IDTransformerCollection(
-                configs, eviction_config, transform_config, ps_collection
+                configs, eviction_config, transform_config, ps_collection, pin
             )
             self._id_transformer_collections[path] = id_transformer_collection
 
@@ -156,6 +160,49 @@ class IDTransformerGroup:
                 fetch_handles.extend(handles)
         return result, fetch_handles
 
+    def release(self):
+        """
+        Release the earliest batch transformed, once it is no longer needed by the
+        training. Only needed if the group is created with `pin=True`.
+        """
+        for id_transformer_collection in self._id_transformer_collections.values():
+            id_transformer_collection.release()
+
+    def preload(
+        self,
+        ranked_ids: Dict[str, Dict[str, torch.Tensor]],
+        progress: Callable[[int, int], None] = None,
+    ):
+        """
+        Warm start the dynamic embeddings with their hottest ids before training,
+        e.g. those of `ranked` of a previous run. The rows of all the modules
+        are fetched in parallel.
+
+        Args:
+            ranked_ids: dict keyed by module path of the ranked ids of the tables,
+                see `IDTransformerCollection.preload`.
+            progress: called with the number of ids loaded and the number of all
+                the ids, see `PreloadHandles.wait`.
+        """
+        handles = []
+        for path, ids in ranked_ids.items():
+            if path not in self._id_transformer_collections:
+                raise ValueError(
+                    f"ranked_ids contain invalid path {path}. "
+                    f"should be one of {self._id_transformer_collections.keys()}"
+                )
+            handles.append(self._id_transformer_collections[path].preload(ids))
+        PreloadHandles(handles).wait(progress)
+
+    def ranked(self, num: int = -1) -> Dict[str, Dict[str, torch.Tensor]]:
+        """
+        The `num` hottest ids of each table, keyed by module path and table name.
+        """
+        return {
+            path: collection.ranked(num)
+            for path, collection in self._id_transformer_collections.items()
+        }
+
     def save(self):
         for _, id_transformer_collection in self._id_transformer_collections.items():
             id_transformer_collection.save()
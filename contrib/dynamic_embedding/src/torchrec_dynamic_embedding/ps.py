@@ -1,3 +1,4 @@
+import json
 import os
 from typing import Callable, Dict, List, Tuple, Union
 
@@ -21,6 +22,57 @@ __all__ = ["PS", "PSCollection"]
 DEFAULT_PS_CHUNK_SIZE = 8 * 1024 * 1024
 
 
+class _Handles:
+    """
+    Handles of the PS tables of all the column slices.
+    """
+
+    def __init__(self, handles):
+        self._handles = handles
+
+    def wait(self):
+        for handle in self._handles:
+            handle.wait()
+
+
+class PreloadHandles:
+    """
+    Progress of the preloads of PS tables, see `PS.preload`. The handles are
+    those of the PS tables, or other `PreloadHandles`, whose handles are merged.
+    """
+
+    def __init__(self, handles):
+        self._handles = []
+        for handle in handles:
+            if isinstance(handle, PreloadHandles):
+                self._handles.extend(handle._handles)
+            else:
+                self._handles.append(handle)
+
+    def num_ids(self) -> int:
+        return sum(handle.num_ids() for handle in self._handles)
+
+    def num_loaded(self) -> int:
+        return sum(handle.num_loaded() for handle in self._handles)
+
+    def wait(self, progress: Callable[[int, int], None] = None, interval: float = 1):
+        """
+        Wait until the rows of all the ids are in place. If `progress` is set, it
+        is called with the number of ids loaded and the number of all the ids
+        every `interval` seconds, and at the end.
+        """
+        timeout_ms = int(interval * 1000) if progress is not None else -1
+        for handle in self._handles:
+            while not handle.wait(timeout_ms):
+                progress(self.num_loaded(), self.num_ids())
+        if progress is not None:
+            progress(self.num_loaded(), self.num_ids())
+
+
+def _merge_handles(handles):
+    return handles[0] if len(handles) == 1 else _Handles(handles)
+
+
 class PS:
     def __init__(
         self,
@@ -28,33 +80,73 @@ class PS:
         tensors: Union[List[torch.Tensor], List[ShardedTensor]],
         url: str,
         chunk_size: str,
+        config=None,
     ):
         """
         PS table of an embedding table.
 
+        For column-wise and table-wise-row-wise sharded tables, every column slice
+        of the local shards is fetched and evicted on its own, keyed by its first
+        column, so each rank only moves the columns it holds.
+
         Args:
             table_name: name of the table.
             tensors: tensors of the table, the first one is the parameter tensor, others are
                 tenors of optimizers, e.g. for Adam, it will be [weight, m, v].
             url: url of the PS.
+            chunk_size: size of data in one chunk when fetching or evicting.
+            config: other configs of the PS, e.g. `{"evict_depth": 4}` for the number of
+                chunks in flight during eviction, or `{"encoding": "fp16"}` to store
+                the rows as fp16. The supported encodings are fp32, fp16, bf16 and int8.
+                `{"victim_cache_size": 4096}` keeps up to 4096 rows evicted by
+                `evict_async` in host memory, so that they are not written back if
+                fetched again soon. A synchronous `evict` flushes the victim cache.
+                `{"max_inflight_bytes": 1 << 30, "max_inflight_requests": 64}` limits
+                the IO in flight. Requests over the limits are deferred, fetches of
+                the current step first, then prefetches, then write-backs. Set
+                `{"block_on_budget": True}` to block instead.
+                `{"target_chunk_latency_us": 20000}` adapts the size of the eviction
+                chunks toward 20ms per push, within `min_chunk_size` and
+                `max_chunk_size`, in the unit of `chunk_size`.
+                `{"negative_filter_ids": 10**8}` keeps a bloom filter of the ids ever
+                evicted, sized for 10**8 ids, and does not fetch the ids not in it.
+                It is stored in the PS with each eviction. If no filter is stored,
+                e.g., the table was created without it, every id is fetched, unless
+                `{"negative_filter_new_table": True}` tells that the table has no
+                rows yet. It is not supported for row-wise sharded tables, whose
+                rows are evicted by several ranks.
         """
-        shards = torch.classes.tde.LocalShardList()
+        # The local shards grouped by columns, each column slice has its own
+        # PS table, keyed by (col_start, col_size).
+        column_slices = {}
         num_optimizer_stats = len(tensors)
         if isinstance(tensors[0], ShardedTensor):
             # Here we assume the shard metadata of optimizer state and weight are the same.
             for i, shard in enumerate(tensors[0].local_shards()):
                 local_tensors = [tensor.local_shards()[i].tensor for tensor in tensors]
+                row_start, col_start = shard.metadata.shard_offsets
+                row_size, col_size = shard.metadata.shard_sizes
+                if (
+                    config is not None
+                    and config.get("negative_filter_ids", 0) != 0
+                    and row_size != tensors[0].size(0)
+                ):
+                    raise ValueError(
+                        f"negative_filter_ids is not supported for the row-wise "
+                        f"sharded table {table_name}"
+                    )
+                shards = column_slices.setdefault(
+                    (col_start, col_size), torch.classes.tde.LocalShardList()
+                )
                 shards.append(
-                    shard.metadata.shard_offsets[0],
-                    shard.metadata.shard_offsets[1],
-                    shard.metadata.shard_sizes[0],
-                    shard.metadata.shard_sizes[1],
+                    row_start,
+                    col_start,
+                    row_size,
+                    col_size,
                     TensorList(local_tensors).tensor_list,
                 )
-                # This assumes all shard have the same column size.
-                col_size = shard.tensor.shape[1]
         elif isinstance(tensors[0], torch.Tensor):
-            tensors
+            shards = torch.classes.tde.LocalShardList()
             shards.append(
                 0,
                 0,
@@ -62,16 +154,40 @@ class PS:
                 tensors[0].shape[1],
                 TensorList(tensors).tensor_list,
             )
-            col_size = tensors[0].shape[1]
-        self._ps = torch.classes.tde.PS(
-            table_name, shards, col_size, num_optimizer_stats, url, chunk_size
-        )
+            column_slices[(0, tensors[0].shape[1])] = shards
+        if config is None:
+            config = {}
+        self._col_starts = [col_start for col_start, _ in column_slices]
+        self._ps = [
+            torch.classes.tde.PS(
+                table_name,
+                shards,
+                col_size,
+                num_optimizer_stats,
+                url,
+                chunk_size,
+                json.dumps(config),
+            )
+            for (_, col_size), shards in column_slices.items()
+        ]
 
     def evict(self, ids_to_evict: torch.Tensor):
         """
         Evict the `ids_to_evict` to PS.
         """
-        self._ps.evict(ids_to_evict)
+        for ps in self._ps:
+            ps.evict(ids_to_evict)
+
+    def evict_async(self, ids_to_evict: torch.Tensor):
+        """
+        Evict the `ids_to_evict` to PS in the background. The rows of the ids
+        could be overwritten once this method returns.
+
+        Return:
+            handle to wait for the eviction, `torch.classes.tde.EvictHandle` if the
+            local shards have only one column slice.
+        """
+        return _merge_handles([ps.evict_async(ids_to_evict) for ps in self._ps])
 
     def fetch(
         self,
@@ -85,10 +201,52 @@ class PS:
         Fetch `ids_to_fetch` from tensor. If `reinit` is set to `True`, will
         reinitialize the embedding if the global id is not in PS.
         """
-        return self._ps.fetch(
-            ids_to_fetch, time, reinit, weight_init_max, weight_init_min
+        return _merge_handles(
+            [
+                ps.fetch(ids_to_fetch, time, reinit, weight_init_max, weight_init_min)
+                for ps in self._ps
+            ]
+        )
+
+    def preload(
+        self,
+        ids_to_fetch: torch.Tensor,
+        time: int = 0,
+        reinit: bool = False,
+        weight_init_min: float = 0,
+        weight_init_max: float = 0,
+    ) -> PreloadHandles:
+        """
+        Fetch `ids_to_fetch` before training, e.g. the ids of
+        `IDTransformer.preload`, as fetches of step `time`. All the chunks are
+        fetched in parallel, see `PreloadHandles` for the progress.
+        """
+        return PreloadHandles(
+            [
+                ps.preload(
+                    ids_to_fetch, time, reinit, weight_init_min, weight_init_max
+                )
+                for ps in self._ps
+            ]
         )
 
+    def stats(self) -> Dict[str, float]:
+        """
+        Metrics of the PS table and its IO, e.g. `ps.<table>.wait_us.p99` for the
+        time spent waiting for fetches, or `io.<schema>.<table>.missing_rate`. See
+        `PS::Stats` and `IO::Stats` for all the metrics.
+
+        With several column slices, the keys of each slice are prefixed by
+        `col<col_start>.`.
+        """
+        if len(self._ps) == 1:
+            return dict(self._ps[0].stats())
+        stats = {}
+        for col_start, ps in zip(self._col_starts, self._ps):
+            for key, value in ps.stats().items():
+                stats[f"col{col_start}.{key}"] = value
+        return stats
+
 
 class PSCollection:
     """
@@ -107,20 +265,40 @@ class PSCollection:
             path: module path.
             plan: dict keyed by table name of ParameterSharding and tensor of the table.
             url: configuration for PS, e.g. redis://127.0.0.1:6379/?prefix=model.
-            ps_config: config of the PS, currently only support setting chunk size.
+                The ids are sharded over several redis endpoints by consistent
+                hashing, e.g. `redis://10.0.0.1:6379,10.0.0.2:6379/?prefix=model`.
+                `layout=2` packs all the optimizer states of an id into one redis
+                value, and `layout=2&&migrate=1` also reads the ids of layout 1.
+                `async=1&&connections=4&&max_outstanding=8` pipelines the chunks
+                over several async connections per io thread.
+                `chunk_latency=5ms` adapts `chunk_size` toward 5ms per chunk, within
+                `min_chunk_size` and `max_chunk_size`.
+                The replicas of an endpoint follow its host, e.g.
+                `redis://10.0.0.1:6379+10.0.0.11:6379/?hedge_percentile=95`, and
+                the pull chunks slower than the 95th percentile of the recent ones
+                are fetched again from them; the pushes only go to the primary.
+                Several PS can be stacked as tiers by `tiered://`, e.g.
+                `tiered://?write_back=1|memory://?cap=8G|redis://127.0.0.1:6379/`,
+                where pulls read through the tiers and promote the rows found below.
+                A memory tier above the last one must have a `cap`, beyond which it
+                drops its oldest rows.
+                `record://path|url` records the traffic to `url` in a trace, which
+                can be replayed by `torchrec_dynamic_embedding.replay`.
+            ps_config: config of the PS, e.g. `{"chunk_size": 1024, "evict_depth": 4}`.
+                `chunk_size` is the size of data in one chunk, other configs are passed
+                to `PS`.
         """
         self._path = path
         self._ps_collection = {}
-        chunk_size = DEFAULT_PS_CHUNK_SIZE
-        if ps_config is not None and "chunk_size" in ps_config:
-            chunk_size = ps_config["chunk_size"]
+        ps_config = dict(ps_config) if ps_config is not None else {}
+        chunk_size = ps_config.pop("chunk_size", DEFAULT_PS_CHUNK_SIZE)
         for table_name, (param_plan, tensor) in plan.items():
             if isinstance(url, str):
                 table_config = url
             else:
                 table_config = url(table_name)
             self._ps_collection[table_name] = PS(
-                f"{path}.{table_name}", tensor, table_config, chunk_size
+                f"{path}.{table_name}", tensor, table_config, chunk_size, ps_config
             )
 
     def table_names(self):
@@ -129,6 +307,15 @@ class PSCollection:
     def __getitem__(self, table_name):
         return self._ps_collection[table_name]
 
+    def stats(self) -> Dict[str, float]:
+        """
+        Metrics of all the PS tables, see `PS.stats`.
+        """
+        stats = {}
+        for ps in self._ps_collection.values():
+            stats.update(ps.stats())
+        return stats
+
     @staticmethod
     def fromModule(path, sharded_module, params_plan, url, ps_config=None):
         """
@@ -139,7 +326,7 @@ class PSCollection:
             sharded_module: the sharded module.
             params_plan: the sharding plan of `sharded_module`.
             url: configuration for PS, e.g. redis://127.0.0.1:6379/?prefix=model.
-            ps_config: config of the PS, currently only support setting chunk size.
+            ps_config: config of the PS, see `PSCollection`.
 
         Return:
             PSCollection of the sharded module.
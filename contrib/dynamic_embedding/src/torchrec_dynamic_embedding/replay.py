@@ -0,0 +1,69 @@
+"""
+Replay the PS traffic recorded by `record://` against any IO, e.g.
+
+    python -m torchrec_dynamic_embedding.replay /tmp/ps.trace \
+        "redis://127.0.0.1:6379/?chunk_size=256" --max-speed
+
+which compares the IO settings without GPUs or trainers.
+"""
+import argparse
+from typing import Dict, List, Optional
+
+import torch
+
+from . import ps  # noqa: F401, loads tde_cpp.so
+
+
+__all__ = ["replay"]
+
+
+def replay(
+    trace: str,
+    url: str,
+    max_speed: bool = False,
+    max_in_flight: int = 64,
+    plugins: Optional[List[str]] = None,
+) -> Dict[str, float]:
+    """
+    Replay the pulls and pushes of a trace against the IO of `url`.
+
+    Args:
+        trace: path of the trace, recorded by `record://path|url`.
+        url: configuration of the IO to replay against, e.g. `memory://`.
+        max_speed: issue the requests as fast as possible instead of at the
+            recorded pace.
+        max_in_flight: max number of requests in flight.
+        plugins: IO plugins to register before the replay.
+
+    Return:
+        metrics of the replay, e.g. `requests_per_s`, `bytes_per_s`,
+        `pull_latency_us.p99` and `recorded_pull_latency_us.p99`.
+    """
+    for plugin in plugins or []:
+        torch.ops.tde.register_io(plugin)
+    return torch.ops.tde.replay(trace, url, not max_speed, max_in_flight)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("trace", help="path of the trace")
+    parser.add_argument("url", help="configuration of the IO to replay against")
+    parser.add_argument(
+        "--max-speed",
+        action="store_true",
+        help="issue the requests as fast as possible",
+    )
+    parser.add_argument("--max-in-flight", type=int, default=64)
+    parser.add_argument(
+        "--plugin", action="append", default=[], help="path of an IO plugin"
+    )
+    args = parser.parse_args()
+    stats = replay(
+        args.trace, args.url, args.max_speed, args.max_in_flight, args.plugin
+    )
+    for key in sorted(stats.keys()):
+        print(f"{key}: {stats[key]:.3f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -126,3 +126,88 @@ class TestIDTransformer(unittest.TestCase):
         for global_id, cache_id in id_pairs:
             self.assertTrue(global_id in id_dict)
             self.assertEqual(cache_id, id_dict[global_id])
+
+    def testPreload(self):
+        num_embedding = 3
+        transformer = IDTransformer(
+            num_embedding,
+            transform_config={
+                "type": "naive",
+            },
+        )
+        global_ids = torch.tensor([10, 11, 12, 13], dtype=torch.long)
+        freq_powers = torch.tensor([20, 7, 9, 8], dtype=torch.long)
+        result = transformer.preload(global_ids, freq_powers)
+        # the last id does not fit.
+        self.assertFalse(result.success)
+        self.assertEqual(
+            sorted(result.ids_to_fetch.tolist()), [[10, 0], [11, 1], [12, 2]]
+        )
+        self.assertEqual(transformer.ranked().tolist(), [[10, 20], [12, 9], [11, 7]])
+        self.assertEqual(transformer.ranked(1).tolist(), [[10, 20]])
+
+    def testPin(self):
+        num_embedding = 9
+        transformer = IDTransformer(
+            num_embedding,
+            transform_config={
+                "type": "naive",
+            },
+            pin=True,
+        )
+        global_ids = torch.tensor([1, 2, 3, 4], dtype=torch.long)
+        cache_ids = torch.empty_like(global_ids)
+        result = transformer.transform(
+            TensorList([global_ids]), TensorList([cache_ids]), 0
+        )
+        self.assertTrue(result.success)
+
+        global_ids = torch.tensor([1, 3, 5, 7], dtype=torch.long)
+        result = transformer.transform(
+            TensorList([global_ids]), TensorList([cache_ids]), 1
+        )
+        self.assertTrue(result.success)
+
+        # all the ids are pinned by the batches in flight.
+        self.assertEqual(transformer.evict(4).shape[0], 0)
+
+        # 1 and 3 are still pinned by the batch of time 1.
+        transformer.release(0)
+        evicted_ids = sorted(transformer.evict(4).tolist())
+        self.assertEqual(evicted_ids, [[2, 1], [4, 3]])
+
+        transformer.release(1)
+        self.assertEqual(transformer.evict(4).shape[0], 4)
+
+    def testResume(self):
+        num_embedding = 4
+        transformer = IDTransformer(
+            num_embedding,
+            transform_config={
+                "type": "naive",
+            },
+        )
+        global_ids = [
+            torch.tensor([1, 2, 3], dtype=torch.long),
+            torch.tensor([4, 2, 5, 6, 5], dtype=torch.long),
+        ]
+        cache_ids = [torch.full_like(ids, -1) for ids in global_ids]
+        result = transformer.transform(TensorList(global_ids), TensorList(cache_ids), 0)
+        # 5 does not fit, 5 and 6 need cache ids.
+        self.assertFalse(result.success)
+        self.assertEqual(result.num_transformed, 5)
+        self.assertEqual(result.num_to_evict, 2)
+        self.assertEqual(result.ids_to_fetch.shape[0], 4)
+
+        # The ids transformed are kept from eviction.
+        self.assertEqual(transformer.evict(1).shape[0], 0)
+
+        result = transformer.transform(
+            TensorList([torch.tensor([7, 8], dtype=torch.long)]),
+            TensorList([torch.empty((2,), dtype=torch.long)]),
+            1,
+        )
+        self.assertFalse(result.success)
+        # The failed batch is given up, its ids can be evicted now.
+        evicted_ids = transformer.evict_at_least(result.num_to_evict).tolist()
+        self.assertEqual(len(evicted_ids), 3)
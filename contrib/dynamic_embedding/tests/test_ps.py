@@ -1,7 +1,11 @@
+import os
+import tempfile
 import unittest
 
 import torch
 from torchrec_dynamic_embedding.ps import PS
+from torchrec_dynamic_embedding.replay import replay
+from torchrec_dynamic_embedding.tensor_list import TensorList
 from utils import register_memory_io
 
 
@@ -20,6 +24,123 @@ class TestPS(unittest.TestCase):
         ps.fetch(ids, 0).wait()
         self.assertTrue(torch.allclose(tensor[cache_ids], origin_tensor[cache_ids]))
 
+    def testPipelinedEvict(self):
+        num_ids = 100
+        cache_ids = list(range(num_ids))
+        ids = torch.tensor([[1000 + i, i] for i in cache_ids], dtype=torch.long)
+        tensor = torch.rand((num_ids, 4))
+        origin_tensor = tensor.clone()
+        # 8 ids per chunk, at most 3 chunks in flight.
+        ps = PS("table", [tensor], "memory://", 32, {"evict_depth": 3})
+        ps.evict(ids)
+        tensor[:, :] = 0
+        ps.fetch(ids, 0).wait()
+        self.assertTrue(torch.allclose(tensor, origin_tensor))
+
+    def testIOBudget(self):
+        num_ids = 100
+        cache_ids = list(range(num_ids))
+        ids = torch.tensor([[1000 + i, i] for i in cache_ids], dtype=torch.long)
+        for block in [False, True]:
+            tensor = torch.rand((num_ids, 4))
+            origin_tensor = tensor.clone()
+            # 8 ids per chunk, only one request in flight.
+            ps = PS(
+                "table",
+                [tensor],
+                "memory://",
+                32,
+                {"max_inflight_requests": 1, "block_on_budget": block},
+            )
+            ps.evict_async(ids)
+            ps.evict(ids[:0])
+            tensor[:, :] = 0
+            handles = [ps.fetch(ids[i : i + 10], i) for i in range(0, num_ids, 10)]
+            for handle in handles:
+                handle.wait()
+            self.assertTrue(torch.allclose(tensor, origin_tensor))
+
+    def testEncoding(self):
+        num_ids = 20
+        cache_ids = list(range(num_ids))
+        ids = torch.tensor([[1000 + i, i] for i in cache_ids], dtype=torch.long)
+        for encoding, atol in [
+            ("fp32", 0),
+            ("fp16", 1e-3),
+            ("bf16", 1e-2),
+            ("int8", 1e-2),
+        ]:
+            tensor = torch.rand((num_ids, 16))
+            origin_tensor = tensor.clone()
+            ps = PS(
+                f"table_{encoding}",
+                [tensor],
+                "memory://",
+                1024,
+                {"encoding": encoding},
+            )
+            ps.evict(ids)
+            tensor[:, :] = 0
+            ps.fetch(ids, 0).wait()
+            self.assertTrue(torch.allclose(tensor, origin_tensor, atol=atol))
+
+    def testColumnWise(self):
+        cache_ids = [0, 2, 4, 8]
+        ids = torch.tensor([[100, 0], [101, 2], [102, 4], [103, 8]], dtype=torch.long)
+        tensor = torch.rand((10, 8))
+        origin_tensor = tensor.clone()
+        # two ranks holding the column slices [0, 4) and [4, 8).
+        column_tensors = [tensor[:, :4].clone(), tensor[:, 4:].clone()]
+        for col_start, column_tensor in zip([0, 4], column_tensors):
+            shards = torch.classes.tde.LocalShardList()
+            shards.append(0, col_start, 10, 4, TensorList([column_tensor]).tensor_list)
+            ps = torch.classes.tde.PS("table", shards, 4, 1, "memory://", 1024, "{}")
+            ps.evict(ids)
+            column_tensor[:, :] = 0
+        # fetching the second slice gets the columns [4, 8).
+        ps.fetch(ids, 0, False, 0, 0).wait()
+        self.assertTrue(
+            torch.allclose(column_tensors[1][cache_ids], origin_tensor[cache_ids, 4:])
+        )
+
+    def testEvictAsync(self):
+        cache_ids = [0, 2, 4, 8]
+        ids = torch.tensor([[100, 0], [101, 2], [102, 4], [103, 8]], dtype=torch.long)
+        tensor = torch.rand((10, 4))
+        origin_tensor = tensor.clone()
+        ps = PS("table", [tensor], "memory://", 1024)
+        handle = ps.evict_async(ids)
+        # the rows could be overwritten before the eviction finishes.
+        tensor[:, :] = 0
+        new_cache_ids = [1, 3, 5, 7]
+        fetch_ids = torch.tensor(
+            [[100, 1], [101, 3], [102, 5], [103, 7]], dtype=torch.long
+        )
+        ps.fetch(fetch_ids, 0).wait()
+        handle.wait()
+        self.assertTrue(torch.allclose(tensor[new_cache_ids], origin_tensor[cache_ids]))
+
+    def testVictimCache(self):
+        num_ids = 8
+        cache_ids = list(range(num_ids))
+        ids = torch.tensor([[1000 + i, i] for i in cache_ids], dtype=torch.long)
+        tensor = torch.rand((num_ids, 4))
+        origin_tensor = tensor.clone()
+        # half of the rows stay in the victim cache.
+        ps = PS("table", [tensor], "memory://", 1024, {"victim_cache_size": 4})
+        ps.evict_async(ids).wait()
+        tensor[:, :] = 0
+        ps.fetch(ids, 0).wait()
+        self.assertTrue(torch.allclose(tensor, origin_tensor))
+
+        # the rows taken from the victim cache are evicted again, and the
+        # synchronous eviction writes all of them back.
+        ps.evict_async(ids).wait()
+        ps.evict(ids[:0])
+        tensor[:, :] = 0
+        ps.fetch(ids, 0).wait()
+        self.assertTrue(torch.allclose(tensor, origin_tensor))
+
     def testOS(self):
         cache_ids = [1, 3, 6]
         ids = torch.tensor([[100, 1], [101, 3], [102, 6]], dtype=torch.long)
@@ -76,5 +197,167 @@ class TestPS(unittest.TestCase):
         )
 
 
+    def testNegativeFilter(self):
+        cache_ids = [0, 2, 4]
+        evict_ids = torch.tensor([[100, 0], [101, 2], [102, 4]], dtype=torch.long)
+        tensor = torch.rand((10, 4))
+        origin_tensor = tensor.clone()
+        config = {"negative_filter_ids": 1024, "negative_filter_new_table": True}
+        ps = PS("table", [tensor], "memory://", 1024, config)
+        ps.evict(evict_ids)
+        tensor[:, :] = 0
+        addition_cache_ids = [3, 9]
+        additional_fetch_ids = torch.tensor([[103, 3], [104, 9]], dtype=torch.long)
+        ps.fetch(torch.cat([evict_ids, additional_fetch_ids]), 0, True, 1, 2).wait()
+        self.assertTrue(torch.allclose(tensor[cache_ids], origin_tensor[cache_ids]))
+        # the ids never evicted are reinitialized without pulling them.
+        self.assertTrue(torch.all(tensor[addition_cache_ids] >= 1))
+        stats = ps.stats()
+        self.assertEqual(stats["ps.table.negative_filter.num_skipped_ids"], 2)
+        self.assertEqual(stats["io.memory.table.num_pulled_rows"], 3)
+        self.assertEqual(stats["io.memory.table.num_missing_rows"], 0)
+
+    def testNegativeFilterEvictAsync(self):
+        cache_ids = [0, 2, 4]
+        evict_ids = torch.tensor([[100, 0], [101, 2], [102, 4]], dtype=torch.long)
+        tensor = torch.rand((10, 4))
+        origin_tensor = tensor.clone()
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            config = {"negative_filter_ids": 1024, "negative_filter_new_table": True}
+            ps = PS("table", [tensor], f"file://{tmp_dir}", 1024, config)
+            ps.evict_async(evict_ids).wait()
+            del ps
+            tensor[:, :] = 0
+            # restart from the filter stored by the eviction.
+            config = {"negative_filter_ids": 1024}
+            ps = PS("table", [tensor], f"file://{tmp_dir}", 1024, config)
+            ps.fetch(evict_ids, 0, True, 1, 2).wait()
+            self.assertTrue(torch.allclose(tensor[cache_ids], origin_tensor[cache_ids]))
+            stats = ps.stats()
+            self.assertEqual(stats["ps.table.negative_filter.num_skipped_ids"], 0)
+
+    def testNegativeFilterNotStored(self):
+        cache_ids = [0, 2, 4]
+        evict_ids = torch.tensor([[100, 0], [101, 2], [102, 4]], dtype=torch.long)
+        tensor = torch.rand((10, 4))
+        origin_tensor = tensor.clone()
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            # the rows are pushed without the filter.
+            ps = PS("table", [tensor], f"file://{tmp_dir}", 1024)
+            ps.evict(evict_ids)
+            del ps
+            tensor[:, :] = 0
+            ps = PS(
+                "table",
+                [tensor],
+                f"file://{tmp_dir}",
+                1024,
+                {"negative_filter_ids": 1024},
+            )
+            ps.fetch(evict_ids, 0, True, 1, 2).wait()
+            self.assertTrue(torch.allclose(tensor[cache_ids], origin_tensor[cache_ids]))
+            self.assertNotIn("ps.table.negative_filter.num_skipped_ids", ps.stats())
+
+    def testPreload(self):
+        num_ids = 100
+        cache_ids = list(range(num_ids))
+        ids = torch.tensor([[1000 + i, i] for i in cache_ids], dtype=torch.long)
+        tensor = torch.rand((num_ids, 4))
+        origin_tensor = tensor.clone()
+        # 8 ids per chunk.
+        ps = PS("table", [tensor], "memory://", 32)
+        ps.evict(ids)
+        tensor[:, :] = 0
+        handles = ps.preload(ids)
+        progress = []
+        handles.wait(lambda loaded, total: progress.append((loaded, total)))
+        self.assertTrue(torch.allclose(tensor, origin_tensor))
+        self.assertEqual(progress[-1], (num_ids, num_ids))
+        self.assertEqual(handles.num_loaded(), num_ids)
+
+        # A preload during training joins the fetches of its step.
+        fetch_handle = ps.fetch(ids, 1)
+        with self.assertRaises(RuntimeError):
+            ps.preload(ids, 0)
+        ps.preload(ids, 1).wait()
+        fetch_handle.wait()
+        self.assertTrue(torch.allclose(tensor, origin_tensor))
+
+    def testTiered(self):
+        cache_ids = [0, 2, 4, 8]
+        ids = torch.tensor([[100, 0], [101, 2], [102, 4], [103, 8]], dtype=torch.long)
+        for url in [
+            "tiered://memory://?cap=1G|memory://",
+            "tiered://?write_back=1|memory://?cap=1G|memory://",
+        ]:
+            tensor = torch.rand((10, 4))
+            origin_tensor = tensor.clone()
+            ps = PS("table", [tensor], url, 1024)
+            ps.evict(ids)
+            tensor[:, :] = 0
+            ps.fetch(ids, 0).wait()
+            self.assertTrue(torch.allclose(tensor[cache_ids], origin_tensor[cache_ids]))
+
+    def testStats(self):
+        evict_ids = torch.tensor([[100, 0], [101, 2], [102, 4]], dtype=torch.long)
+        fetch_ids = torch.tensor(
+            [[100, 0], [101, 2], [102, 4], [103, 3], [104, 9]], dtype=torch.long
+        )
+        tensor = torch.rand((10, 4))
+        ps = PS("table", [tensor], "memory://", 1024)
+        ps.evict(evict_ids)
+        ps.fetch(fetch_ids, 0).wait()
+        stats = ps.stats()
+        self.assertEqual(stats["io.memory.table.num_pushed_rows"], 3)
+        self.assertEqual(stats["io.memory.table.num_pulled_rows"], 5)
+        self.assertEqual(stats["io.memory.table.num_missing_rows"], 2)
+        self.assertEqual(stats["io.memory.table.pulled_bytes"], 3 * 4 * 4)
+        self.assertEqual(stats["io.memory.table.pull_latency_us.count"], 1)
+        self.assertEqual(stats["ps.table.evict_us.count"], 1)
+        self.assertEqual(stats["ps.table.wait_us.count"], 1)
+        self.assertGreaterEqual(
+            stats["ps.table.filter_us.max"], stats["ps.table.filter_us.p50"]
+        )
+
+    def testAdaptiveChunk(self):
+        num_ids = 100
+        cache_ids = list(range(num_ids))
+        ids = torch.tensor([[1000 + i, i] for i in cache_ids], dtype=torch.long)
+        tensor = torch.rand((num_ids, 4))
+        origin_tensor = tensor.clone()
+        # Starts from 8 ids per chunk, and every push is within the target.
+        ps = PS(
+            "table",
+            [tensor],
+            "memory://",
+            32,
+            {"target_chunk_latency_us": 10**7, "max_chunk_size": 64},
+        )
+        ps.evict(ids)
+        tensor[:, :] = 0
+        ps.fetch(ids, 0).wait()
+        self.assertTrue(torch.allclose(tensor, origin_tensor))
+        stats = ps.stats()
+        # Grows by one id per push, up to 16 ids.
+        self.assertGreater(stats["ps.table.evict_chunk.size"], 8)
+        self.assertLessEqual(stats["ps.table.evict_chunk.size"], 16)
+        self.assertGreater(stats["ps.table.evict_chunk.num_increases"], 0)
+        self.assertEqual(stats["ps.table.evict_chunk.num_decreases"], 0)
+
+    def testRecordReplay(self):
+        ids = torch.tensor([[100, 0], [101, 2], [102, 4]], dtype=torch.long)
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            trace = os.path.join(tmp_dir, "ps.trace")
+            tensor = torch.rand((10, 4))
+            ps = PS("table", [tensor], f"record://{trace}|memory://", 1024)
+            ps.evict(ids)
+            ps.fetch(ids, 0).wait()
+            stats = replay(trace, "memory://", max_speed=True)
+            self.assertEqual(stats["num_pushes"], 1)
+            self.assertEqual(stats["num_pulls"], 1)
+            self.assertEqual(stats["pulled_rows"], 3)
+            self.assertEqual(stats["pulled_bytes"], 3 * 4 * 4)
+
+
 if __name__ == "__main__":
     unittest.main()
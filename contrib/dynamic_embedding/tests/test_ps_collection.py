@@ -7,6 +7,7 @@ import torch.nn as nn
 from torchrec import EmbeddingCollection, EmbeddingConfig, KeyedJaggedTensor
 from torchrec.distributed.model_parallel import DistributedModelParallel as DMP
 from torchrec_dynamic_embedding.id_transformer_collection import IDTransformerCollection
+from torchrec_dynamic_embedding.id_transformer_group import IDTransformerGroup
 from torchrec_dynamic_embedding.ps import PSCollection
 from torchrec_dynamic_embedding.utils import _get_sharded_modules_recursive
 from utils import init_dist, register_memory_io
@@ -172,6 +173,90 @@ class TestPSCollection(unittest.TestCase):
             )
         )
 
+    def testPreload(self):
+        init_dist()
+        rank = dist.get_rank()
+        device = torch.device(f"cuda:{rank}")
+        torch.cuda.set_device(device)
+
+        configs = [
+            EmbeddingConfig(
+                name="AB", num_embeddings=4, embedding_dim=8, feature_names=["A", "B"]
+            ),
+        ]
+        model = EmbeddingCollection(tables=configs, device=torch.device("meta"))
+        model = DMP(module=model, device=device)
+
+        plan = model.plan
+        sharded_modules = _get_sharded_modules_recursive(model.module, "", plan)
+        sharded_module, params_plan = sharded_modules[""]
+        ps_collection = PSCollection.fromModule(
+            "", sharded_module, params_plan, "memory://"
+        )
+        transformer_collection = IDTransformerCollection(
+            configs, ps_collection=ps_collection
+        )
+
+        handles = transformer_collection.preload({"AB": torch.tensor([10, 11, 12])})
+        progress = []
+        handles.wait(lambda loaded, total: progress.append((loaded, total)))
+        self.assertEqual(progress[-1], (3, 3))
+        handles.wait()
+
+        # The preloaded ids are cached.
+        global_kjt = KeyedJaggedTensor(
+            keys=["A", "B"],
+            values=torch.tensor([12, 10, 11]),
+            lengths=torch.tensor([3, 0]),
+        )
+        cache_kjt, fetch_handles = transformer_collection.transform(global_kjt)
+        for handle in fetch_handles:
+            handle.wait()
+        self.assertEqual(sorted(cache_kjt.values().tolist()), [0, 1, 2])
+
+    def testGroupPreload(self):
+        init_dist()
+        rank = dist.get_rank()
+        device = torch.device(f"cuda:{rank}")
+        torch.cuda.set_device(device)
+
+        class Model(nn.Module):
+            def __init__(self, configs):
+                super().__init__()
+                self.emb = EmbeddingCollection(
+                    tables=configs, device=torch.device("meta")
+                )
+
+            def forward(self, x):
+                return self.emb(x)
+
+        configs = [
+            EmbeddingConfig(name="A", num_embeddings=4, embedding_dim=8),
+            EmbeddingConfig(name="B", num_embeddings=4, embedding_dim=8),
+        ]
+        model = DMP(module=Model(configs), device=device)
+        transformer = IDTransformerGroup("memory://", model, {"emb": configs})
+
+        progress = []
+        transformer.preload(
+            {"emb": {"A": torch.tensor([10, 11]), "B": torch.tensor([20])}},
+            lambda loaded, total: progress.append((loaded, total)),
+        )
+        self.assertEqual(progress[-1], (3, 3))
+        # Without progress.
+        transformer.preload({"emb": {"B": torch.tensor([21])}})
+
+        global_kjt = KeyedJaggedTensor(
+            keys=["A", "B"],
+            values=torch.tensor([11, 10, 21, 20]),
+            lengths=torch.tensor([2, 2]),
+        )
+        kjts, fetch_handles = transformer.transform({"emb": global_kjt})
+        for handle in fetch_handles:
+            handle.wait()
+        self.assertEqual(sorted(kjts["emb"].values().tolist()[:2]), [0, 1])
+        self.assertEqual(sorted(kjts["emb"].values().tolist()[2:]), [0, 1])
+
 
 if __name__ == "__main__":
     unittest.main()